@@ -76,10 +76,21 @@ typedef struct api_file_upload {
 	file_type_t allowed_files; /**< Bitor of all allowed files */
 } api_file_upload_t;
 
+/**
+ * @brief Decides whether a requester without a session receives a new one.
+ */
+typedef enum api_session_policy {
+	API_SESSION_DEFAULT, /**< Uses API_SESSION_DEFERRED if deferred is set in session cookie config, otherwise API_SESSION_REQUIRED. */
+	API_SESSION_NONE, /**< Never creates a session. An existing cookie is still verified. */
+	API_SESSION_DEFERRED, /**< Creates a session only after api_endpoint_store_session() was called. */
+	API_SESSION_REQUIRED /**< Every requester without a session receives a new one. */
+} api_session_policy_t;
+
 /**
  * @brief Contains a connection to the database. Received by \ref pgdb_connection_queue_t
  */
 typedef struct api_endpoint {
+	arena_t* arena; /**< Holds endpoint, request log, its strings and a stateless account. Reset by api_endpoint_free(), NULL if endpoint was allocated on the heap. */
 	pgdb_connection_t* conn; /**< Connection to database claimed from queue. Must be released when no longer in use */
 	json_t* json_body; /**< Loaded and parsed http body. */
 	auth_request_log_t* request_log; /**< Log which helps monitoring API. */
@@ -88,27 +99,68 @@ typedef struct api_endpoint {
 	bool authenticated;
 	auth_account_t* account; /**< User accessing api. */
 	bool refresh_cookie; /**< If requester already has a cookie, but a new one with account linked to it has to be created, set to true. */
+	api_session_policy_t session_policy; /**< Resolved by api_callback_endpoint_init(), API_SESSION_DEFAULT behaves like API_SESSION_REQUIRED. */
+	bool store_session; /**< Set by api_endpoint_store_session(), creates a session even if policy is API_SESSION_DEFERRED. */
 
 	api_file_upload_t* file_upload;
 } api_endpoint_t;
 
 /**
  * @brief Initializes endoint and tries to claim a connection to the database. If it fails, it ends the callback chain.
+ * Same as api_callback_endpoint_prepare() followed by api_callback_endpoint_claim_connection().
  */
 int api_callback_endpoint_init(const struct _u_request* request, struct _u_response * response, void * user_data);
 
+/**
+ * @brief Sets policy of endpoint. API_SESSION_DEFAULT keeps the one chosen by api_callback_endpoint_init().
+ */
+void api_endpoint_set_session_policy(api_endpoint_t* endpoint, const api_session_policy_t policy);
+
+/**
+ * @brief Marks that state has to be stored for requester, so a session is created at response time
+ * even if policy is API_SESSION_DEFERRED. Has no effect with API_SESSION_NONE.
+ */
+void api_endpoint_store_session(api_endpoint_t* endpoint);
+
+/**
+ * @brief Sets session policy of endpoint to API_SESSION_NONE.
+ */
+int api_callback_endpoint_session_none(const struct _u_request* request, struct _u_response * response, void * user_data);
+
+/**
+ * @brief Sets session policy of endpoint to API_SESSION_DEFERRED.
+ */
+int api_callback_endpoint_session_deferred(const struct _u_request* request, struct _u_response * response, void * user_data);
+
+/**
+ * @brief Sets session policy of endpoint to API_SESSION_REQUIRED.
+ */
+int api_callback_endpoint_session_required(const struct _u_request* request, struct _u_response * response, void * user_data);
+
+/**
+ * @brief Creates endpoint and its request log from an arena of the current thread, but does not claim a connection yet.
+ */
+int api_callback_endpoint_prepare(const struct _u_request* request, struct _u_response * response, void * user_data);
+
+/**
+ * @brief Claims a connection to the database, if endpoint does not have one yet. If it fails, it ends the callback chain.
+ */
+int api_callback_endpoint_claim_connection(const struct _u_request* request, struct _u_response * response, void * user_data);
+
 /**
  * @brief Loads body json, if it fails, cancels the callback chain.
  */
 int api_callback_endpoint_load_json_body(const struct _u_request* request, struct _u_response * response, void * user_data);
 
 /**
- * @brief If ip is blacklisted, terminates request. 
+ * @brief If ip is blacklisted, terminates request. Claims a connection only if the in memory blacklist
+ * is disabled or ip was found.
  */
 int api_auth_callback_check_blacklist(const struct _u_request * request, struct _u_response * response, void * user_data);
 
 /**
- * @brief Checks if ip has typical malicious behaviour
+ * @brief Checks if ip has typical malicious behaviour. Claims a connection only if the in memory rate
+ * limiter is disabled or ip has to be banned.
  *
  * @todo implement properly 
  */
@@ -129,6 +181,17 @@ int api_callback_endpoint_check_for_authentication(const struct _u_request* requ
  */
 int api_callback_endpoint_check_for_verified_email(const struct _u_request* request, struct _u_response * response, void * user_data);
 
+/**
+ * @brief Replaces endpoint->account with the full row from database, if it came from a stateless
+ * cookie which only carries uuid, role and verified. If role or verification changed since the
+ * cookie was issued, a new cookie is sent.
+ *
+ * @param endpoint Authenticated endpoint.
+ *
+ * @returns Returns 0 on success, 1 if account could not be loaded.
+ */
+int api_endpoint_load_account(api_endpoint_t* endpoint);
+
 /**
  * @brief Logs request with given internal_status to database.
  *
@@ -173,7 +236,8 @@ json_t* api_response_object_ok();
 int api_default_options_callback(const struct _u_request * request, struct _u_response * response, void * user_data);
 
 /**
- * @brief Cleans up and endpoint and releases its connection.
+ * @brief Cleans up and endpoint and releases its connection. If endpoint came from an arena, the arena
+ * is reset and handed back to its thread, so endpoint must not be used afterwards.
  *
  * @param endpoint Pointer to endpoint data.
  *
@@ -181,7 +245,79 @@ int api_default_options_callback(const struct _u_request * request, struct _u_re
 void api_endpoint_free(api_endpoint_t* endpoint);
 
 /**
- * @brief Adds endpoint to instance.
+ * @brief Signature shared by ulfius callbacks and route stages.
+ */
+typedef int (* api_callback_t)(const struct _u_request * request, struct _u_response * response, void * user_data);
+
+/**
+ * @brief Max amount of stages of a route.
+ */
+#define API_ROUTE_MAX_STAGES 10
+
+/**
+ * @brief Bits passed to api_add_route().
+ */
+typedef enum api_route_flags {
+	API_ROUTE_AUTHENTICATED = 1 << 0, /**< Only authenticated requesters may use route. */
+	API_ROUTE_VERIFIED = 1 << 1, /**< Only requesters with a verified email may use route. */
+	API_ROUTE_JSON_BODY = 1 << 2, /**< Loads json body and responds with an error if there is none. */
+	API_ROUTE_SESSION_NONE = 1 << 3, /**< Sets session policy to API_SESSION_NONE. */
+	API_ROUTE_SESSION_DEFERRED = 1 << 4, /**< Sets session policy to API_SESSION_DEFERRED. */
+	API_ROUTE_SESSION_REQUIRED = 1 << 5 /**< Sets session policy to API_SESSION_REQUIRED. */
+} api_route_flags_t;
+
+/**
+ * @brief Stages of a single url and method, run by one ulfius callback until one of them does not
+ * return U_CALLBACK_CONTINUE. Every stage receives the api instance as user_data.
+ *
+ * @see api_add_route()
+ */
+typedef struct api_route {
+	api_instance_t* instance; /**< Passed as user_data to every stage. */
+	size_t stage_count; /**< Amount of used stages. */
+	api_callback_t stages[API_ROUTE_MAX_STAGES]; /**< Checks in order, handler of route is the last one. */
+	struct api_route* next; /**< Next route of same instance. */
+} api_route_t;
+
+/**
+ * @brief Builds stages of a route. Blacklist and rate limiter run before a connection is claimed,
+ * the json body is only loaded once the session and authentication checks passed.
+ *
+ * @param callback_function Handler of route.
+ * @param api_instance Instance passed to stages.
+ * @param flags Bitor of api_route_flags_t.
+ *
+ * @returns Returns new route.
+ */
+api_route_t* api_route_new(api_callback_t callback_function, api_instance_t* api_instance, const unsigned int flags);
+
+/**
+ * @brief Frees route and every route linked behind it.
+ *
+ * @param route Double pointer to route. Will be set to NULL.
+ */
+void api_route_free(api_route_t** route);
+
+/**
+ * @brief Runs stages of route given as user_data.
+ */
+int api_callback_route(const struct _u_request * request, struct _u_response * response, void * user_data);
+
+/**
+ * @brief Adds route to instance using a single ulfius callback for all of its checks, plus the default OPTIONS callback.
+ * Route is freed together with api_instance.
+ *
+ * @param instance Ulfius Library instance
+ * @param method HTTP method to bind to route
+ * @param url URL of route
+ * @param callback_function Handler of route.
+ * @param api_instance Instance containing global properties.
+ * @param flags Bitor of api_route_flags_t.
+ */
+void api_add_route(struct _u_instance* instance, const char* method, const char* url, api_callback_t callback_function, api_instance_t* api_instance, const unsigned int flags);
+
+/**
+ * @brief Adds endpoint to instance. Same as api_add_route() with the matching flags.
  *
  * @param instance Ulfius Library instance
  * @param method HTTP method to bind to endpoint
@@ -196,6 +332,18 @@ void api_add_endpoint(struct _u_instance* instance, const char* method, const ch
                                                          struct _u_response * response,     // Output parameters (set by the user)
                                                          void * user_data), api_instance_t* api_instance, bool authenticated, bool verified, bool jsonBody);
 
+/**
+ * @brief Same as api_add_endpoint(), but lets endpoint declare whether it needs a session.
+ *
+ * @param policy API_SESSION_NONE for endpoints which never store state like health checks,
+ * API_SESSION_DEFERRED for endpoints which only sometimes do and call api_endpoint_store_session(),
+ * API_SESSION_REQUIRED if every requester needs a session and API_SESSION_DEFAULT to use session
+ * cookie config.
+ */
+void api_add_endpoint_with_session_policy(struct _u_instance* instance, const char* method, const char* url, int (* callback_function)(const struct _u_request * request,
+                                                         struct _u_response * response,
+                                                         void * user_data), api_instance_t* api_instance, bool authenticated, bool verified, bool jsonBody, const api_session_policy_t policy);
+
 /**
  * @brief If rollback fails, resets connection so that open transaction wont be
  * transfered to next person.
@@ -87,7 +87,9 @@ typedef enum internal_errors {
 	ERROR_SAVING_BLACKLIST,
 	ERROR_SAVE_BLACKLIST_ACCESS,
 	ERROR_SAVING_FILE,
-	ERROR_WRITING_FILE
+	ERROR_WRITING_FILE,
+	ERROR_HASHING_BUSY,
+	ERROR_ACCOUNT_LOOKUP
 } internal_errors_t;
 
 const char* internal_errors_msg(int code, const char* (*custom_error_msgs)(int));
@@ -34,6 +34,12 @@
 #include <ulfius.h>
 
 #include "radicle/pgdb.h"
+#include "radicle/auth/access_log.h"
+#include "radicle/auth/session_cache.h"
+#include "radicle/auth/blacklist.h"
+#include "radicle/auth/rate_limiter.h"
+#include "radicle/auth/hash_pool.h"
+#include "radicle/auth/revocation_list.h"
 #include "radicle/api/mail/sendgrid.h"
 
 #if defined(__cplusplus)
@@ -48,6 +54,8 @@ typedef struct api_cookie_config {
 	bool http_only; /**< If true, cookie will not be accessible by js. */
 	int max_age; /**< Max age of session cookie. */
 	int same_site; /**< One of U_COOKIE_SAME_SITE_STRICT, U_COOKIE_SAME_SITE_LAX, U_COOKIE_SAME_SITE_NONE. */ 
+	bool compact; /**< If true, new sessions get compact cookies with a binary token instead of the 301 chars long classic ones. */
+	bool deferred; /**< If true, anonymous requesters only receive a session once an endpoint has to store state for them. */
 } api_cookie_config_t;
 
 /**
@@ -62,6 +70,24 @@ api_cookie_config_t* api_cookie_config_copy(const api_cookie_config_t* original)
  */
 void api_cookie_config_free(api_cookie_config_t** cookie_config);
 
+/**
+ * @brief Settings for asynchronous access logging. Loaded from optional key access_log.
+ */
+typedef struct api_access_log_config {
+	bool enabled; /**< If false, accesses are written synchronously by the request thread. */
+	int capacity; /**< Amount of accesses which can be queued. */
+	int batch_size; /**< Amount of accesses written with a single COPY. */
+	int flush_interval_in_ms; /**< Max time an access stays queued. */
+	auth_access_log_policy_t policy; /**< Behaviour if queue is full. */
+} api_access_log_config_t;
+
+/**
+ * @brief Frees access log config.
+ *
+ * @param access_log Double pointer to config.
+ */
+void api_access_log_config_free(api_access_log_config_t** access_log);
+
 /**
  * @brief Container for configuration which will be loaded from file on start up.
  */
@@ -81,6 +107,24 @@ typedef struct api_instance {
 	string_t* default_access_control_allow_methods;
 	string_t* default_access_control_allow_headers;
 	api_cookie_config_t* session_cookie;
+	api_access_log_config_t* access_log; /**< Settings for access_logger. */
+	auth_access_logger_t* access_logger; /**< If set, accesses are logged in background. Started by api_setup_instance(). */
+	int session_cache_capacity; /**< Max amount of cached sessions, 0 disables cache. */
+	time_t session_cache_ttl_in_s; /**< Time in seconds a cached session is trusted without asking the database. */
+	auth_session_cache_t* session_cache; /**< Verified session cookies. Created by api_setup_instance(). */
+	int blacklist_refresh_interval_in_s; /**< Time between polls for new bans, 0 disables in memory blacklist. */
+	auth_blacklist_t* blacklist; /**< Banned ips. Loaded by api_setup_instance(). */
+	int rate_limiter_capacity; /**< Max amount of ips counted in memory, 0 counts SessionAccesses rows instead. */
+	auth_rate_limiter_t* rate_limiter; /**< Counts requests per ip using the max_session_accesses_* settings. Created by api_setup_instance(). */
+	int hash_pool_workers; /**< Max amount of passwords hashed at once, 0 hashes on request thread. */
+	int hash_pool_queue_depth; /**< Max amount of hashes waiting for a worker before requests get a 503. */
+	int hash_pool_memory_budget_in_mib; /**< Max memory all concurrent hashes may use, caps amount of workers. */
+	auth_password_params_t password_params; /**< Argon2 settings for new hashes. */
+	int password_calibration_target_in_ms; /**< If positive, password_params are tuned to this hash duration on start up. */
+	auth_hash_pool_t* hash_pool; /**< Runs argon2 for sign in, register and password reset. Created by api_setup_instance(). */
+	bool stateless_sessions; /**< If true, new session cookies carry their own session data and are verified without the database. */
+	int revocation_refresh_interval_in_s; /**< Time between reloads of revoked sessions, 0 asks the database for every stateless cookie. */
+	auth_revocation_list_t* revocations; /**< Revoked sessions and deactivated accounts. Loaded by api_setup_instance(). */
 	sendgrid_instance_t* sendgrid; /**< SendGrdi values like API key and tempalte ids; */
 	string_t* verification_url; /**< URL which will be used for verifying registraiton codes. */
 	string_t* verification_reroute_url; /**< URL to which users will be rerouted after completing verification. */
@@ -92,6 +136,7 @@ typedef struct api_instance {
 	time_t max_session_accesses_penalty_in_s; /**< Amount of time ip will be banned. */
 	string_t* root_files_folder; /**< All files will be written to this path */
 	const char* (* custom_errors_msg)(int code); /**< This function will be called for every code after 10000, if code does not exist, return a string and not null. **/
+	struct api_route* routes; /**< Routes added by api_add_route(), freed together with instance. */
 	void* custom;
 } api_instance_t;
 
@@ -37,6 +37,7 @@ extern "C" {
 
 /**
  * @brief Validates that key is given in object and checks that minLength and maxLength are correct.
+ * Length is counted in bytes over the whole value. Values containing line breaks are rejected.
  *
  * @param object JSON object.
  * @param key Key of value to check.
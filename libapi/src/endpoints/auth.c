@@ -44,11 +44,12 @@ int api_auth_callback_register(const struct _u_request * request, struct _u_resp
 
 	if(duplicate_account != NULL) {
 		auth_account_free(&duplicate_account);
-		// fake hash to minimize difference of response times
-		string_t* fake_pw_buffer = NULL;
-		if(auth_hash_password(endpoint->account->password, &fake_pw_buffer))
-			DEBUG("Failed to fake hash password.\n");
-		string_free(&fake_pw_buffer);
+		// fake verify to minimize difference of response times
+		if(auth_hash_pool_verify_dummy(instance->hash_pool, endpoint->account->password) == AUTH_HASH_POOL_BUSY) {
+			// Same response as for a new account, otherwise it would tell the email is taken.
+			api_endpoint_safe_rollback(request, response, instance);
+			return RESPOND(503, "Service is currently unavailable, please try again later.", ERROR_HASHING_BUSY);
+		}
 
 		if(send_duplicate_mail_notify(instance->sendgrid, endpoint->account->email))
 			api_endpoint_log(request, instance, endpoint, 0, ERROR_SEND_MAIL_DUPLICATE_REGISTER_NOTIFY);
@@ -57,8 +58,11 @@ int api_auth_callback_register(const struct _u_request * request, struct _u_resp
 		return RESPOND(200, "A verification email has been sent to your email.", DUPLICATE_EMAIL_REGISTER);
 	}
 
-	if(auth_register(endpoint->conn->connection, endpoint->account)) {
+	auth_errors_t error = auth_register_pooled(endpoint->conn->connection, instance->hash_pool, endpoint->account);
+	if(error) {
 		api_endpoint_safe_rollback(request, response, instance);
+		if(error == AUTH_BUSY)
+			return RESPOND(503, "Service is currently unavailable, please try again later.", ERROR_HASHING_BUSY);
 		return RESPOND(500, DEFAULT_500_MSG, ERROR_REGISTER);
 	}
 
@@ -86,6 +90,9 @@ int api_auth_callback_resend_verification_mail(const struct _u_request * request
 	api_instance_t* instance = user_data;
 	api_endpoint_t* endpoint = response->shared_data;
 
+	if(api_endpoint_load_account(endpoint))
+		return RESPOND(500, DEFAULT_500_MSG, ERROR_ACCOUNT_LOOKUP);
+
 	if(endpoint->account->verified)
 		return RESPOND(400, "Your mail has already been verified!", VALIDATION_EMAIL_ALREADY_VERIFIED);
 
@@ -157,10 +164,14 @@ int api_auth_callback_register_verify(const struct _u_request * request, struct
 	}
 
 	if(pgdb_transaction_commit(endpoint->conn->connection)) {
+		uuid_free(&owner);
 		api_endpoint_safe_rollback(request, response, instance);
 		return RESPOND(500, DEFAULT_500_MSG, ERROR_TRANSACTION_COMMIT);
 	}
 
+	if(instance->session_cache != NULL)
+		auth_session_cache_remove_account(instance->session_cache, owner);
+	uuid_free(&owner);
 
 	char location_url[instance->verification_reroute_url->length + 15];
 	sprintf(location_url, "%s?verified=true", instance->verification_reroute_url->ptr);
@@ -183,9 +194,12 @@ int api_auth_callback_sign_in(const struct _u_request * request, struct _u_respo
 		return RESPOND(422, "Please supply a password.", VALIDATION_INVALID_PASSWORD);
 	}
 
-	if(auth_sign_in(endpoint->conn->connection, email, password, &endpoint->account)) {
+	auth_errors_t error = auth_sign_in_pooled(endpoint->conn->connection, instance->hash_pool, email, password, &endpoint->account);
+	if(error) {
 		string_free(&email);
 		string_free(&password);
+		if(error == AUTH_BUSY)
+			return RESPOND(503, "Service is currently unavailable, please try again later.", ERROR_HASHING_BUSY);
 		return RESPOND(401, "There is no account matching your username and password combination.", INVALID_USER_CREDENTIALS);
 	}
 
@@ -210,6 +224,10 @@ int api_auth_callback_send_password_reset(const struct _u_request * request, str
 
 	/* Checks if authenticated user email is same as requested one */
 	if(endpoint->authenticated) {
+		if(api_endpoint_load_account(endpoint)) {
+			string_free(&email);
+			return RESPOND(500, DEFAULT_500_MSG, ERROR_ACCOUNT_LOOKUP);
+		}
 		if(strcmp(endpoint->account->email->ptr, email->ptr) != 0) {
 			string_free(&email);
 			return RESPOND(403, "Not allowed to request password reset for this account.", VALIDATION_UNAUTHORIZED);
@@ -278,9 +296,6 @@ int api_auth_callback_reset_password(const struct _u_request * request, struct _
 	/* Fetched from database */ 
 	uuid_t* uuid = NULL;
 
-	/* Created after token was validated */
-	string_t* password_hashed = NULL;
-
 	if(api_json_validate_password(endpoint->json_body, "password", &password))
 		return RESPOND(422, "Password either missing or not complex enough.", VALIDATION_INVALID_PASSWORD);
 
@@ -310,30 +325,26 @@ int api_auth_callback_reset_password(const struct _u_request * request, struct _
 		return RESPOND(400, "Invalid token.", INVALID_TOKEN_TYPE);
 	}
 
-	if(auth_hash_password(password, &password_hashed)) {
-		string_free(&password);	
-		uuid_free(&uuid);
-		api_endpoint_safe_rollback(request, response, instance);
-		return RESPOND(500, DEFAULT_500_MSG, ERROR_UPDATING_PASSWORD);
-	}
-
+	auth_errors_t error = auth_update_password_pooled(endpoint->conn->connection, instance->hash_pool, uuid, password);
 	string_free(&password);
-
-	if(auth_update_password(endpoint->conn->connection, uuid, password_hashed)) {
-		string_free(&password);
+	if(error) {
 		uuid_free(&uuid);
 		api_endpoint_safe_rollback(request, response, instance);
+		if(error == AUTH_BUSY)
+			return RESPOND(503, "Service is currently unavailable, please try again later.", ERROR_HASHING_BUSY);
 		return RESPOND(500, DEFAULT_500_MSG, ERROR_UPDATING_PASSWORD);
 	}
 
-	string_free(&password_hashed);
-	uuid_free(&uuid);
-
 	if(pgdb_transaction_commit(endpoint->conn->connection)) {
+		uuid_free(&uuid);
 		api_endpoint_safe_rollback(request, response, instance);
 		return RESPOND(500, DEFAULT_500_MSG, ERROR_TRANSACTION_COMMIT);
 	}
 
+	if(instance->session_cache != NULL)
+		auth_session_cache_remove_account(instance->session_cache, uuid);
+	uuid_free(&uuid);
+
 	return RESPOND(200, DEFAULT_200_MSG, SUCCESS);
 }
 
@@ -341,6 +352,9 @@ int api_auth_callback_cookie_info(const struct _u_request * request, struct _u_r
 	api_instance_t* instance = user_data;
 	api_endpoint_t* endpoint = response->shared_data;
 
+	if(api_endpoint_load_account(endpoint))
+		return RESPOND(500, DEFAULT_500_MSG, ERROR_ACCOUNT_LOOKUP);
+
 	json_t* body = api_response_object_ok();
 	json_object_set(body, "email", json_stringn(endpoint->account->email->ptr, endpoint->account->email->length));
 	json_object_set(body, "verified", json_boolean(endpoint->account->verified));
@@ -425,13 +439,17 @@ int api_auth_callback_verify_new_email(const struct _u_request * request, struct
 		return RESPOND(500, DEFAULT_500_MSG, ERROR_UPDATING_ACCOUNT_EMAIL);
 	}
 
-	uuid_free(&owner);
 	string_free(&new_email);
 	if(pgdb_transaction_commit(endpoint->conn->connection)) {
+		uuid_free(&owner);
 		api_endpoint_safe_rollback(request, response, instance);
 		return RESPOND(500, DEFAULT_500_MSG, ERROR_VERIFYING_TOKEN);
 	}
 
+	if(instance->session_cache != NULL)
+		auth_session_cache_remove_account(instance->session_cache, owner);
+	uuid_free(&owner);
+
 	return RESPOND(200, DEFAULT_200_MSG, SUCCESS);
 }
 
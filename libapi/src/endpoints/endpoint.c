@@ -12,14 +12,19 @@
 #include <ulfius.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "radicle/auth.h"
 #include "radicle/auth/db.h"
 #include "radicle/auth/types.h"
+#include "radicle/auth/blacklist.h"
+#include "radicle/auth/rate_limiter.h"
+#include "radicle/auth/stateless_session.h"
 #include "radicle/pgdb.h"
 #include "radicle/print.h"
 #include "radicle/api/endpoints/endpoint.h"
 #include "radicle/api/instance.h"
+#include "radicle/types/arena.h"
 #include "radicle/types/string.h"
 #include "radicle/api/endpoints/internal_codes.h"
 #include "radicle/types/uuid.h"
@@ -54,44 +59,97 @@ int api_map_get_string(const struct _u_map* map, const char* key, string_t** res
 }
 
 
-int socket_info(const struct sockaddr* address, string_t** buffer, unsigned int* port) {
-	*buffer = calloc(1, sizeof(string_t));
-	(*buffer)->length = NI_MAXHOST;
-	(*buffer)->ptr = calloc(NI_MAXHOST, sizeof(char));
+int socket_info(arena_t* arena, const struct sockaddr* address, string_t** buffer, unsigned int* port) {
+	char host[NI_MAXHOST] = {0};
+	int error = 0;
 
-	if (getnameinfo(address, sizeof(*address), (*buffer)->ptr, NI_MAXHOST, NULL, 0, NI_NUMERICHOST)) {
+	if (getnameinfo(address, sizeof(*address), host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST)) {
 		ERROR("Failed to translate ip.\n");
+		error = 1;
 	} 
 
-	/* This line is needed for pgdb as it would try to insert 0x00 into the
+	/* Length is needed for pgdb as it would try to insert 0x00 into the
 	 * database otherwise */
-	(*buffer)->length = strnlen((*buffer)->ptr, NI_MAXHOST);
-
+	*buffer = string_new_arena(arena, host, strnlen(host, NI_MAXHOST));
 	*port = ((struct sockaddr_in*)address)->sin_port;
-	return 0;
+	return error;
 }
 
-int api_callback_endpoint_init(const struct _u_request * request, struct _u_response * response, void * user_data) {
+/**
+ * @brief Initial size of request arenas. Fits endpoint, request log, cookie and account.
+ */
+#define API_ENDPOINT_ARENA_SIZE 4096
 
-	
-                
+static pthread_key_t api_endpoint_arena_key;
+static pthread_once_t api_endpoint_arena_once = PTHREAD_ONCE_INIT;
+
+static void api_endpoint_arena_destroy(void* data) {
+	arena_t* arena = data;
+	arena_free(&arena);
+}
+
+static void api_endpoint_arena_key_create() {
+	pthread_key_create(&api_endpoint_arena_key, api_endpoint_arena_destroy);
+}
+
+/**
+ * @brief Takes idle arena of current thread, so steady traffic does not allocate at all.
+ * A new one is created if thread has none or its arena is still used by another endpoint.
+ */
+static arena_t* api_endpoint_arena_claim() {
+	pthread_once(&api_endpoint_arena_once, api_endpoint_arena_key_create);
+	arena_t* arena = pthread_getspecific(api_endpoint_arena_key);
+	if(arena != NULL) {
+		pthread_setspecific(api_endpoint_arena_key, NULL);
+		return arena;
+	}
+	return arena_new(API_ENDPOINT_ARENA_SIZE);
+}
+
+static void api_endpoint_arena_release(arena_t* arena) {
+	arena_reset(arena);
+	if(pthread_getspecific(api_endpoint_arena_key) == NULL)
+		pthread_setspecific(api_endpoint_arena_key, arena);
+	else
+		arena_free(&arena);
+}
+
+int api_callback_endpoint_prepare(const struct _u_request * request, struct _u_response * response, void * user_data) {
 	if(user_data == NULL) {
 		DEBUG("Missing user_data for %s.\n", request->http_url);
 		return U_CALLBACK_ERROR;
 	}
 	api_instance_t* instance = (api_instance_t*)user_data;
-	api_endpoint_t* endpoint = calloc(1, sizeof(api_endpoint_t));
 
-	endpoint->request_log = auth_request_log_new();
+	arena_t* arena = api_endpoint_arena_claim();
+	if(arena == NULL) {
+		ERROR("Failed to create arena for %s.\n", request->http_url);
+		return U_CALLBACK_ERROR;
+	}
+
+	// First chunk is large enough, so these cannot fail.
+	api_endpoint_t* endpoint = arena_alloc(arena, sizeof(api_endpoint_t));
+	endpoint->arena = arena;
+	endpoint->request_log = auth_request_log_new_arena(arena);
 	endpoint->request_log->date = time(NULL);
 
-	if(socket_info(request->client_address, &endpoint->request_log->ip, &endpoint->request_log->port)) {
+	if(socket_info(arena, request->client_address, &endpoint->request_log->ip, &endpoint->request_log->port)) {
 		ERROR("Failed to convert ip to text.\n");
-		endpoint->request_log->ip = string_from_literal("?.?.?.?");
+		endpoint->request_log->ip = string_from_literal_arena(arena, "?.?.?.?");
 	}
-	endpoint->request_log->url = string_from_literal(request->url_path);
+	endpoint->request_log->url = string_from_literal_arena(arena, request->url_path);
+	endpoint->session_policy = instance->session_cookie->deferred ? API_SESSION_DEFERRED : API_SESSION_REQUIRED;
 
 	response->shared_data = endpoint;
+	return U_CALLBACK_CONTINUE;
+}
+
+int api_callback_endpoint_claim_connection(const struct _u_request * request, struct _u_response * response, void * user_data) {
+	api_instance_t* instance = user_data;
+	api_endpoint_t* endpoint = response->shared_data;
+
+	if(endpoint->conn != NULL)
+		return U_CALLBACK_CONTINUE;
 
 	if(pgdb_claim_connection(instance->queue, &endpoint->conn))
 		return RESPOND(503, "Service is currently unavailable, please try again later.", PGDB_UNABLE_TO_CLAIM);
@@ -103,6 +161,38 @@ int api_callback_endpoint_init(const struct _u_request * request, struct _u_resp
 	return U_CALLBACK_CONTINUE;
 }
 
+int api_callback_endpoint_init(const struct _u_request * request, struct _u_response * response, void * user_data) {
+	int result = api_callback_endpoint_prepare(request, response, user_data);
+	if(result != U_CALLBACK_CONTINUE)
+		return result;
+
+	return api_callback_endpoint_claim_connection(request, response, user_data);
+}
+
+void api_endpoint_set_session_policy(api_endpoint_t* endpoint, const api_session_policy_t policy) {
+	if(policy != API_SESSION_DEFAULT)
+		endpoint->session_policy = policy;
+}
+
+void api_endpoint_store_session(api_endpoint_t* endpoint) {
+	endpoint->store_session = true;
+}
+
+int api_callback_endpoint_session_none(const struct _u_request* request, struct _u_response * response, void * user_data) {
+	api_endpoint_set_session_policy(response->shared_data, API_SESSION_NONE);
+	return U_CALLBACK_CONTINUE;
+}
+
+int api_callback_endpoint_session_deferred(const struct _u_request* request, struct _u_response * response, void * user_data) {
+	api_endpoint_set_session_policy(response->shared_data, API_SESSION_DEFERRED);
+	return U_CALLBACK_CONTINUE;
+}
+
+int api_callback_endpoint_session_required(const struct _u_request* request, struct _u_response * response, void * user_data) {
+	api_endpoint_set_session_policy(response->shared_data, API_SESSION_REQUIRED);
+	return U_CALLBACK_CONTINUE;
+}
+
 int api_callback_endpoint_load_json_body(const struct _u_request* request, struct _u_response * response, void * user_data) {
 	api_endpoint_t* endpoint = response->shared_data;
 	if(request->binary_body_length == 0)
@@ -123,11 +213,22 @@ int api_auth_callback_check_blacklist(const struct _u_request * request, struct
 	api_instance_t* instance = user_data;
 	api_endpoint_t* endpoint = response->shared_data;
 
+	// In a route pipeline this runs before a connection is claimed, so only a hit or a missing
+	// in memory blacklist waits for one.
+	int result;
 	uint32_t blacklist_id;
-	if(auth_blacklist_lookup_ip(endpoint->conn->connection, endpoint->request_log->ip, &blacklist_id))
-		return RESPOND(500, DEFAULT_500_MSG, ERROR_BLACKLIST_LOOKUP);
+	if(instance->blacklist != NULL) {
+		blacklist_id = auth_blacklist_lookup(instance->blacklist, endpoint->request_log->ip);
+	} else {
+		if((result = api_callback_endpoint_claim_connection(request, response, user_data)) != U_CALLBACK_CONTINUE)
+			return result;
+		if(auth_blacklist_lookup_ip(endpoint->conn->connection, endpoint->request_log->ip, &blacklist_id))
+			return RESPOND(500, DEFAULT_500_MSG, ERROR_BLACKLIST_LOOKUP);
+	}
 
 	if(blacklist_id != 0) {
+		if((result = api_callback_endpoint_claim_connection(request, response, user_data)) != U_CALLBACK_CONTINUE)
+			return result;
 
 		if(auth_save_blacklist_access(endpoint->conn->connection, blacklist_id, time(NULL), endpoint->request_log->url)) {
 			DEBUG("Failed to insert blacklist access\n");
@@ -144,47 +245,54 @@ int api_auth_callback_check_blacklist(const struct _u_request * request, struct
 int api_auth_callback_check_ip_for_malicious_activity(const struct _u_request * request, struct _u_response * response, void * user_data) {
 	api_instance_t* instance = user_data;
 	api_endpoint_t* endpoint = response->shared_data;
-	
 
-	list_t* results = NULL;
-	if(auth_session_lookup_ip(endpoint->conn->connection, endpoint->request_log->ip, time(NULL) - instance->max_session_accesses_lookup_delta_in_s, &results)) {
-		return RESPOND(500, DEFAULT_500_MSG, ERROR_SESSION_ACCESS_LOOKUP);
-	}
+	int result;
+	int counter = 0;
+	if(instance->rate_limiter != NULL) {
+		if(auth_rate_limiter_hit(instance->rate_limiter, endpoint->request_log->ip))
+			counter = instance->max_session_accesses_in_lookup_delta;
+	} else {
+		if((result = api_callback_endpoint_claim_connection(request, response, user_data)) != U_CALLBACK_CONTINUE)
+			return result;
+
+		list_t* results = NULL;
+		if(auth_session_lookup_ip(endpoint->conn->connection, endpoint->request_log->ip, time(NULL) - instance->max_session_accesses_lookup_delta_in_s, &results)) {
+			return RESPOND(500, DEFAULT_500_MSG, ERROR_SESSION_ACCESS_LOOKUP);
+		}
 
-	/**
-	 * @todo this is currently very badly implemented, since this could
-	 * simply be done by a SQL count query.
-	 */
-	if(results != NULL) {
-		int counter = 0;
 		list_t* iter = results;
 		while(iter != NULL) {
-			auth_session_access_entry_t* entry = (auth_session_access_entry_t*)iter->data;
-			
 			/** @todo maybe check how many resopnsed were 500 or
 			 * whatever. */
-
 			counter++;
 			iter = iter->next;
 		} 
 
-		list_free(iter, &auth_session_access_entry_free);
+		list_free(results, &auth_session_access_entry_free);
+	}
 
-		if(counter >= instance->max_session_accesses_in_lookup_delta) {
-			uint32_t id;
-			if(auth_blacklist_ip(endpoint->conn->connection,
-					       	endpoint->request_log->ip, time(NULL),
-					       	time(NULL) + instance->max_session_accesses_penalty_in_s, &id)) {
-				return RESPOND(500, DEFAULT_500_MSG, ERROR_SAVING_BLACKLIST);
-			}
+	if(counter > 0 && counter >= instance->max_session_accesses_in_lookup_delta) {
+		if((result = api_callback_endpoint_claim_connection(request, response, user_data)) != U_CALLBACK_CONTINUE)
+			return result;
 
-			if(auth_save_blacklist_access(endpoint->conn->connection, id, time(NULL), endpoint->request_log->url)) {
-				return RESPOND(500, DEFAULT_500_MSG, ERROR_SAVE_BLACKLIST_ACCESS);
-			}
+		uint32_t id;
+		time_t ban_lift = time(NULL) + instance->max_session_accesses_penalty_in_s;
+		if(auth_blacklist_ip(endpoint->conn->connection,
+				       	endpoint->request_log->ip, time(NULL),
+				       	ban_lift, &id)) {
+			return RESPOND(500, DEFAULT_500_MSG, ERROR_SAVING_BLACKLIST);
+		}
 
-			return RESPOND(403, "Your ip has been blocked.", FORBIDDEN_BLACKLIST_IP);
+		if(instance->blacklist != NULL)
+			auth_blacklist_add(instance->blacklist, id, endpoint->request_log->ip, ban_lift);
+		if(instance->rate_limiter != NULL)
+			auth_rate_limiter_reset(instance->rate_limiter, endpoint->request_log->ip);
+
+		if(auth_save_blacklist_access(endpoint->conn->connection, id, time(NULL), endpoint->request_log->url)) {
+			return RESPOND(500, DEFAULT_500_MSG, ERROR_SAVE_BLACKLIST_ACCESS);
 		}
 
+		return RESPOND(403, "Your ip has been blocked.", FORBIDDEN_BLACKLIST_IP);
 	}
 
 	return U_CALLBACK_CONTINUE;
@@ -195,21 +303,24 @@ int api_callback_endpoint_check_for_session(const struct _u_request* request, st
 	api_endpoint_t* endpoint = response->shared_data;
 
 	if(u_map_has_key(request->map_cookie, "session-id")) {
-		string_t* cookie_raw = string_from_literal(u_map_get(request->map_cookie, "session-id"));
-		int error = auth_verify_cookie(endpoint->conn->connection, instance->signature_key, cookie_raw, &endpoint->session, &endpoint->account);
+		const char* cookie_c = u_map_get(request->map_cookie, "session-id");
+		string_t cookie_raw = { (char*) cookie_c, strlen(cookie_c) };
+		int error;
+		if(auth_stateless_session_is_cookie(&cookie_raw) && endpoint->arena != NULL)
+			error = auth_verify_stateless_cookie_arena(endpoint->conn->connection, endpoint->arena, instance->revocations, instance->signature_key, &cookie_raw, &endpoint->session, &endpoint->account);
+		else if(auth_stateless_session_is_cookie(&cookie_raw))
+			error = auth_verify_stateless_cookie(endpoint->conn->connection, instance->revocations, instance->signature_key, &cookie_raw, &endpoint->session, &endpoint->account);
+		else
+			error = auth_verify_cookie_cached(endpoint->conn->connection, instance->session_cache, instance->signature_key, &cookie_raw, &endpoint->session, &endpoint->account);
 		if(error == AUTH_ACCOUNT_NOT_ACTIVE) {
-			string_free(&cookie_raw);
 			return RESPOND(403, "Your account has been deactivated.", VALIDATION_ACCOUNT_DEACTIVATED);
 		} else if(error == AUTH_ERROR) {
-			string_free(&cookie_raw);
 			return RESPOND(500, "There is something wrong with your cookie.", VALIDATION_INVALID_COOKIE);
 		} else if(error) {
-			string_free(&cookie_raw);
 			return RESPOND(400, "Cookie is invalid.", VALIDATION_INVALID_COOKIE);
 		} else if(endpoint->account != NULL && error == AUTH_OK) {
 			endpoint->authenticated = true;
 		}
-		string_free(&cookie_raw);
 	}
 	return U_CALLBACK_CONTINUE;
 }
@@ -228,19 +339,53 @@ int api_callback_endpoint_check_for_verified_email(const struct _u_request* requ
 	api_instance_t* instance = user_data;
 	api_endpoint_t* endpoint = response->shared_data;
 
+	// Cookie may predate verification, so only the database can tell for sure.
+	if(endpoint->authenticated && !endpoint->account->verified && endpoint->account->email == NULL && api_endpoint_load_account(endpoint))
+		return RESPOND(500, DEFAULT_500_MSG, ERROR_ACCOUNT_LOOKUP);
+
 	if(!endpoint->authenticated || !endpoint->account->verified)
 		return RESPOND(401, "Authentication and verification required.", VALIDATION_NOT_AUTHENTICATED);
 
 	return U_CALLBACK_CONTINUE;
 }
 
+/**
+ * @brief Frees account of endpoint unless it lives in arena of endpoint.
+ */
+static void api_endpoint_free_account(api_endpoint_t* endpoint) {
+	if(arena_owns(endpoint->arena, endpoint->account))
+		endpoint->account = NULL;
+	else
+		auth_account_free(&endpoint->account);
+}
+
+int api_endpoint_load_account(api_endpoint_t* endpoint) {
+	if(endpoint->account == NULL || endpoint->account->email != NULL)
+		return 0;
+
+	auth_account_t* account = NULL;
+	if(auth_get_account_by_uuid(endpoint->conn->connection, endpoint->account->uuid, &account) || account == NULL)
+		return 1;
+
+	if(account->role != endpoint->account->role || account->verified != endpoint->account->verified)
+		endpoint->refresh_cookie = true;
+
+	api_endpoint_free_account(endpoint);
+	endpoint->account = account;
+	return 0;
+}
+
 int api_endpoint_log(const struct _u_request* request, api_instance_t* instance, api_endpoint_t* endpoint, const unsigned int http_status, const int internal_status) {
 	
 	endpoint->request_log->response_code = http_status;
 	endpoint->request_log->internal_status = internal_status;
 	auth_request_log_calculate_response_time(endpoint->request_log);
 		
-	if(endpoint->session != 0) {
+	if(endpoint->session != 0 && instance->access_logger != NULL) {
+		if(auth_access_logger_push(instance->access_logger, endpoint->session, endpoint->request_log)) {
+			INFO("%s:%d %d %d %s\n", endpoint->request_log->ip->ptr, endpoint->request_log->port, http_status, internal_status, internal_errors_msg(internal_status, instance->custom_errors_msg));
+		}
+	} else if(endpoint->session != 0) {
 		if(endpoint->conn != NULL && auth_log_access(endpoint->conn->connection, endpoint->session, endpoint->request_log)) {
 			INFO("%s:%d %d %d %s\n", endpoint->request_log->ip->ptr, endpoint->request_log->port, http_status, internal_status, internal_errors_msg(internal_status, instance->custom_errors_msg));
 		} else if(endpoint->conn == NULL)
@@ -252,15 +397,40 @@ int api_endpoint_log(const struct _u_request* request, api_instance_t* instance,
 	return 0;
 }
 
+/**
+ * @brief Decides whether requester without session receives a new one.
+ */
+static bool api_endpoint_needs_session(const api_endpoint_t* endpoint) {
+	switch(endpoint->session_policy) {
+		case API_SESSION_NONE:
+			return false;
+		case API_SESSION_DEFERRED:
+			return endpoint->store_session;
+		default:
+			return true;
+	}
+}
+
 /**
  * @brief If session id is already set, no new session will be created, otherwise, depending if endpoint->account is set, either
- * a owner or unowned session is created.
+ * a owner or unowned session is created. Anonymous requesters only receive one if the session policy of endpoint asks for it,
+ * a refreshed cookie after sign in is always sent.
  */
 int api_endpoint_manage_session(struct _u_response * response, api_instance_t* instance, api_endpoint_t* endpoint) {
 
-	if(endpoint->conn != NULL && endpoint->session == 0 || endpoint->refresh_cookie) {
+	if(endpoint->conn != NULL && ((endpoint->session == 0 && api_endpoint_needs_session(endpoint)) || endpoint->refresh_cookie)) {
 		auth_cookie_t* cookie = NULL;
-		if(!endpoint->authenticated && auth_make_free_session(endpoint->conn->connection, instance->signature_key, &cookie, &endpoint->session)) {
+		if(instance->stateless_sessions) {
+			if(auth_make_stateless_session(endpoint->conn->connection, endpoint->authenticated ? endpoint->account : NULL, instance->signature_key, &cookie, &endpoint->session)) {
+				ERROR("Unable to create stateless session.\n");
+				return 0;
+			}
+		} else if(instance->session_cookie->compact) {
+			if(auth_make_compact_session(endpoint->conn->connection, endpoint->authenticated ? endpoint->account->uuid : NULL, instance->signature_key, &cookie, &endpoint->session)) {
+				ERROR("Unable to create compact session.\n");
+				return 0;
+			}
+		} else if(!endpoint->authenticated && auth_make_free_session(endpoint->conn->connection, instance->signature_key, &cookie, &endpoint->session)) {
 			ERROR("Unable to create free session.\n");
 			/**
 			 * This error isnt as bad as the one below, since the
@@ -315,6 +485,7 @@ int api_endpoint_respond(const struct _u_request* request, struct _u_response *
 			api_request_log(request, endpoint->request_log, NULL, http_status);
 
 		api_endpoint_free(endpoint);
+		response->shared_data = NULL;
 	}
 
 	if(instance->mirror_origin) {
@@ -349,31 +520,100 @@ void api_endpoint_free(api_endpoint_t* endpoint) {
 	if(endpoint->json_body != NULL) {
 		json_decref(endpoint->json_body);
 	}
-	auth_account_free(&endpoint->account);
-	auth_request_log_free(&endpoint->request_log);
-	free(endpoint);
+	api_endpoint_free_account(endpoint);
+
+	// Endpoints created by tests or older callers live on the heap.
+	if(endpoint->arena == NULL) {
+		auth_request_log_free(&endpoint->request_log);
+		free(endpoint);
+		return;
+	}
+
+	api_endpoint_arena_release(endpoint->arena);
 }
 
-/** @todo instead of parameters use bit vars **/
 void api_add_endpoint(struct _u_instance* instance, const char* method, const char* url, int (* callback_function)(const struct _u_request * request, // Input parameters (set by the framework)
                                                          struct _u_response * response,     // Output parameters (set by the user)
                                                          void * user_data), api_instance_t* api_instance, bool authenticated, bool verified, bool jsonBody) {
-	ulfius_add_endpoint_by_val(instance, "OPTIONS", url, NULL, 0, &api_default_options_callback, api_instance);
+	api_add_endpoint_with_session_policy(instance, method, url, callback_function, api_instance, authenticated, verified, jsonBody, API_SESSION_DEFAULT);
+}
 
-	int counter = 0;
+void api_add_endpoint_with_session_policy(struct _u_instance* instance, const char* method, const char* url, int (* callback_function)(const struct _u_request * request,
+                                                         struct _u_response * response,
+                                                         void * user_data), api_instance_t* api_instance, bool authenticated, bool verified, bool jsonBody, const api_session_policy_t policy) {
+	unsigned int flags = 0;
+	if(authenticated)
+		flags |= API_ROUTE_AUTHENTICATED;
+	if(verified)
+		flags |= API_ROUTE_VERIFIED;
+	if(jsonBody)
+		flags |= API_ROUTE_JSON_BODY;
 
-	ulfius_add_endpoint_by_val(instance, method, url, NULL, counter++, &api_callback_endpoint_init, api_instance);
-	ulfius_add_endpoint_by_val(instance, method, url, NULL, counter++, &api_auth_callback_check_blacklist, api_instance);
-	ulfius_add_endpoint_by_val(instance, method, url, NULL, counter++, &api_auth_callback_check_ip_for_malicious_activity, api_instance);
-	ulfius_add_endpoint_by_val(instance, method, url, NULL, counter++, &api_callback_endpoint_check_for_session, api_instance);
-	if(authenticated && !verified)
-		ulfius_add_endpoint_by_val(instance, method, url, NULL, counter++, &api_callback_endpoint_check_for_authentication, api_instance);
-	else if(verified) 
-		ulfius_add_endpoint_by_val(instance, method, url, NULL, counter++, &api_callback_endpoint_check_for_verified_email, api_instance);
+	if(policy == API_SESSION_NONE)
+		flags |= API_ROUTE_SESSION_NONE;
+	else if(policy == API_SESSION_DEFERRED)
+		flags |= API_ROUTE_SESSION_DEFERRED;
+	else if(policy == API_SESSION_REQUIRED)
+		flags |= API_ROUTE_SESSION_REQUIRED;
 
-	if(jsonBody)
-		ulfius_add_endpoint_by_val(instance, method, url, NULL, counter++, &api_callback_endpoint_load_json_body, api_instance);
-	ulfius_add_endpoint_by_val(instance, method, url, NULL, counter++, callback_function, api_instance);
+	api_add_route(instance, method, url, callback_function, api_instance, flags);
+}
+
+api_route_t* api_route_new(api_callback_t callback_function, api_instance_t* api_instance, const unsigned int flags) {
+	api_route_t* route = calloc(1, sizeof(api_route_t));
+	route->instance = api_instance;
+
+	// In memory checks go first, so a blocked ip never waits for a connection.
+	route->stages[route->stage_count++] = &api_callback_endpoint_prepare;
+	if(flags & API_ROUTE_SESSION_NONE)
+		route->stages[route->stage_count++] = &api_callback_endpoint_session_none;
+	else if(flags & API_ROUTE_SESSION_DEFERRED)
+		route->stages[route->stage_count++] = &api_callback_endpoint_session_deferred;
+	else if(flags & API_ROUTE_SESSION_REQUIRED)
+		route->stages[route->stage_count++] = &api_callback_endpoint_session_required;
+	route->stages[route->stage_count++] = &api_auth_callback_check_blacklist;
+	route->stages[route->stage_count++] = &api_auth_callback_check_ip_for_malicious_activity;
+
+	route->stages[route->stage_count++] = &api_callback_endpoint_claim_connection;
+	route->stages[route->stage_count++] = &api_callback_endpoint_check_for_session;
+	if(flags & API_ROUTE_VERIFIED)
+		route->stages[route->stage_count++] = &api_callback_endpoint_check_for_verified_email;
+	else if(flags & API_ROUTE_AUTHENTICATED)
+		route->stages[route->stage_count++] = &api_callback_endpoint_check_for_authentication;
+	// Body is only parsed once the caller passed authentication, so anonymous callers still get 401.
+	if(flags & API_ROUTE_JSON_BODY)
+		route->stages[route->stage_count++] = &api_callback_endpoint_load_json_body;
+	route->stages[route->stage_count++] = callback_function;
+
+	return route;
+}
+
+void api_route_free(api_route_t** route) {
+	while(*route != NULL) {
+		api_route_t* next = (*route)->next;
+		free(*route);
+		*route = next;
+	}
+}
+
+int api_callback_route(const struct _u_request * request, struct _u_response * response, void * user_data) {
+	const api_route_t* route = user_data;
+
+	int result = U_CALLBACK_CONTINUE;
+	for(size_t i = 0; i < route->stage_count && result == U_CALLBACK_CONTINUE; i++)
+		result = route->stages[i](request, response, route->instance);
+
+	return result;
+}
+
+void api_add_route(struct _u_instance* instance, const char* method, const char* url, api_callback_t callback_function, api_instance_t* api_instance, const unsigned int flags) {
+	ulfius_add_endpoint_by_val(instance, "OPTIONS", url, NULL, 0, &api_default_options_callback, api_instance);
+
+	api_route_t* route = api_route_new(callback_function, api_instance, flags);
+	route->next = api_instance->routes;
+	api_instance->routes = route;
+
+	ulfius_add_endpoint_by_val(instance, method, url, NULL, 0, &api_callback_route, route);
 }
 
 void api_endpoint_safe_rollback(const struct _u_request* request, struct _u_response * response, api_instance_t* instance) {
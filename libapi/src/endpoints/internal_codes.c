@@ -97,6 +97,10 @@ const char* internal_errors_msg(int code, const char* (*custom_error_msgs)(int))
 			return "Failed to save file to database.";
 		case ERROR_WRITING_FILE:
 			return "Failed to write file to disc.";
+		case ERROR_HASHING_BUSY:
+			return "Too many passwords are being hashed.";
+		case ERROR_ACCOUNT_LOOKUP:
+			return "Failed to load account of session.";
 		default: {
             if(custom_error_msgs != NULL) return custom_error_msgs(code);
             return "missing error message.";
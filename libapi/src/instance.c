@@ -9,6 +9,7 @@
 #include <ulfius.h>
 #include <signal.h>
 #include <sys/wait.h>
+#include <unistd.h>
 
 #include "radicle/api/instance.h"
 #include "radicle/api/endpoints/internal_codes.h"
@@ -22,6 +23,8 @@ api_cookie_config_t* api_cookie_config_copy(const api_cookie_config_t* original)
 	copy->secure = original->secure;
 	copy->max_age = original->max_age;
 	copy->same_site = original->same_site;
+	copy->compact = original->compact;
+	copy->deferred = original->deferred;
 	return copy;
 }
 
@@ -31,6 +34,12 @@ void api_cookie_config_free(api_cookie_config_t** cookie_config) {
 	*cookie_config = NULL;
 }
 
+void api_access_log_config_free(api_access_log_config_t** access_log) {
+	if(*access_log == NULL) return;
+	free(*access_log);
+	*access_log = NULL;
+}
+
 int api_config_get_bool(json_t* object, const char* key, bool* ptr) {
 	json_t* data = json_object_get(object, key);
 	if(data == NULL) {
@@ -123,6 +132,241 @@ int api_cookie_config_load(json_t* object, const char* key, api_cookie_config_t*
 		return 1;
 	}
 
+	if(json_object_get(data, "compact") != NULL && api_config_get_bool(data, "compact", &(*cookie_config)->compact)) {
+		api_cookie_config_free(cookie_config);
+		return 1;
+	}
+
+	if(json_object_get(data, "deferred") != NULL && api_config_get_bool(data, "deferred", &(*cookie_config)->deferred)) {
+		api_cookie_config_free(cookie_config);
+		return 1;
+	}
+
+	return 0;
+}
+
+int api_access_log_config_load(json_t* object, const char* key, api_access_log_config_t** access_log) {
+	*access_log = calloc(1, sizeof(api_access_log_config_t));
+	(*access_log)->enabled = true;
+	(*access_log)->capacity = 8192;
+	(*access_log)->batch_size = 512;
+	(*access_log)->flush_interval_in_ms = 250;
+	(*access_log)->policy = AUTH_ACCESS_LOG_DROP;
+
+	json_t* data = json_object_get(object, key);
+	if(data == NULL) {
+		return 0;
+	} else if(!json_is_object(data)) {
+		ERROR("Expected object for key %s.\n", key);
+		api_access_log_config_free(access_log);
+		return 1;
+	}
+
+	if(json_object_get(data, "enabled") != NULL && api_config_get_bool(data, "enabled", &(*access_log)->enabled)) {
+		api_access_log_config_free(access_log);
+		return 1;
+	}
+
+	if(json_object_get(data, "capacity") != NULL && api_config_get_number(data, "capacity", &(*access_log)->capacity)) {
+		api_access_log_config_free(access_log);
+		return 1;
+	}
+
+	if(json_object_get(data, "batch_size") != NULL && api_config_get_number(data, "batch_size", &(*access_log)->batch_size)) {
+		api_access_log_config_free(access_log);
+		return 1;
+	}
+
+	if(json_object_get(data, "flush_interval_in_ms") != NULL && api_config_get_number(data, "flush_interval_in_ms", &(*access_log)->flush_interval_in_ms)) {
+		api_access_log_config_free(access_log);
+		return 1;
+	}
+
+	if(json_object_get(data, "policy") != NULL) {
+		string_t* policy = NULL;
+		if(api_config_get_string(data, "policy", &policy)) {
+			api_access_log_config_free(access_log);
+			return 1;
+		}
+
+		if(strcmp(policy->ptr, "drop") == 0) {
+			(*access_log)->policy = AUTH_ACCESS_LOG_DROP;
+		} else if(strcmp(policy->ptr, "block") == 0) {
+			(*access_log)->policy = AUTH_ACCESS_LOG_BLOCK;
+		} else {
+			string_free(&policy);
+			ERROR("policy for %s must be one of drop or block.\n", key);
+			api_access_log_config_free(access_log);
+			return 1;
+		}
+		string_free(&policy);
+	}
+
+	if((*access_log)->capacity <= 0 || (*access_log)->batch_size <= 0 || (*access_log)->flush_interval_in_ms <= 0) {
+		ERROR("capacity, batch_size and flush_interval_in_ms of %s must be positive.\n", key);
+		api_access_log_config_free(access_log);
+		return 1;
+	}
+
+	return 0;
+}
+
+int api_session_cache_config_load(json_t* object, const char* key, api_instance_t* config) {
+	config->session_cache_capacity = 10000;
+	config->session_cache_ttl_in_s = 60;
+
+	json_t* data = json_object_get(object, key);
+	if(data == NULL) {
+		return 0;
+	} else if(!json_is_object(data)) {
+		ERROR("Expected object for key %s.\n", key);
+		return 1;
+	}
+
+	if(json_object_get(data, "capacity") != NULL && api_config_get_number(data, "capacity", &config->session_cache_capacity)) {
+		return 1;
+	}
+
+	int ttl = config->session_cache_ttl_in_s;
+	if(json_object_get(data, "ttl_in_s") != NULL && api_config_get_number(data, "ttl_in_s", &ttl)) {
+		return 1;
+	}
+	config->session_cache_ttl_in_s = ttl;
+
+	if(config->session_cache_capacity < 0 || config->session_cache_ttl_in_s < 0) {
+		ERROR("capacity and ttl_in_s of %s must not be negative.\n", key);
+		return 1;
+	}
+
+	return 0;
+}
+
+int api_hash_pool_config_load(json_t* object, const char* key, api_instance_t* config) {
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	config->hash_pool_workers = cpus > 0 ? cpus : 1;
+	config->hash_pool_queue_depth = 64;
+	config->hash_pool_memory_budget_in_mib = 1024;
+
+	json_t* data = json_object_get(object, key);
+	if(data == NULL) {
+		return 0;
+	} else if(!json_is_object(data)) {
+		ERROR("Expected object for key %s.\n", key);
+		return 1;
+	}
+
+	if(json_object_get(data, "workers") != NULL && api_config_get_number(data, "workers", &config->hash_pool_workers)) {
+		return 1;
+	}
+
+	if(json_object_get(data, "queue_depth") != NULL && api_config_get_number(data, "queue_depth", &config->hash_pool_queue_depth)) {
+		return 1;
+	}
+
+	if(json_object_get(data, "memory_budget_in_mib") != NULL && 
+			api_config_get_number(data, "memory_budget_in_mib", &config->hash_pool_memory_budget_in_mib)) {
+		return 1;
+	}
+
+	if(config->hash_pool_workers < 0 || config->hash_pool_queue_depth < 0 || config->hash_pool_memory_budget_in_mib < 0) {
+		ERROR("workers, queue_depth and memory_budget_in_mib of %s must not be negative.\n", key);
+		return 1;
+	}
+
+	return 0;
+}
+
+int api_stateless_sessions_config_load(json_t* object, const char* key, api_instance_t* config) {
+	config->stateless_sessions = false;
+	config->revocation_refresh_interval_in_s = 10;
+
+	json_t* data = json_object_get(object, key);
+	if(data == NULL) {
+		return 0;
+	} else if(!json_is_object(data)) {
+		ERROR("Expected object for key %s.\n", key);
+		return 1;
+	}
+
+	if(json_object_get(data, "enabled") != NULL && api_config_get_bool(data, "enabled", &config->stateless_sessions)) {
+		return 1;
+	}
+
+	if(json_object_get(data, "revocation_refresh_interval_in_s") != NULL &&
+			api_config_get_number(data, "revocation_refresh_interval_in_s", &config->revocation_refresh_interval_in_s)) {
+		return 1;
+	}
+
+	if(config->revocation_refresh_interval_in_s < 0) {
+		ERROR("revocation_refresh_interval_in_s of %s must not be negative.\n", key);
+		return 1;
+	}
+
+	return 0;
+}
+
+int api_password_hash_config_load(json_t* object, const char* key, api_instance_t* config) {
+	auth_password_params_t defaults = AUTH_PASSWORD_PARAMS_DEFAULT;
+	config->password_params = defaults;
+	config->password_calibration_target_in_ms = 0;
+
+	json_t* data = json_object_get(object, key);
+	if(data == NULL) {
+		return 0;
+	} else if(!json_is_object(data)) {
+		ERROR("Expected object for key %s.\n", key);
+		return 1;
+	}
+
+	if(json_object_get(data, "type") != NULL) {
+		string_t* type = NULL;
+		if(api_config_get_string(data, "type", &type)) {
+			return 1;
+		}
+
+		if(strcmp(type->ptr, "argon2i") == 0) {
+			config->password_params.type = Argon2_i;
+		} else if(strcmp(type->ptr, "argon2id") == 0) {
+			config->password_params.type = Argon2_id;
+		} else if(strcmp(type->ptr, "argon2d") == 0) {
+			config->password_params.type = Argon2_d;
+		} else {
+			string_free(&type);
+			ERROR("type for %s must be one of argon2i, argon2id or argon2d.\n", key);
+			return 1;
+		}
+		string_free(&type);
+	}
+
+	int time_cost = config->password_params.time_cost;
+	if(json_object_get(data, "time_cost") != NULL && api_config_get_number(data, "time_cost", &time_cost)) {
+		return 1;
+	}
+
+	int memory_cost = config->password_params.memory_cost;
+	if(json_object_get(data, "memory_cost_in_kib") != NULL && api_config_get_number(data, "memory_cost_in_kib", &memory_cost)) {
+		return 1;
+	}
+
+	int parallelism = config->password_params.parallelism;
+	if(json_object_get(data, "parallelism") != NULL && api_config_get_number(data, "parallelism", &parallelism)) {
+		return 1;
+	}
+
+	if(json_object_get(data, "calibration_target_in_ms") != NULL && 
+			api_config_get_number(data, "calibration_target_in_ms", &config->password_calibration_target_in_ms)) {
+		return 1;
+	}
+
+	// Argon2 needs at least 8 kibibytes per lane.
+	if(time_cost < 1 || parallelism < 1 || memory_cost < 8 * parallelism || config->password_calibration_target_in_ms < 0) {
+		ERROR("time_cost and parallelism of %s must be positive, memory_cost_in_kib at least 8 times parallelism.\n", key);
+		return 1;
+	}
+	config->password_params.time_cost = time_cost;
+	config->password_params.memory_cost = memory_cost;
+	config->password_params.parallelism = parallelism;
+
 	return 0;
 }
 
@@ -356,6 +600,52 @@ int api_instance_load_from_file(const char* file, api_instance_t** config) {
 		return 1;
 	}
 
+	if(api_access_log_config_load(data, "access_log", &(*config)->access_log)) {
+		json_decref(data);
+		api_instance_free(config);
+		return 1;
+	}
+
+	if(api_session_cache_config_load(data, "session_cache", *config)) {
+		json_decref(data);
+		api_instance_free(config);
+		return 1;
+	}
+
+	(*config)->rate_limiter_capacity = 65536;
+	if(json_object_get(data, "rate_limiter_capacity") != NULL && 
+			api_config_get_number(data, "rate_limiter_capacity", &(*config)->rate_limiter_capacity)) {
+		json_decref(data);
+		api_instance_free(config);
+		return 1;
+	}
+
+	if(api_hash_pool_config_load(data, "hash_pool", *config)) {
+		json_decref(data);
+		api_instance_free(config);
+		return 1;
+	}
+
+	if(api_password_hash_config_load(data, "password_hash", *config)) {
+		json_decref(data);
+		api_instance_free(config);
+		return 1;
+	}
+
+	if(api_stateless_sessions_config_load(data, "stateless_sessions", *config)) {
+		json_decref(data);
+		api_instance_free(config);
+		return 1;
+	}
+
+	(*config)->blacklist_refresh_interval_in_s = 30;
+	if(json_object_get(data, "blacklist_refresh_interval_in_s") != NULL && 
+			api_config_get_number(data, "blacklist_refresh_interval_in_s", &(*config)->blacklist_refresh_interval_in_s)) {
+		json_decref(data);
+		api_instance_free(config);
+		return 1;
+	}
+
 	json_decref(data);
 	return 0;
 }
@@ -375,7 +665,16 @@ void api_instance_free(api_instance_t** config) {
 	string_free(&(*config)->root_files_folder);
 	sendgrid_instance_free(&(*config)->sendgrid);
 	api_cookie_config_free(&(*config)->session_cookie);
+	// Flushes remaining accesses, so it has to go before anything it writes about.
+	auth_access_logger_free(&(*config)->access_logger);
+	api_access_log_config_free(&(*config)->access_log);
+	auth_session_cache_free(&(*config)->session_cache);
+	auth_blacklist_free(&(*config)->blacklist);
+	auth_revocation_list_free(&(*config)->revocations);
+	auth_rate_limiter_free(&(*config)->rate_limiter);
+	auth_hash_pool_free(&(*config)->hash_pool);
 	pgdb_connection_queue_free(&(*config)->queue);
+	api_route_free(&(*config)->routes);
 	free(*config);
 	*config = NULL;
 }
@@ -395,9 +694,14 @@ int api_bind(const char* addr, const unsigned int port, struct sockaddr_in* bind
  */
 int callback_default(const struct _u_request * request, struct _u_response * response, void * user_data) {
 	int result = api_callback_endpoint_init(request, response, user_data);
+	if(result != U_CALLBACK_CONTINUE)
+		return result;
 
+	// Cookie is still read for access logging, but unknown urls never create sessions.
+	api_endpoint_set_session_policy(response->shared_data, API_SESSION_NONE);
+	result = api_callback_endpoint_check_for_session(request, response, user_data);
 	if(result != U_CALLBACK_CONTINUE)
-		result = api_callback_endpoint_check_for_session(request, response, user_data);
+		return result;
 
 	return api_endpoint_respond(request, response, user_data, 404, api_response_object("Sorry but the resources you are looking for does not exist, have been removed. name changed or is temporarily unavailable."), NOT_FOUND);
 }
@@ -418,6 +722,54 @@ int api_setup_instance(api_instance_t* config, struct _u_instance* instance) {
 	u_map_put(instance->default_headers, "Access-Control-Allow-Headers", config->default_access_control_allow_headers->ptr);
 	u_map_put(instance->default_headers, "Content-Type", "application/json;charset=UTF-8");
 
+	if(config->access_log != NULL && config->access_log->enabled && config->access_logger == NULL) {
+		config->access_logger = auth_access_logger_new(config->conn_info->ptr, config->access_log->capacity,
+				config->access_log->batch_size, config->access_log->flush_interval_in_ms, config->access_log->policy);
+		if(config->access_logger == NULL) {
+			ERROR("Failed to start access logger.\n");
+			return 1;
+		}
+	}
+
+	if(config->session_cache_capacity > 0 && config->session_cache_ttl_in_s > 0 && config->session_cache == NULL)
+		config->session_cache = auth_session_cache_new(config->session_cache_capacity, config->session_cache_ttl_in_s, 16);
+
+	if(config->rate_limiter_capacity > 0 && config->max_session_accesses_in_lookup_delta > 0 &&
+			config->max_session_accesses_lookup_delta_in_s > 0 && config->rate_limiter == NULL) {
+		config->rate_limiter = auth_rate_limiter_new(config->max_session_accesses_in_lookup_delta,
+				config->max_session_accesses_lookup_delta_in_s, config->rate_limiter_capacity, 16);
+	}
+
+	if(config->password_calibration_target_in_ms > 0 && 
+			auth_password_params_calibrate(&config->password_params, config->password_calibration_target_in_ms)) {
+		ERROR("Failed to calibrate password hashing, using configured settings.\n");
+	}
+
+	if(config->hash_pool == NULL) {
+		config->hash_pool = auth_hash_pool_new(config->hash_pool_workers, config->hash_pool_queue_depth,
+				(size_t) config->hash_pool_memory_budget_in_mib * 1024, &config->password_params);
+		if(config->hash_pool == NULL) {
+			ERROR("Failed to start hash pool.\n");
+			return 1;
+		}
+	}
+
+	if(config->blacklist_refresh_interval_in_s > 0 && config->blacklist == NULL) {
+		config->blacklist = auth_blacklist_new();
+		if(config->blacklist == NULL || auth_blacklist_start_refresh(config->blacklist, config->conn_info->ptr, (int64_t) config->blacklist_refresh_interval_in_s * 1000)) {
+			ERROR("Failed to load blacklist, falling back to database lookups.\n");
+			auth_blacklist_free(&config->blacklist);
+		}
+	}
+
+	if(config->stateless_sessions && config->revocation_refresh_interval_in_s > 0 && config->revocations == NULL) {
+		config->revocations = auth_revocation_list_new();
+		if(config->revocations == NULL || auth_revocation_list_start_refresh(config->revocations, config->conn_info->ptr, (int64_t) config->revocation_refresh_interval_in_s * 1000)) {
+			ERROR("Failed to load revocation list, falling back to database lookups.\n");
+			auth_revocation_list_free(&config->revocations);
+		}
+	}
+
 	ulfius_set_default_endpoint(instance, callback_default, config);
 	return 0;
 }
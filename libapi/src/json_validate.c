@@ -1,3 +1,6 @@
+#include <string.h>
+#include <pthread.h>
+
 #include <jansson.h>
 
 #define PCRE2_CODE_UNIT_WIDTH 8
@@ -8,73 +11,152 @@
 
 #include "radicle/api/json_validate.h"
 
-int validate_regex(const char* exp, const int capture_groups, const char* input) {
-	PCRE2_SIZE error_offset;
-	int ec;
+/**
+ * @brief Pattern which is compiled once and shared by all threads.
+ */
+typedef struct api_json_validator {
+	const char* exp; /**< Regular expression. */
+	pcre2_code* re; /**< Compiled expression, NULL if compilation failed. */
+} api_json_validator_t;
+
+enum {
+	API_JSON_VALIDATOR_EMAIL,
+	API_JSON_VALIDATOR_PASSWORD,
+	API_JSON_VALIDATOR_COUNT
+};
 
-	pcre2_code* re = pcre2_compile((PCRE2_SPTR8)exp, -1, 0, &ec, &error_offset, NULL);
-	if(re == NULL) {
-		PCRE2_UCHAR8 buffer[120];
-		pcre2_get_error_message(ec, buffer, 120);
-		ERROR("Failed to compile %s with error message %s.\n", exp, buffer);
+static api_json_validator_t api_json_validators[API_JSON_VALIDATOR_COUNT] = {
+	[API_JSON_VALIDATOR_EMAIL] = { "^[^\\s@]+@([^\\s@.,]+\\.)+[^\\s@.,]{2,}$", NULL },
+	[API_JSON_VALIDATOR_PASSWORD] = { "^(?=.*?[A-Z])(?=.*?[a-z])(?=.*?[0-9])(?=.*?[#?!@$ %^&*-]).{8,}$", NULL }
+};
+
+static pthread_once_t api_json_validators_once = PTHREAD_ONCE_INIT;
+static pthread_key_t api_json_validators_match_data;
+
+static void api_json_validators_match_data_free(void* match_data) {
+	pcre2_match_data_free(match_data);
+}
+
+static void api_json_validators_compile() {
+	pthread_key_create(&api_json_validators_match_data, api_json_validators_match_data_free);
+
+	for(int i = 0; i < API_JSON_VALIDATOR_COUNT; i++) {
+		api_json_validator_t* validator = &api_json_validators[i];
+		PCRE2_SIZE error_offset;
+		int ec;
+
+		validator->re = pcre2_compile((PCRE2_SPTR8)validator->exp, PCRE2_ZERO_TERMINATED, 0, &ec, &error_offset, NULL);
+		if(validator->re == NULL) {
+			PCRE2_UCHAR8 buffer[120];
+			pcre2_get_error_message(ec, buffer, 120);
+			ERROR("Failed to compile %s with error message %s.\n", validator->exp, buffer);
+			continue;
+		}
+
+		// Without jit support pcre2_match falls back to the interpreter.
+		ec = pcre2_jit_compile(validator->re, PCRE2_JIT_COMPLETE);
+		if(ec != 0) {
+			DEBUG("Jit compilation of %s failed with %d.\n", validator->exp, ec);
+		}
+	}
+}
+
+/**
+ * @brief Returns match data of calling thread. It only holds the whole match, since validators
+ * never look at capture groups.
+ */
+static pcre2_match_data* api_json_validators_get_match_data() {
+	pcre2_match_data* match_data = pthread_getspecific(api_json_validators_match_data);
+	if(match_data == NULL) {
+		match_data = pcre2_match_data_create(1, NULL);
+		pthread_setspecific(api_json_validators_match_data, match_data);
+	}
+	return match_data;
+}
+
+static int validate_regex(const int validator_id, const char* input, const size_t length) {
+	pthread_once(&api_json_validators_once, api_json_validators_compile);
+
+	const api_json_validator_t* validator = &api_json_validators[validator_id];
+	if(validator->re == NULL)
+		return 1;
+
+	pcre2_match_data* match_data = api_json_validators_get_match_data();
+	if(match_data == NULL) {
+		ERROR("Failed to create match data.\n");
 		return 1;
 	}
-	pcre2_match_data* match_data = pcre2_match_data_create(capture_groups, NULL);
-	ec = pcre2_match(re, (PCRE2_SPTR8)input, -1, 0, 0, match_data, NULL);
 
-	if(ec == 0) {
-		ERROR("Vector of offsets is too small. (Increase pcre2_match_data_create\n");
-	} else if (ec < 0 && ec != PCRE2_ERROR_NOMATCH) {
+	int ec = pcre2_match(validator->re, (PCRE2_SPTR8)input, length, 0, 0, match_data, NULL);
+	if(ec < 0 && ec != PCRE2_ERROR_NOMATCH) {
 		PCRE2_UCHAR8 buffer[120];
 		pcre2_get_error_message(ec, buffer, 120);
-		ERROR("Failed to match expression %s with error %s.\n", exp, buffer);
+		ERROR("Failed to match expression %s with error %s.\n", validator->exp, buffer);
 	}
 
-	pcre2_match_data_free(match_data);
-	pcre2_code_free(re);
+	// Zero means it matched, but capture groups did not fit into match data.
+	return !(ec >= 0);
+}
 
-	return !(ec >= 1);
+/**
+ * @brief Checks if key is in object and verifies type is string.
+ *
+ * @param object JSON object
+ * @param key Key of value to extract from object
+ * @param length Length of value in bytes.
+ *
+ * @result Returns value or NULL.
+ */
+static const char* api_json_get_string(const json_t* object, const char* key, size_t* length) {
+	json_t* child = json_object_get(object, key);
+	if(child == NULL || child->type != JSON_STRING)
+		return NULL;
+	*length = json_string_length(child);
+	return json_string_value(child);
 }
 
 /**
- * @brief Checks if key is in object, verifies typei s string and then runs
- * regex on it.
+ * @brief Checks if key is in object, verifies type is string and then runs
+ * validator on it.
  *
  * @param object JSON object
  * @param key Key of value to extract from object
- * @param regex Regex to check on value
+ * @param validator_id Validator to check on value
  * @param result If regex was valid, value will be stored in result
  * 
  * @result Returns 0 on success
  */
-int api_json_validate_string(const json_t* object, const char* key, const char* regex, const int capture_groups, string_t** result) {
-	json_t* child = json_object_get(object, key);
-	if(child == NULL || child->type != JSON_STRING) {
-		*result = NULL;
-		return 1;
-	}
-	const char* value = json_string_value(child);
-	
-	if(validate_regex(regex, capture_groups, value)) {
+static int api_json_validate_string(const json_t* object, const char* key, const int validator_id, string_t** result) {
+	size_t length;
+	const char* value = api_json_get_string(object, key, &length);
+	if(value == NULL || validate_regex(validator_id, value, length)) {
 		*result = NULL;
 		return 1;
 	}
 
-	*result = string_new(value, json_string_length(child));
+	*result = string_new(value, length);
 	return 0;
-
 }
 
 int api_json_validate_text(const json_t* object, const char* key, const int minLength, const int maxLength, string_t** result) {
-	char buffer[50];
-	sprintf(buffer, "^.{%d,%d}$", minLength, maxLength);
-	return api_json_validate_string(object, key, buffer, 0, result);
+	size_t length;
+	const char* value = api_json_get_string(object, key, &length);
+
+	// Replaces former ^.{min,max}$ and is stricter than it: PCRE2's $ let a single trailing line break
+	// through and matching stopped at the first NUL. Now the full value is counted and any line break rejected.
+	if(value == NULL || length < (size_t) minLength || length > (size_t) maxLength || memchr(value, '\n', length) != NULL) {
+		*result = NULL;
+		return 1;
+	}
+
+	*result = string_new(value, length);
+	return 0;
 }
 
 int api_json_validate_email(const json_t* object, const char* key, string_t** result) {
-	return api_json_validate_string(object, key, "^[^\\s@]+@([^\\s@.,]+\\.)+[^\\s@.,]{2,}$", 2, result);
+	return api_json_validate_string(object, key, API_JSON_VALIDATOR_EMAIL, result);
 }
 
 int api_json_validate_password(const json_t* object, const char* key, string_t** result) {
-	return api_json_validate_string(object, key, "^(?=.*?[A-Z])(?=.*?[a-z])(?=.*?[0-9])(?=.*?[#?!@$ %^&*-]).{8,}$", 4, result);
+	return api_json_validate_string(object, key, API_JSON_VALIDATOR_PASSWORD, result);
 }
@@ -76,7 +76,7 @@ class APITests: public RadiclePGDBHooks {
 
 	api_instance_t* manage_instance() {
 		api_instance_t* instance  = (api_instance_t*)calloc(1, sizeof(api_instance_t));
-		instance->queue = pgdb_connection_queue_new("conn info", 10, 10);
+		instance->queue = pgdb_connection_queue_new("conn info", 0, 10, 10);
 		instance->signature_key = string_from_literal("signature key");
 		instance->session_cookie = (api_cookie_config_t*)calloc(1, sizeof(api_cookie_config_t));
 		instance->session_cookie->max_age = 0;
@@ -11,6 +11,7 @@
 #include "radicle/pgdb.h"
 #include "radicle/tests/api/api_fixture.hpp"
 #include "radicle/api/endpoints/endpoint.h"
+#include "radicle/api/endpoints/internal_codes.h"
 #include "radicle/types/string.h"
 #include "subhook.h"
 
@@ -409,4 +410,119 @@ TEST_F(APITests, TestAuthCallbackCheckIpForMaliciousActivityMalicious) {
 	EXPECT_EQ(auth_blacklist_ip_counter, 1);
 }
 
+TEST_F(APITests, TestAuthCallbackCheckIpForMaliciousActivityRateLimiter) {
 
+	auth_blacklist_ip_counter = 0;
+	install_hook(subhook_new((void*)auth_blacklist_ip, (void*)auth_blacklist_ip_fake_counter, SUBHOOK_64BIT_OFFSET));
+	install_execute_always_success();
+
+	api_instance_t* instance = manage_instance();
+	instance->max_session_accesses_in_lookup_delta = 2;
+	instance->max_session_accesses_penalty_in_s = 100;
+	instance->max_session_accesses_lookup_delta_in_s = 100;
+	instance->rate_limiter = auth_rate_limiter_new(2, 100, 16, 1);
+
+	_u_request* request = manage_request();
+	_u_response* response = manage_response();
+	api_endpoint_t* endpoint = create_endpoint(response);
+
+	ASSERT_EQ(api_auth_callback_check_ip_for_malicious_activity(request, response, instance), U_CALLBACK_CONTINUE);
+	ASSERT_EQ(api_auth_callback_check_ip_for_malicious_activity(request, response, instance), U_CALLBACK_CONTINUE);
+	ASSERT_EQ(api_auth_callback_check_ip_for_malicious_activity(request, response, instance), U_CALLBACK_COMPLETE);
+
+	EXPECT_EQ(auth_blacklist_ip_counter, 1);
+}
+
+
+
+TEST_F(APITests, TestEndpointRespondDeferredSessionNotStored) {
+	install_execute_always_success();
+
+	api_instance_t* instance = manage_instance();
+	_u_request* request = manage_request();
+	_u_response* response = manage_response();
+	api_endpoint_t* endpoint = create_endpoint(response);
+	api_endpoint_set_session_policy(endpoint, API_SESSION_DEFERRED);
+
+	ASSERT_EQ(api_endpoint_respond(request, response, instance, 200, api_response_object_ok(), SUCCESS), U_CALLBACK_COMPLETE);
+	EXPECT_EQ(response->nb_cookies, 0);
+	EXPECT_TRUE(response->shared_data == NULL);
+}
+
+PGDB_FAKE_FETCH(InsertSessionId) {
+	PGDB_FAKE_RESULT_1(PGRES_TUPLES_OK, "id");
+	PGDB_FAKE_INT(5);
+	PGDB_FAKE_FINISH();
+}
+
+TEST_F(APITests, TestEndpointRespondDeferredSessionStored) {
+	install_execute_always_success();
+	install_hook(PGDB_FAKE_CREATE_FETCH_HOOK(InsertSessionId));
+
+	api_instance_t* instance = manage_instance();
+	_u_request* request = manage_request();
+	_u_response* response = manage_response();
+	api_endpoint_t* endpoint = create_endpoint(response);
+	api_endpoint_set_session_policy(endpoint, API_SESSION_DEFERRED);
+	api_endpoint_store_session(endpoint);
+
+	ASSERT_EQ(api_endpoint_respond(request, response, instance, 200, api_response_object_ok(), SUCCESS), U_CALLBACK_COMPLETE);
+	EXPECT_EQ(response->nb_cookies, 1);
+}
+
+TEST_F(APITests, TestEndpointRespondNoSessionPolicy) {
+	install_execute_always_success();
+
+	api_instance_t* instance = manage_instance();
+	_u_request* request = manage_request();
+	_u_response* response = manage_response();
+	api_endpoint_t* endpoint = create_endpoint(response);
+	api_endpoint_set_session_policy(endpoint, API_SESSION_NONE);
+	api_endpoint_store_session(endpoint);
+
+	ASSERT_EQ(api_endpoint_respond(request, response, instance, 404, api_response_object_ok(), NOT_FOUND), U_CALLBACK_COMPLETE);
+	EXPECT_EQ(response->nb_cookies, 0);
+}
+
+static int route_stage_counter = 0;
+
+int route_stage_continue(const struct _u_request* request, struct _u_response* response, void* user_data) {
+	route_stage_counter++;
+	return U_CALLBACK_CONTINUE;
+}
+
+int route_stage_complete(const struct _u_request* request, struct _u_response* response, void* user_data) {
+	route_stage_counter++;
+	return U_CALLBACK_COMPLETE;
+}
+
+TEST(APIRouteTests, TestRouteStages) {
+	api_route_t* route = api_route_new(&route_stage_complete, NULL, API_ROUTE_VERIFIED | API_ROUTE_JSON_BODY | API_ROUTE_SESSION_DEFERRED);
+
+	ASSERT_EQ(route->stage_count, 9);
+	EXPECT_TRUE(route->stages[0] == &api_callback_endpoint_prepare);
+	EXPECT_TRUE(route->stages[1] == &api_callback_endpoint_session_deferred);
+	EXPECT_TRUE(route->stages[2] == &api_auth_callback_check_blacklist);
+	EXPECT_TRUE(route->stages[3] == &api_auth_callback_check_ip_for_malicious_activity);
+	EXPECT_TRUE(route->stages[4] == &api_callback_endpoint_claim_connection);
+	EXPECT_TRUE(route->stages[5] == &api_callback_endpoint_check_for_session);
+	EXPECT_TRUE(route->stages[6] == &api_callback_endpoint_check_for_verified_email);
+	EXPECT_TRUE(route->stages[7] == &api_callback_endpoint_load_json_body);
+	EXPECT_TRUE(route->stages[8] == &route_stage_complete);
+
+	api_route_free(&route);
+	EXPECT_TRUE(route == NULL);
+}
+
+TEST(APIRouteTests, TestRouteEarlyExit) {
+	api_route_t* route = (api_route_t*)calloc(1, sizeof(api_route_t));
+	route->stages[route->stage_count++] = &route_stage_continue;
+	route->stages[route->stage_count++] = &route_stage_complete;
+	route->stages[route->stage_count++] = &route_stage_continue;
+
+	route_stage_counter = 0;
+	EXPECT_EQ(api_callback_route(NULL, NULL, route), U_CALLBACK_COMPLETE);
+	EXPECT_EQ(route_stage_counter, 2);
+
+	api_route_free(&route);
+}
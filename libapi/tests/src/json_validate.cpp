@@ -0,0 +1,106 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <jansson.h>
+
+#include "radicle/api/json_validate.h"
+#include "radicle/types/string.h"
+
+TEST(APIJsonValidateTests, TestText) {
+	json_t* object = json_pack("{s:s, s:s, s:s, s:s, s:s#, s:i}", "valid", "hello", "long", "hello world",
+			"inner", "hel\nlo", "trailing", "hello\n", "nul", "he\0lo", 5, "number", 5);
+	string_t* result = NULL;
+
+	EXPECT_EQ(api_json_validate_text(object, "valid", 1, 10, &result), 0);
+	ASSERT_TRUE(result != NULL);
+	EXPECT_STREQ(result->ptr, "hello");
+	string_free(&result);
+
+	EXPECT_EQ(api_json_validate_text(object, "valid", 5, 5, &result), 0);
+	string_free(&result);
+
+	EXPECT_EQ(api_json_validate_text(object, "valid", 6, 10, &result), 1);
+	EXPECT_TRUE(result == NULL);
+	EXPECT_EQ(api_json_validate_text(object, "long", 1, 10, &result), 1);
+	EXPECT_TRUE(result == NULL);
+
+	// Line breaks are rejected, also a trailing one.
+	EXPECT_EQ(api_json_validate_text(object, "inner", 1, 10, &result), 1);
+	EXPECT_EQ(api_json_validate_text(object, "trailing", 1, 10, &result), 1);
+
+	// Embedded NUL counts towards length.
+	EXPECT_EQ(api_json_validate_text(object, "nul", 1, 4, &result), 1);
+	EXPECT_EQ(api_json_validate_text(object, "nul", 5, 5, &result), 0);
+	ASSERT_TRUE(result != NULL);
+	EXPECT_EQ(result->length, 5);
+	string_free(&result);
+
+	EXPECT_EQ(api_json_validate_text(object, "number", 0, 10, &result), 1);
+	EXPECT_TRUE(result == NULL);
+	EXPECT_EQ(api_json_validate_text(object, "missing", 0, 10, &result), 1);
+	EXPECT_TRUE(result == NULL);
+
+	json_decref(object);
+}
+
+TEST(APIJsonValidateTests, TestEmail) {
+	json_t* object = json_pack("{s:s, s:s, s:s, s:s, s:s, s:i}", "valid", "test@mail.com", "subdomain", "test@mail.example.com",
+			"tld", "test@mail.c", "space", "te st@mail.com", "at", "@mail.com", "number", 5);
+	string_t* result = NULL;
+
+	EXPECT_EQ(api_json_validate_email(object, "valid", &result), 0);
+	ASSERT_TRUE(result != NULL);
+	EXPECT_STREQ(result->ptr, "test@mail.com");
+	string_free(&result);
+
+	EXPECT_EQ(api_json_validate_email(object, "subdomain", &result), 0);
+	string_free(&result);
+
+	EXPECT_EQ(api_json_validate_email(object, "tld", &result), 1);
+	EXPECT_TRUE(result == NULL);
+	EXPECT_EQ(api_json_validate_email(object, "space", &result), 1);
+	EXPECT_EQ(api_json_validate_email(object, "at", &result), 1);
+	EXPECT_EQ(api_json_validate_email(object, "number", &result), 1);
+	EXPECT_EQ(api_json_validate_email(object, "missing", &result), 1);
+	EXPECT_TRUE(result == NULL);
+
+	json_decref(object);
+}
+
+TEST(APIJsonValidateTests, TestPassword) {
+	json_t* object = json_pack("{s:s, s:s, s:s, s:s, s:s}", "valid", "Password1!", "short", "Pass1!",
+			"lower", "password1!", "digit", "Password!", "special", "Password1");
+	string_t* result = NULL;
+
+	EXPECT_EQ(api_json_validate_password(object, "valid", &result), 0);
+	ASSERT_TRUE(result != NULL);
+	EXPECT_STREQ(result->ptr, "Password1!");
+	string_free(&result);
+
+	EXPECT_EQ(api_json_validate_password(object, "short", &result), 1);
+	EXPECT_TRUE(result == NULL);
+	EXPECT_EQ(api_json_validate_password(object, "lower", &result), 1);
+	EXPECT_EQ(api_json_validate_password(object, "digit", &result), 1);
+	EXPECT_EQ(api_json_validate_password(object, "special", &result), 1);
+	EXPECT_EQ(api_json_validate_password(object, "missing", &result), 1);
+	EXPECT_TRUE(result == NULL);
+
+	json_decref(object);
+}
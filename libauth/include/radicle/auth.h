@@ -31,6 +31,9 @@
 #include <libpq-fe.h>
 
 #include "radicle/auth/types.h"
+#include "radicle/auth/session_cache.h"
+#include "radicle/auth/hash_pool.h"
+#include "radicle/auth/revocation_list.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -48,7 +51,8 @@ typedef enum auth_errors {
 	AUTH_ACCOUNT_NOT_ACTIVE,
 	AUTH_INVALID_COOKIE,
 	AUTH_COOKIE_NOT_FOUND,
-	AUTH_INVALID_SIGNATURE
+	AUTH_INVALID_SIGNATURE,
+	AUTH_BUSY
 } auth_errors_t;
 
 /**
@@ -76,6 +80,31 @@ auth_errors_t auth_make_owned_session(PGconn* conn, const uuid_t* uuid, const st
  */
 auth_errors_t auth_make_free_session(PGconn* conn, const string_t* signature_key, auth_cookie_t** cookie, uint32_t* id);
 
+/**
+ * @brief Same as \ref auth_make_owned_session, but creates a compact cookie of \ref AUTH_COMPACT_COOKIE_LENGTH
+ * chars, whose binary token is stored as bytea. Verified by auth_verify_cookie() like any other cookie.
+ *
+ * @param uuid Uuid of owner account, NULL for a session which is not associated to any account.
+ *
+ * @see auth_make_owned_session()
+ */
+auth_errors_t auth_make_compact_session(PGconn* conn, const uuid_t* uuid, const string_t* signature_key, auth_cookie_t** cookie, uint32_t* id);
+
+/**
+ * @brief Creates a session whose cookie carries owner, role, verification status and expiration,
+ * so it can be verified by auth_verify_stateless_cookie() without the database. A Sessions row
+ * is still saved for access logging and revocation.
+ *
+ * @param conn Connection to database.
+ * @param account Owner of session, NULL for a session which is not associated to any account.
+ * @param signature_key Key used for signing cookie.
+ * @param cookie Pointer to cookie which will be created by this function. Only \ref auth_cookie_t.cookie is set.
+ * @param id Identifier of session row.
+ *
+ * @returns Returns either \ref auth_errors_t.AUTH_OK or auth_errors_t.AUTH_ERROR.
+ */
+auth_errors_t auth_make_stateless_session(PGconn* conn, const auth_account_t* account, const string_t* signature_key, auth_cookie_t** cookie, uint32_t* id);
+
 /**
  * @brief Logs a session access with its corresponding status.
  *
@@ -100,6 +129,17 @@ auth_errors_t auth_log_access(PGconn* conn, const uint32_t session_id, const aut
  */
 auth_errors_t auth_register(PGconn* conn, auth_account_t* account);
 
+/**
+ * @brief Same as \ref auth_register, but hashes password on \p pool.
+ *
+ * @param pool Pool used for hashing, may be NULL.
+ *
+ * @returns Additionally returns \ref auth_errors_t.AUTH_BUSY if \p pool is full.
+ *
+ * @see auth_register()
+ */
+auth_errors_t auth_register_pooled(PGconn* conn, auth_hash_pool_t* pool, auth_account_t* account);
+
 /**
  * @brief Creates password hash and saves it to database.
  *
@@ -111,6 +151,17 @@ auth_errors_t auth_register(PGconn* conn, auth_account_t* account);
  */
 auth_errors_t auth_update_password(PGconn* conn, const uuid_t* uuid, const string_t* password);
 
+/**
+ * @brief Same as \ref auth_update_password, but hashes password on \p pool.
+ *
+ * @param pool Pool used for hashing, may be NULL.
+ *
+ * @returns Additionally returns \ref auth_errors_t.AUTH_BUSY if \p pool is full.
+ *
+ * @see auth_update_password()
+ */
+auth_errors_t auth_update_password_pooled(PGconn* conn, auth_hash_pool_t* pool, const uuid_t* uuid, const string_t* password);
+
 /**
  * @brief Creates and saves token.
  *
@@ -143,9 +194,22 @@ auth_errors_t auth_create_token(PGconn* conn, const uuid_t* owner, const token_t
  */
 auth_errors_t auth_sign_in(PGconn* conn, const string_t* email, const string_t* password, auth_account_t** account);
 
+/**
+ * @brief Same as \ref auth_sign_in, but verifies password on \p pool. If the stored hash was
+ * created with other settings than \p pool uses, it is replaced by a new hash.
+ *
+ * @param pool Pool used for verifying, may be NULL.
+ *
+ * @returns Additionally returns \ref auth_errors_t.AUTH_BUSY if \p pool is full.
+ *
+ * @see auth_sign_in()
+ */
+auth_errors_t auth_sign_in_pooled(PGconn* conn, auth_hash_pool_t* pool, const string_t* email, const string_t* password, auth_account_t** account);
+
 /**
  * @brief Checks if received cookie has a valid signature and exists in database.
  * If it exists, it also checks for expiration or if it has been manually revoked.
+ * Accepts classic cookies as well as compact ones created by auth_make_compact_session().
  *
  * @param conn Connection to database.
  * @param cookie Raw textual cookie representation.
@@ -159,6 +223,39 @@ auth_errors_t auth_sign_in(PGconn* conn, const string_t* email, const string_t*
  */
 auth_errors_t auth_verify_cookie(PGconn* conn, const string_t* signature_key, const string_t* cookie, uint32_t* session_id, auth_account_t** account);
 
+/**
+ * @brief Same as \ref auth_verify_cookie, but consults \p cache first. A hit skips database and
+ * signature check, a verified miss is added to \p cache.
+ *
+ * @param cache Cache of verified sessions, may be NULL.
+ *
+ * @see auth_verify_cookie()
+ */
+auth_errors_t auth_verify_cookie_cached(PGconn* conn, auth_session_cache_t* cache, const string_t* signature_key, const string_t* cookie, uint32_t* session_id, auth_account_t** account);
+
+/**
+ * @brief Verifies a cookie created by auth_make_stateless_session(). Signature and expiration are
+ * checked in memory. Revocation and deactivation are checked against \p revocations, as long as it is
+ * fresh, otherwise the database is asked instead.
+ *
+ * The returned account only has uuid, role and verified set, as they were when cookie was issued.
+ *
+ * @param revocations Revoked sessions and deactivated accounts, may be NULL.
+ *
+ * @see auth_verify_cookie()
+ */
+auth_errors_t auth_verify_stateless_cookie(PGconn* conn, auth_revocation_list_t* revocations, const string_t* signature_key, const string_t* cookie, uint32_t* session_id, auth_account_t** account);
+
+/**
+ * @brief Same as \ref auth_verify_stateless_cookie, but allocates account from \p arena, so it must not
+ * be passed to auth_account_free().
+ *
+ * @param arena Arena to allocate account from.
+ *
+ * @see auth_verify_stateless_cookie()
+ */
+auth_errors_t auth_verify_stateless_cookie_arena(PGconn* conn, arena_t* arena, auth_revocation_list_t* revocations, const string_t* signature_key, const string_t* cookie, uint32_t* session_id, auth_account_t** account);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,119 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Asynchronous batched writer for session accesses.
+ * @author Nils Egger
+ * @addtogroup Auth
+ * @{
+ */
+
+#ifndef RADICLE_AUTH_INCLUDE_RADICLE_AUTH_ACCESS_LOG_H
+#define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_ACCESS_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/types/mpsc_queue.h"
+#include "radicle/pgdb/copy.h"
+#include "radicle/auth/types.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Decides what happens to an access if the queue is full.
+ */
+typedef enum auth_access_log_policy {
+	AUTH_ACCESS_LOG_DROP, /**< Access is discarded and counted as dropped. */
+	AUTH_ACCESS_LOG_BLOCK /**< Caller waits until the writer made space. */
+} auth_access_log_policy_t;
+
+/**
+ * @brief Logs session accesses on a background thread, so requests never wait for the database.
+ *
+ * Accesses are queued in a lock free ring buffer and written in batches via COPY on
+ * a dedicated connection.
+ *
+ * @see auth_access_logger_new()
+ * @see auth_access_logger_free()
+ */
+typedef struct auth_access_logger {
+	mpsc_queue_t* queue; /**< Pending accesses. */
+	auth_access_log_policy_t policy; /**< Behaviour when queue is full. */
+	char* conn_info; /**< Used for (re)connecting the writer connection. */
+	PGconn* conn; /**< Connection owned by the writer thread. */
+	pgdb_copy_writer_t* writer; /**< Batches accesses into COPY statements. */
+	int batch_size; /**< Writer is woken up once this many accesses are pending. */
+	int64_t flush_interval; /**< Max time in milliseconds an access stays queued. */
+	pthread_t thread; /**< Writer thread. */
+	pthread_mutex_t lock; /**< Guards running and the condition variables. */
+	pthread_cond_t wakeup; /**< Wakes writer before flush_interval passed. */
+	pthread_cond_t drained; /**< Signaled after writer emptied queue. */
+	bool running; /**< False once free was called. */
+	uint64_t dropped; /**< Amount of accesses lost due to a full queue. */
+} auth_access_logger_t;
+
+/**
+ * @brief Creates a logger and starts its writer thread.
+ *
+ * @param conn_info Connection info used for the writer connection.
+ * @param capacity Amount of accesses which can be queued.
+ * @param batch_size Amount of accesses written with a single COPY.
+ * @param flush_interval Time in milliseconds after which queued accesses are written regardless of batch size.
+ * @param policy Behaviour if queue is full.
+ *
+ * @returns Returns new logger or NULL on failure.
+ */
+auth_access_logger_t* auth_access_logger_new(const char* conn_info, const size_t capacity, const int batch_size, const int64_t flush_interval, const auth_access_log_policy_t policy);
+
+/**
+ * @brief Queues an access of session. The request log is copied, so the caller keeps ownership.
+ *
+ * @param logger Logger to queue at.
+ * @param session_id Id of session.
+ * @param request_log Access which will be logged.
+ *
+ * @returns Returns 0 if access was queued and 1 if it was dropped.
+ */
+int auth_access_logger_push(auth_access_logger_t* logger, const uint32_t session_id, const auth_request_log_t* request_log);
+
+/**
+ * @brief Returns amount of accesses dropped so far.
+ */
+uint64_t auth_access_logger_dropped(auth_access_logger_t* logger);
+
+/**
+ * @brief Stops writer thread after writing all queued accesses and frees logger.
+ *
+ * @param logger Double pointer to logger. Will be set to NULL.
+ */
+void auth_access_logger_free(auth_access_logger_t** logger);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_AUTH_INCLUDE_RADICLE_AUTH_ACCESS_LOG_H
+
+/** @} */
@@ -0,0 +1,108 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Base64 and base64url codec writing into caller provided buffers.
+ * @author Nils Egger
+ * @addtogroup Auth
+ * @{
+ */
+
+#ifndef RADICLE_AUTH_INCLUDE_RADICLE_AUTH_BASE64_H
+#define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_BASE64_H
+
+#include <stddef.h>
+
+#include "radicle/types/string.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Alphabets supported by codec.
+ */
+typedef enum base64_alphabet {
+	BASE64_STANDARD, /**< RFC 4648 base64 with + and /, padded with =. */
+	BASE64_URL /**< RFC 4648 base64url with - and _, without padding. */
+} base64_alphabet_t;
+
+/**
+ * @brief Calculates amount of chars encoding \p length bytes results in, without null terminator.
+ *
+ * @param length Amount of bytes to encode.
+ * @param alphabet Alphabet to encode with.
+ *
+ * @returns Returns length of encoded string.
+ */
+size_t base64_encoded_length(const size_t length, const base64_alphabet_t alphabet);
+
+/**
+ * @brief Encodes \p input into \p output. Uses SSSE3 if the cpu supports it.
+ *
+ * @param input Bytes to encode.
+ * @param length Amount of bytes to encode.
+ * @param output Buffer of at least \ref base64_encoded_length() + 1 chars. Will be null terminated.
+ * @param alphabet Alphabet to encode with.
+ *
+ * @returns Returns amount of chars written, without null terminator.
+ */
+size_t base64_encode_to(const unsigned char* input, const size_t length, char* output, const base64_alphabet_t alphabet);
+
+/**
+ * @brief Decodes \p input into \p output. Padding is optional.
+ *
+ * @param input Encoded chars.
+ * @param length Amount of chars.
+ * @param output Buffer of at least 3 * length / 4 + 1 bytes. Will be null terminated.
+ * @param output_length Amount of bytes written, without null terminator.
+ * @param alphabet Alphabet input is encoded with.
+ *
+ * @returns Returns 0 on success, 1 if input is not valid.
+ */
+int base64_decode_to(const char* input, const size_t length, unsigned char* output, size_t* output_length, const base64_alphabet_t alphabet);
+
+/**
+ * @brief Takes a string as input and converts it to base64.
+ *
+ * @param input Input string or bytes.
+ * @param length Length of input.
+ * @param buffer Double pointer to buffer to write to.
+ *
+ * @returns Returns 0 on success.
+ */
+int base64_encode(const unsigned char* input, size_t length, string_t** buffer);
+
+/**
+ * @brief Takes a base64 as input and converts it back to its original bytes.
+ *
+ * @param input Input base64 string.
+ * @param buffer Double pointer to buffer to write to.
+ * 
+ * @returns Returns 0 on success.
+ */
+int base64_decode(const string_t* base64, string_t** buffer);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_AUTH_INCLUDE_RADICLE_AUTH_BASE64_H
+
+/** @} */
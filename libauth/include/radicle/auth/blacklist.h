@@ -0,0 +1,176 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief In memory index of banned ips.
+ * @author Nils Egger
+ * @addtogroup Auth
+ * @{
+ */
+
+#ifndef RADICLE_AUTH_INCLUDE_RADICLE_AUTH_BLACKLIST_H
+#define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_BLACKLIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/types/linked_list.h"
+#include "radicle/types/retire_list.h"
+#include "radicle/types/string.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Max length of a textual ip including terminator. Fits any IPv6 address.
+ */
+#define AUTH_BLACKLIST_IP_LENGTH 46
+
+/**
+ * @brief Amount of polls after which the refresh thread fully reloads the blacklist.
+ */
+#define AUTH_BLACKLIST_RELOAD_REFRESHES 30
+
+/**
+ * @brief Banned ip. Slot is empty if id is 0. Hash and ip never change once id was set.
+ */
+typedef struct auth_blacklist_slot {
+	uint64_t hash; /**< Hash of ip. */
+	uint32_t id; /**< Id of Blacklist row. Only accessed atomically. */
+	time_t ban_lift; /**< Time ban is lifted, 0 if permanent. Only accessed atomically. */
+	char ip[AUTH_BLACKLIST_IP_LENGTH]; /**< Textual ip. */
+} auth_blacklist_slot_t;
+
+/**
+ * @brief Open addressing hash set. Local bans are published into free slots in place, loads and
+ * growing replace it as a whole.
+ */
+typedef struct auth_blacklist_table {
+	retire_node_t retire; /**< Must stay first member. */
+	size_t mask; /**< Amount of slots minus one. */
+	size_t count; /**< Amount of used slots. */
+	auth_blacklist_slot_t slots[]; /**< Slots. */
+} auth_blacklist_table_t;
+
+/**
+ * @brief Read mostly set of banned ips. Lookups never lock, they read the current table
+ * through an atomic pointer. Writers either fill a free slot or build a new table and swap
+ * it in. Replaced tables are only freed once no lookup which may have loaded them is left.
+ *
+ * @see auth_blacklist_new()
+ * @see auth_blacklist_free()
+ */
+typedef struct auth_blacklist {
+	auth_blacklist_table_t* table; /**< Current table. Only accessed atomically. */
+	pthread_mutex_t lock; /**< Serializes writers. */
+	retire_list_t* retired; /**< Replaced tables and lookups which may still read them. */
+	uint32_t last_id; /**< Highest Blacklist id loaded from database so far. */
+	bool reloading; /**< True while a full reload is fetching. */
+	list_t* pending; /**< Copies of bans added locally during a full reload. */
+	size_t refreshes; /**< Polls since last full reload. Only used by refresh thread. */
+	char* conn_info; /**< Connection info of refresh thread. */
+	PGconn* conn; /**< Connection owned by refresh thread. */
+	int64_t refresh_interval; /**< Time in milliseconds between refreshes. */
+	pthread_t thread; /**< Refresh thread. */
+	pthread_cond_t wakeup; /**< Used to stop refresh thread early. */
+	bool running; /**< True while refresh thread is running. */
+} auth_blacklist_t;
+
+/**
+ * @brief Creates an empty blacklist.
+ *
+ * @returns Returns new blacklist or NULL if no thread specific key is left.
+ */
+auth_blacklist_t* auth_blacklist_new();
+
+/**
+ * @brief Loads all bans with an id above blacklist->last_id and drops lifted ones. Unbans and
+ * changed ban lifts of rows already loaded are only picked up by auth_blacklist_reload().
+ *
+ * @param blacklist Blacklist to update.
+ * @param conn Connection to database.
+ *
+ * @returns Returns 0 on success.
+ */
+int auth_blacklist_load(auth_blacklist_t* blacklist, PGconn* conn);
+
+/**
+ * @brief Replaces blacklist with all bans in database which are not lifted yet. Bans added with
+ * auth_blacklist_add() while fetching are kept.
+ *
+ * @param blacklist Blacklist to update.
+ * @param conn Connection to database.
+ *
+ * @returns Returns 0 on success.
+ */
+int auth_blacklist_reload(auth_blacklist_t* blacklist, PGconn* conn);
+
+/**
+ * @brief Adds ban locally, e.g. right after it was saved with auth_blacklist_ip(). Does not
+ * move blacklist->last_id, so bans with lower ids saved elsewhere are still loaded.
+ *
+ * @param blacklist Blacklist to add to.
+ * @param id Id of Blacklist row.
+ * @param ip Banned ip.
+ * @param ban_lift Time ban is lifted, 0 if permanent.
+ */
+void auth_blacklist_add(auth_blacklist_t* blacklist, const uint32_t id, const string_t* ip, const time_t ban_lift);
+
+/**
+ * @brief Checks if ip is banned. Safe to call from any thread without locking.
+ *
+ * @param blacklist Blacklist to search.
+ * @param ip Ip of requester.
+ *
+ * @returns Returns id of ban or 0 if ip is not banned.
+ */
+uint32_t auth_blacklist_lookup(auth_blacklist_t* blacklist, const string_t* ip);
+
+/**
+ * @brief Loads blacklist and starts a thread which polls for new bans and fully reloads
+ * it every \ref AUTH_BLACKLIST_RELOAD_REFRESHES polls.
+ *
+ * @param blacklist Blacklist to refresh.
+ * @param conn_info Connection info used by refresh thread.
+ * @param interval Time in milliseconds between polls.
+ *
+ * @returns Returns 0 if initial load succeeded and thread was started.
+ */
+int auth_blacklist_start_refresh(auth_blacklist_t* blacklist, const char* conn_info, const int64_t interval);
+
+/**
+ * @brief Stops refresh thread and frees blacklist.
+ *
+ * @param blacklist Double pointer to blacklist. Will be set to NULL.
+ */
+void auth_blacklist_free(auth_blacklist_t** blacklist);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_AUTH_INCLUDE_RADICLE_AUTH_BLACKLIST_H
+
+/** @} */
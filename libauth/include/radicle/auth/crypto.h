@@ -28,9 +28,13 @@
 #define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_CRYPTO_H 
 
 #include <stddef.h>
+#include <stdbool.h>
+
+#include <argon2.h>
 
 #include "radicle/types/string.h"
 #include "radicle/auth/types.h"
+#include "radicle/auth/base64.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -46,6 +50,63 @@ extern "C" {
  */
 #define HMAC_LENGTH 128 // sha512 results in a hex string of size 128
 
+/**
+ * @brief Size of binary HMAC-sha512 digest.
+ */
+#define HMAC_DIGEST_SIZE (HMAC_LENGTH / 2)
+
+/**
+ * @brief Version byte compact cookies start with.
+ */
+#define AUTH_COMPACT_COOKIE_VERSION 1
+
+/**
+ * @brief Amount of random bytes identifying a compact session. Stored as bytea in Sessions.token_id.
+ */
+#define AUTH_COMPACT_TOKEN_SIZE 16
+
+/**
+ * @brief Amount of bytes hmac-sha512 is truncated to in compact cookies.
+ */
+#define AUTH_COMPACT_MAC_SIZE 16
+
+/**
+ * @brief Length of base64url encoded version, token and truncated mac.
+ */
+#define AUTH_COMPACT_COOKIE_LENGTH 44
+
+#define AUTH_COMPACT_COOKIE_INVALID_SIGNATURE 2
+
+/**
+ * @brief Amount of argon2 passes per password hash.
+ */
+#define AUTH_PASSWORD_TIME_COST 2
+
+/**
+ * @brief Memory in kibibytes every password hash allocates.
+ */
+#define AUTH_PASSWORD_MEMORY_COST (1<<16) // 64 mebibytes
+
+/**
+ * @brief Amount of argon2 lanes and threads per password hash.
+ */
+#define AUTH_PASSWORD_PARALLELISM 2
+
+/**
+ * @brief Argon2 settings used for new password hashes.
+ */
+typedef struct auth_password_params {
+	argon2_type type; /**< Argon2 variant. */
+	uint32_t time_cost; /**< Amount of passes. */
+	uint32_t memory_cost; /**< Memory in kibibytes. */
+	uint32_t parallelism; /**< Amount of lanes and threads. */
+} auth_password_params_t;
+
+/**
+ * @brief Initializer for \ref auth_password_params_t with the compiled in defaults.
+ */
+#define AUTH_PASSWORD_PARAMS_DEFAULT { Argon2_i, AUTH_PASSWORD_TIME_COST, AUTH_PASSWORD_MEMORY_COST, AUTH_PASSWORD_PARALLELISM }
+
 /**
  * @brief Generates a \ref auth_cookie_t with the given key.
  *
@@ -66,6 +127,35 @@ int auth_generate_session_cookie(const string_t* key, auth_cookie_t** cookie);
  */
 int auth_split_cookie(const string_t* cookie,  auth_cookie_t** result);
 
+/**
+ * @brief Generates a compact cookie: version, random token and truncated mac, base64url encoded
+ * into \ref AUTH_COMPACT_COOKIE_LENGTH chars. Mac only depends on key, so forged cookies are
+ * rejected before asking the database.
+ *
+ * @param key Key which will be used for the hmac-sha512 hash.
+ * @param token Buffer of \ref AUTH_COMPACT_TOKEN_SIZE bytes for the generated token.
+ * @param cookie Pointer to resulting cookie.
+ *
+ * @return Returns 0 on success.
+ */
+int auth_generate_compact_cookie(const string_t* key, unsigned char* token, string_t** cookie);
+
+/**
+ * @brief Checks if cookie has the length of a compact cookie. Signature is not checked.
+ */
+bool auth_is_compact_cookie(const string_t* cookie);
+
+/**
+ * @brief Decodes a compact cookie and verifies its mac.
+ *
+ * @param key Key cookie was signed with.
+ * @param cookie Raw cookie.
+ * @param token Buffer of \ref AUTH_COMPACT_TOKEN_SIZE bytes for the token.
+ *
+ * @returns Returns 0 on success, \ref AUTH_COMPACT_COOKIE_INVALID_SIGNATURE if mac does not match, otherwise 1.
+ */
+int auth_split_compact_cookie(const string_t* key, const string_t* cookie, unsigned char* token);
+
 /**
  * Generates a secure random session id and converts it to base64.
  *
@@ -78,7 +168,7 @@ int auth_split_cookie(const string_t* cookie,  auth_cookie_t** result);
 int auth_generate_random_base64(const int rand_bytes, string_t** buffer);
 
 /**
- * Generates a secure random session id and converts it to base64 url safe.
+ * Generates a secure random session id and converts it to base64url without padding.
  *
  * @param rand_bytes Length to use for generating random bytes. buffer will not be of this length, due to the convertion to base64.
  * @param buffer Double pointer to char buffer, resulting base64 char array will be stored here.
@@ -89,7 +179,7 @@ int auth_generate_random_base64(const int rand_bytes, string_t** buffer);
 int auth_generate_random_base64_url_safe(const int rand_bytes, string_t** buffer);
 
 /**
- * @brief Creates a hash using Argon2i.
+ * @brief Creates a hash using Argon2i with the compiled in defaults.
  *
  * @param password Raw password string.
  * @param buffer Pointer to resulting hashed password, encoded alongside argon2 parameters. 
@@ -98,6 +188,15 @@ int auth_generate_random_base64_url_safe(const int rand_bytes, string_t** buffer
  */
 int auth_hash_password(const string_t* password, string_t** buffer);
 
+/**
+ * @brief Same as \ref auth_hash_password, but uses \p params instead of the defaults.
+ *
+ * @param params Argon2 settings.
+ *
+ * @see auth_hash_password()
+ */
+int auth_hash_password_with(const auth_password_params_t* params, const string_t* password, string_t** buffer);
+
 /**
  * @brief Verifies if password matches prehashed password.
  *
@@ -109,25 +208,48 @@ int auth_hash_password(const string_t* password, string_t** buffer);
 int auth_verify_password(const string_t* encoded, const string_t* password);
 
 /**
- * @brief Takes a string as input and converts it to base64.
+ * @brief Checks if encoded hash was created with other settings than \p params.
  *
- * @param input Input string or bytes.
- * @param length Length of input.
- * @param buffer Double pointer to buffer to write to.
+ * @param encoded Encoded argon2 password string.
+ * @param params Argon2 settings new hashes are created with.
+ *
+ * @returns Returns true if hash should be replaced. Hashes which cant be parsed are left alone.
+ */
+bool auth_password_needs_rehash(const string_t* encoded, const auth_password_params_t* params);
+
+/**
+ * @brief Picks time and memory cost so a single hash takes about \p target_in_ms on this machine.
+ * Memory cost is only lowered if a single pass with it already exceeds the target.
+ *
+ * @param params Settings to adjust. Type and parallelism are kept.
+ * @param target_in_ms Desired duration of a single hash.
  *
  * @returns Returns 0 on success.
  */
-int base64_encode(const unsigned char* input, size_t length, string_t** buffer);
+int auth_password_params_calibrate(auth_password_params_t* params, const int target_in_ms);
 
 /**
- * @brief Takes a base64 as input and converts it back to its original bytes.
+ * @brief Same as \ref hmac_sign_salted_hex, but writes the binary digest, e.g. to truncate it.
+ *
+ * @param output Buffer of at least \ref HMAC_DIGEST_SIZE bytes.
+ *
+ * @returns Returns 0 on success.
+ */
+int hmac_sign_salted_raw(const string_t* key, const string_t* salt, const unsigned char* input, const size_t input_length, unsigned char* output);
+
+/**
+ * @brief Signs input with key followed by salt using hmac-sha512 and writes the hex digest to
+ * \p output. Uses a context kept per thread and allocates nothing for keys of usual length.
+ *
+ * @param key Key to use for signing.
+ * @param salt Appended to key, may be NULL.
+ * @param input Bytes to sign.
+ * @param input_length Length of input.
+ * @param output Buffer of at least \ref HMAC_LENGTH + 1 chars. Will be null terminated.
  *
- * @param input Input base64 string.
- * @param buffer Double pointer to buffer to write to.
- * 
  * @returns Returns 0 on success.
  */
-int base64_decode(const string_t* base64, string_t** buffer);
+int hmac_sign_salted_hex(const string_t* key, const string_t* salt, const unsigned char* input, const size_t input_length, char* output);
 
 /**
  * @brief Signs an input bytes array with the given key using hmac-sha512.
@@ -142,7 +264,7 @@ int base64_decode(const string_t* base64, string_t** buffer);
 int hmac_sign(const unsigned char* input, const size_t input_length, const string_t* key, string_t** buffer);
 
 /**
- * @brief Check if a hmac signed signature matches any given input.
+ * @brief Check if a hmac signed signature matches any given input. Comparison takes constant time.
  *
  * @param key Key used to create signature.
  * @param signature Expected signature hash.
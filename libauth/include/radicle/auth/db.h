@@ -28,12 +28,15 @@
 #define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_DB_H 
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #include <libpq-fe.h>
 
 #include "radicle/types/string.h"
 #include "radicle/types/uuid.h"
 #include "radicle/types/linked_list.h"
+#include "radicle/pgdb/copy.h"
 #include "radicle/auth/types.h"
 
 #if defined(__cplusplus)
@@ -103,6 +106,20 @@ int auth_save_token(PGconn* conn, const uuid_t* owner, const string_t* token, to
  */
 int auth_save_session(PGconn* conn, const uuid_t* owner, const string_t* token, const time_t expires, const string_t* salt, uint32_t* id);
 
+/**
+ * @brief Saves a session identified by a binary token and returns its row id. The token goes to
+ * Sessions.token_id, a bytea column with a unique index, token and salt are left NULL.
+ *
+ * @param conn Connection to database.
+ * @param owner Owner uuid of session. Can be null.
+ * @param token \ref AUTH_COMPACT_TOKEN_SIZE random bytes.
+ * @param expires Time session expires.
+ * @param id Returned row id of session.
+ *
+ * @returns Returns 0 on success.
+ */
+int auth_save_compact_session(PGconn* conn, const uuid_t* owner, const unsigned char* token, const time_t expires, uint32_t* id);
+
 /**
  * @brief Saves session access to database.
  *
@@ -115,6 +132,28 @@ int auth_save_session(PGconn* conn, const uuid_t* owner, const string_t* token,
  */
 int auth_save_session_access(PGconn* conn, const uint32_t session_id, const auth_request_log_t* request_log);
 
+/**
+ * @brief Creates a writer which saves session accesses in bulk using COPY.
+ *
+ * @param conn Connection to database. Can be NULL and set before flushing.
+ * @param max_rows Flush after this many accesses. 0 disables the limit.
+ * @param max_bytes Flush after this many bytes. 0 disables the limit.
+ *
+ * @returns Returns new writer.
+ */
+pgdb_copy_writer_t* auth_session_access_writer_new(PGconn* conn, const int max_rows, const size_t max_bytes);
+
+/**
+ * @brief Same as \ref auth_save_session_access, but appends access to \p writer.
+ *
+ * @param writer Writer created by auth_session_access_writer_new().
+ * @param session_id Row id of session.
+ * @param request_log Request to save.
+ *
+ * @returns Returns 0 on success.
+ */
+int auth_copy_session_access(pgdb_copy_writer_t* writer, const uint32_t session_id, const auth_request_log_t* request_log);
+
 /**
  * @brief Deletes all registration tokens linked to owner.
  *
@@ -175,6 +214,41 @@ int auth_get_account_by_email(PGconn* conn, const string_t* email, auth_account_
  */
 int auth_get_session_by_cookie(PGconn* conn, const string_t* cookie, uint32_t* id, string_t** salt, auth_account_t** account);
 
+/**
+ * @brief Same as \ref auth_get_session_by_cookie, but looks up session by binary token of a compact cookie.
+ *
+ * @param conn Connection to database.
+ * @param token \ref AUTH_COMPACT_TOKEN_SIZE bytes of token.
+ * @param id ID of queried session, 0 if not found.
+ * @param account Account to be set if session has an owner.
+ * 
+ * @returns Returns 0 on success.
+ */
+int auth_get_session_by_token_id(PGconn* conn, const unsigned char* token, uint32_t* id, auth_account_t** account);
+
+/**
+ * @brief Retrieves account by its uuid.
+ *
+ * @param conn Connection to database.
+ * @param uuid Account to find.
+ * @param account Double pointer to account, NULL if it does not exist. Will have to be freed after use.
+ *
+ * @returns Returns 0 on success.
+ */
+int auth_get_account_by_uuid(PGconn* conn, const uuid_t* uuid, auth_account_t** account);
+
+/**
+ * @brief Checks if session is neither expired nor revoked and if its owner is still active.
+ *
+ * @param conn Connection to database.
+ * @param id ID of session.
+ * @param valid Set to true if session exists, is not revoked and not expired.
+ * @param active Set to false if owner was deactivated, true for sessions without owner.
+ *
+ * @returns Returns 0 on success.
+ */
+int auth_get_session_state(PGconn* conn, const uint32_t id, bool* valid, bool* active);
+
 /**
  * @brief Saves ip to blacklist and retrieves id.
  *
@@ -200,6 +274,41 @@ int auth_blacklist_ip(PGconn* conn, const string_t* ip, const time_t date, const
  */
 int auth_save_blacklist_access(PGconn* conn, const int id, const time_t date, const string_t* url);
 
+/**
+ * @brief Retrieves all bans which are still in effect and were added after \p after_id.
+ *
+ * @param conn Connection to database.
+ * @param after_id Only rows with a greater id are returned. Pass 0 for all.
+ * @param now Bans lifted before this time are skipped.
+ * @param results List of \ref auth_blacklist_entry_t ordered by id. NULL if there are none.
+ *
+ * @return Returns 0 on success
+ */
+int auth_blacklist_fetch(PGconn* conn, const uint32_t after_id, const time_t now, list_t** results);
+
+/**
+ * @brief Retrieves ids of all revoked sessions which did not expire yet.
+ *
+ * @param conn Connection to database.
+ * @param now Sessions expired before this time are skipped.
+ * @param ids Set to new array of ids, NULL if there are none. Will have to be freed after use.
+ * @param count Amount of ids.
+ *
+ * @return Returns 0 on success
+ */
+int auth_revoked_sessions_fetch(PGconn* conn, const time_t now, uint32_t** ids, size_t* count);
+
+/**
+ * @brief Retrieves uuids of all deactivated accounts.
+ *
+ * @param conn Connection to database.
+ * @param accounts Set to new array of uuids, NULL if there are none. Will have to be freed after use.
+ * @param count Amount of uuids.
+ *
+ * @return Returns 0 on success
+ */
+int auth_inactive_accounts_fetch(PGconn* conn, uuid_t** accounts, size_t* count);
+
 /**
  * @brief Lookups if given ip is currently  blacklisted
  *
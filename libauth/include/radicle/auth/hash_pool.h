@@ -0,0 +1,166 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Bounded executor for password hashing.
+ * @author Nils Egger
+ * @addtogroup Auth
+ * @{
+ */
+
+#ifndef RADICLE_AUTH_INCLUDE_RADICLE_AUTH_HASH_POOL_H
+#define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_HASH_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "radicle/types/string.h"
+#include "radicle/auth/crypto.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Returned if pool has no room left for another job.
+ */
+#define AUTH_HASH_POOL_BUSY 2
+
+/**
+ * @brief Kind of work a job does.
+ */
+typedef enum auth_hash_job_type {
+	AUTH_HASH_JOB_HASH, /**< Hashes password with a fresh salt. */
+	AUTH_HASH_JOB_VERIFY /**< Verifies password against encoded hash. */
+} auth_hash_job_type_t;
+
+/**
+ * @brief Single hash or verify request. Lives on the stack of the submitting thread.
+ */
+typedef struct auth_hash_job {
+	auth_hash_job_type_t type; /**< Kind of work. */
+	const string_t* password; /**< Raw password. */
+	const string_t* encoded; /**< Encoded hash to verify against. */
+	string_t* result; /**< Encoded hash of a finished hash job. */
+	int error; /**< Return value of hashing function. */
+	bool done; /**< Set by worker once job finished. */
+	struct auth_hash_job* next; /**< Next job in queue. */
+} auth_hash_job_t;
+
+/**
+ * @brief Fixed amount of workers which run argon2. Since every hash allocates its memory cost,
+ * the amount of workers is capped by a memory budget. Jobs which find the queue full are
+ * rejected right away instead of piling up.
+ *
+ * @see auth_hash_pool_new()
+ * @see auth_hash_pool_free()
+ */
+typedef struct auth_hash_pool {
+	auth_password_params_t params; /**< Settings for new hashes. */
+	string_t* dummy; /**< Hash of a random password created with params, NULL if hashing failed. */
+	pthread_t* threads; /**< Worker threads. */
+	int workers; /**< Amount of worker threads, 0 runs jobs on submitting thread. */
+	size_t queue_depth; /**< Max amount of jobs waiting for a worker. */
+	size_t queued; /**< Amount of jobs waiting for a worker. */
+	auth_hash_job_t* head; /**< Next job to run. */
+	auth_hash_job_t* tail; /**< Last job to run. */
+	pthread_mutex_t lock; /**< Guards queue. */
+	pthread_cond_t wakeup; /**< Signals workers about new jobs. */
+	pthread_cond_t finished; /**< Signals submitters about finished jobs. */
+	bool running; /**< False once pool is shutting down. */
+} auth_hash_pool_t;
+
+/**
+ * @brief Creates pool and starts its workers.
+ *
+ * @param workers Max amount of hashes computed at once. If 0, jobs run on the submitting thread.
+ * @param queue_depth Max amount of jobs waiting for a worker.
+ * @param memory_budget Max amount of memory in kibibytes all concurrent hashes may use. Lowers
+ * amount of workers if necessary, but at least one worker is started.
+ * @param params Settings for new hashes, NULL uses \ref AUTH_PASSWORD_PARAMS_DEFAULT.
+ *
+ * @returns Returns new pool or NULL if no worker could be started.
+ */
+auth_hash_pool_t* auth_hash_pool_new(const int workers, const size_t queue_depth, const size_t memory_budget, const auth_password_params_t* params);
+
+/**
+ * @brief Hashes password on a worker and waits for it. Runs inline with the default settings if
+ * pool is NULL.
+ *
+ * @param pool Pool to run on, may be NULL.
+ * @param password Raw password.
+ * @param buffer Pointer to resulting encoded hash.
+ *
+ * @returns Returns 0 on success, \ref AUTH_HASH_POOL_BUSY if queue is full.
+ *
+ * @see auth_hash_password()
+ */
+int auth_hash_pool_hash(auth_hash_pool_t* pool, const string_t* password, string_t** buffer);
+
+/**
+ * @brief Verifies password on a worker and waits for it. Runs inline if pool is NULL.
+ *
+ * @param pool Pool to run on, may be NULL.
+ * @param encoded Encoded argon2 password string.
+ * @param password Raw password to validate.
+ *
+ * @returns Returns 0 if password matches, \ref AUTH_HASH_POOL_BUSY if queue is full.
+ *
+ * @see auth_verify_password()
+ */
+int auth_hash_pool_verify(auth_hash_pool_t* pool, const string_t* encoded, const string_t* password);
+
+/**
+ * @brief Checks if encoded hash was created with other settings than pool uses for new hashes.
+ *
+ * @param pool Pool to compare with, may be NULL.
+ * @param encoded Encoded argon2 password string.
+ *
+ * @returns Returns true if hash should be replaced.
+ *
+ * @see auth_password_needs_rehash()
+ */
+bool auth_hash_pool_needs_rehash(const auth_hash_pool_t* pool, const string_t* encoded);
+
+/**
+ * @brief Verifies password against a hash no password matches. Costs the same as a real verify,
+ * so callers can hide whether an account exists.
+ *
+ * @param pool Pool to run on, may be NULL.
+ * @param password Raw password.
+ *
+ * @returns Returns 1, or \ref AUTH_HASH_POOL_BUSY if queue is full.
+ */
+int auth_hash_pool_verify_dummy(auth_hash_pool_t* pool, const string_t* password);
+
+/**
+ * @brief Finishes all queued jobs, stops workers and frees pool.
+ *
+ * @param pool Double pointer to pool. Will be set to NULL.
+ */
+void auth_hash_pool_free(auth_hash_pool_t** pool);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_AUTH_INCLUDE_RADICLE_AUTH_HASH_POOL_H
+
+/** @} */
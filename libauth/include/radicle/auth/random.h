@@ -0,0 +1,73 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Buffered cryptographically secure random bytes and tokens.
+ * @author Nils Egger
+ * @addtogroup Auth
+ * @{
+ */
+
+#ifndef RADICLE_AUTH_INCLUDE_RADICLE_AUTH_RANDOM_H
+#define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_RANDOM_H
+
+#include <stddef.h>
+
+#include "radicle/auth/base64.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Amount of random bytes every thread fetches from OpenSSL at once.
+ */
+#define AUTH_RANDOM_BUFFER_SIZE 4096
+
+/**
+ * @brief Fills \p output with random bytes. Small requests are served from a buffer kept per
+ * thread, which is refilled with RAND_bytes and discarded in the child after a fork. Handed out
+ * bytes are wiped from the buffer.
+ *
+ * @param output Buffer to fill.
+ * @param length Amount of bytes to write.
+ *
+ * @returns Returns 0 on success.
+ */
+int auth_random_bytes(unsigned char* output, const size_t length);
+
+/**
+ * @brief Writes an encoded random token into \p output without any allocation. Large tokens
+ * are generated and encoded in chunks.
+ *
+ * @param bytes Amount of random bytes in token.
+ * @param alphabet Alphabet to encode with.
+ * @param output Buffer of at least \ref base64_encoded_length() + 1 chars. Will be null terminated.
+ *
+ * @returns Returns length of token or 0 on failure.
+ */
+size_t auth_random_token(const size_t bytes, const base64_alphabet_t alphabet, char* output);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_AUTH_INCLUDE_RADICLE_AUTH_RANDOM_H
+
+/** @} */
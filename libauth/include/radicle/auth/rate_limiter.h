@@ -0,0 +1,123 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief In memory per ip request counter.
+ * @author Nils Egger
+ * @addtogroup Auth
+ * @{
+ */
+
+#ifndef RADICLE_AUTH_INCLUDE_RADICLE_AUTH_RATE_LIMITER_H
+#define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_RATE_LIMITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "radicle/types/string.h"
+#include "radicle/auth/blacklist.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Request counter of a single ip.
+ */
+typedef struct auth_rate_limiter_entry {
+	uint64_t hash; /**< Hash of ip. */
+	int64_t window_start; /**< Monotonic time in milliseconds current window started. */
+	uint32_t current; /**< Requests in current window. */
+	uint32_t previous; /**< Requests in previous window. */
+	struct auth_rate_limiter_entry* next; /**< Next entry in same bucket. */
+	char ip[AUTH_BLACKLIST_IP_LENGTH]; /**< Textual ip. */
+} auth_rate_limiter_entry_t;
+
+/**
+ * @brief Part of limiter with its own lock.
+ */
+typedef struct auth_rate_limiter_shard {
+	pthread_mutex_t lock; /**< Guards everything in shard. */
+	auth_rate_limiter_entry_t** buckets; /**< Hash table. */
+	size_t mask; /**< Amount of buckets minus one. */
+	size_t count; /**< Amount of tracked ips. */
+	size_t capacity; /**< Max amount of tracked ips. */
+} __attribute__((aligned(64))) auth_rate_limiter_shard_t;
+
+/**
+ * @brief Sharded sliding window counter. The amount of requests in the last window is estimated
+ * from the count of the current and the weighted count of the previous fixed window, so each ip
+ * costs constant memory no matter how many requests it sends.
+ *
+ * @see auth_rate_limiter_new()
+ * @see auth_rate_limiter_free()
+ */
+typedef struct auth_rate_limiter {
+	auth_rate_limiter_shard_t* shards; /**< Array of shards. */
+	size_t shard_mask; /**< Amount of shards minus one. */
+	uint32_t limit; /**< Max amount of requests per window. */
+	int64_t window; /**< Length of window in milliseconds. */
+} auth_rate_limiter_t;
+
+/**
+ * @brief Creates a new limiter.
+ *
+ * @param limit Max amount of requests per window.
+ * @param window Length of window in seconds.
+ * @param capacity Max amount of ips tracked at once. Ips which dont fit are not limited.
+ * @param shards Amount of independently locked shards. Is rounded up to the next power of two.
+ *
+ * @returns Returns new limiter.
+ */
+auth_rate_limiter_t* auth_rate_limiter_new(const uint32_t limit, const time_t window, const size_t capacity, const int shards);
+
+/**
+ * @brief Counts a request of ip.
+ *
+ * @param limiter Limiter to count at.
+ * @param ip Ip of requester.
+ *
+ * @returns Returns 1 if ip already sent limit or more requests within the last window, otherwise 0.
+ */
+int auth_rate_limiter_hit(auth_rate_limiter_t* limiter, const string_t* ip);
+
+/**
+ * @brief Forgets requests of ip, e.g. after it was banned.
+ *
+ * @param limiter Limiter to reset at.
+ * @param ip Ip of requester.
+ */
+void auth_rate_limiter_reset(auth_rate_limiter_t* limiter, const string_t* ip);
+
+/**
+ * @brief Frees limiter.
+ *
+ * @param limiter Double pointer to limiter. Will be set to NULL.
+ */
+void auth_rate_limiter_free(auth_rate_limiter_t** limiter);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_AUTH_INCLUDE_RADICLE_AUTH_RATE_LIMITER_H
+
+/** @} */
@@ -0,0 +1,141 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file
+ * @brief In memory list of revoked sessions and deactivated accounts.
+ * @author Nils Egger
+ * @addtogroup Auth
+ * @{
+ */
+
+#ifndef RADICLE_AUTH_INCLUDE_RADICLE_AUTH_REVOCATION_LIST_H
+#define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_REVOCATION_LIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/types/retire_list.h"
+#include "radicle/types/uuid.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Amount of missed refreshes after which the list is no longer trusted.
+ */
+#define AUTH_REVOCATION_LIST_STALE_REFRESHES 3
+
+/**
+ * @brief Immutable snapshot, both arrays are sorted and live in the same allocation.
+ */
+typedef struct auth_revocation_table {
+	retire_node_t retire; /**< Must stay first member. */
+	size_t session_count; /**< Amount of revoked sessions. */
+	size_t account_count; /**< Amount of deactivated accounts. */
+	uint32_t* sessions; /**< Ids of revoked sessions. */
+	uuid_t* accounts; /**< Deactivated accounts. */
+} auth_revocation_table_t;
+
+/**
+ * @brief Revocations which still matter for stateless cookies. Lookups never lock, they read
+ * the current table through an atomic pointer and binary search it. Same as \ref auth_blacklist_t,
+ * replaced tables are only freed once no lookup which may have loaded them is left.
+ *
+ * @see auth_revocation_list_new()
+ * @see auth_revocation_list_free()
+ */
+typedef struct auth_revocation_list {
+	auth_revocation_table_t* table; /**< Current table. Only accessed atomically. */
+	pthread_mutex_t lock; /**< Serializes writers. */
+	retire_list_t* retired; /**< Replaced tables and lookups which may still read them. */
+	time_t loaded; /**< Monotonic time in seconds of last complete load, 0 if never loaded. Only accessed atomically. */
+	char* conn_info; /**< Connection info of refresh thread. */
+	PGconn* conn; /**< Connection owned by refresh thread. */
+	int64_t refresh_interval; /**< Time in milliseconds between refreshes. */
+	pthread_t thread; /**< Refresh thread. */
+	pthread_cond_t wakeup; /**< Used to stop refresh thread early. */
+	bool running; /**< True while refresh thread is running. */
+} auth_revocation_list_t;
+
+/**
+ * @brief Creates an empty list, which is not fresh until first loaded.
+ *
+ * @returns Returns new list or NULL if no thread specific key is left.
+ */
+auth_revocation_list_t* auth_revocation_list_new();
+
+/**
+ * @brief Replaces list with all revoked, unexpired sessions and all deactivated accounts.
+ *
+ * @param list List to update.
+ * @param conn Connection to database.
+ *
+ * @returns Returns 0 on success.
+ */
+int auth_revocation_list_load(auth_revocation_list_t* list, PGconn* conn);
+
+/**
+ * @brief Checks if list was loaded recently enough to be trusted instead of the database.
+ *
+ * @returns Returns false if list was never loaded or the last \ref AUTH_REVOCATION_LIST_STALE_REFRESHES refreshes failed.
+ */
+bool auth_revocation_list_is_fresh(auth_revocation_list_t* list);
+
+/**
+ * @brief Checks if session was revoked. Safe to call from any thread without locking.
+ */
+bool auth_revocation_list_session_revoked(auth_revocation_list_t* list, const uint32_t session);
+
+/**
+ * @brief Checks if account was deactivated. Safe to call from any thread without locking.
+ */
+bool auth_revocation_list_account_revoked(auth_revocation_list_t* list, const uuid_t* account);
+
+/**
+ * @brief Loads list and starts a thread which reloads it periodically.
+ *
+ * @param list List to refresh.
+ * @param conn_info Connection info used by refresh thread.
+ * @param interval Time in milliseconds between reloads.
+ *
+ * @returns Returns 0 if initial load succeeded and thread was started.
+ */
+int auth_revocation_list_start_refresh(auth_revocation_list_t* list, const char* conn_info, const int64_t interval);
+
+/**
+ * @brief Stops refresh thread and frees list.
+ *
+ * @param list Double pointer to list. Will be set to NULL.
+ */
+void auth_revocation_list_free(auth_revocation_list_t** list);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_AUTH_INCLUDE_RADICLE_AUTH_REVOCATION_LIST_H
+
+/** @} */
@@ -0,0 +1,148 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief In process cache of verified session cookies.
+ * @author Nils Egger
+ * @addtogroup Auth
+ * @{
+ */
+
+#ifndef RADICLE_AUTH_INCLUDE_RADICLE_AUTH_SESSION_CACHE_H
+#define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_SESSION_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "radicle/types/string.h"
+#include "radicle/types/uuid.h"
+#include "radicle/auth/types.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Cached session. Only stored after its cookie passed verification.
+ */
+typedef struct auth_session_cache_entry {
+	uint64_t hash; /**< Hash of token. */
+	string_t* token; /**< Session token, key of entry. */
+	string_t* signature; /**< Signature of cookie which was verified against salt of session. */
+	uint32_t session_id; /**< Id of session. */
+	auth_account_t* account; /**< Snapshot of owner without password, NULL for free sessions. */
+	time_t expires; /**< Monotonic time in seconds after which entry is ignored. */
+	struct auth_session_cache_entry* next; /**< Next entry in same bucket. */
+	struct auth_session_cache_entry* newer; /**< Next more recently used entry. */
+	struct auth_session_cache_entry* older; /**< Next less recently used entry. */
+} auth_session_cache_entry_t;
+
+/**
+ * @brief Part of cache with its own lock, so requests for different sessions rarely contend.
+ */
+typedef struct auth_session_cache_shard {
+	pthread_mutex_t lock; /**< Guards everything in shard. */
+	auth_session_cache_entry_t** buckets; /**< Hash table. */
+	size_t mask; /**< Amount of buckets minus one. */
+	auth_session_cache_entry_t* newest; /**< Most recently used entry. */
+	auth_session_cache_entry_t* oldest; /**< Least recently used entry, evicted first. */
+	size_t count; /**< Amount of entries. */
+	size_t capacity; /**< Max amount of entries. */
+} __attribute__((aligned(64))) auth_session_cache_shard_t;
+
+/**
+ * @brief Sharded LRU cache with time to live, mapping session tokens to session id and owner.
+ *
+ * @see auth_session_cache_new()
+ * @see auth_session_cache_free()
+ */
+typedef struct auth_session_cache {
+	auth_session_cache_shard_t* shards; /**< Array of shards. */
+	size_t shard_mask; /**< Amount of shards minus one. */
+	time_t ttl; /**< Time in seconds an entry stays valid. */
+} auth_session_cache_t;
+
+/**
+ * @brief Creates a new cache.
+ *
+ * @param capacity Max amount of cached sessions.
+ * @param ttl Time in seconds after which a session has to be verified against the database again.
+ * @param shards Amount of independently locked shards. Is rounded up to the next power of two.
+ *
+ * @returns Returns new cache or NULL if capacity is 0.
+ */
+auth_session_cache_t* auth_session_cache_new(const size_t capacity, const time_t ttl, const int shards);
+
+/**
+ * @brief Looks up token. Is only a hit if signature equals the one verified when the entry was added.
+ *
+ * @param cache Cache to search.
+ * @param token Token of cookie.
+ * @param signature Signature of cookie.
+ * @param session_id Will be set to id of session on hit.
+ * @param account Will be set to a copy of cached account on hit. Stays NULL for free sessions.
+ *
+ * @returns Returns 0 on hit and 1 on miss.
+ */
+int auth_session_cache_get(auth_session_cache_t* cache, const string_t* token, const string_t* signature, uint32_t* session_id, auth_account_t** account);
+
+/**
+ * @brief Adds or replaces session. Least recently used session of shard is evicted if it is full.
+ *
+ * @param cache Cache to add to.
+ * @param token Token of cookie.
+ * @param signature Verified signature of cookie.
+ * @param session_id Id of session.
+ * @param account Owner of session or NULL. Password is not copied.
+ */
+void auth_session_cache_put(auth_session_cache_t* cache, const string_t* token, const string_t* signature, const uint32_t session_id, const auth_account_t* account);
+
+/**
+ * @brief Removes session, e.g. after it was revoked.
+ *
+ * @param cache Cache to remove from.
+ * @param token Token of session.
+ */
+void auth_session_cache_remove(auth_session_cache_t* cache, const string_t* token);
+
+/**
+ * @brief Removes all sessions owned by account. Has to be called whenever the account
+ * changes, e.g. password, email, verification or deactivation.
+ *
+ * @param cache Cache to remove from.
+ * @param owner Uuid of account.
+ */
+void auth_session_cache_remove_account(auth_session_cache_t* cache, const uuid_t* owner);
+
+/**
+ * @brief Frees all entries and the cache itself.
+ *
+ * @param cache Double pointer to cache. Will be set to NULL.
+ */
+void auth_session_cache_free(auth_session_cache_t** cache);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_AUTH_INCLUDE_RADICLE_AUTH_SESSION_CACHE_H
+
+/** @} */
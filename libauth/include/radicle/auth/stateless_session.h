@@ -0,0 +1,138 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file
+ * @brief Session cookies which carry their own session data.
+ * @author Nils Egger
+ * @addtogroup Auth
+ * @{
+ */
+
+#ifndef RADICLE_AUTH_INCLUDE_RADICLE_AUTH_STATELESS_SESSION_H
+#define RADICLE_AUTH_INCLUDE_RADICLE_AUTH_STATELESS_SESSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "radicle/types/string.h"
+#include "radicle/types/uuid.h"
+#include "radicle/auth/types.h"
+#include "radicle/auth/crypto.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Version byte every payload starts with.
+ */
+#define AUTH_STATELESS_SESSION_VERSION 2
+
+/**
+ * @brief Size of binary payload: version, flags, role, session id, expiration and owner.
+ */
+#define AUTH_STATELESS_SESSION_PAYLOAD_SIZE 31
+
+/**
+ * @brief Amount of bytes hmac-sha512 of payload is truncated to.
+ */
+#define AUTH_STATELESS_SESSION_MAC_SIZE 16
+
+/**
+ * @brief Length of complete cookie, payload followed by mac, base64url encoded.
+ */
+#define AUTH_STATELESS_SESSION_COOKIE_LENGTH 63
+
+#define AUTH_STATELESS_SESSION_OK 0
+#define AUTH_STATELESS_SESSION_MALFORMED 1
+#define AUTH_STATELESS_SESSION_INVALID_SIGNATURE 2
+#define AUTH_STATELESS_SESSION_EXPIRED 3
+
+/**
+ * @brief Everything a stateless cookie vouches for.
+ */
+typedef struct auth_stateless_session {
+	uint32_t id; /**< Id of Sessions row, used for access logging and revocation. */
+	bool owned; /**< False for sessions without account. */
+	uuid_t owner; /**< Account of session, zeroed if not owned. */
+	auth_account_role_t role; /**< Role of owner when cookie was issued. */
+	bool verified; /**< Verification status of owner when cookie was issued. */
+	time_t expires; /**< Time after which cookie is no longer accepted. */
+} auth_stateless_session_t;
+
+/**
+ * @brief Checks if cookie has the shape of a stateless cookie. Signature is not checked.
+ *
+ * @param cookie Raw cookie.
+ *
+ * @returns Returns true if cookie should be parsed with auth_stateless_session_parse().
+ */
+bool auth_stateless_session_is_cookie(const string_t* cookie);
+
+/**
+ * @brief Encodes session and signs it with key.
+ *
+ * @param key Signature key.
+ * @param session Session to encode.
+ * @param cookie Will point to new cookie of length \ref AUTH_STATELESS_SESSION_COOKIE_LENGTH.
+ *
+ * @returns Returns 0 on success.
+ */
+int auth_stateless_session_sign(const string_t* key, const auth_stateless_session_t* session, string_t** cookie);
+
+/**
+ * @brief Verifies signature and expiration of cookie and decodes it.
+ *
+ * @param key Signature key.
+ * @param cookie Raw cookie.
+ * @param session Buffer for decoded session.
+ *
+ * @returns Returns \ref AUTH_STATELESS_SESSION_OK or one of the AUTH_STATELESS_SESSION_* errors.
+ */
+int auth_stateless_session_parse(const string_t* key, const string_t* cookie, auth_stateless_session_t* session);
+
+/**
+ * @brief Creates account from session claims. Email, password and creation date are unknown
+ * and left empty, account is assumed to be active.
+ *
+ * @param session Session with owner.
+ *
+ * @returns Returns new account or NULL if session has no owner.
+ */
+auth_account_t* auth_stateless_session_account(const auth_stateless_session_t* session);
+
+/**
+ * @brief Same as auth_stateless_session_account(), but allocates account from \p arena.
+ *
+ * @param arena Arena to allocate from.
+ * @param session Session with owner.
+ *
+ * @returns Returns new account or NULL if session has no owner or arena is out of memory.
+ */
+auth_account_t* auth_stateless_session_account_arena(arena_t* arena, const auth_stateless_session_t* session);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_AUTH_INCLUDE_RADICLE_AUTH_STATELESS_SESSION_H
+
+/** @} */
@@ -78,6 +78,16 @@ typedef struct auth_account {
  */
 auth_account_t* auth_account_new(uuid_t* uuid, string_t* email, string_t* password, auth_account_role_t role, bool active, bool verified, time_t created);
 
+/**
+ * @brief Same as auth_account_new(), but the account and its copied values are allocated from \p arena.
+ * Must not be passed to auth_account_free().
+ *
+ * @param arena Arena to allocate from.
+ *
+ * @returns Returns a new pointer to \ref auth_account_t or NULL if arena is out of memory.
+ */
+auth_account_t* auth_account_new_arena(arena_t* arena, const uuid_t* uuid, const string_t* email, const string_t* password, auth_account_role_t role, bool active, bool verified, time_t created);
+
 /**
  * @brief Frees all associated data of account_t and sets pointer to NULL.
  *
@@ -111,6 +121,16 @@ typedef struct auth_request_log {
  */
 auth_request_log_t* auth_request_log_new();
 
+/**
+ * @brief Same as auth_request_log_new(), but allocates from \p arena. Strings assigned to it have to
+ * come from the same arena. Must not be passed to auth_request_log_free().
+ *
+ * @param arena Arena to allocate from.
+ *
+ * @returns Returns pointer to new \ref auth_request_log_t or NULL if arena is out of memory.
+ */
+auth_request_log_t* auth_request_log_new_arena(arena_t* arena);
+
 /**
  * @brief Calculates time since \ref auth_reqeust_log_new was called. Time is given in microseconds.
  *
@@ -175,6 +195,17 @@ typedef struct auth_session_access_entry {
 
 void auth_session_access_entry_free(void* ptr);
 
+/**
+ * @brief Row of Blacklist table.
+ */
+typedef struct auth_blacklist_entry {
+	uint32_t id; /**< Identifier of row. */
+	string_t* ip; /**< Banned ip. */
+	time_t ban_lift; /**< Time ban is lifted, 0 if ban is permanent. */
+} auth_blacklist_entry_t;
+
+void auth_blacklist_entry_free(void* ptr);
+
 typedef enum file_type {
 	FILE_TYPE_UNKNOWN=0b0,
 	FILE_TYPE_IMAGE_JPEG=0b1,
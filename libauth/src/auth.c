@@ -23,7 +23,10 @@
 #include "radicle/print.h"
 #include "radicle/pgdb.h"
 #include "radicle/auth/crypto.h"
+#include "radicle/auth/random.h"
 #include "radicle/auth/db.h"
+#include "radicle/auth/session_cache.h"
+#include "radicle/auth/stateless_session.h"
 #include "radicle/auth.h"
 
 auth_errors_t auth_make_owned_session(PGconn* conn, const uuid_t* uuid, const string_t* signature_key, auth_cookie_t** cookie, uint32_t* id) {
@@ -44,6 +47,56 @@ auth_errors_t auth_make_free_session(PGconn* conn, const string_t* signature_key
 	return auth_make_owned_session(conn, NULL, signature_key, cookie, id);
 }
 
+auth_errors_t auth_make_compact_session(PGconn* conn, const uuid_t* uuid, const string_t* signature_key, auth_cookie_t** cookie, uint32_t* id) {
+	unsigned char token[AUTH_COMPACT_TOKEN_SIZE];
+	*cookie = auth_cookie_new_empty();
+	if(auth_generate_compact_cookie(signature_key, token, &(*cookie)->cookie)) {
+		DEBUG("Failed to  generate cookie for session.\n");
+		auth_cookie_free(cookie);
+		return AUTH_ERROR;
+	}
+
+	if(auth_save_compact_session(conn, uuid, token, time(NULL) + SESSION_EXPIRE, id)) {
+		DEBUG("Failed to save session.\n");
+		auth_cookie_free(cookie);
+		return AUTH_ERROR;
+	}
+	return AUTH_OK;
+}
+
+auth_errors_t auth_make_stateless_session(PGconn* conn, const auth_account_t* account, const string_t* signature_key, auth_cookie_t** cookie, uint32_t* id) {
+	auth_stateless_session_t session = { 0 };
+	session.expires = time(NULL) + SESSION_EXPIRE;
+
+	// Token of row is never handed out, it only has to be unique.
+	unsigned char token[AUTH_COMPACT_TOKEN_SIZE];
+	if(auth_random_bytes(token, sizeof(token))) {
+		DEBUG("Failed to generate token for session.\n");
+		return AUTH_ERROR;
+	}
+
+	if(auth_save_compact_session(conn, account != NULL ? account->uuid : NULL, token, session.expires, id)) {
+		DEBUG("Failed to save session.\n");
+		return AUTH_ERROR;
+	}
+
+	session.id = *id;
+	if(account != NULL) {
+		session.owned = true;
+		session.owner = *account->uuid;
+		session.role = account->role;
+		session.verified = account->verified;
+	}
+
+	*cookie = auth_cookie_new_empty();
+	if(auth_stateless_session_sign(signature_key, &session, &(*cookie)->cookie)) {
+		DEBUG("Failed to sign session.\n");
+		auth_cookie_free(cookie);
+		return AUTH_ERROR;
+	}
+	return AUTH_OK;
+}
+
 auth_errors_t auth_log_access(PGconn* conn, const uint32_t session_id, const auth_request_log_t* request_log) {
 	if(auth_save_session_access(conn, session_id, request_log)) {
 		return AUTH_ERROR;
@@ -52,12 +105,17 @@ auth_errors_t auth_log_access(PGconn* conn, const uint32_t session_id, const aut
 }
 
 auth_errors_t auth_register(PGconn* conn, auth_account_t* account) {
+	return auth_register_pooled(conn, NULL, account);
+}
+
+auth_errors_t auth_register_pooled(PGconn* conn, auth_hash_pool_t* pool, auth_account_t* account) {
 
 	string_t* password_hash = NULL;
 
-	if(auth_hash_password(account->password, &password_hash)) {
+	int error = auth_hash_pool_hash(pool, account->password, &password_hash);
+	if(error) {
 		DEBUG("Failed to hash password.\n");
-		return AUTH_ERROR;
+		return error == AUTH_HASH_POOL_BUSY ? AUTH_BUSY : AUTH_ERROR;
 	}
 
 	string_free(&account->password);
@@ -72,14 +130,20 @@ auth_errors_t auth_register(PGconn* conn, auth_account_t* account) {
 }
 
 auth_errors_t auth_update_password(PGconn* conn, const uuid_t* uuid, const string_t* password) {
+	return auth_update_password_pooled(conn, NULL, uuid, password);
+}
+
+auth_errors_t auth_update_password_pooled(PGconn* conn, auth_hash_pool_t* pool, const uuid_t* uuid, const string_t* password) {
 	string_t* password_hash = NULL;
-	if(auth_hash_password(password, &password_hash)) {
+	int error = auth_hash_pool_hash(pool, password, &password_hash);
+	if(error) {
 		DEBUG("Failed to hash password.\n");
-		return AUTH_ERROR;
+		return error == AUTH_HASH_POOL_BUSY ? AUTH_BUSY : AUTH_ERROR;
 	}
 	
-	if(auth_update_account_password(conn, uuid, password)) {
+	if(auth_update_account_password(conn, uuid, password_hash)) {
 		DEBUG("Failed to update password of account.");
+		string_free(&password_hash);
 		return AUTH_ERROR;
 	}
 
@@ -101,21 +165,28 @@ auth_errors_t auth_create_token(PGconn* conn, const uuid_t* owner, const token_t
 }
 
 auth_errors_t auth_sign_in(PGconn* conn, const string_t* email, const string_t* password, auth_account_t** account) {
+	return auth_sign_in_pooled(conn, NULL, email, password, account);
+}
+
+auth_errors_t auth_sign_in_pooled(PGconn* conn, auth_hash_pool_t* pool, const string_t* email, const string_t* password, auth_account_t** account) {
 		
 	if(auth_get_account_by_email(conn, email, account)) {
 		DEBUG("Failed to retrieve account.\n");
 		return AUTH_ERROR;
 	}
 
-	// There is no account linked to the email
-	// Do a fake hash to mislead email finder? what are they called?
+	// There is no account linked to the email. Verifying anyway keeps response time
+	// the same as for a wrong password, so emails cant be enumerated.
 	if(*account == NULL) {
+		if(auth_hash_pool_verify_dummy(pool, password) == AUTH_HASH_POOL_BUSY)
+			return AUTH_BUSY;
 		return AUTH_EMAIL_NOT_FOUND;
 	}
 
-	if(auth_verify_password((*account)->password, password)) {
+	int error = auth_hash_pool_verify(pool, (*account)->password, password);
+	if(error) {
 		auth_account_free(account);
-		return AUTH_INVALID_PASSWORD;
+		return error == AUTH_HASH_POOL_BUSY ? AUTH_BUSY : AUTH_INVALID_PASSWORD;
 	}
 
 	if(!(*account)->active) {
@@ -123,16 +194,73 @@ auth_errors_t auth_sign_in(PGconn* conn, const string_t* email, const string_t*
 		return AUTH_ACCOUNT_NOT_ACTIVE;
 	}
 
+	// Raw password is only known here, so outdated hashes can only be upgraded on sign in.
+	if(auth_hash_pool_needs_rehash(pool, (*account)->password)) {
+		string_t* password_hash = NULL;
+		if(auth_hash_pool_hash(pool, password, &password_hash)) {
+			DEBUG("Failed to rehash password, keeping old hash.\n");
+		} else if(auth_update_account_password(conn, (*account)->uuid, password_hash)) {
+			DEBUG("Failed to store rehashed password, keeping old hash.\n");
+			string_free(&password_hash);
+		} else {
+			string_free(&(*account)->password);
+			(*account)->password = password_hash;
+		}
+	}
+
 	return AUTH_OK;
 }
 
 auth_errors_t auth_verify_cookie(PGconn* conn, const string_t* signature_key, const string_t* cookie, uint32_t* session_id, auth_account_t** account) {
+	return auth_verify_cookie_cached(conn, NULL, signature_key, cookie, session_id, account);
+}
+
+/**
+ * @brief Verifies a cookie created by auth_make_compact_session(). Mac is checked first, so only
+ * authentic tokens reach cache and database. Cache is keyed by the whole cookie.
+ */
+static auth_errors_t auth_verify_compact_cookie_cached(PGconn* conn, auth_session_cache_t* cache, const string_t* signature_key, const string_t* cookie, uint32_t* session_id, auth_account_t** account) {
+	unsigned char token[AUTH_COMPACT_TOKEN_SIZE];
+	int error = auth_split_compact_cookie(signature_key, cookie, token);
+	if(error == AUTH_COMPACT_COOKIE_INVALID_SIGNATURE)
+		return AUTH_INVALID_SIGNATURE;
+	else if(error)
+		return AUTH_INVALID_COOKIE;
+
+	if(cache == NULL || auth_session_cache_get(cache, cookie, cookie, session_id, account)) {
+		if(auth_get_session_by_token_id(conn, token, session_id, account))
+			return AUTH_ERROR;
+		if(*session_id == 0)
+			return AUTH_COOKIE_NOT_FOUND;
+		if(cache != NULL)
+			auth_session_cache_put(cache, cookie, cookie, *session_id, *account);
+	}
+
+	if(*account != NULL && (*account)->active == false) {
+		auth_account_free(account);
+		return AUTH_ACCOUNT_NOT_ACTIVE;
+	}
+	return AUTH_OK;
+}
+
+auth_errors_t auth_verify_cookie_cached(PGconn* conn, auth_session_cache_t* cache, const string_t* signature_key, const string_t* cookie, uint32_t* session_id, auth_account_t** account) {
+	if(auth_is_compact_cookie(cookie))
+		return auth_verify_compact_cookie_cached(conn, cache, signature_key, cookie, session_id, account);
 	
 	auth_cookie_t* cookie_result;
 	if(auth_split_cookie(cookie, &cookie_result)) {
 		return AUTH_INVALID_COOKIE;
 	}
 
+	if(cache != NULL && auth_session_cache_get(cache, cookie_result->token, cookie_result->signature, session_id, account) == 0) {
+		auth_cookie_free(&cookie_result);
+		if(*account != NULL && (*account)->active == false) {
+			auth_account_free(account);
+			return AUTH_ACCOUNT_NOT_ACTIVE;
+		}
+		return AUTH_OK;
+	}
+
 	string_t* session_salt = NULL;
 	if(auth_get_session_by_cookie(conn, cookie_result->token, session_id, &session_salt, account)) {
 		auth_cookie_free(&cookie_result);
@@ -152,6 +280,10 @@ auth_errors_t auth_verify_cookie(PGconn* conn, const string_t* signature_key, co
 		auth_account_free(account);
 		return AUTH_INVALID_SIGNATURE;
 	}
+
+	if(cache != NULL)
+		auth_session_cache_put(cache, cookie_result->token, cookie_result->signature, *session_id, *account);
+
 	string_free(&session_salt);
 	auth_cookie_free(&cookie_result);
 
@@ -166,3 +298,60 @@ auth_errors_t auth_verify_cookie(PGconn* conn, const string_t* signature_key, co
 
 	return AUTH_OK;
 }
+
+/**
+ * @brief Checks signature, expiration and revocation of a stateless cookie.
+ */
+static auth_errors_t auth_verify_stateless_session(PGconn* conn, auth_revocation_list_t* revocations, const string_t* signature_key, const string_t* cookie, auth_stateless_session_t* session) {
+	switch(auth_stateless_session_parse(signature_key, cookie, session)) {
+		case AUTH_STATELESS_SESSION_OK:
+			break;
+		case AUTH_STATELESS_SESSION_INVALID_SIGNATURE:
+			return AUTH_INVALID_SIGNATURE;
+		case AUTH_STATELESS_SESSION_EXPIRED:
+			return AUTH_COOKIE_NOT_FOUND;
+		default:
+			return AUTH_INVALID_COOKIE;
+	}
+
+	if(revocations != NULL && auth_revocation_list_is_fresh(revocations)) {
+		if(auth_revocation_list_session_revoked(revocations, session->id))
+			return AUTH_COOKIE_NOT_FOUND;
+		if(session->owned && auth_revocation_list_account_revoked(revocations, &session->owner))
+			return AUTH_ACCOUNT_NOT_ACTIVE;
+	} else {
+		bool valid = false, active = true;
+		if(auth_get_session_state(conn, session->id, &valid, &active))
+			return AUTH_ERROR;
+		if(!valid)
+			return AUTH_COOKIE_NOT_FOUND;
+		if(!active)
+			return AUTH_ACCOUNT_NOT_ACTIVE;
+	}
+
+	return AUTH_OK;
+}
+
+auth_errors_t auth_verify_stateless_cookie(PGconn* conn, auth_revocation_list_t* revocations, const string_t* signature_key, const string_t* cookie, uint32_t* session_id, auth_account_t** account) {
+	auth_stateless_session_t session;
+	auth_errors_t error = auth_verify_stateless_session(conn, revocations, signature_key, cookie, &session);
+	if(error != AUTH_OK)
+		return error;
+
+	*session_id = session.id;
+	*account = auth_stateless_session_account(&session);
+	return AUTH_OK;
+}
+
+auth_errors_t auth_verify_stateless_cookie_arena(PGconn* conn, arena_t* arena, auth_revocation_list_t* revocations, const string_t* signature_key, const string_t* cookie, uint32_t* session_id, auth_account_t** account) {
+	auth_stateless_session_t session;
+	auth_errors_t error = auth_verify_stateless_session(conn, revocations, signature_key, cookie, &session);
+	if(error != AUTH_OK)
+		return error;
+
+	*session_id = session.id;
+	*account = auth_stateless_session_account_arena(arena, &session);
+	if(session.owned && *account == NULL)
+		return AUTH_ERROR;
+	return AUTH_OK;
+}
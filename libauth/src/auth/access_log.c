@@ -0,0 +1,238 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "radicle/auth/access_log.h"
+#include "radicle/auth/db.h"
+#include "radicle/clock.h"
+#include "radicle/pgdb.h"
+#include "radicle/print.h"
+
+/**
+ * @brief Time a blocked producer sleeps before checking the queue again.
+ */
+#define AUTH_ACCESS_LOG_BLOCK_WAIT 100
+
+/**
+ * @brief Queued access. Strings are stored behind the struct, so an access costs a single allocation.
+ */
+typedef struct auth_access_log_entry {
+	uint32_t session_id;
+	auth_request_log_t log;
+	string_t ip;
+	string_t url;
+	char data[];
+} auth_access_log_entry_t;
+
+static string_t* auth_access_log_entry_string(const string_t* source, string_t* target, char** data) {
+	if(source == NULL)
+		return NULL;
+	target->length = source->length;
+	target->ptr = *data;
+	memcpy(target->ptr, source->ptr, source->length);
+	target->ptr[source->length] = 0;
+	*data += source->length + 1;
+	return target;
+}
+
+static auth_access_log_entry_t* auth_access_log_entry_new(const uint32_t session_id, const auth_request_log_t* request_log) {
+	size_t ip_length = request_log->ip != NULL ? request_log->ip->length + 1 : 0;
+	size_t url_length = request_log->url != NULL ? request_log->url->length + 1 : 0;
+
+	auth_access_log_entry_t* entry = malloc(sizeof(auth_access_log_entry_t) + ip_length + url_length);
+	if(entry == NULL)
+		return NULL;
+
+	entry->session_id = session_id;
+	entry->log = *request_log;
+	char* data = entry->data;
+	entry->log.ip = auth_access_log_entry_string(request_log->ip, &entry->ip, &data);
+	entry->log.url = auth_access_log_entry_string(request_log->url, &entry->url, &data);
+	return entry;
+}
+
+/**
+ * @brief Makes sure writer has a usable connection. Broken connections are reset first
+ * and replaced if that didnt help.
+ *
+ * @returns Returns 0 if connection is usable.
+ */
+static int auth_access_logger_connect(auth_access_logger_t* logger) {
+	if(pgdb_reconnect(logger->conn_info, &logger->conn)) {
+		ERROR("Access logger failed to connect to database.\n");
+		return 1;
+	}
+	logger->writer->conn = logger->conn;
+	return 0;
+}
+
+/**
+ * @brief Writes everything currently queued. Must only be called by one thread at a time.
+ */
+static void auth_access_logger_drain(auth_access_logger_t* logger) {
+	auth_access_log_entry_t* entry = NULL;
+	if(mpsc_queue_size(logger->queue) == 0)
+		return;
+
+	if(auth_access_logger_connect(logger)) {
+		int dropped = 0;
+		while((entry = mpsc_queue_pop(logger->queue)) != NULL) {
+			free(entry);
+			dropped++;
+		}
+		ERROR("Dropped %d accesses without connection.\n", dropped);
+	} else {
+		// Writer flushes on its own once batch_size rows are added.
+		while((entry = mpsc_queue_pop(logger->queue)) != NULL) {
+			auth_copy_session_access(logger->writer, entry->session_id, &entry->log);
+			free(entry);
+		}
+		pgdb_copy_writer_flush(logger->writer);
+	}
+
+	pthread_mutex_lock(&logger->lock);
+	pthread_cond_broadcast(&logger->drained);
+	pthread_mutex_unlock(&logger->lock);
+}
+
+static void* auth_access_logger_thread(void* data) {
+	auth_access_logger_t* logger = data;
+	struct timespec deadline;
+
+	pthread_mutex_lock(&logger->lock);
+	while(logger->running) {
+		clock_deadline_in(logger->flush_interval, &deadline);
+		pthread_cond_timedwait(&logger->wakeup, &logger->lock, &deadline);
+		pthread_mutex_unlock(&logger->lock);
+
+		auth_access_logger_drain(logger);
+
+		pthread_mutex_lock(&logger->lock);
+	}
+	pthread_mutex_unlock(&logger->lock);
+
+	// Producers may have queued until running was cleared.
+	auth_access_logger_drain(logger);
+	return NULL;
+}
+
+auth_access_logger_t* auth_access_logger_new(const char* conn_info, const size_t capacity, const int batch_size, const int64_t flush_interval, const auth_access_log_policy_t policy) {
+	auth_access_logger_t* logger = calloc(1, sizeof(auth_access_logger_t));
+	logger->queue = mpsc_queue_new(capacity);
+	logger->writer = auth_session_access_writer_new(NULL, batch_size, 0);
+	if(logger->queue == NULL || logger->writer == NULL) {
+		ERROR("Failed to allocate access logger.\n");
+		mpsc_queue_free(&logger->queue, NULL);
+		pgdb_copy_writer_free(&logger->writer);
+		free(logger);
+		return NULL;
+	}
+
+	logger->conn_info = strdup(conn_info);
+	logger->policy = policy;
+	logger->batch_size = batch_size;
+	logger->flush_interval = flush_interval;
+	logger->running = true;
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&logger->lock, NULL);
+	pthread_cond_init(&logger->wakeup, &attr);
+	pthread_cond_init(&logger->drained, &attr);
+	pthread_condattr_destroy(&attr);
+
+	if(pthread_create(&logger->thread, NULL, auth_access_logger_thread, logger)) {
+		ERROR("Failed to start access logger thread.\n");
+		logger->running = false;
+		auth_access_logger_free(&logger);
+		return NULL;
+	}
+
+	return logger;
+}
+
+int auth_access_logger_push(auth_access_logger_t* logger, const uint32_t session_id, const auth_request_log_t* request_log) {
+	auth_access_log_entry_t* entry = auth_access_log_entry_new(session_id, request_log);
+	if(entry == NULL) {
+		__atomic_add_fetch(&logger->dropped, 1, __ATOMIC_RELAXED);
+		return 1;
+	}
+
+	struct timespec deadline;
+	while(mpsc_queue_push(logger->queue, entry)) {
+		pthread_mutex_lock(&logger->lock);
+		if(logger->policy == AUTH_ACCESS_LOG_DROP || !logger->running) {
+			pthread_cond_signal(&logger->wakeup);
+			pthread_mutex_unlock(&logger->lock);
+			__atomic_add_fetch(&logger->dropped, 1, __ATOMIC_RELAXED);
+			free(entry);
+			return 1;
+		}
+		pthread_cond_signal(&logger->wakeup);
+		clock_deadline_in(AUTH_ACCESS_LOG_BLOCK_WAIT, &deadline);
+		pthread_cond_timedwait(&logger->drained, &logger->lock, &deadline);
+		pthread_mutex_unlock(&logger->lock);
+	}
+
+	// Lost wakeups are harmless, writer runs every flush_interval anyway.
+	if(mpsc_queue_size(logger->queue) == (size_t) logger->batch_size)
+		pthread_cond_signal(&logger->wakeup);
+
+	return 0;
+}
+
+uint64_t auth_access_logger_dropped(auth_access_logger_t* logger) {
+	return __atomic_load_n(&logger->dropped, __ATOMIC_RELAXED);
+}
+
+static void auth_access_log_entry_free(void* entry) {
+	free(entry);
+}
+
+void auth_access_logger_free(auth_access_logger_t** logger) {
+	if(*logger == NULL) return;
+
+	pthread_mutex_lock(&(*logger)->lock);
+	bool running = (*logger)->running;
+	(*logger)->running = false;
+	pthread_cond_broadcast(&(*logger)->wakeup);
+	pthread_cond_broadcast(&(*logger)->drained);
+	pthread_mutex_unlock(&(*logger)->lock);
+
+	if(running)
+		pthread_join((*logger)->thread, NULL);
+
+	pgdb_copy_writer_free(&(*logger)->writer);
+	mpsc_queue_free(&(*logger)->queue, auth_access_log_entry_free);
+	if((*logger)->conn != NULL)
+		PQfinish((*logger)->conn);
+	pthread_cond_destroy(&(*logger)->wakeup);
+	pthread_cond_destroy(&(*logger)->drained);
+	pthread_mutex_destroy(&(*logger)->lock);
+	free((*logger)->conn_info);
+	free(*logger);
+	*logger = NULL;
+}
@@ -0,0 +1,208 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BASE64_X86 1
+#endif
+
+#include "radicle/auth/base64.h"
+#include "radicle/print.h"
+
+static const char base64_standard_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char base64_url_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/**
+ * @brief Marks chars which are not part of an alphabet in the decode tables.
+ */
+#define BASE64_INVALID 0xff
+
+static uint8_t base64_standard_values[256];
+static uint8_t base64_url_values[256];
+
+static void base64_values_init(uint8_t* values, const char* chars) {
+	memset(values, BASE64_INVALID, 256);
+	for(int i = 0; i < 64; i++)
+		values[(unsigned char) chars[i]] = i;
+}
+
+static pthread_once_t base64_tables_once = PTHREAD_ONCE_INIT;
+
+static void base64_tables_init() {
+	base64_values_init(base64_standard_values, base64_standard_chars);
+	base64_values_init(base64_url_values, base64_url_chars);
+}
+
+size_t base64_encoded_length(const size_t length, const base64_alphabet_t alphabet) {
+	if(alphabet == BASE64_URL)
+		return length / 3 * 4 + (length % 3 == 0 ? 0 : length % 3 + 1);
+	return (length + 2) / 3 * 4;
+}
+
+#ifdef BASE64_X86
+/**
+ * @brief Encodes 12 bytes of every 16 byte block at once, see Wojciech Mula's SSSE3 base64.
+ * Reads 4 bytes past the last encoded group, so caller must keep 16 bytes readable.
+ *
+ * @returns Returns amount of input bytes consumed.
+ */
+__attribute__((target("ssse3"))) static size_t base64_encode_ssse3(const unsigned char* input, const size_t length, char* output, const base64_alphabet_t alphabet) {
+	const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const char plus = alphabet == BASE64_URL ? '-' : '+';
+	const char slash = alphabet == BASE64_URL ? '_' : '/';
+	// Offset added to each 6 bit value, picked by which of the ranges A-Z, a-z, 0-9, 62, 63 it is in.
+	const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, plus - 62, slash - 63, 'A', 0, 0);
+
+	size_t consumed = 0;
+	while(length - consumed >= 16) {
+		__m128i in = _mm_loadu_si128((const __m128i*) (input + consumed));
+		in = _mm_shuffle_epi8(in, shuffle);
+
+		const __m128i high = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+		const __m128i low = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+		const __m128i indices = _mm_or_si128(high, low);
+
+		__m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		const __m128i lower = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+		range = _mm_or_si128(range, _mm_and_si128(lower, _mm_set1_epi8(13)));
+		const __m128i chars = _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+
+		_mm_storeu_si128((__m128i*) output, chars);
+		output += 16;
+		consumed += 12;
+	}
+	return consumed;
+}
+#endif
+
+size_t base64_encode_to(const unsigned char* input, const size_t length, char* output, const base64_alphabet_t alphabet) {
+	const char* chars = alphabet == BASE64_URL ? base64_url_chars : base64_standard_chars;
+	char* iter = output;
+	size_t i = 0;
+
+#ifdef BASE64_X86
+	if(length >= 16 && __builtin_cpu_supports("ssse3")) {
+		i = base64_encode_ssse3(input, length, iter, alphabet);
+		iter += i / 3 * 4;
+	}
+#endif
+
+	for(; i + 3 <= length; i += 3) {
+		uint32_t group = (uint32_t) input[i] << 16 | (uint32_t) input[i + 1] << 8 | input[i + 2];
+		iter[0] = chars[group >> 18];
+		iter[1] = chars[(group >> 12) & 0x3f];
+		iter[2] = chars[(group >> 6) & 0x3f];
+		iter[3] = chars[group & 0x3f];
+		iter += 4;
+	}
+
+	if(i < length) {
+		uint32_t group = (uint32_t) input[i] << 16;
+		if(i + 1 < length)
+			group |= (uint32_t) input[i + 1] << 8;
+		*iter++ = chars[group >> 18];
+		*iter++ = chars[(group >> 12) & 0x3f];
+		if(i + 1 < length)
+			*iter++ = chars[(group >> 6) & 0x3f];
+		if(alphabet != BASE64_URL) {
+			if(i + 1 >= length)
+				*iter++ = '=';
+			*iter++ = '=';
+		}
+	}
+
+	*iter = '\0';
+	return iter - output;
+}
+
+int base64_decode_to(const char* input, const size_t input_length, unsigned char* output, size_t* output_length, const base64_alphabet_t alphabet) {
+	pthread_once(&base64_tables_once, base64_tables_init);
+	const uint8_t* values = alphabet == BASE64_URL ? base64_url_values : base64_standard_values;
+
+	size_t length = input_length;
+	if(length % 4 == 0 && length > 0 && input[length - 1] == '=') {
+		length--;
+		if(input[length - 1] == '=')
+			length--;
+	}
+	if(length % 4 == 1)
+		return 1;
+
+	unsigned char* iter = output;
+	size_t i = 0;
+	for(; i + 4 <= length; i += 4) {
+		uint8_t a = values[(unsigned char) input[i]], b = values[(unsigned char) input[i + 1]];
+		uint8_t c = values[(unsigned char) input[i + 2]], d = values[(unsigned char) input[i + 3]];
+		// Invalid chars map to BASE64_INVALID, which is the only value above 63.
+		if((a | b | c | d) > 63)
+			return 1;
+		uint32_t group = (uint32_t) a << 18 | (uint32_t) b << 12 | (uint32_t) c << 6 | d;
+		iter[0] = group >> 16;
+		iter[1] = group >> 8;
+		iter[2] = group;
+		iter += 3;
+	}
+
+	size_t rest = length - i;
+	if(rest > 0) {
+		uint8_t a = values[(unsigned char) input[i]], b = values[(unsigned char) input[i + 1]];
+		uint8_t c = rest == 3 ? values[(unsigned char) input[i + 2]] : 0;
+		if((a | b | c) > 63)
+			return 1;
+		uint32_t group = (uint32_t) a << 18 | (uint32_t) b << 12 | (uint32_t) c << 6;
+		*iter++ = group >> 16;
+		if(rest == 3)
+			*iter++ = group >> 8;
+	}
+
+	*iter = '\0';
+	*output_length = iter - output;
+	return 0;
+}
+
+int base64_encode(const unsigned char* input, size_t length, string_t** buffer) {
+	if(length < 1) {
+		ERROR("Nothing to encode.\n");
+		return 1;
+	}
+	*buffer = string_new_empty(base64_encoded_length(length, BASE64_STANDARD));
+	base64_encode_to(input, length, (*buffer)->ptr, BASE64_STANDARD);
+	return 0;
+}
+
+int base64_decode(const string_t* base64, string_t** buffer) {
+	*buffer = string_new_empty(base64->length / 4 * 3 + 3);
+	size_t length = 0;
+	if(base64->length < 1 || base64_decode_to(base64->ptr, base64->length, (unsigned char*) (*buffer)->ptr, &length, BASE64_STANDARD) || length < 1) {
+		ERROR("Failed to decode base64.\n");
+		string_free(buffer);
+		return 1;
+	}
+	(*buffer)->length = length;
+	return 0;
+}
@@ -0,0 +1,342 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "radicle/auth/blacklist.h"
+#include "radicle/auth/types.h"
+#include "radicle/auth/db.h"
+#include "radicle/types/linked_list.h"
+#include "radicle/clock.h"
+#include "radicle/pgdb.h"
+#include "radicle/print.h"
+
+/**
+ * @brief Minimum amount of slots of a table.
+ */
+#define AUTH_BLACKLIST_MIN_SLOTS 16
+
+/**
+ * @brief Local bans are inserted in place until this fraction of slots is used, then the table is rebuilt twice as large.
+ */
+#define AUTH_BLACKLIST_MAX_LOAD(slots) ((slots) / 4 * 3)
+
+static uint64_t auth_blacklist_hash(const char* ip, const size_t length) {
+	uint64_t hash = 14695981039346656037ULL;
+	for(size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char) ip[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static auth_blacklist_table_t* auth_blacklist_table_new(const size_t entries) {
+	size_t size = AUTH_BLACKLIST_MIN_SLOTS;
+	// Keeps load factor at or below one half, so probing always finds an empty slot quickly.
+	while(size < entries * 2)
+		size <<= 1;
+
+	auth_blacklist_table_t* table = calloc(1, sizeof(auth_blacklist_table_t) + size * sizeof(auth_blacklist_slot_t));
+	table->mask = size - 1;
+	return table;
+}
+
+static void auth_blacklist_table_insert(auth_blacklist_table_t* table, const uint64_t hash, const uint32_t id, const char* ip, const time_t ban_lift) {
+	size_t index = hash & table->mask;
+	while(table->slots[index].id != 0) {
+		auth_blacklist_slot_t* slot = &table->slots[index];
+		if(slot->hash == hash && strcmp(slot->ip, ip) == 0) {
+			// Same as in database, ip stays banned until its longest ban is lifted.
+			if(slot->ban_lift != 0 && (ban_lift == 0 || ban_lift > slot->ban_lift)) {
+				__atomic_store_n(&slot->ban_lift, ban_lift, __ATOMIC_RELAXED);
+				__atomic_store_n(&slot->id, id, __ATOMIC_RELEASE);
+			}
+			return;
+		}
+		index = (index + 1) & table->mask;
+	}
+
+	auth_blacklist_slot_t* slot = &table->slots[index];
+	slot->hash = hash;
+	slot->ban_lift = ban_lift;
+	strcpy(slot->ip, ip);
+	// Published last, table may already be visible to lookups.
+	__atomic_store_n(&slot->id, id, __ATOMIC_RELEASE);
+	table->count++;
+}
+
+static bool auth_blacklist_expired(const time_t ban_lift, const time_t now) {
+	return ban_lift != 0 && ban_lift <= now;
+}
+
+static size_t auth_blacklist_entry_count(list_t* entries) {
+	size_t count = 0;
+	for(list_t* iter = entries; iter != NULL; iter = iter->next)
+		count++;
+	return count;
+}
+
+static void auth_blacklist_table_insert_entries(auth_blacklist_table_t* table, list_t* entries, const time_t now) {
+	for(list_t* iter = entries; iter != NULL; iter = iter->next) {
+		auth_blacklist_entry_t* entry = iter->data;
+		if(entry->ip == NULL || entry->ip->length >= AUTH_BLACKLIST_IP_LENGTH) {
+			ERROR("Skipping invalid blacklist entry %u.\n", entry->id);
+			continue;
+		}
+		if(!auth_blacklist_expired(entry->ban_lift, now))
+			auth_blacklist_table_insert(table, auth_blacklist_hash(entry->ip->ptr, entry->ip->length), entry->id, entry->ip->ptr, entry->ban_lift);
+	}
+}
+
+/**
+ * @brief Builds a table from \p added and \p pending, swaps it in and retires the old one.
+ * Must be called with blacklist->lock held.
+ *
+ * @param keep If true unexpired slots of the current table are copied over, otherwise they are dropped.
+ */
+static void auth_blacklist_rebuild(auth_blacklist_t* blacklist, const bool keep, list_t* added, list_t* pending) {
+	auth_blacklist_table_t* old = blacklist->table;
+	time_t now = time(NULL);
+
+	size_t count = (keep ? old->count : 0) + auth_blacklist_entry_count(added) + auth_blacklist_entry_count(pending);
+	auth_blacklist_table_t* table = auth_blacklist_table_new(count);
+	for(size_t i = 0; keep && i <= old->mask; i++) {
+		auth_blacklist_slot_t* slot = &old->slots[i];
+		if(slot->id != 0 && !auth_blacklist_expired(slot->ban_lift, now))
+			auth_blacklist_table_insert(table, slot->hash, slot->id, slot->ip, slot->ban_lift);
+	}
+	auth_blacklist_table_insert_entries(table, added, now);
+	auth_blacklist_table_insert_entries(table, pending, now);
+
+	__atomic_store_n(&blacklist->table, table, __ATOMIC_RELEASE);
+
+	retire_list_push(blacklist->retired, &old->retire);
+}
+
+/**
+ * @brief Fetches bans and swaps in a new table.
+ *
+ * @param full If true all bans are fetched and replace the current table, otherwise only bans
+ * above blacklist->last_id are fetched and merged into it.
+ */
+static int auth_blacklist_fetch_and_swap(auth_blacklist_t* blacklist, PGconn* conn, const bool full) {
+	pthread_mutex_lock(&blacklist->lock);
+	uint32_t after_id = full ? 0 : blacklist->last_id;
+	if(full)
+		blacklist->reloading = true;
+	pthread_mutex_unlock(&blacklist->lock);
+
+	list_t* entries = NULL;
+	int error = auth_blacklist_fetch(conn, after_id, time(NULL), &entries);
+	if(error) {
+		ERROR("Failed to fetch blacklist.\n");
+	}
+
+	pthread_mutex_lock(&blacklist->lock);
+	if(!error) {
+		// Only rows read from the database move the watermark, never local additions.
+		for(list_t* iter = entries; iter != NULL; iter = iter->next) {
+			auth_blacklist_entry_t* entry = iter->data;
+			if(entry->id > blacklist->last_id)
+				blacklist->last_id = entry->id;
+		}
+		if(full || entries != NULL)
+			auth_blacklist_rebuild(blacklist, !full, entries, full ? blacklist->pending : NULL);
+	}
+	if(full) {
+		list_free(blacklist->pending, auth_blacklist_entry_free);
+		blacklist->pending = NULL;
+		blacklist->reloading = false;
+	}
+	pthread_mutex_unlock(&blacklist->lock);
+
+	list_free(entries, auth_blacklist_entry_free);
+	return error;
+}
+
+auth_blacklist_t* auth_blacklist_new() {
+	auth_blacklist_t* blacklist = calloc(1, sizeof(auth_blacklist_t));
+	blacklist->retired = retire_list_new();
+	if(blacklist->retired == NULL) {
+		ERROR("Failed to create retire list of blacklist.\n");
+		free(blacklist);
+		return NULL;
+	}
+	blacklist->table = auth_blacklist_table_new(0);
+	pthread_mutex_init(&blacklist->lock, NULL);
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&blacklist->wakeup, &attr);
+	pthread_condattr_destroy(&attr);
+	return blacklist;
+}
+
+int auth_blacklist_load(auth_blacklist_t* blacklist, PGconn* conn) {
+	return auth_blacklist_fetch_and_swap(blacklist, conn, false);
+}
+
+int auth_blacklist_reload(auth_blacklist_t* blacklist, PGconn* conn) {
+	return auth_blacklist_fetch_and_swap(blacklist, conn, true);
+}
+
+void auth_blacklist_add(auth_blacklist_t* blacklist, const uint32_t id, const string_t* ip, const time_t ban_lift) {
+	if(ip == NULL || ip->length >= AUTH_BLACKLIST_IP_LENGTH) {
+		ERROR("Skipping invalid blacklist entry %u.\n", id);
+		return;
+	}
+
+	pthread_mutex_lock(&blacklist->lock);
+	auth_blacklist_table_t* table = blacklist->table;
+	// Bans mostly come in bursts during attacks, so they go into free slots of the current table
+	// instead of copying it for each one.
+	if(table->count < AUTH_BLACKLIST_MAX_LOAD(table->mask + 1)) {
+		if(!auth_blacklist_expired(ban_lift, time(NULL)))
+			auth_blacklist_table_insert(table, auth_blacklist_hash(ip->ptr, ip->length), id, ip->ptr, ban_lift);
+	} else {
+		auth_blacklist_entry_t entry = { id, (string_t*) ip, ban_lift };
+		list_t node = { .next = NULL, .prev = NULL, .tail = NULL, .data = &entry };
+		auth_blacklist_rebuild(blacklist, true, &node, NULL);
+	}
+
+	// A running full reload may have fetched before this ban was saved, so it has to be kept on top.
+	if(blacklist->reloading) {
+		auth_blacklist_entry_t* copy = calloc(1, sizeof(auth_blacklist_entry_t));
+		copy->id = id;
+		copy->ip = string_copy(ip);
+		copy->ban_lift = ban_lift;
+		list_tail(&blacklist->pending, copy);
+	}
+	pthread_mutex_unlock(&blacklist->lock);
+}
+
+uint32_t auth_blacklist_lookup(auth_blacklist_t* blacklist, const string_t* ip) {
+	if(ip == NULL || ip->length >= AUTH_BLACKLIST_IP_LENGTH)
+		return 0;
+
+	uint64_t hash = auth_blacklist_hash(ip->ptr, ip->length);
+	uint32_t found = 0;
+
+	retire_reader_t* reader = retire_list_enter(blacklist->retired);
+	auth_blacklist_table_t* table = __atomic_load_n(&blacklist->table, __ATOMIC_ACQUIRE);
+	size_t index = hash & table->mask;
+	uint32_t id;
+	while((id = __atomic_load_n(&table->slots[index].id, __ATOMIC_ACQUIRE)) != 0) {
+		const auth_blacklist_slot_t* slot = &table->slots[index];
+		if(slot->hash == hash && strcmp(slot->ip, ip->ptr) == 0) {
+			if(!auth_blacklist_expired(__atomic_load_n(&slot->ban_lift, __ATOMIC_RELAXED), time(NULL)))
+				found = id;
+			break;
+		}
+		index = (index + 1) & table->mask;
+	}
+	retire_list_leave(reader);
+	return found;
+}
+
+/**
+ * @brief Makes sure refresh thread has a usable connection.
+ *
+ * @returns Returns 0 if connection is usable.
+ */
+static int auth_blacklist_connect(auth_blacklist_t* blacklist) {
+	if(pgdb_reconnect(blacklist->conn_info, &blacklist->conn)) {
+		ERROR("Blacklist failed to connect to database.\n");
+		return 1;
+	}
+	return 0;
+}
+
+static void* auth_blacklist_refresh_thread(void* data) {
+	auth_blacklist_t* blacklist = data;
+	struct timespec deadline;
+
+	pthread_mutex_lock(&blacklist->lock);
+	while(blacklist->running) {
+		clock_deadline_in(blacklist->refresh_interval, &deadline);
+		pthread_cond_timedwait(&blacklist->wakeup, &blacklist->lock, &deadline);
+		if(!blacklist->running)
+			break;
+		pthread_mutex_unlock(&blacklist->lock);
+
+		if(auth_blacklist_connect(blacklist) == 0) {
+			if(++blacklist->refreshes < AUTH_BLACKLIST_RELOAD_REFRESHES)
+				auth_blacklist_load(blacklist, blacklist->conn);
+			else if(auth_blacklist_reload(blacklist, blacklist->conn) == 0)
+				blacklist->refreshes = 0;
+		}
+
+		pthread_mutex_lock(&blacklist->lock);
+		// Tables which were still read during the last swap.
+		retire_list_collect(blacklist->retired);
+	}
+	pthread_mutex_unlock(&blacklist->lock);
+	return NULL;
+}
+
+int auth_blacklist_start_refresh(auth_blacklist_t* blacklist, const char* conn_info, const int64_t interval) {
+	if(blacklist->running) {
+		ERROR("Blacklist refresh is already running.\n");
+		return 1;
+	}
+
+	free(blacklist->conn_info);
+	blacklist->conn_info = strdup(conn_info);
+	blacklist->refresh_interval = interval;
+
+	if(auth_blacklist_connect(blacklist) || auth_blacklist_load(blacklist, blacklist->conn))
+		return 1;
+
+	blacklist->running = true;
+	if(pthread_create(&blacklist->thread, NULL, auth_blacklist_refresh_thread, blacklist)) {
+		blacklist->running = false;
+		ERROR("Failed to start blacklist refresh thread.\n");
+		return 1;
+	}
+	return 0;
+}
+
+void auth_blacklist_free(auth_blacklist_t** blacklist) {
+	if(*blacklist == NULL) return;
+
+	pthread_mutex_lock(&(*blacklist)->lock);
+	bool running = (*blacklist)->running;
+	(*blacklist)->running = false;
+	pthread_cond_broadcast(&(*blacklist)->wakeup);
+	pthread_mutex_unlock(&(*blacklist)->lock);
+
+	if(running)
+		pthread_join((*blacklist)->thread, NULL);
+
+	retire_list_free(&(*blacklist)->retired);
+	list_free((*blacklist)->pending, auth_blacklist_entry_free);
+	free((*blacklist)->table);
+	if((*blacklist)->conn != NULL)
+		PQfinish((*blacklist)->conn);
+	free((*blacklist)->conn_info);
+	pthread_cond_destroy(&(*blacklist)->wakeup);
+	pthread_mutex_destroy(&(*blacklist)->lock);
+	free(*blacklist);
+	*blacklist = NULL;
+}
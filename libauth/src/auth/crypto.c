@@ -17,7 +17,10 @@
  */
 
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h> 
+#include <time.h>
+#include <pthread.h>
 
 #include <openssl/aes.h>
 #include <openssl/hmac.h>
@@ -25,137 +28,223 @@
 #include <openssl/pem.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
-#include <openssl/bio.h>
-#include <openssl/buffer.h>
 #include <openssl/rand.h>
+#include <openssl/crypto.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
 
 #include <argon2.h>
 
 #include "radicle/print.h"
 #include "radicle/auth/crypto.h"
+#include "radicle/auth/random.h"
 
-int base64_encode(const unsigned char* input, size_t length, string_t** buffer) {
-	BIO* b64 = BIO_new(BIO_f_base64());
-	if(b64 == NULL) {
-		ERROR("Failed to use BIO_new for b64.\n");
-		return 1;
-	}
-	BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-	BIO* bmem = BIO_new(BIO_s_mem());
-	if(bmem == NULL) {
-		BIO_free(b64);
-		ERROR("Failed to use BIO_new for bmem.\n");
-		return 1;
+/**
+ * @brief Keys up to this length are joined with their salt on the stack.
+ */
+#define HMAC_STACK_KEY_LENGTH 512
+
+static const char hmac_hex_digits[] = "0123456789abcdef";
+
+static pthread_key_t hmac_context_key;
+static pthread_once_t hmac_context_once = PTHREAD_ONCE_INIT;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static EVP_MAC* hmac_mac = NULL;
+
+static void hmac_context_free(void* context) {
+	EVP_MAC_CTX_free(context);
+}
+
+static void hmac_context_init() {
+	hmac_mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+	pthread_key_create(&hmac_context_key, hmac_context_free);
+}
+
+/**
+ * @brief Returns hmac-sha512 context of calling thread. It is created on first use and then
+ * only rekeyed, so signing does not allocate.
+ */
+static EVP_MAC_CTX* hmac_context() {
+	pthread_once(&hmac_context_once, hmac_context_init);
+	EVP_MAC_CTX* context = pthread_getspecific(hmac_context_key);
+	if(context != NULL || hmac_mac == NULL)
+		return context;
+
+	context = EVP_MAC_CTX_new(hmac_mac);
+	if(context == NULL)
+		return NULL;
+
+	OSSL_PARAM params[] = {
+		OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "SHA512", 0),
+		OSSL_PARAM_construct_end()
+	};
+	if(!EVP_MAC_CTX_set_params(context, params)) {
+		EVP_MAC_CTX_free(context);
+		return NULL;
 	}
-	b64 = BIO_push(b64, bmem);
-	size_t bytes_written = BIO_write(b64, input, length);
-	if(bytes_written < 1) {
-		/* no data was successfully read or written if the result is 0 or -1 */
-		BIO_free_all(b64);
-		ERROR("BIO_write failed to write to b64. Returned %ld\n", bytes_written);
+	pthread_setspecific(hmac_context_key, context);
+	return context;
+}
+
+static int hmac_compute(const unsigned char* key, const size_t key_length, const unsigned char* input, const size_t input_length, unsigned char* digest) {
+	EVP_MAC_CTX* context = hmac_context();
+	size_t digest_length = 0;
+	if(context == NULL || !EVP_MAC_init(context, key, key_length, NULL) || !EVP_MAC_update(context, input, input_length) ||
+			!EVP_MAC_final(context, digest, &digest_length, HMAC_DIGEST_SIZE) || digest_length != HMAC_DIGEST_SIZE)
 		return 1;
+	return 0;
+}
+#else
+static void hmac_context_free(void* context) {
+	HMAC_CTX_free(context);
+}
+
+static void hmac_context_init() {
+	pthread_key_create(&hmac_context_key, hmac_context_free);
+}
+
+/**
+ * @brief Returns hmac context of calling thread. It is created on first use and then only
+ * rekeyed, so signing does not allocate.
+ */
+static HMAC_CTX* hmac_context() {
+	pthread_once(&hmac_context_once, hmac_context_init);
+	HMAC_CTX* context = pthread_getspecific(hmac_context_key);
+	if(context == NULL) {
+		context = HMAC_CTX_new();
+		if(context != NULL)
+			pthread_setspecific(hmac_context_key, context);
 	}
-	if(BIO_flush(b64) < 1) {
-		BIO_free_all(b64);
-		ERROR("Failed to use BIO_flush for b64.\n");
+	return context;
+}
+
+static int hmac_compute(const unsigned char* key, const size_t key_length, const unsigned char* input, const size_t input_length, unsigned char* digest) {
+	HMAC_CTX* context = hmac_context();
+	unsigned int digest_length = 0;
+	if(context == NULL || !HMAC_Init_ex(context, key, key_length, EVP_sha512(), NULL) || !HMAC_Update(context, input, input_length) ||
+			!HMAC_Final(context, digest, &digest_length) || digest_length != HMAC_DIGEST_SIZE)
 		return 1;
-	}
-	BUF_MEM* bptr = NULL;
-	BIO_get_mem_ptr(b64, &bptr);
-	*buffer = string_new(bptr->data, bptr->length);
-	BIO_free_all(b64);
 	return 0;
 }
+#endif
+
+int hmac_sign_salted_raw(const string_t* key, const string_t* salt, const unsigned char* input, const size_t input_length, unsigned char* output) {
+	size_t salt_length = salt != NULL ? salt->length : 0;
+	size_t key_length = key->length + salt_length;
+
+	unsigned char stack_key[HMAC_STACK_KEY_LENGTH];
+	unsigned char* final_key = stack_key;
+	if(key_length > HMAC_STACK_KEY_LENGTH)
+		final_key = malloc(key_length);
+	memcpy(final_key, key->ptr, key->length);
+	if(salt_length > 0)
+		memcpy(final_key + key->length, salt->ptr, salt_length);
 
-int base64_decode(const string_t* base64, string_t** buffer) {
-	BIO* b64 = BIO_new(BIO_f_base64());
-	if(b64 == NULL) {
-		ERROR("Failed to use BIO_new for b64.\n");
+	int error = hmac_compute(final_key, key_length, input, input_length, output);
+	OPENSSL_cleanse(final_key, key_length);
+	if(final_key != stack_key)
+		free(final_key);
+	if(error) {
+		ERROR("Failed to sign using hmac.\n");
 		return 1;
 	}
-	BIO_set_flags(b64, BIO_FLAGS_BASE64_NO_NL);
-	BIO* bio = BIO_new_mem_buf(base64->ptr, base64->length);
-	bio = BIO_push(b64, bio);
-	*buffer = calloc(1, sizeof(string_t));
-	(*buffer)->ptr  = calloc(base64->length + 1, sizeof(char));
-	(*buffer)->length = BIO_read(bio, (*buffer)->ptr, base64->length);
-	if((*buffer)->length < 1) {
-		/* no data was successfully read or written if the result is 0 or -1 */
-		BIO_free_all(bio);
-		ERROR("BIO_read did not read successfully. Returned %ld.\n", (*buffer)->length);
-		string_free(buffer);
+	return 0;
+}
+
+int hmac_sign_salted_hex(const string_t* key, const string_t* salt, const unsigned char* input, const size_t input_length, char* output) {
+	unsigned char digest[HMAC_DIGEST_SIZE];
+	if(hmac_sign_salted_raw(key, salt, input, input_length, digest))
 		return 1;
+
+	for(int i = 0; i < HMAC_DIGEST_SIZE; i++) {
+		output[i * 2] = hmac_hex_digits[digest[i] >> 4];
+		output[i * 2 + 1] = hmac_hex_digits[digest[i] & 0x0f];
 	}
-	BIO_free_all(bio);
+	output[HMAC_LENGTH] = '\0';
 	return 0;
 }
 
 int hmac_sign(const unsigned char* input, const size_t input_length, const string_t* key, string_t** buffer) {
-	unsigned char hmac_buffer[EVP_MAX_MD_SIZE];
-	unsigned int hmac_buffer_length;
-	if(HMAC(EVP_sha512(), key->ptr, key->length, input, input_length, hmac_buffer, &hmac_buffer_length) != hmac_buffer) {
-		ERROR("Failed to sign using hmac.\n");
+	char signature[HMAC_LENGTH + 1];
+	if(hmac_sign_salted_hex(key, NULL, input, input_length, signature))
 		return 1;
-	}
-	
-	*buffer = string_new_empty(hmac_buffer_length * 2);
-	char* iter = (*buffer)->ptr;
-	for(int i = 0; i < hmac_buffer_length; i++) {
-		iter += sprintf(iter, "%02x", hmac_buffer[i]);
-	}
+
+	*buffer = string_new(signature, HMAC_LENGTH);
 	return 0;
 }
 
 int hmac_verify(const string_t* key, const string_t* signature, const string_t* input) {
-	string_t* buffer = NULL;
-	if(hmac_sign((unsigned char*)input->ptr, input->length, key, &buffer)) {
+	return hmac_verify_salted(key, NULL, signature, input);
+}
+
+int hmac_verify_salted(const string_t* key, const string_t* salt, const string_t* signature, const string_t* input) {
+	char expected[HMAC_LENGTH + 1];
+	if(hmac_sign_salted_hex(key, salt, (unsigned char*)input->ptr, input->length, expected))
 		return 1;
-	}
 
-	if(signature->length != buffer->length || strcmp(buffer->ptr, signature->ptr) != 0) {
-		string_free(&buffer);
+	if(signature->length != HMAC_LENGTH || CRYPTO_memcmp(expected, signature->ptr, HMAC_LENGTH) != 0)
 		return 1;
-	}
-	string_free(&buffer);
 	return 0;
 }
 
-int hmac_verify_salted(const string_t* key, const string_t* salt, const string_t* signature, const string_t* input) {
-	string_t* final_key = string_new_empty(key->length + salt->length);
-	strncpy(final_key->ptr, key->ptr, key->length);
-	strncat(final_key->ptr, salt->ptr, salt->length);
-	int res = hmac_verify(final_key, signature, input);
-	string_free(&final_key);
-	return res;
+int auth_hash_password(const string_t* password, string_t** buffer) {
+	static const auth_password_params_t defaults = AUTH_PASSWORD_PARAMS_DEFAULT;
+	return auth_hash_password_with(&defaults, password, buffer);
 }
 
-int auth_hash_password(const string_t* password, string_t** buffer) {
+int auth_hash_password_with(const auth_password_params_t* params, const string_t* password, string_t** buffer) {
 	string_t* salt;
 	if(auth_generate_random_base64(16, &salt)) {
 		ERROR("Failed to generate salt for password hashing.\n");
 		return 1;
 	}
-	uint32_t t_cost = 2;            // 2-pass computation
-    	uint32_t m_cost = (1<<16);      // 64 mebibytes memory usage
-    	uint32_t parallelism = 2;       // number of threads and lanes
 	uint32_t hash_length = 32;
-	*buffer = string_new_empty(256);
-	int error = argon2i_hash_encoded(t_cost, m_cost, parallelism, password->ptr, password->length, salt->ptr, salt->length, hash_length, (*buffer)->ptr, (*buffer)->length);
+	size_t encoded_length = argon2_encodedlen(params->time_cost, params->memory_cost, params->parallelism, salt->length, hash_length, params->type);
+	*buffer = string_new_empty(encoded_length);
+	int error = argon2_hash(params->time_cost, params->memory_cost, params->parallelism, password->ptr, password->length,
+			salt->ptr, salt->length, NULL, hash_length, (*buffer)->ptr, (*buffer)->length, params->type, ARGON2_VERSION_13);
 	if(error != ARGON2_OK) {
 		ERROR("Failed to hash password. %s\n", argon2_error_message(error));
 		string_free(&salt);
 		string_free(buffer);
 		return 1;
 	}
-	// because string_new_empty sets size to 256, it has to be corrected
+	// encoded length is only an upper bound, so it has to be corrected
 	(*buffer)->length = strnlen((*buffer)->ptr, (*buffer)->length);
 
 	string_free(&salt);
 	return 0;
 }
 
+/**
+ * @brief Reads argon2 variant from prefix of encoded hash.
+ *
+ * @returns Returns length of prefix or 0 if it is unknown.
+ */
+static size_t auth_password_type(const char* encoded, argon2_type* type) {
+	if(strncmp(encoded, "$argon2id$", 10) == 0) {
+		*type = Argon2_id;
+		return 10;
+	} else if(strncmp(encoded, "$argon2i$", 9) == 0) {
+		*type = Argon2_i;
+		return 9;
+	} else if(strncmp(encoded, "$argon2d$", 9) == 0) {
+		*type = Argon2_d;
+		return 9;
+	}
+	return 0;
+}
+
 int auth_verify_password(const string_t* encoded, const string_t* password) {
-	int error = argon2i_verify(encoded->ptr, password->ptr, password->length);
+	argon2_type type = Argon2_i;
+	if(auth_password_type(encoded->ptr, &type) == 0) {
+		ERROR("Failed to verify password. Unknown hash type.\n");
+		return 1;
+	}
+
+	int error = argon2_verify(encoded->ptr, password->ptr, password->length, type);
 	if(error != ARGON2_OK) {
 		ERROR("Failed to verify password. %s\n", argon2_error_message(error));
 		return 1;
@@ -163,72 +252,120 @@ int auth_verify_password(const string_t* encoded, const string_t* password) {
 	return 0;
 }
 
-int auth_generate_random_base64(const int rand_bytes, string_t** buffer) {
-	unsigned char rand_buffer[rand_bytes];
-	if(RAND_bytes(rand_buffer, rand_bytes) != 1) {
-		unsigned int error_code = ERR_get_error();
-		if(error_code != 0) {
-			char error_buffer[1024];
-			ERR_error_string_n(error_code, error_buffer, 1024);
-			ERROR("%s\n", error_buffer);
-		} else {
-			ERROR("RAND_bytes reported an error but ERR_get_error does not return any error information.\n");	
-		}
+bool auth_password_needs_rehash(const string_t* encoded, const auth_password_params_t* params) {
+	argon2_type type;
+	size_t offset = auth_password_type(encoded->ptr, &type);
+	if(offset == 0)
+		return false;
+
+	unsigned int version, memory_cost, time_cost, parallelism;
+	if(sscanf(encoded->ptr + offset, "v=%u$m=%u,t=%u,p=%u$", &version, &memory_cost, &time_cost, &parallelism) != 4)
+		return false;
+
+	return type != params->type || version != ARGON2_VERSION_13 || memory_cost != params->memory_cost ||
+		time_cost != params->time_cost || parallelism != params->parallelism;
+}
+
+/**
+ * @brief Measures a single hash with \p params.
+ *
+ * @returns Returns duration in microseconds or -1 on failure.
+ */
+static int64_t auth_password_params_measure(const auth_password_params_t* params) {
+	string_t* password = string_from_literal("calibration");
+	string_t* encoded = NULL;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	int error = auth_hash_password_with(params, password, &encoded);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	string_free(&password);
+	string_free(&encoded);
+	if(error)
+		return -1;
+	return (int64_t) (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+}
+
+int auth_password_params_calibrate(auth_password_params_t* params, const int target_in_ms) {
+	if(target_in_ms <= 0) {
+		ERROR("Calibration target must be positive.\n");
 		return 1;
 	}
-	if(base64_encode(rand_buffer, rand_bytes, buffer)) {
-		ERROR("Failed to encode rand_buffer to base64.\n");
+
+	int64_t target = (int64_t) target_in_ms * 1000;
+	auth_password_params_t candidate = *params;
+	candidate.time_cost = 1;
+	int64_t single_pass = auth_password_params_measure(&candidate);
+	if(single_pass < 0)
 		return 1;
+
+	// Argon2 needs at least 8 blocks per lane.
+	while(single_pass > target && candidate.memory_cost / 2 >= 8 * candidate.parallelism) {
+		candidate.memory_cost /= 2;
+		single_pass = auth_password_params_measure(&candidate);
+		if(single_pass < 0)
+			return 1;
 	}
+
+	// Duration grows linearly with amount of passes.
+	if(single_pass < target)
+		candidate.time_cost = (target + single_pass / 2) / (single_pass > 0 ? single_pass : 1);
+
+	*params = candidate;
+	INFO("Calibrated password hashing to t_cost=%u m_cost=%u p=%u for %d ms.\n", params->time_cost, params->memory_cost, params->parallelism, target_in_ms);
 	return 0;
 }
 
-int auth_generate_random_base64_url_safe(const int rand_bytes, string_t** buffer) {
-	int result = auth_generate_random_base64(rand_bytes, buffer);
-	if(result) return result;
-	for(int i = 0; i < (*buffer)->length; i++) {
-		char c = (*buffer)->ptr[i];
-		if(c == '+')
-			(*buffer)->ptr[i] = '-';
-		else if(c == '/')
-			(*buffer)->ptr[i] = '_';
-		else if(c == '=')
-			(*buffer)->ptr[i] = '-';
+/**
+ * @brief Encodes \p rand_bytes random bytes with \p alphabet.
+ */
+static int auth_generate_random(const int rand_bytes, const base64_alphabet_t alphabet, string_t** buffer) {
+	*buffer = string_new_empty(base64_encoded_length(rand_bytes, alphabet));
+	if(auth_random_token(rand_bytes, alphabet, (*buffer)->ptr) == 0) {
+		string_free(buffer);
+		return 1;
 	}
 	return 0;
 }
 
+int auth_generate_random_base64(const int rand_bytes, string_t** buffer) {
+	return auth_generate_random(rand_bytes, BASE64_STANDARD, buffer);
+}
+
+int auth_generate_random_base64_url_safe(const int rand_bytes, string_t** buffer) {
+	return auth_generate_random(rand_bytes, BASE64_URL, buffer);
+}
+
 int auth_generate_session_cookie(const string_t* key, auth_cookie_t** cookie) {
 
 	*cookie = auth_cookie_new_empty();
 
-	if(auth_generate_random_base64(SESSION_ID_LENGTH, &(*cookie)->token)) {
+	if(auth_generate_random_base64(SESSION_ID_LENGTH, &(*cookie)->salt)) {
 		auth_cookie_free(cookie);
-		ERROR("Failed to generate session token.\n");
+		ERROR("Failed to generate salt for session id.\n");
 		return 1;
 	}
 
-	if(auth_generate_random_base64(SESSION_ID_LENGTH, &(*cookie)->salt)) {
+	// Token and signature are written straight into cookie, separated by the delimiter.
+	size_t token_length = base64_encoded_length(SESSION_ID_LENGTH, BASE64_STANDARD);
+	(*cookie)->cookie = string_new_empty(token_length + HMAC_LENGTH + 1);
+	char* token = (*cookie)->cookie->ptr;
+	if(auth_random_token(SESSION_ID_LENGTH, BASE64_STANDARD, token) != token_length) {
 		auth_cookie_free(cookie);
-		ERROR("Failed to generate salt for session id.\n");
+		ERROR("Failed to generate session token.\n");
 		return 1;
 	}
 
-	string_t* final_key = string_new_empty(key->length + (*cookie)->salt->length);
-	strncpy(final_key->ptr, key->ptr, key->length);
-	strncat(final_key->ptr, (*cookie)->salt->ptr, (*cookie)->salt->length);
-
-	if(hmac_sign((unsigned char*)(*cookie)->token->ptr, (*cookie)->token->length, final_key, &(*cookie)->signature)) {
-		string_free(&final_key);
+	char* signature = token + token_length + 1;
+	if(hmac_sign_salted_hex(key, (*cookie)->salt, (unsigned char*) token, token_length, signature)) {
 		auth_cookie_free(cookie);
 		ERROR("Failed to sign session id.");
 		return 1;
 	}
-
-	string_free(&final_key);
-
-	(*cookie)->cookie = string_new_empty((*cookie)->token->length + (*cookie)->signature->length + 1);
-	sprintf((*cookie)->cookie->ptr, "%s-%s", (*cookie)->token->ptr, (*cookie)->signature->ptr);
+	token[token_length] = '-';
+	(*cookie)->token = string_new(token, token_length);
+	(*cookie)->signature = string_new(signature, HMAC_LENGTH);
 	
 	return 0;
 }
@@ -265,3 +402,54 @@ int auth_split_cookie(const string_t* cookie,  auth_cookie_t** result) {
 
 	return 0;
 }
+
+/**
+ * @brief Size of binary compact cookie.
+ */
+#define AUTH_COMPACT_COOKIE_SIZE (1 + AUTH_COMPACT_TOKEN_SIZE + AUTH_COMPACT_MAC_SIZE)
+
+int auth_generate_compact_cookie(const string_t* key, unsigned char* token, string_t** cookie) {
+	unsigned char raw[AUTH_COMPACT_COOKIE_SIZE];
+	raw[0] = AUTH_COMPACT_COOKIE_VERSION;
+	if(auth_random_bytes(raw + 1, AUTH_COMPACT_TOKEN_SIZE)) {
+		ERROR("Failed to generate session token.\n");
+		return 1;
+	}
+
+	unsigned char digest[HMAC_DIGEST_SIZE];
+	if(hmac_sign_salted_raw(key, NULL, raw, 1 + AUTH_COMPACT_TOKEN_SIZE, digest)) {
+		ERROR("Failed to sign session token.\n");
+		return 1;
+	}
+	memcpy(raw + 1 + AUTH_COMPACT_TOKEN_SIZE, digest, AUTH_COMPACT_MAC_SIZE);
+	memcpy(token, raw + 1, AUTH_COMPACT_TOKEN_SIZE);
+
+	*cookie = string_new_empty(AUTH_COMPACT_COOKIE_LENGTH);
+	base64_encode_to(raw, sizeof(raw), (*cookie)->ptr, BASE64_URL);
+	return 0;
+}
+
+bool auth_is_compact_cookie(const string_t* cookie) {
+	return cookie != NULL && cookie->length == AUTH_COMPACT_COOKIE_LENGTH;
+}
+
+int auth_split_compact_cookie(const string_t* key, const string_t* cookie, unsigned char* token) {
+	if(!auth_is_compact_cookie(cookie))
+		return 1;
+
+	unsigned char raw[AUTH_COMPACT_COOKIE_SIZE + 1];
+	size_t length = 0;
+	if(base64_decode_to(cookie->ptr, cookie->length, raw, &length, BASE64_URL) || length != AUTH_COMPACT_COOKIE_SIZE ||
+			raw[0] != AUTH_COMPACT_COOKIE_VERSION) {
+		return 1;
+	}
+
+	unsigned char digest[HMAC_DIGEST_SIZE];
+	if(hmac_sign_salted_raw(key, NULL, raw, 1 + AUTH_COMPACT_TOKEN_SIZE, digest))
+		return 1;
+	if(CRYPTO_memcmp(digest, raw + 1 + AUTH_COMPACT_TOKEN_SIZE, AUTH_COMPACT_MAC_SIZE) != 0)
+		return AUTH_COMPACT_COOKIE_INVALID_SIGNATURE;
+
+	memcpy(token, raw + 1, AUTH_COMPACT_TOKEN_SIZE);
+	return 0;
+}
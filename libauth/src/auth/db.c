@@ -27,21 +27,23 @@
 #include <libpq-fe.h>
 
 #include "radicle/auth/types.h"
+#include "radicle/auth/crypto.h"
 #include "radicle/pgdb.h"
+#include "radicle/pgdb/copy.h"
 #include "radicle/auth/db.h"
 
 int auth_save_account(PGconn* conn, const auth_account_t* account, uuid_t** uuid) {
-	const char* stmt = "INSERT INTO Accounts(uuid, email, password, role, verified, created, active) VALUES(gen_random_uuid(), $1::text, $2::text, $3::ACCOUNTS_ROLE, $4::boolean, $5::timestamp, TRUE) RETURNING uuid;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_save_account", "INSERT INTO Accounts(uuid, email, password, role, verified, created, active) VALUES(gen_random_uuid(), $1::text, $2::text, $3::ACCOUNTS_ROLE, $4::boolean, $5::timestamp, TRUE) RETURNING uuid;");
 	pgdb_result_t* result = NULL;
 	pgdb_params_t* params = pgdb_params_new(5);
 
 	pgdb_bind_text(account->email, params);
 	pgdb_bind_text(account->password, params);
-	pgdb_bind_c_str(auth_account_role_to_str(account->role), params);
+	pgdb_bind_c_str_borrowed(auth_account_role_to_str(account->role), params);
 	pgdb_bind_bool(account->verified, params);
 	pgdb_bind_timestamp(time(NULL), params);
 
-	if(pgdb_fetch_param(conn, stmt, params, &result)) {
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
 		pgdb_params_free(&params);
 		return 1;
 	}
@@ -57,36 +59,36 @@ int auth_save_account(PGconn* conn, const auth_account_t* account, uuid_t** uuid
 }
 
 int auth_update_account_email(PGconn* conn, const uuid_t* uuid, const string_t* email) {
-	const char* stmt = "UPDATE Accounts SET email=$1::text, verified=true WHERE uuid=$2::uuid;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_update_account_email", "UPDATE Accounts SET email=$1::text, verified=true WHERE uuid=$2::uuid;");
 
 	pgdb_params_t* params = pgdb_params_new(2);
 	pgdb_bind_text(email, params);
 	pgdb_bind_uuid(uuid, params);
 
-	int result = pgdb_execute_param(conn, stmt, params);
+	int result = pgdb_execute_prepared(conn, &stmt, params);
 	pgdb_params_free(&params);
 	return result;
 
 }
 
 int auth_update_account_password(PGconn* conn, const uuid_t* uuid, const string_t* password) {
-	const char* stmt = "UPDATE Accounts SET password=$1::text WHERE uuid=$2::uuid;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_update_account_password", "UPDATE Accounts SET password=$1::text WHERE uuid=$2::uuid;");
 
 	pgdb_params_t* params = pgdb_params_new(2);
 	pgdb_bind_text(password, params);
 	pgdb_bind_uuid(uuid, params);
 
-	int result = pgdb_execute_param(conn, stmt, params);
+	int result = pgdb_execute_prepared(conn, &stmt, params);
 	pgdb_params_free(&params);
 	return result;
 }
 
 int auth_save_token(PGconn* conn, const uuid_t* owner, const string_t* token, token_type_t type, const string_t* custom) {
-	const char* stmt = "INSERT INTO Tokens(owner, created, token, type, custom) VALUES($1::uuid, now(), $2::text, $3::TOKEN_TYPE, $4::text);";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_save_token", "INSERT INTO Tokens(owner, created, token, type, custom) VALUES($1::uuid, now(), $2::text, $3::TOKEN_TYPE, $4::text);");
 	pgdb_params_t* params = pgdb_params_new(4);
 	pgdb_bind_uuid(owner, params);
 	pgdb_bind_text(token, params);
-	pgdb_bind_c_str(token_type_to_str(type), params);
+	pgdb_bind_c_str_borrowed(token_type_to_str(type), params);
 
 	if(custom != NULL)
 		pgdb_bind_text(custom, params);
@@ -94,14 +96,14 @@ int auth_save_token(PGconn* conn, const uuid_t* owner, const string_t* token, to
 		pgdb_bind_null(params);
 
 
-	int result = pgdb_execute_param(conn, stmt, params);
+	int result = pgdb_execute_prepared(conn, &stmt, params);
 	pgdb_params_free(&params);
 	return result;
 }
 
 int auth_save_session(PGconn* conn, const uuid_t* owner, const string_t* token, const time_t expires, const string_t* salt, uint32_t* id) {
 
-	const char* stmt = "INSERT INTO Sessions(owner, token, created, expires, revoked, salt) VALUES($1::uuid, $2::text, $3::timestamp, $4::timestamp, FALSE, $5::text) RETURNING id;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_save_session", "INSERT INTO Sessions(owner, token, created, expires, revoked, salt) VALUES($1::uuid, $2::text, $3::timestamp, $4::timestamp, FALSE, $5::text) RETURNING id;");
 	pgdb_params_t* params = pgdb_params_new(5);
 	if(owner != NULL)
 		pgdb_bind_uuid(owner, params);
@@ -114,7 +116,7 @@ int auth_save_session(PGconn* conn, const uuid_t* owner, const string_t* token,
 
 	pgdb_result_t* result = NULL;
 
-	if(pgdb_fetch_param(conn, stmt, params, &result)) {
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
 		DEBUG("Failed to insert session data.\n");
 		pgdb_params_free(&params);
 		return 1;
@@ -131,43 +133,88 @@ int auth_save_session(PGconn* conn, const uuid_t* owner, const string_t* token,
 	return 0;
 }
 
-int auth_save_session_access(PGconn* conn, const uint32_t session_id, const auth_request_log_t* request_log) {
-	const char* stmt = "INSERT INTO SessionAccesses(session_id, requester_ip, requester_port, date, url, response_time, response_code, internal_status) "
-			   "VALUES($1::int4, $2::text, $3::int4, $4::timestamp, $5::text, $6::int4, $7::int4, $8::int4);";
-	pgdb_params_t* params = pgdb_params_new(8);
+int auth_save_compact_session(PGconn* conn, const uuid_t* owner, const unsigned char* token, const time_t expires, uint32_t* id) {
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_save_compact_session", "INSERT INTO Sessions(owner, token_id, created, expires, revoked) VALUES($1::uuid, $2::bytea, $3::timestamp, $4::timestamp, FALSE) RETURNING id;");
+	pgdb_params_t* params = pgdb_params_new(4);
+	if(owner != NULL)
+		pgdb_bind_uuid(owner, params);
+	else
+		pgdb_bind_null(params);
+	pgdb_bind_bytea(token, AUTH_COMPACT_TOKEN_SIZE, params);
+	pgdb_bind_timestamp(time(NULL), params);
+	pgdb_bind_timestamp(expires, params);
+
+	pgdb_result_t* result = NULL;
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
+		DEBUG("Failed to insert session data.\n");
+		pgdb_params_free(&params);
+		return 1;
+	}
+	pgdb_params_free(&params);
+
+	if(pgdb_get_uint32(result, 0, "id", id)) {
+		ERROR("pgdb_get_int returned NULL for id. This should not be possible.\n");
+		pgdb_result_free(&result);
+		return 1;
+	}
+
+	pgdb_result_free(&result);
+	return 0;
+}
 
+/**
+ * @brief Binds columns of a SessionAccesses row in table order. Text is borrowed from \p request_log.
+ */
+static void auth_bind_session_access(pgdb_params_t* params, const uint32_t session_id, const auth_request_log_t* request_log) {
 	pgdb_bind_uint32(session_id, params);
-	pgdb_bind_text(request_log->ip, params);
+	pgdb_bind_text_borrowed(request_log->ip, params);
 	pgdb_bind_uint32(request_log->port, params);
 	pgdb_bind_timestamp(request_log->date, params);
-	pgdb_bind_text(request_log->url, params);
+	pgdb_bind_text_borrowed(request_log->url, params);
 	pgdb_bind_uint32(request_log->response_time, params);
 	pgdb_bind_uint32(request_log->response_code, params);
 	pgdb_bind_uint32(request_log->internal_status, params);
+}
 
-	int result = pgdb_execute_param(conn, stmt, params);
+int auth_save_session_access(PGconn* conn, const uint32_t session_id, const auth_request_log_t* request_log) {
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_save_session_access", "INSERT INTO SessionAccesses(session_id, requester_ip, requester_port, date, url, response_time, response_code, internal_status) "
+			   "VALUES($1::int4, $2::text, $3::int4, $4::timestamp, $5::text, $6::int4, $7::int4, $8::int4);");
+	pgdb_params_t* params = pgdb_params_new(8);
+	auth_bind_session_access(params, session_id, request_log);
+	int result = pgdb_execute_prepared(conn, &stmt, params);
 	pgdb_params_free(&params);
 	return result;
 }
 
+pgdb_copy_writer_t* auth_session_access_writer_new(PGconn* conn, const int max_rows, const size_t max_bytes) {
+	return pgdb_copy_writer_new(conn, "SessionAccesses(session_id, requester_ip, requester_port, date, url, response_time, response_code, internal_status)",
+			8, max_rows, max_bytes);
+}
+
+int auth_copy_session_access(pgdb_copy_writer_t* writer, const uint32_t session_id, const auth_request_log_t* request_log) {
+	pgdb_params_t* params = pgdb_copy_writer_row(writer);
+	auth_bind_session_access(params, session_id, request_log);
+	return pgdb_copy_writer_add(writer, params);
+}
+
 int auth_remove_token_by_owner(PGconn* conn, const uuid_t* owner, token_type_t type) {
-	const char* stmt = "DELETE FROM Tokens WHERE owner=$1::uuid and type=$2::TOKEN_TYPE;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_remove_token_by_owner", "DELETE FROM Tokens WHERE owner=$1::uuid and type=$2::TOKEN_TYPE;");
 	pgdb_params_t* params = pgdb_params_new(2);
 	pgdb_bind_uuid(owner, params);
-	pgdb_bind_c_str(token_type_to_str(type), params);
-	int result = pgdb_execute_param(conn, stmt, params);
+	pgdb_bind_c_str_borrowed(token_type_to_str(type), params);
+	int result = pgdb_execute_prepared(conn, &stmt, params);
 	pgdb_params_free(&params);
 	return result;
 }
 
 int auth_verify_token(PGconn* conn, const string_t* token, token_type_t expected_type, uuid_t** owner, string_t** custom) {
-	const char* stmt = "DELETE FROM Tokens WHERE token=$1::text AND type=$2::TOKEN_TYPE RETURNING owner, custom;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_verify_token", "DELETE FROM Tokens WHERE token=$1::text AND type=$2::TOKEN_TYPE RETURNING owner, custom;");
 	pgdb_params_t* params = pgdb_params_new(2);
 	pgdb_bind_text(token, params);
-	pgdb_bind_c_str(token_type_to_str(expected_type), params);
+	pgdb_bind_c_str_borrowed(token_type_to_str(expected_type), params);
 
 	pgdb_result_t* result = NULL;
-	if(pgdb_fetch_param(conn, stmt, params, &result)) {
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
 		pgdb_params_free(&params);
 		*owner = NULL;
 		return 1;
@@ -191,23 +238,23 @@ int auth_verify_token(PGconn* conn, const string_t* token, token_type_t expected
 }
 
 int auth_update_account_verification_status(PGconn* conn, const uuid_t* account, bool verified) {
-	const char* stmt = "UPDATE Accounts SET verified=$1::boolean WHERE uuid=$2::uuid;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_update_account_verification_status", "UPDATE Accounts SET verified=$1::boolean WHERE uuid=$2::uuid;");
 	pgdb_params_t* params = pgdb_params_new(2);
 	pgdb_bind_bool(verified, params);
 	pgdb_bind_uuid(account, params);
 
-	int result = pgdb_execute_param(conn, stmt, params);
+	int result = pgdb_execute_prepared(conn, &stmt, params);
 	pgdb_params_free(&params);
 	return result;
 }
 
 int auth_get_account_by_email(PGconn* conn, const string_t* email, auth_account_t** account) {
-	const char* stmt = "SELECT uuid, password, role, verified, active, created FROM Accounts WHERE email = $1::text";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_get_account_by_email", "SELECT uuid, password, role, verified, active, created FROM Accounts WHERE email = $1::text");
 	pgdb_params_t* params = pgdb_params_new(1);
 	pgdb_bind_text(email, params);
 
 	pgdb_result_t* result = NULL;
-	if(pgdb_fetch_param(conn, stmt, params, &result)) {
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
 		*account = NULL;
 		pgdb_params_free(&params);
 		return 1;
@@ -234,15 +281,15 @@ int auth_get_account_by_email(PGconn* conn, const string_t* email, auth_account_
 }
 
 int auth_get_session_by_cookie(PGconn* conn, const string_t* cookie, uint32_t* id, string_t** salt, auth_account_t** account) {
-	const char* stmt = "SELECT Sessions.id, Sessions.salt, Accounts.uuid, Accounts.email, Accounts.role, Accounts.verified, Accounts.active, Accounts.created" \
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_get_session_by_cookie", "SELECT Sessions.id, Sessions.salt, Accounts.uuid, Accounts.email, Accounts.role, Accounts.verified, Accounts.active, Accounts.created" \
 			   " FROM Sessions LEFT JOIN Accounts ON Accounts.uuid = Sessions.owner WHERE Sessions.token=$1 AND" \
-			   " revoked=FALSE AND expires>$2::timestamp LIMIT 1";
+			   " revoked=FALSE AND expires>$2::timestamp LIMIT 1");
 	pgdb_params_t* params = pgdb_params_new(2);
 	pgdb_bind_text(cookie, params);
 	pgdb_bind_timestamp(time(NULL), params);
 
 	pgdb_result_t* result = NULL;
-	if(pgdb_fetch_param(conn, stmt, params, &result)) {
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
 		INFO("Failed to fetch account info.\n");
 		pgdb_params_free(&params);
 		return 1;
@@ -285,8 +332,112 @@ int auth_get_session_by_cookie(PGconn* conn, const string_t* cookie, uint32_t* i
 	return 0;
 }
 
+int auth_get_session_by_token_id(PGconn* conn, const unsigned char* token, uint32_t* id, auth_account_t** account) {
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_get_session_by_token_id", "SELECT Sessions.id, Accounts.uuid, Accounts.email, Accounts.role, Accounts.verified, Accounts.active, Accounts.created" \
+			   " FROM Sessions LEFT JOIN Accounts ON Accounts.uuid = Sessions.owner WHERE Sessions.token_id=$1::bytea AND" \
+			   " revoked=FALSE AND expires>$2::timestamp LIMIT 1");
+	pgdb_params_t* params = pgdb_params_new(2);
+	pgdb_bind_bytea(token, AUTH_COMPACT_TOKEN_SIZE, params);
+	pgdb_bind_timestamp(time(NULL), params);
+
+	pgdb_result_t* result = NULL;
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
+		INFO("Failed to fetch account info.\n");
+		pgdb_params_free(&params);
+		return 1;
+	}	
+	pgdb_params_free(&params);
+
+	*id = 0;
+	if(PQntuples(result->pg) == 1) {
+		if(pgdb_get_uint32(result, 0, "id", id)) {
+			DEBUG("Cannot find column id\n");
+			pgdb_result_free(&result);
+			*id = 0;
+			return 1;
+		}
+
+		if(pgdb_exists(result, "uuid", 0)) {
+			*account  = calloc(1, sizeof(auth_account_t));
+			if(
+			pgdb_get_uuid(result, 0, "uuid", &(*account)->uuid) ||
+			pgdb_get_text(result, 0, "email", &(*account)->email) ||
+			pgdb_get_enum(result, 0, "role", &auth_account_role_from_str, (int*)&(*account)->role) ||
+			pgdb_get_bool(result, 0, "verified", &(*account)->verified) ||
+			pgdb_get_bool(result, 0, "active", &(*account)->active) ||
+			pgdb_get_timestamp(result, 0, "created", &(*account)->created)) {
+				DEBUG("Failed to read in all account columns\n");
+				pgdb_result_free(&result);
+				*id = 0;
+				auth_account_free(account);
+				return 1;
+			}
+		}
+	}
+
+	pgdb_result_free(&result);
+	return 0;
+}
+
+int auth_get_account_by_uuid(PGconn* conn, const uuid_t* uuid, auth_account_t** account) {
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_get_account_by_uuid", "SELECT email, password, role, verified, active, created FROM Accounts WHERE uuid = $1::uuid");
+	pgdb_params_t* params = pgdb_params_new(1);
+	pgdb_bind_uuid(uuid, params);
+
+	pgdb_result_t* result = NULL;
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
+		*account = NULL;
+		pgdb_params_free(&params);
+		return 1;
+	}
+	pgdb_params_free(&params);
+
+	*account = NULL;
+	if(PQntuples(result->pg) == 1) {
+		*account = calloc(1, sizeof(auth_account_t));
+		if(pgdb_get_text(result, 0, "email", &(*account)->email) ||
+		   pgdb_get_text(result, 0, "password", &(*account)->password) ||
+		   pgdb_get_enum(result, 0, "role", &auth_account_role_from_str, (int*)&(*account)->role) ||
+		   pgdb_get_bool(result, 0, "verified", &(*account)->verified) ||
+		   pgdb_get_bool(result, 0, "active", &(*account)->active) ||
+		   pgdb_get_timestamp(result, 0, "created", &(*account)->created)) {
+			DEBUG("Failed to read in all account columns\n");
+			pgdb_result_free(&result);
+			auth_account_free(account);
+			return 1;
+		}
+		(*account)->uuid = uuid_copy(uuid);
+	}
+
+	pgdb_result_free(&result);
+	return 0;
+}
+
+int auth_get_session_state(PGconn* conn, const uint32_t id, bool* valid, bool* active) {
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_get_session_state", "SELECT Accounts.active FROM Sessions LEFT JOIN Accounts ON Accounts.uuid = Sessions.owner"
+			" WHERE Sessions.id=$1::int4 AND revoked=FALSE AND expires>$2::timestamp LIMIT 1");
+	pgdb_params_t* params = pgdb_params_new(2);
+	pgdb_bind_uint32(id, params);
+	pgdb_bind_timestamp(time(NULL), params);
+
+	pgdb_result_t* result = NULL;
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
+		pgdb_params_free(&params);
+		return 1;
+	}
+	pgdb_params_free(&params);
+
+	*valid = PQntuples(result->pg) == 1;
+	// Sessions without owner have no active column to speak of.
+	if(!*valid || pgdb_get_bool(result, 0, "active", active))
+		*active = true;
+
+	pgdb_result_free(&result);
+	return 0;
+}
+
 int auth_blacklist_ip(PGconn* conn, const string_t* ip, const time_t date, const time_t ban_lift, uint32_t* id) {
-	const char* stmt = "INSERT INTO Blacklist(ip, added, ban_lift) VALUES ($1::text, $2::timestamp, $3::timestamp) RETURNING id;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_blacklist_ip", "INSERT INTO Blacklist(ip, added, ban_lift) VALUES ($1::text, $2::timestamp, $3::timestamp) RETURNING id;");
 	pgdb_params_t* params = pgdb_params_new(3);
 	pgdb_bind_text(ip, params);
 	pgdb_bind_timestamp(date, params);
@@ -296,7 +447,7 @@ int auth_blacklist_ip(PGconn* conn, const string_t* ip, const time_t date, const
 		pgdb_bind_null(params);
 
 	pgdb_result_t* result = NULL;
-	if(pgdb_fetch_param(conn, stmt, params, &result)) {
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
 		pgdb_params_free(&params);
 		*id = 0;
 		return 1;
@@ -313,25 +464,25 @@ int auth_blacklist_ip(PGconn* conn, const string_t* ip, const time_t date, const
 }
 
 int auth_save_blacklist_access(PGconn* conn, const int id, const time_t date, const string_t* url) {
-	const char* stmt = "INSERT INTO BlacklistAccesses(blacklist_id, date, url) VALUES ($1::int, $2::timestamp, $3::text);";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_save_blacklist_access", "INSERT INTO BlacklistAccesses(blacklist_id, date, url) VALUES ($1::int, $2::timestamp, $3::text);");
 	pgdb_params_t* params = pgdb_params_new(3);
 	pgdb_bind_uint32(id, params);
 	pgdb_bind_timestamp(date, params);
 	pgdb_bind_text(url, params);
-	int result = pgdb_execute_param(conn, stmt, params);
+	int result = pgdb_execute_prepared(conn, &stmt, params);
 	pgdb_params_free(&params);
 	return result;
 }
 
 int auth_blacklist_lookup_ip(PGconn* conn, const string_t* ip, uint32_t* id) {
-	const char* stmt = "SELECT id FROM Blacklist WHERE ip=$1::text AND (ban_lift IS NULL OR ban_lift < $2::timestamp) LIMIT 1;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_blacklist_lookup_ip", "SELECT id FROM Blacklist WHERE ip=$1::text AND (ban_lift IS NULL OR ban_lift > $2::timestamp) LIMIT 1;");
 
 	pgdb_params_t* params = pgdb_params_new(2);
 	pgdb_bind_text(ip, params);
 	pgdb_bind_timestamp(time(NULL), params);
 
 	pgdb_result_t* result = NULL;
-	if(pgdb_fetch_param(conn, stmt, params, &result)) {
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
 		pgdb_params_free(&params);
 		return 1;
 	}
@@ -354,17 +505,131 @@ int auth_blacklist_lookup_ip(PGconn* conn, const string_t* ip, uint32_t* id) {
 	return 0;
 }
 
+int auth_blacklist_fetch(PGconn* conn, const uint32_t after_id, const time_t now, list_t** results) {
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_blacklist_fetch", "SELECT id, ip, ban_lift FROM Blacklist WHERE id > $1::int4 "
+				"AND (ban_lift IS NULL OR ban_lift > $2::timestamp) ORDER BY id;");
+
+	pgdb_params_t* params = pgdb_params_new(2);
+	pgdb_bind_uint32(after_id, params);
+	pgdb_bind_timestamp(now, params);
+
+	pgdb_result_t* result = NULL;
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
+		pgdb_params_free(&params);
+		return 1;
+	}
+	pgdb_params_free(&params);
+
+	*results = NULL;
+	int rows = PQntuples(result->pg);
+	if(rows == 0) {
+		pgdb_result_free(&result);
+		return 0;
+	}
+
+	static const pgdb_column_t columns[] = {
+		PGDB_COLUMN("id", PGDB_COLUMN_UINT32, auth_blacklist_entry_t, id),
+		PGDB_COLUMN("ip", PGDB_COLUMN_TEXT, auth_blacklist_entry_t, ip),
+		PGDB_COLUMN_OPTIONAL("ban_lift", PGDB_COLUMN_TIMESTAMP, auth_blacklist_entry_t, ban_lift)
+	};
+	pgdb_row_decoder_t* decoder = pgdb_row_decoder_new(result, columns, sizeof(columns) / sizeof(columns[0]));
+	if(decoder == NULL) {
+		pgdb_result_free(&result);
+		return 1;
+	}
+
+	for(int i = 0; i < rows; i++) {
+		auth_blacklist_entry_t* entry = (auth_blacklist_entry_t*)calloc(1, sizeof(auth_blacklist_entry_t));
+		list_tail(results, entry);
+		if(pgdb_row_decode(decoder, result, i, entry)) {
+			pgdb_row_decoder_free(&decoder);
+			pgdb_result_free(&result);
+			list_free(*results, auth_blacklist_entry_free);
+			*results = NULL;
+			return 1;
+		}
+	}
+
+	pgdb_row_decoder_free(&decoder);
+	pgdb_result_free(&result);
+	return 0;
+}
+
+int auth_revoked_sessions_fetch(PGconn* conn, const time_t now, uint32_t** ids, size_t* count) {
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_revoked_sessions_fetch", "SELECT id FROM Sessions WHERE revoked=TRUE AND expires>$1::timestamp ORDER BY id;");
+
+	pgdb_params_t* params = pgdb_params_new(1);
+	pgdb_bind_timestamp(now, params);
+
+	pgdb_result_t* result = NULL;
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
+		pgdb_params_free(&params);
+		return 1;
+	}
+	pgdb_params_free(&params);
+
+	*ids = NULL;
+	*count = PQntuples(result->pg);
+	if(*count > 0)
+		*ids = malloc(*count * sizeof(uint32_t));
+	for(size_t i = 0; i < *count; i++) {
+		if(pgdb_get_uint32(result, i, "id", &(*ids)[i])) {
+			pgdb_result_free(&result);
+			free(*ids);
+			*ids = NULL;
+			*count = 0;
+			return 1;
+		}
+	}
+
+	pgdb_result_free(&result);
+	return 0;
+}
+
+int auth_inactive_accounts_fetch(PGconn* conn, uuid_t** accounts, size_t* count) {
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_inactive_accounts_fetch", "SELECT uuid FROM Accounts WHERE active=FALSE;");
+
+	pgdb_params_t* params = pgdb_params_new(0);
+
+	pgdb_result_t* result = NULL;
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
+		pgdb_params_free(&params);
+		return 1;
+	}
+	pgdb_params_free(&params);
+
+	*accounts = NULL;
+	*count = PQntuples(result->pg);
+	if(*count > 0)
+		*accounts = malloc(*count * sizeof(uuid_t));
+	for(size_t i = 0; i < *count; i++) {
+		uuid_t* uuid = NULL;
+		if(pgdb_get_uuid(result, i, "uuid", &uuid)) {
+			pgdb_result_free(&result);
+			free(*accounts);
+			*accounts = NULL;
+			*count = 0;
+			return 1;
+		}
+		(*accounts)[i] = *uuid;
+		uuid_free(&uuid);
+	}
+
+	pgdb_result_free(&result);
+	return 0;
+}
+
 int auth_session_lookup_ip(PGconn* conn, const string_t* ip, const time_t begin, list_t** results) {
-	const char* stmt = "SELECT Sessions.owner, SessionAccesses.internal_status, SessionAccesses.response_code FROM SessionAccesses "
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_session_lookup_ip", "SELECT Sessions.owner, SessionAccesses.internal_status, SessionAccesses.response_code FROM SessionAccesses "
 				"JOIN Sessions ON SessionAccesses.session_id=Sessions.id "
-				"WHERE SessionAccesses.requester_ip=$1::text AND SessionAccesses.date > $2::timestamp;";
+				"WHERE SessionAccesses.requester_ip=$1::text AND SessionAccesses.date > $2::timestamp;");
 
 	pgdb_params_t* params = pgdb_params_new(2);
 	pgdb_bind_text(ip, params);
 	pgdb_bind_timestamp(begin, params);
 
 	pgdb_result_t* result = NULL;
-	if(pgdb_fetch_param(conn, stmt, params, &result)) {
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result)) {
 		pgdb_params_free(&params);
 		return 1;
 	}
@@ -378,26 +643,37 @@ int auth_session_lookup_ip(PGconn* conn, const string_t* ip, const time_t begin,
 		return 0;
 	}
 
+	static const pgdb_column_t columns[] = {
+		PGDB_COLUMN("internal_status", PGDB_COLUMN_UINT32, auth_session_access_entry_t, internal_status),
+		PGDB_COLUMN("response_code", PGDB_COLUMN_UINT32, auth_session_access_entry_t, response_code),
+		PGDB_COLUMN_OPTIONAL("owner", PGDB_COLUMN_UUID, auth_session_access_entry_t, owner)
+	};
+	pgdb_row_decoder_t* decoder = pgdb_row_decoder_new(result, columns, sizeof(columns) / sizeof(columns[0]));
+	if(decoder == NULL) {
+		pgdb_result_free(&result);
+		return 1;
+	}
+
 	for(int i = 0; i < rows; i++) {
 		auth_session_access_entry_t* entry = (auth_session_access_entry_t*)calloc(1, sizeof(auth_session_access_entry_t));
-		if(pgdb_get_uint32(result, i, "internal_status", &entry->internal_status) ||
-		   pgdb_get_uint32(result, i, "response_code", &entry->response_code)) {
-
+		list_tail(results, entry);
+		if(pgdb_row_decode(decoder, result, i, entry)) {
+			pgdb_row_decoder_free(&decoder);
 			pgdb_result_free(&result);
 			list_free(*results, auth_session_access_entry_free);
+			*results = NULL;
 			return 1;
 		}
-		pgdb_get_uuid(result, i, "owner", &entry->owner);
-		list_tail(results, entry);
 	}
-		
+
+	pgdb_row_decoder_free(&decoder);
 	pgdb_result_free(&result);
 	return 0;
 }
 
 int auth_save_file(PGconn* conn, auth_file_t* file) {
-	const char* stmt = "INSERT INTO Files(uuid, owner, type, path, name, uploaded, size)"
-	       " VALUES(gen_random_uuid(), $1::uuid, $2::FileTypes, $3::text, $4::text, $5::timestamp, $6::biging) RETURNING uuid;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_save_file", "INSERT INTO Files(uuid, owner, type, path, name, uploaded, size)"
+	       " VALUES(gen_random_uuid(), $1::uuid, $2::FileTypes, $3::text, $4::text, $5::timestamp, $6::biging) RETURNING uuid;");
 	pgdb_params_t* params = pgdb_params_new(6);
 	pgdb_bind_uuid(file->owner, params);
 	pgdb_bind_c_str(file_type_to_str(file->type), params);
@@ -407,7 +683,7 @@ int auth_save_file(PGconn* conn, auth_file_t* file) {
 	pgdb_bind_uint64(file->size, params);
 
 	pgdb_result_t* result = NULL;
-	int r = (pgdb_fetch_param(conn, stmt, params, &result) ||
+	int r = (pgdb_fetch_prepared(conn, &stmt, params, &result) ||
 		PQntuples(result->pg) != 1 ||
 		pgdb_get_uuid(result, 0, "uuid", &file->uuid));
 
@@ -417,13 +693,13 @@ int auth_save_file(PGconn* conn, auth_file_t* file) {
 }
 
 int auth_get_file(PGconn* conn, const uuid_t* uuid, auth_file_t** file) {
-	const char* stmt = "SELECT owner, type, path, name, uploaded, size FROM Files WHERE uuid=$1::uuid;";
+	static pgdb_statement_t stmt = PGDB_STATEMENT("auth_get_file", "SELECT owner, type, path, name, uploaded, size FROM Files WHERE uuid=$1::uuid;");
 	pgdb_params_t* params = pgdb_params_new(1);
 	pgdb_bind_uuid(uuid, params);
 
 	pgdb_result_t* result = NULL;
 
-	if(pgdb_fetch_param(conn, stmt, params, &result) ||
+	if(pgdb_fetch_prepared(conn, &stmt, params, &result) ||
 		PQntuples(result->pg) != 1) {
 		pgdb_params_free(&params);
 		return 1;
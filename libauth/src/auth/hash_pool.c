@@ -0,0 +1,211 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "radicle/auth/hash_pool.h"
+#include "radicle/auth/crypto.h"
+#include "radicle/print.h"
+
+static pthread_once_t auth_hash_pool_default_dummy_once = PTHREAD_ONCE_INIT;
+static string_t* auth_hash_pool_default_dummy = NULL;
+
+/**
+ * @brief Creates hash of a random password, so verifying anything against it fails.
+ */
+static string_t* auth_hash_pool_dummy_new(const auth_password_params_t* params) {
+	string_t* password = NULL;
+	if(auth_generate_random_base64(32, &password)) {
+		ERROR("Failed to generate dummy password.\n");
+		return NULL;
+	}
+
+	string_t* dummy = NULL;
+	if(auth_hash_password_with(params, password, &dummy)) {
+		ERROR("Failed to hash dummy password.\n");
+	}
+	string_free(&password);
+	return dummy;
+}
+
+static void auth_hash_pool_default_dummy_new() {
+	static const auth_password_params_t defaults = AUTH_PASSWORD_PARAMS_DEFAULT;
+	auth_hash_pool_default_dummy = auth_hash_pool_dummy_new(&defaults);
+}
+
+static void auth_hash_pool_run(const auth_hash_pool_t* pool, auth_hash_job_t* job) {
+	if(job->type == AUTH_HASH_JOB_HASH)
+		job->error = auth_hash_password_with(&pool->params, job->password, &job->result);
+	else
+		job->error = auth_verify_password(job->encoded, job->password);
+}
+
+static void* auth_hash_pool_worker(void* data) {
+	auth_hash_pool_t* pool = data;
+
+	pthread_mutex_lock(&pool->lock);
+	while(true) {
+		while(pool->running && pool->head == NULL)
+			pthread_cond_wait(&pool->wakeup, &pool->lock);
+		// Queued jobs are still finished while shutting down, their submitters are waiting.
+		if(pool->head == NULL)
+			break;
+
+		auth_hash_job_t* job = pool->head;
+		pool->head = job->next;
+		if(pool->head == NULL)
+			pool->tail = NULL;
+		pool->queued--;
+		pthread_mutex_unlock(&pool->lock);
+
+		auth_hash_pool_run(pool, job);
+
+		pthread_mutex_lock(&pool->lock);
+		job->done = true;
+		pthread_cond_broadcast(&pool->finished);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/**
+ * @brief Queues job and waits until a worker finished it.
+ */
+static int auth_hash_pool_submit(auth_hash_pool_t* pool, auth_hash_job_t* job) {
+	if(pool->workers == 0) {
+		auth_hash_pool_run(pool, job);
+		return job->error;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	if(!pool->running || pool->queued >= pool->queue_depth) {
+		pthread_mutex_unlock(&pool->lock);
+		DEBUG("Hash pool is busy, rejecting job.\n");
+		return AUTH_HASH_POOL_BUSY;
+	}
+
+	if(pool->tail != NULL)
+		pool->tail->next = job;
+	else
+		pool->head = job;
+	pool->tail = job;
+	pool->queued++;
+	pthread_cond_signal(&pool->wakeup);
+
+	while(!job->done)
+		pthread_cond_wait(&pool->finished, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+	return job->error;
+}
+
+auth_hash_pool_t* auth_hash_pool_new(const int workers, const size_t queue_depth, const size_t memory_budget, const auth_password_params_t* params) {
+	static const auth_password_params_t defaults = AUTH_PASSWORD_PARAMS_DEFAULT;
+	if(params == NULL)
+		params = &defaults;
+
+	int count = workers > 0 ? workers : 0;
+	size_t affordable = params->memory_cost > 0 ? memory_budget / params->memory_cost : (size_t) count;
+	if(count > 0 && affordable < (size_t) count) {
+		INFO("Memory budget of %ld KiB only allows %ld concurrent hashes.\n", memory_budget, affordable);
+		count = affordable > 0 ? affordable : 1;
+	}
+
+	auth_hash_pool_t* pool = calloc(1, sizeof(auth_hash_pool_t));
+	pool->params = *params;
+	pool->dummy = auth_hash_pool_dummy_new(params);
+	pool->threads = calloc(count, sizeof(pthread_t));
+	pool->queue_depth = queue_depth;
+	pool->running = true;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wakeup, NULL);
+	pthread_cond_init(&pool->finished, NULL);
+
+	for(int i = 0; i < count; i++) {
+		if(pthread_create(&pool->threads[i], NULL, auth_hash_pool_worker, pool)) {
+			ERROR("Failed to start hash worker %d.\n", i);
+			break;
+		}
+		pool->workers++;
+	}
+
+	if(count > 0 && pool->workers == 0)
+		auth_hash_pool_free(&pool);
+	return pool;
+}
+
+int auth_hash_pool_hash(auth_hash_pool_t* pool, const string_t* password, string_t** buffer) {
+	if(pool == NULL)
+		return auth_hash_password(password, buffer);
+
+	auth_hash_job_t job = { .type = AUTH_HASH_JOB_HASH, .password = password };
+	int error = auth_hash_pool_submit(pool, &job);
+	*buffer = job.result;
+	return error;
+}
+
+int auth_hash_pool_verify(auth_hash_pool_t* pool, const string_t* encoded, const string_t* password) {
+	if(pool == NULL)
+		return auth_verify_password(encoded, password);
+
+	auth_hash_job_t job = { .type = AUTH_HASH_JOB_VERIFY, .password = password, .encoded = encoded };
+	return auth_hash_pool_submit(pool, &job);
+}
+
+bool auth_hash_pool_needs_rehash(const auth_hash_pool_t* pool, const string_t* encoded) {
+	static const auth_password_params_t defaults = AUTH_PASSWORD_PARAMS_DEFAULT;
+	return auth_password_needs_rehash(encoded, pool != NULL ? &pool->params : &defaults);
+}
+
+int auth_hash_pool_verify_dummy(auth_hash_pool_t* pool, const string_t* password) {
+	const string_t* dummy = NULL;
+	if(pool != NULL) {
+		dummy = pool->dummy;
+	} else {
+		pthread_once(&auth_hash_pool_default_dummy_once, auth_hash_pool_default_dummy_new);
+		dummy = auth_hash_pool_default_dummy;
+	}
+
+	if(dummy == NULL)
+		return 1;
+	return auth_hash_pool_verify(pool, dummy, password) == AUTH_HASH_POOL_BUSY ? AUTH_HASH_POOL_BUSY : 1;
+}
+
+void auth_hash_pool_free(auth_hash_pool_t** pool) {
+	if(*pool == NULL) return;
+
+	pthread_mutex_lock(&(*pool)->lock);
+	(*pool)->running = false;
+	pthread_cond_broadcast(&(*pool)->wakeup);
+	pthread_mutex_unlock(&(*pool)->lock);
+
+	for(int i = 0; i < (*pool)->workers; i++)
+		pthread_join((*pool)->threads[i], NULL);
+
+	free((*pool)->threads);
+	string_free(&(*pool)->dummy);
+	pthread_cond_destroy(&(*pool)->finished);
+	pthread_cond_destroy(&(*pool)->wakeup);
+	pthread_mutex_destroy(&(*pool)->lock);
+	free(*pool);
+	*pool = NULL;
+}
@@ -0,0 +1,123 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <openssl/rand.h>
+#include <openssl/err.h>
+#include <openssl/crypto.h>
+
+#include "radicle/auth/random.h"
+#include "radicle/print.h"
+
+/**
+ * @brief Random bytes of a single thread.
+ */
+typedef struct auth_random_buffer {
+	unsigned char bytes[AUTH_RANDOM_BUFFER_SIZE]; /**< Unused bytes are at the end. */
+	size_t available; /**< Amount of unused bytes. */
+	uint64_t generation; /**< Fork generation buffer was filled in. */
+} auth_random_buffer_t;
+
+static __thread auth_random_buffer_t auth_random_buffer;
+
+/**
+ * @brief Incremented in every child process, so buffers filled before the fork are not shared
+ * between parent and child.
+ */
+static uint64_t auth_random_generation = 0;
+static pthread_once_t auth_random_once = PTHREAD_ONCE_INIT;
+
+static void auth_random_fork_child() {
+	__atomic_add_fetch(&auth_random_generation, 1, __ATOMIC_RELAXED);
+}
+
+static void auth_random_init() {
+	pthread_atfork(NULL, NULL, auth_random_fork_child);
+}
+
+static int auth_random_fill(unsigned char* output, const size_t length) {
+	// OpenSSL reseeds its DRBG on its own and after a fork.
+	if(RAND_bytes(output, length) != 1) {
+		unsigned int error_code = ERR_get_error();
+		if(error_code != 0) {
+			char error_buffer[1024];
+			ERR_error_string_n(error_code, error_buffer, 1024);
+			ERROR("%s\n", error_buffer);
+		} else {
+			ERROR("RAND_bytes reported an error but ERR_get_error does not return any error information.\n");	
+		}
+		return 1;
+	}
+	return 0;
+}
+
+int auth_random_bytes(unsigned char* output, const size_t length) {
+	pthread_once(&auth_random_once, auth_random_init);
+	auth_random_buffer_t* buffer = &auth_random_buffer;
+
+	uint64_t generation = __atomic_load_n(&auth_random_generation, __ATOMIC_RELAXED);
+	if(buffer->generation != generation) {
+		OPENSSL_cleanse(buffer->bytes, sizeof(buffer->bytes));
+		buffer->available = 0;
+		buffer->generation = generation;
+	}
+
+	// Large requests would drain the buffer anyway.
+	if(length > AUTH_RANDOM_BUFFER_SIZE / 2)
+		return auth_random_fill(output, length);
+
+	if(buffer->available < length) {
+		if(auth_random_fill(buffer->bytes, AUTH_RANDOM_BUFFER_SIZE))
+			return 1;
+		buffer->available = AUTH_RANDOM_BUFFER_SIZE;
+	}
+
+	unsigned char* start = buffer->bytes + AUTH_RANDOM_BUFFER_SIZE - buffer->available;
+	memcpy(output, start, length);
+	OPENSSL_cleanse(start, length);
+	buffer->available -= length;
+	return 0;
+}
+
+size_t auth_random_token(const size_t bytes, const base64_alphabet_t alphabet, char* output) {
+	// Multiple of three, so chunks are encoded without padding in between.
+	unsigned char random[AUTH_RANDOM_BUFFER_SIZE / 2 / 3 * 3];
+	size_t length = 0;
+
+	*output = '\0';
+	for(size_t done = 0; done < bytes;) {
+		size_t chunk = bytes - done < sizeof(random) ? bytes - done : sizeof(random);
+		if(auth_random_bytes(random, chunk)) {
+			length = 0;
+			break;
+		}
+		length += base64_encode_to(random, chunk, output + length, alphabet);
+		done += chunk;
+	}
+
+	OPENSSL_cleanse(random, sizeof(random));
+	return length;
+}
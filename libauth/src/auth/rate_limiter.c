@@ -0,0 +1,212 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "radicle/auth/rate_limiter.h"
+#include "radicle/print.h"
+
+static int64_t auth_rate_limiter_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static uint64_t auth_rate_limiter_hash(const string_t* ip) {
+	uint64_t hash = 14695981039346656037ULL;
+	for(size_t i = 0; i < ip->length; i++) {
+		hash ^= (unsigned char) ip->ptr[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static size_t auth_rate_limiter_round(size_t value) {
+	size_t size = 1;
+	while(size < value)
+		size <<= 1;
+	return size;
+}
+
+static auth_rate_limiter_shard_t* auth_rate_limiter_shard(auth_rate_limiter_t* limiter, const uint64_t hash) {
+	return &limiter->shards[hash & limiter->shard_mask];
+}
+
+static auth_rate_limiter_entry_t** auth_rate_limiter_bucket(auth_rate_limiter_shard_t* shard, const uint64_t hash) {
+	// Low bits already picked the shard.
+	return &shard->buckets[(hash >> 32) & shard->mask];
+}
+
+/**
+ * @brief An entry whose previous window ended is worth nothing anymore.
+ */
+static bool auth_rate_limiter_stale(const auth_rate_limiter_t* limiter, const auth_rate_limiter_entry_t* entry, const int64_t now) {
+	return now - entry->window_start >= 2 * limiter->window;
+}
+
+/**
+ * @brief Removes all stale entries of shard. Shard must be locked.
+ */
+static void auth_rate_limiter_sweep(auth_rate_limiter_t* limiter, auth_rate_limiter_shard_t* shard, const int64_t now) {
+	for(size_t i = 0; i <= shard->mask; i++) {
+		auth_rate_limiter_entry_t** iter = &shard->buckets[i];
+		while(*iter != NULL) {
+			auth_rate_limiter_entry_t* entry = *iter;
+			if(auth_rate_limiter_stale(limiter, entry, now)) {
+				*iter = entry->next;
+				free(entry);
+				shard->count--;
+			} else {
+				iter = &entry->next;
+			}
+		}
+	}
+}
+
+static auth_rate_limiter_entry_t* auth_rate_limiter_find(auth_rate_limiter_shard_t* shard, const uint64_t hash, const string_t* ip) {
+	auth_rate_limiter_entry_t* iter = *auth_rate_limiter_bucket(shard, hash);
+	while(iter != NULL) {
+		if(iter->hash == hash && strcmp(iter->ip, ip->ptr) == 0)
+			return iter;
+		iter = iter->next;
+	}
+	return NULL;
+}
+
+auth_rate_limiter_t* auth_rate_limiter_new(const uint32_t limit, const time_t window, const size_t capacity, const int shards) {
+	size_t shard_count = auth_rate_limiter_round(shards > 0 ? shards : 1);
+	while(shard_count > 1 && shard_count > capacity)
+		shard_count >>= 1;
+
+	auth_rate_limiter_t* limiter = calloc(1, sizeof(auth_rate_limiter_t));
+	limiter->shards = aligned_alloc(64, shard_count * sizeof(auth_rate_limiter_shard_t));
+	memset(limiter->shards, 0, shard_count * sizeof(auth_rate_limiter_shard_t));
+	limiter->shard_mask = shard_count - 1;
+	limiter->limit = limit;
+	limiter->window = (int64_t) window * 1000;
+
+	size_t per_shard = capacity > 0 ? (capacity + shard_count - 1) / shard_count : 1;
+	size_t buckets = auth_rate_limiter_round(per_shard);
+	for(size_t i = 0; i < shard_count; i++) {
+		auth_rate_limiter_shard_t* shard = &limiter->shards[i];
+		pthread_mutex_init(&shard->lock, NULL);
+		shard->buckets = calloc(buckets, sizeof(auth_rate_limiter_entry_t*));
+		shard->mask = buckets - 1;
+		shard->capacity = per_shard;
+	}
+
+	return limiter;
+}
+
+int auth_rate_limiter_hit(auth_rate_limiter_t* limiter, const string_t* ip) {
+	if(ip == NULL || ip->length >= AUTH_BLACKLIST_IP_LENGTH || limiter->window <= 0)
+		return 0;
+
+	int64_t now = auth_rate_limiter_now();
+	uint64_t hash = auth_rate_limiter_hash(ip);
+	auth_rate_limiter_shard_t* shard = auth_rate_limiter_shard(limiter, hash);
+
+	pthread_mutex_lock(&shard->lock);
+	auth_rate_limiter_entry_t* entry = auth_rate_limiter_find(shard, hash, ip);
+	if(entry == NULL) {
+		if(shard->count >= shard->capacity)
+			auth_rate_limiter_sweep(limiter, shard, now);
+		if(shard->count >= shard->capacity) {
+			pthread_mutex_unlock(&shard->lock);
+			DEBUG("Rate limiter is full, not tracking %s.\n", ip->ptr);
+			return 0;
+		}
+
+		entry = calloc(1, sizeof(auth_rate_limiter_entry_t));
+		entry->hash = hash;
+		entry->window_start = now;
+		memcpy(entry->ip, ip->ptr, ip->length);
+		auth_rate_limiter_entry_t** bucket = auth_rate_limiter_bucket(shard, hash);
+		entry->next = *bucket;
+		*bucket = entry;
+		shard->count++;
+	}
+
+	int64_t elapsed = now - entry->window_start;
+	if(elapsed >= 2 * limiter->window) {
+		entry->previous = 0;
+		entry->current = 0;
+		entry->window_start = now;
+		elapsed = 0;
+	} else if(elapsed >= limiter->window) {
+		entry->previous = entry->current;
+		entry->current = 0;
+		entry->window_start += limiter->window;
+		elapsed -= limiter->window;
+	}
+
+	// Assumes requests of previous window were evenly spread.
+	uint64_t estimate = entry->current + (uint64_t) entry->previous * (limiter->window - elapsed) / limiter->window;
+	if(entry->current < UINT32_MAX)
+		entry->current++;
+	pthread_mutex_unlock(&shard->lock);
+
+	return estimate >= limiter->limit ? 1 : 0;
+}
+
+void auth_rate_limiter_reset(auth_rate_limiter_t* limiter, const string_t* ip) {
+	if(ip == NULL || ip->length >= AUTH_BLACKLIST_IP_LENGTH)
+		return;
+
+	uint64_t hash = auth_rate_limiter_hash(ip);
+	auth_rate_limiter_shard_t* shard = auth_rate_limiter_shard(limiter, hash);
+
+	pthread_mutex_lock(&shard->lock);
+	auth_rate_limiter_entry_t** iter = auth_rate_limiter_bucket(shard, hash);
+	while(*iter != NULL) {
+		auth_rate_limiter_entry_t* entry = *iter;
+		if(entry->hash == hash && strcmp(entry->ip, ip->ptr) == 0) {
+			*iter = entry->next;
+			free(entry);
+			shard->count--;
+			break;
+		}
+		iter = &entry->next;
+	}
+	pthread_mutex_unlock(&shard->lock);
+}
+
+void auth_rate_limiter_free(auth_rate_limiter_t** limiter) {
+	if(*limiter == NULL) return;
+	for(size_t i = 0; i <= (*limiter)->shard_mask; i++) {
+		auth_rate_limiter_shard_t* shard = &(*limiter)->shards[i];
+		for(size_t j = 0; j <= shard->mask; j++) {
+			auth_rate_limiter_entry_t* iter = shard->buckets[j];
+			while(iter != NULL) {
+				auth_rate_limiter_entry_t* next = iter->next;
+				free(iter);
+				iter = next;
+			}
+		}
+		free(shard->buckets);
+		pthread_mutex_destroy(&shard->lock);
+	}
+	free((*limiter)->shards);
+	free(*limiter);
+	*limiter = NULL;
+}
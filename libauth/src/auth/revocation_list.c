@@ -0,0 +1,226 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "radicle/auth/revocation_list.h"
+#include "radicle/auth/db.h"
+#include "radicle/clock.h"
+#include "radicle/pgdb.h"
+#include "radicle/print.h"
+
+static int auth_revocation_list_compare_session(const void* a, const void* b) {
+	uint32_t first = *(const uint32_t*) a;
+	uint32_t second = *(const uint32_t*) b;
+	return (first > second) - (first < second);
+}
+
+static int auth_revocation_list_compare_account(const void* a, const void* b) {
+	return memcmp(((const uuid_t*) a)->bin, ((const uuid_t*) b)->bin, sizeof(((const uuid_t*) a)->bin));
+}
+
+/**
+ * @brief Copies and sorts sessions and accounts into a single allocation.
+ */
+static auth_revocation_table_t* auth_revocation_table_new(const uint32_t* sessions, size_t session_count, const uuid_t* accounts, size_t account_count) {
+	auth_revocation_table_t* table = calloc(1, sizeof(auth_revocation_table_t) + session_count * sizeof(uint32_t) + account_count * sizeof(uuid_t));
+	table->session_count = session_count;
+	table->account_count = account_count;
+	table->sessions = (uint32_t*) (table + 1);
+	table->accounts = (uuid_t*) (table->sessions + session_count);
+
+	if(session_count > 0)
+		memcpy(table->sessions, sessions, session_count * sizeof(uint32_t));
+	qsort(table->sessions, session_count, sizeof(uint32_t), auth_revocation_list_compare_session);
+
+	if(account_count > 0)
+		memcpy(table->accounts, accounts, account_count * sizeof(uuid_t));
+	qsort(table->accounts, account_count, sizeof(uuid_t), auth_revocation_list_compare_account);
+
+	return table;
+}
+
+/**
+ * @brief Swaps in table and retires the old one. Must be called with list->lock held.
+ */
+static void auth_revocation_list_swap(auth_revocation_list_t* list, auth_revocation_table_t* table) {
+	auth_revocation_table_t* old = list->table;
+	__atomic_store_n(&list->table, table, __ATOMIC_RELEASE);
+
+	retire_list_push(list->retired, &old->retire);
+}
+
+auth_revocation_list_t* auth_revocation_list_new() {
+	auth_revocation_list_t* list = calloc(1, sizeof(auth_revocation_list_t));
+	list->retired = retire_list_new();
+	if(list->retired == NULL) {
+		ERROR("Failed to create retire list of revocation list.\n");
+		free(list);
+		return NULL;
+	}
+	list->table = auth_revocation_table_new(NULL, 0, NULL, 0);
+	pthread_mutex_init(&list->lock, NULL);
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&list->wakeup, &attr);
+	pthread_condattr_destroy(&attr);
+	return list;
+}
+
+int auth_revocation_list_load(auth_revocation_list_t* list, PGconn* conn) {
+	uint32_t* sessions = NULL;
+	size_t session_count = 0;
+	if(auth_revoked_sessions_fetch(conn, time(NULL), &sessions, &session_count)) {
+		ERROR("Failed to fetch revoked sessions.\n");
+		return 1;
+	}
+
+	uuid_t* accounts = NULL;
+	size_t account_count = 0;
+	if(auth_inactive_accounts_fetch(conn, &accounts, &account_count)) {
+		ERROR("Failed to fetch inactive accounts.\n");
+		free(sessions);
+		return 1;
+	}
+
+	// Revocations are rare, so a full reload stays small and also forgets expired sessions.
+	auth_revocation_table_t* table = auth_revocation_table_new(sessions, session_count, accounts, account_count);
+	free(sessions);
+	free(accounts);
+
+	pthread_mutex_lock(&list->lock);
+	auth_revocation_list_swap(list, table);
+	pthread_mutex_unlock(&list->lock);
+	__atomic_store_n(&list->loaded, clock_monotonic(), __ATOMIC_RELEASE);
+	return 0;
+}
+
+bool auth_revocation_list_is_fresh(auth_revocation_list_t* list) {
+	time_t loaded = __atomic_load_n(&list->loaded, __ATOMIC_ACQUIRE);
+	if(loaded == 0)
+		return false;
+	if(list->refresh_interval <= 0)
+		return true;
+	int64_t age = (int64_t) (clock_monotonic() - loaded) * 1000;
+	return age <= AUTH_REVOCATION_LIST_STALE_REFRESHES * list->refresh_interval;
+}
+
+bool auth_revocation_list_session_revoked(auth_revocation_list_t* list, const uint32_t session) {
+	retire_reader_t* reader = retire_list_enter(list->retired);
+	auth_revocation_table_t* table = __atomic_load_n(&list->table, __ATOMIC_ACQUIRE);
+	bool revoked = bsearch(&session, table->sessions, table->session_count, sizeof(uint32_t), auth_revocation_list_compare_session) != NULL;
+	retire_list_leave(reader);
+	return revoked;
+}
+
+bool auth_revocation_list_account_revoked(auth_revocation_list_t* list, const uuid_t* account) {
+	retire_reader_t* reader = retire_list_enter(list->retired);
+	auth_revocation_table_t* table = __atomic_load_n(&list->table, __ATOMIC_ACQUIRE);
+	bool revoked = bsearch(account, table->accounts, table->account_count, sizeof(uuid_t), auth_revocation_list_compare_account) != NULL;
+	retire_list_leave(reader);
+	return revoked;
+}
+
+/**
+ * @brief Makes sure refresh thread has a usable connection.
+ *
+ * @returns Returns 0 if connection is usable.
+ */
+static int auth_revocation_list_connect(auth_revocation_list_t* list) {
+	if(pgdb_reconnect(list->conn_info, &list->conn)) {
+		ERROR("Revocation list failed to connect to database.\n");
+		return 1;
+	}
+	return 0;
+}
+
+static void* auth_revocation_list_refresh_thread(void* data) {
+	auth_revocation_list_t* list = data;
+	struct timespec deadline;
+
+	pthread_mutex_lock(&list->lock);
+	while(list->running) {
+		clock_deadline_in(list->refresh_interval, &deadline);
+		pthread_cond_timedwait(&list->wakeup, &list->lock, &deadline);
+		if(!list->running)
+			break;
+		pthread_mutex_unlock(&list->lock);
+
+		if(auth_revocation_list_connect(list) == 0)
+			auth_revocation_list_load(list, list->conn);
+
+		pthread_mutex_lock(&list->lock);
+		// Tables which were still read during the last swap.
+		retire_list_collect(list->retired);
+	}
+	pthread_mutex_unlock(&list->lock);
+	return NULL;
+}
+
+int auth_revocation_list_start_refresh(auth_revocation_list_t* list, const char* conn_info, const int64_t interval) {
+	if(list->running) {
+		ERROR("Revocation list refresh is already running.\n");
+		return 1;
+	}
+
+	free(list->conn_info);
+	list->conn_info = strdup(conn_info);
+	list->refresh_interval = interval;
+
+	if(auth_revocation_list_connect(list) || auth_revocation_list_load(list, list->conn))
+		return 1;
+
+	list->running = true;
+	if(pthread_create(&list->thread, NULL, auth_revocation_list_refresh_thread, list)) {
+		list->running = false;
+		ERROR("Failed to start revocation list refresh thread.\n");
+		return 1;
+	}
+	return 0;
+}
+
+void auth_revocation_list_free(auth_revocation_list_t** list) {
+	if(*list == NULL) return;
+
+	pthread_mutex_lock(&(*list)->lock);
+	bool running = (*list)->running;
+	(*list)->running = false;
+	pthread_cond_broadcast(&(*list)->wakeup);
+	pthread_mutex_unlock(&(*list)->lock);
+
+	if(running)
+		pthread_join((*list)->thread, NULL);
+
+	retire_list_free(&(*list)->retired);
+	free((*list)->table);
+	if((*list)->conn != NULL)
+		PQfinish((*list)->conn);
+	free((*list)->conn_info);
+	pthread_cond_destroy(&(*list)->wakeup);
+	pthread_mutex_destroy(&(*list)->lock);
+	free(*list);
+	*list = NULL;
+}
@@ -0,0 +1,255 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/crypto.h>
+
+#include "radicle/auth/session_cache.h"
+#include "radicle/print.h"
+
+static time_t auth_session_cache_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec;
+}
+
+/**
+ * @brief FNV-1a, tokens are random so nothing stronger is needed.
+ */
+static uint64_t auth_session_cache_hash(const string_t* token) {
+	uint64_t hash = 14695981039346656037ULL;
+	for(size_t i = 0; i < token->length; i++) {
+		hash ^= (unsigned char) token->ptr[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static size_t auth_session_cache_round(size_t value) {
+	size_t size = 1;
+	while(size < value)
+		size <<= 1;
+	return size;
+}
+
+static auth_session_cache_shard_t* auth_session_cache_shard(auth_session_cache_t* cache, const uint64_t hash) {
+	return &cache->shards[hash & cache->shard_mask];
+}
+
+static auth_session_cache_entry_t** auth_session_cache_bucket(auth_session_cache_shard_t* shard, const uint64_t hash) {
+	// Low bits already picked the shard.
+	return &shard->buckets[(hash >> 32) & shard->mask];
+}
+
+static void auth_session_cache_entry_free(auth_session_cache_entry_t* entry) {
+	string_free(&entry->token);
+	string_free(&entry->signature);
+	auth_account_free(&entry->account);
+	free(entry);
+}
+
+static void auth_session_cache_unlink(auth_session_cache_shard_t* shard, auth_session_cache_entry_t* entry) {
+	if(entry->newer != NULL)
+		entry->newer->older = entry->older;
+	else
+		shard->newest = entry->older;
+
+	if(entry->older != NULL)
+		entry->older->newer = entry->newer;
+	else
+		shard->oldest = entry->newer;
+
+	entry->newer = NULL;
+	entry->older = NULL;
+}
+
+static void auth_session_cache_link_newest(auth_session_cache_shard_t* shard, auth_session_cache_entry_t* entry) {
+	entry->older = shard->newest;
+	entry->newer = NULL;
+	if(shard->newest != NULL)
+		shard->newest->newer = entry;
+	shard->newest = entry;
+	if(shard->oldest == NULL)
+		shard->oldest = entry;
+}
+
+/**
+ * @brief Removes entry from bucket chain and lru list and frees it. Shard must be locked.
+ */
+static void auth_session_cache_evict(auth_session_cache_shard_t* shard, auth_session_cache_entry_t* entry) {
+	auth_session_cache_entry_t** iter = auth_session_cache_bucket(shard, entry->hash);
+	while(*iter != entry)
+		iter = &(*iter)->next;
+	*iter = entry->next;
+
+	auth_session_cache_unlink(shard, entry);
+	shard->count--;
+	auth_session_cache_entry_free(entry);
+}
+
+static auth_session_cache_entry_t* auth_session_cache_find(auth_session_cache_shard_t* shard, const uint64_t hash, const string_t* token) {
+	auth_session_cache_entry_t* iter = *auth_session_cache_bucket(shard, hash);
+	while(iter != NULL) {
+		if(iter->hash == hash && iter->token->length == token->length && memcmp(iter->token->ptr, token->ptr, token->length) == 0)
+			return iter;
+		iter = iter->next;
+	}
+	return NULL;
+}
+
+auth_session_cache_t* auth_session_cache_new(const size_t capacity, const time_t ttl, const int shards) {
+	if(capacity == 0)
+		return NULL;
+
+	size_t shard_count = auth_session_cache_round(shards > 0 ? shards : 1);
+	while(shard_count > 1 && shard_count > capacity)
+		shard_count >>= 1;
+
+	auth_session_cache_t* cache = calloc(1, sizeof(auth_session_cache_t));
+	cache->shards = aligned_alloc(64, shard_count * sizeof(auth_session_cache_shard_t));
+	memset(cache->shards, 0, shard_count * sizeof(auth_session_cache_shard_t));
+	cache->shard_mask = shard_count - 1;
+	cache->ttl = ttl;
+
+	size_t per_shard = (capacity + shard_count - 1) / shard_count;
+	size_t buckets = auth_session_cache_round(per_shard);
+	for(size_t i = 0; i < shard_count; i++) {
+		auth_session_cache_shard_t* shard = &cache->shards[i];
+		pthread_mutex_init(&shard->lock, NULL);
+		shard->buckets = calloc(buckets, sizeof(auth_session_cache_entry_t*));
+		shard->mask = buckets - 1;
+		shard->capacity = per_shard;
+	}
+
+	return cache;
+}
+
+int auth_session_cache_get(auth_session_cache_t* cache, const string_t* token, const string_t* signature, uint32_t* session_id, auth_account_t** account) {
+	uint64_t hash = auth_session_cache_hash(token);
+	auth_session_cache_shard_t* shard = auth_session_cache_shard(cache, hash);
+
+	pthread_mutex_lock(&shard->lock);
+	auth_session_cache_entry_t* entry = auth_session_cache_find(shard, hash, token);
+	if(entry == NULL) {
+		pthread_mutex_unlock(&shard->lock);
+		return 1;
+	}
+
+	if(entry->expires <= auth_session_cache_now()) {
+		auth_session_cache_evict(shard, entry);
+		pthread_mutex_unlock(&shard->lock);
+		return 1;
+	}
+
+	// A different signature was never verified, let caller go through the full check.
+	if(entry->signature->length != signature->length ||
+			CRYPTO_memcmp(entry->signature->ptr, signature->ptr, signature->length) != 0) {
+		pthread_mutex_unlock(&shard->lock);
+		return 1;
+	}
+
+	auth_session_cache_unlink(shard, entry);
+	auth_session_cache_link_newest(shard, entry);
+
+	*session_id = entry->session_id;
+	if(entry->account != NULL) {
+		const auth_account_t* cached = entry->account;
+		*account = auth_account_new(cached->uuid, cached->email, NULL, cached->role, cached->active, cached->verified, cached->created);
+	}
+	pthread_mutex_unlock(&shard->lock);
+	return 0;
+}
+
+void auth_session_cache_put(auth_session_cache_t* cache, const string_t* token, const string_t* signature, const uint32_t session_id, const auth_account_t* account) {
+	uint64_t hash = auth_session_cache_hash(token);
+	auth_session_cache_shard_t* shard = auth_session_cache_shard(cache, hash);
+
+	// Copies are made before locking to keep critical section short.
+	auth_session_cache_entry_t* entry = calloc(1, sizeof(auth_session_cache_entry_t));
+	entry->hash = hash;
+	entry->token = string_copy(token);
+	entry->signature = string_copy(signature);
+	entry->session_id = session_id;
+	if(account != NULL)
+		entry->account = auth_account_new(account->uuid, account->email, NULL, account->role, account->active, account->verified, account->created);
+	entry->expires = auth_session_cache_now() + cache->ttl;
+
+	pthread_mutex_lock(&shard->lock);
+	auth_session_cache_entry_t* existing = auth_session_cache_find(shard, hash, token);
+	if(existing != NULL)
+		auth_session_cache_evict(shard, existing);
+	else if(shard->count >= shard->capacity)
+		auth_session_cache_evict(shard, shard->oldest);
+
+	auth_session_cache_entry_t** bucket = auth_session_cache_bucket(shard, hash);
+	entry->next = *bucket;
+	*bucket = entry;
+	auth_session_cache_link_newest(shard, entry);
+	shard->count++;
+	pthread_mutex_unlock(&shard->lock);
+}
+
+void auth_session_cache_remove(auth_session_cache_t* cache, const string_t* token) {
+	uint64_t hash = auth_session_cache_hash(token);
+	auth_session_cache_shard_t* shard = auth_session_cache_shard(cache, hash);
+
+	pthread_mutex_lock(&shard->lock);
+	auth_session_cache_entry_t* entry = auth_session_cache_find(shard, hash, token);
+	if(entry != NULL)
+		auth_session_cache_evict(shard, entry);
+	pthread_mutex_unlock(&shard->lock);
+}
+
+void auth_session_cache_remove_account(auth_session_cache_t* cache, const uuid_t* owner) {
+	for(size_t i = 0; i <= cache->shard_mask; i++) {
+		auth_session_cache_shard_t* shard = &cache->shards[i];
+		pthread_mutex_lock(&shard->lock);
+		auth_session_cache_entry_t* iter = shard->newest;
+		while(iter != NULL) {
+			auth_session_cache_entry_t* older = iter->older;
+			if(iter->account != NULL && iter->account->uuid != NULL && memcmp(iter->account->uuid->bin, owner->bin, sizeof(owner->bin)) == 0)
+				auth_session_cache_evict(shard, iter);
+			iter = older;
+		}
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
+
+void auth_session_cache_free(auth_session_cache_t** cache) {
+	if(*cache == NULL) return;
+	for(size_t i = 0; i <= (*cache)->shard_mask; i++) {
+		auth_session_cache_shard_t* shard = &(*cache)->shards[i];
+		auth_session_cache_entry_t* iter = shard->newest;
+		while(iter != NULL) {
+			auth_session_cache_entry_t* older = iter->older;
+			auth_session_cache_entry_free(iter);
+			iter = older;
+		}
+		free(shard->buckets);
+		pthread_mutex_destroy(&shard->lock);
+	}
+	free((*cache)->shards);
+	free(*cache);
+	*cache = NULL;
+}
@@ -0,0 +1,123 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/crypto.h>
+
+#include "radicle/auth/stateless_session.h"
+#include "radicle/auth/base64.h"
+#include "radicle/print.h"
+
+#define AUTH_STATELESS_SESSION_FLAG_OWNED 0x01
+#define AUTH_STATELESS_SESSION_FLAG_VERIFIED 0x02
+
+static void auth_stateless_session_put_uint(unsigned char* output, uint64_t value, const int bytes) {
+	for(int i = bytes - 1; i >= 0; i--) {
+		output[i] = value & 0xff;
+		value >>= 8;
+	}
+}
+
+static uint64_t auth_stateless_session_get_uint(const unsigned char* input, const int bytes) {
+	uint64_t value = 0;
+	for(int i = 0; i < bytes; i++)
+		value = (value << 8) | input[i];
+	return value;
+}
+
+/**
+ * @brief Size of binary cookie.
+ */
+#define AUTH_STATELESS_SESSION_SIZE (AUTH_STATELESS_SESSION_PAYLOAD_SIZE + AUTH_STATELESS_SESSION_MAC_SIZE)
+
+bool auth_stateless_session_is_cookie(const string_t* cookie) {
+	return cookie != NULL && cookie->length == AUTH_STATELESS_SESSION_COOKIE_LENGTH;
+}
+
+int auth_stateless_session_sign(const string_t* key, const auth_stateless_session_t* session, string_t** cookie) {
+	unsigned char raw[AUTH_STATELESS_SESSION_SIZE];
+	raw[0] = AUTH_STATELESS_SESSION_VERSION;
+	raw[1] = (session->owned ? AUTH_STATELESS_SESSION_FLAG_OWNED : 0) | (session->verified ? AUTH_STATELESS_SESSION_FLAG_VERIFIED : 0);
+	raw[2] = session->role;
+	auth_stateless_session_put_uint(raw + 3, session->id, 4);
+	auth_stateless_session_put_uint(raw + 7, (uint64_t) session->expires, 8);
+	if(session->owned)
+		memcpy(raw + 15, session->owner.bin, sizeof(session->owner.bin));
+	else
+		memset(raw + 15, 0, sizeof(session->owner.bin));
+
+	unsigned char digest[HMAC_DIGEST_SIZE];
+	if(hmac_sign_salted_raw(key, NULL, raw, AUTH_STATELESS_SESSION_PAYLOAD_SIZE, digest)) {
+		ERROR("Failed to sign stateless session.\n");
+		return 1;
+	}
+	memcpy(raw + AUTH_STATELESS_SESSION_PAYLOAD_SIZE, digest, AUTH_STATELESS_SESSION_MAC_SIZE);
+
+	*cookie = string_new_empty(AUTH_STATELESS_SESSION_COOKIE_LENGTH);
+	base64_encode_to(raw, sizeof(raw), (*cookie)->ptr, BASE64_URL);
+	return 0;
+}
+
+int auth_stateless_session_parse(const string_t* key, const string_t* cookie, auth_stateless_session_t* session) {
+	if(!auth_stateless_session_is_cookie(cookie))
+		return AUTH_STATELESS_SESSION_MALFORMED;
+
+	unsigned char raw[AUTH_STATELESS_SESSION_SIZE + 2];
+	size_t length = 0;
+	if(base64_decode_to(cookie->ptr, cookie->length, raw, &length, BASE64_URL) || length != AUTH_STATELESS_SESSION_SIZE)
+		return AUTH_STATELESS_SESSION_MALFORMED;
+
+	// Signature is checked before anything in payload is trusted.
+	unsigned char digest[HMAC_DIGEST_SIZE];
+	if(hmac_sign_salted_raw(key, NULL, raw, AUTH_STATELESS_SESSION_PAYLOAD_SIZE, digest))
+		return AUTH_STATELESS_SESSION_MALFORMED;
+	if(CRYPTO_memcmp(digest, raw + AUTH_STATELESS_SESSION_PAYLOAD_SIZE, AUTH_STATELESS_SESSION_MAC_SIZE) != 0)
+		return AUTH_STATELESS_SESSION_INVALID_SIGNATURE;
+	if(raw[0] != AUTH_STATELESS_SESSION_VERSION)
+		return AUTH_STATELESS_SESSION_MALFORMED;
+
+	session->owned = (raw[1] & AUTH_STATELESS_SESSION_FLAG_OWNED) != 0;
+	session->verified = (raw[1] & AUTH_STATELESS_SESSION_FLAG_VERIFIED) != 0;
+	session->role = raw[2];
+	session->id = auth_stateless_session_get_uint(raw + 3, 4);
+	session->expires = (time_t) auth_stateless_session_get_uint(raw + 7, 8);
+	memcpy(session->owner.bin, raw + 15, sizeof(session->owner.bin));
+
+	if(session->id == 0 || session->expires <= time(NULL))
+		return AUTH_STATELESS_SESSION_EXPIRED;
+	return AUTH_STATELESS_SESSION_OK;
+}
+
+auth_account_t* auth_stateless_session_account(const auth_stateless_session_t* session) {
+	if(!session->owned)
+		return NULL;
+	return auth_account_new((uuid_t*) &session->owner, NULL, NULL, session->role, true, session->verified, 0);
+}
+
+auth_account_t* auth_stateless_session_account_arena(arena_t* arena, const auth_stateless_session_t* session) {
+	if(!session->owned)
+		return NULL;
+	return auth_account_new_arena(arena, &session->owner, NULL, NULL, session->role, true, session->verified, 0);
+}
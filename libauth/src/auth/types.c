@@ -57,6 +57,21 @@ auth_account_t* auth_account_new(uuid_t* uuid, string_t* email, string_t* passwo
 	return acc;
 }
 
+auth_account_t* auth_account_new_arena(arena_t* arena, const uuid_t* uuid, const string_t* email, const string_t* password, auth_account_role_t role, bool active, bool verified, time_t created) {
+	auth_account_t* acc = arena_alloc(arena, sizeof(auth_account_t));
+	if(acc == NULL)
+		return NULL;
+
+	acc->uuid = uuid_copy_arena(arena, uuid);
+	acc->email = string_copy_arena(arena, email);
+	acc->password = string_copy_arena(arena, password);
+	acc->role = role;
+	acc->active = active;
+	acc->verified = verified;
+	acc->created = created;
+
+	return acc;
+}
 
 void auth_account_free(auth_account_t** account) {
 	if(*account == NULL) return;
@@ -73,6 +88,13 @@ auth_request_log_t* auth_request_log_new() {
 	return rq;
 }
 
+auth_request_log_t* auth_request_log_new_arena(arena_t* arena) {
+	auth_request_log_t* rq = arena_alloc(arena, sizeof(auth_request_log_t));
+	if(rq != NULL)
+		clock_gettime(CLOCK_MONOTONIC, &rq->timer);
+	return rq;
+}
+
 void auth_request_log_calculate_response_time(auth_request_log_t* request_log) {
 	struct timespec now = {0, 0};
 	clock_gettime(CLOCK_MONOTONIC, &now);
@@ -133,6 +155,13 @@ void auth_session_access_entry_free(void* ptr) {
 	free(ptr);
 }
 
+void auth_blacklist_entry_free(void* ptr) {
+	if(ptr == NULL) return;
+	auth_blacklist_entry_t* entry = (auth_blacklist_entry_t*)ptr;
+	string_free(&entry->ip);
+	free(ptr);
+}
+
 int file_type_from_str(const char* type) {
 	if(strcmp(type, "image/jpeg") == 0 || strcmp(type, "image/jpg") == 0) {
 		return FILE_TYPE_IMAGE_JPEG;
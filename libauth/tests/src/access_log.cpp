@@ -0,0 +1,67 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "radicle/auth/access_log.h"
+#include "radicle/auth/types.h"
+#include "radicle/types/string.h"
+
+// Nothing listens on port 1, so the writer drops every batch right away.
+static const char* unreachable = "host=127.0.0.1 port=1 connect_timeout=1";
+
+class AuthAccessLogTests: public ::testing::Test {
+	public:
+		auth_request_log_t* request_log = NULL;
+	protected:
+		void SetUp() override {
+			request_log = auth_request_log_new();
+			request_log->ip = string_from_literal("127.0.0.1");
+			request_log->url = string_from_literal("/test");
+			request_log->port = 80;
+			request_log->date = time(NULL);
+		}
+
+		void TearDown() override {
+			auth_request_log_free(&request_log);
+		}
+};
+
+TEST_F(AuthAccessLogTests, TestDropWhenFull) {
+	auth_access_logger_t* logger = auth_access_logger_new(unreachable, 2, 64, 60000, AUTH_ACCESS_LOG_DROP);
+	ASSERT_TRUE(logger != NULL);
+
+	EXPECT_EQ(auth_access_logger_push(logger, 1, request_log), 0);
+	EXPECT_EQ(auth_access_logger_push(logger, 1, request_log), 0);
+	EXPECT_EQ(auth_access_logger_push(logger, 1, request_log), 1);
+	EXPECT_EQ(auth_access_logger_dropped(logger), 1);
+
+	auth_access_logger_free(&logger);
+	EXPECT_TRUE(logger == NULL);
+}
+
+TEST_F(AuthAccessLogTests, TestBlockWaitsForWriter) {
+	auth_access_logger_t* logger = auth_access_logger_new(unreachable, 2, 1, 60000, AUTH_ACCESS_LOG_BLOCK);
+	ASSERT_TRUE(logger != NULL);
+
+	for(int i = 0; i < 10; i++)
+		EXPECT_EQ(auth_access_logger_push(logger, 1, request_log), 0);
+	EXPECT_EQ(auth_access_logger_dropped(logger), 0);
+
+	auth_access_logger_free(&logger);
+}
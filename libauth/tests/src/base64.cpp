@@ -0,0 +1,75 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include "radicle/auth/base64.h"
+
+TEST(AuthBase64Tests, TestEncodeMatchesOpenSSL) {
+	unsigned char input[200];
+	char expected[300];
+	char output[300];
+	unsigned char decoded[300];
+	RAND_bytes(input, sizeof(input));
+
+	// Covers every tail length and both the scalar and vector path.
+	for(size_t length = 0; length <= sizeof(input); length++) {
+		int expected_length = EVP_EncodeBlock((unsigned char*) expected, input, length);
+		ASSERT_EQ(base64_encoded_length(length, BASE64_STANDARD), expected_length);
+		ASSERT_EQ(base64_encode_to(input, length, output, BASE64_STANDARD), expected_length);
+		ASSERT_STREQ(output, expected) << "length " << length;
+
+		size_t decoded_length = 0;
+		ASSERT_EQ(base64_decode_to(output, expected_length, decoded, &decoded_length, BASE64_STANDARD), 0);
+		ASSERT_EQ(decoded_length, length);
+		ASSERT_EQ(memcmp(decoded, input, length), 0);
+	}
+}
+
+TEST(AuthBase64Tests, TestUrl) {
+	unsigned char input[200];
+	char output[300];
+	unsigned char decoded[300];
+	RAND_bytes(input, sizeof(input));
+
+	for(size_t length = 0; length <= sizeof(input); length++) {
+		size_t encoded_length = base64_encode_to(input, length, output, BASE64_URL);
+		ASSERT_EQ(encoded_length, base64_encoded_length(length, BASE64_URL));
+		ASSERT_EQ(strcspn(output, "+/="), encoded_length);
+
+		size_t decoded_length = 0;
+		ASSERT_EQ(base64_decode_to(output, encoded_length, decoded, &decoded_length, BASE64_URL), 0);
+		ASSERT_EQ(decoded_length, length);
+		ASSERT_EQ(memcmp(decoded, input, length), 0);
+	}
+
+	const unsigned char bytes[] = { 0xfb, 0xff, 0xbf };
+	ASSERT_EQ(base64_encode_to(bytes, sizeof(bytes), output, BASE64_URL), 4);
+	EXPECT_STREQ(output, "-_-_");
+}
+
+TEST(AuthBase64Tests, TestDecodeInvalid) {
+	unsigned char decoded[16];
+	size_t length = 0;
+	EXPECT_EQ(base64_decode_to("ab$d", 4, decoded, &length, BASE64_STANDARD), 1);
+	EXPECT_EQ(base64_decode_to("ab-d", 4, decoded, &length, BASE64_STANDARD), 1);
+	EXPECT_EQ(base64_decode_to("ab+d", 4, decoded, &length, BASE64_URL), 1);
+	EXPECT_EQ(base64_decode_to("abcde", 5, decoded, &length, BASE64_STANDARD), 1);
+}
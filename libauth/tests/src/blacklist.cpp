@@ -0,0 +1,190 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "radicle/auth/blacklist.h"
+#include "radicle/tests/auth/auth_fixture.hpp"
+
+PGDB_FAKE_FETCH(BlacklistFetch) {
+	PGDB_FAKE_RESULT_3(PGRES_TUPLES_OK, "id", "ip", "ban_lift");
+
+	PGDB_FAKE_INT(1);
+	PGDB_FAKE_C_STR("10.0.0.1");
+	PGDB_FAKE_TIMESTAMP(time(NULL) + 3600);
+
+	PGDB_FAKE_NEXT_ROW();
+
+	PGDB_FAKE_INT(2);
+	PGDB_FAKE_C_STR("10.0.0.2");
+	PGDB_FAKE_TIMESTAMP(time(NULL) + 3600);
+
+	PGDB_FAKE_FINISH();
+}
+
+TEST_F(RadicleAuthTests, TestBlacklistLoad) {
+	install_hook(PGDB_FAKE_CREATE_FETCH_HOOK(BlacklistFetch));
+	auth_blacklist_t* blacklist = auth_blacklist_new();
+
+	ASSERT_EQ(auth_blacklist_load(blacklist, NULL), 0);
+	EXPECT_EQ(blacklist->last_id, 2);
+
+	string_t* first = string_from_literal("10.0.0.1");
+	string_t* second = string_from_literal("10.0.0.2");
+	string_t* other = string_from_literal("10.0.0.3");
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, first), 1);
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, second), 2);
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, other), 0);
+
+	string_free(&first);
+	string_free(&second);
+	string_free(&other);
+	auth_blacklist_free(&blacklist);
+}
+
+TEST_F(RadicleAuthTests, TestBlacklistLoadFailure) {
+	install_status_fatal_error();
+	auth_blacklist_t* blacklist = auth_blacklist_new();
+	ASSERT_EQ(auth_blacklist_load(blacklist, NULL), 1);
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, test_request_log->ip), 0);
+	auth_blacklist_free(&blacklist);
+}
+
+TEST_F(RadicleAuthTests, TestBlacklistReload) {
+	install_hook(PGDB_FAKE_CREATE_FETCH_HOOK(BlacklistFetch));
+	auth_blacklist_t* blacklist = auth_blacklist_new();
+	string_t* local = string_from_literal("10.0.0.9");
+	string_t* pending = string_from_literal("10.0.0.10");
+
+	// Local bans never move the watermark, otherwise rows with lower ids would be skipped.
+	auth_blacklist_add(blacklist, 7, local, 0);
+	EXPECT_EQ(blacklist->last_id, 0);
+	ASSERT_EQ(auth_blacklist_load(blacklist, NULL), 0);
+	EXPECT_EQ(blacklist->last_id, 2);
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, local), 7);
+
+	// Ban saved while a full reload is fetching survives it.
+	blacklist->reloading = true;
+	auth_blacklist_add(blacklist, 8, pending, 0);
+
+	// Full reload drops bans which are no longer in database.
+	ASSERT_EQ(auth_blacklist_reload(blacklist, NULL), 0);
+	EXPECT_EQ(blacklist->last_id, 2);
+	EXPECT_FALSE(blacklist->reloading);
+	EXPECT_TRUE(blacklist->pending == NULL);
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, local), 0);
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, pending), 8);
+
+	string_t* first = string_from_literal("10.0.0.1");
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, first), 1);
+	string_free(&first);
+
+	string_free(&local);
+	string_free(&pending);
+	auth_blacklist_free(&blacklist);
+}
+
+TEST(AuthBlacklistTests, TestAddAndLift) {
+	auth_blacklist_t* blacklist = auth_blacklist_new();
+	string_t* ip = string_from_literal("127.0.0.1");
+
+	auth_blacklist_add(blacklist, 5, ip, time(NULL) - 1);
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, ip), 0);
+
+	auth_blacklist_add(blacklist, 6, ip, 0);
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, ip), 6);
+
+	// Permanent ban outlasts any later temporary one.
+	auth_blacklist_add(blacklist, 7, ip, time(NULL) + 3600);
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, ip), 6);
+
+	char address[16];
+	for(int i = 0; i < 100; i++) {
+		snprintf(address, sizeof(address), "10.0.1.%d", i);
+		string_t* other = string_from_literal(address);
+		auth_blacklist_add(blacklist, 10 + i, other, 0);
+		string_free(&other);
+	}
+	string_t* other = string_from_literal("10.0.1.42");
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, other), 52);
+	string_free(&other);
+
+	string_free(&ip);
+	auth_blacklist_free(&blacklist);
+}
+
+TEST(AuthBlacklistTests, TestAddInPlace) {
+	auth_blacklist_t* blacklist = auth_blacklist_new();
+	auth_blacklist_table_t* table = blacklist->table;
+	size_t slots = table->mask + 1;
+
+	char address[16];
+	for(size_t i = 0; i < slots / 4 * 3; i++) {
+		snprintf(address, sizeof(address), "10.0.2.%zu", i);
+		string_t* ip = string_from_literal(address);
+		auth_blacklist_add(blacklist, 1 + i, ip, 0);
+		string_free(&ip);
+	}
+	// Bans went into free slots, table was not copied.
+	EXPECT_EQ(blacklist->table, table);
+	EXPECT_EQ(table->count, slots / 4 * 3);
+
+	string_t* ip = string_from_literal("10.0.3.1");
+	auth_blacklist_add(blacklist, 100, ip, 0);
+	EXPECT_NE(blacklist->table, table);
+	EXPECT_GE(blacklist->table->mask + 1, slots * 2);
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, ip), 100);
+	string_free(&ip);
+
+	ip = string_from_literal("10.0.2.0");
+	EXPECT_EQ(auth_blacklist_lookup(blacklist, ip), 1);
+	string_free(&ip);
+
+	auth_blacklist_free(&blacklist);
+}
+
+static void* blacklist_lookup_thread(void* data) {
+	auth_blacklist_t* blacklist = (auth_blacklist_t*) data;
+	string_t* ip = string_from_literal("10.0.4.0");
+	while(auth_blacklist_lookup(blacklist, ip) == 0);
+	string_free(&ip);
+	return NULL;
+}
+
+TEST(AuthBlacklistTests, TestLookupWhileGrowing) {
+	auth_blacklist_t* blacklist = auth_blacklist_new();
+	pthread_t threads[4];
+	for(int i = 0; i < 4; i++)
+		ASSERT_EQ(pthread_create(&threads[i], NULL, blacklist_lookup_thread, blacklist), 0);
+
+	// Grows table several times while lookups run, the last ban ends them.
+	char address[24];
+	for(int i = 1; i <= 5000; i++) {
+		snprintf(address, sizeof(address), "10.%d.%d.%d", 1 + i / 65536, (i / 256) % 256, i % 256);
+		string_t* ip = string_from_literal(address);
+		auth_blacklist_add(blacklist, i, ip, 0);
+		string_free(&ip);
+	}
+	string_t* ip = string_from_literal("10.0.4.0");
+	auth_blacklist_add(blacklist, 5001, ip, 0);
+	string_free(&ip);
+
+	for(int i = 0; i < 4; i++)
+		pthread_join(threads[i], NULL);
+	auth_blacklist_free(&blacklist);
+}
@@ -114,6 +114,24 @@ TEST_F(AuthCryptoHmacTest, HmacVerifySaltedTest) {
 	ASSERT_EQ(hmac_verify_salted(key_without_salt, key_salt, encoded, raw), 0);
 }
 
+TEST_F(AuthCryptoHmacTest, HmacSignSaltedHexTest) {
+	char signature[HMAC_LENGTH + 1];
+	ASSERT_EQ(hmac_sign_salted_hex(key_without_salt, key_salt, (unsigned char*)raw->ptr, raw->length, signature), 0);
+	EXPECT_STREQ(signature, encoded->ptr);
+
+	unsigned char digest[HMAC_DIGEST_SIZE];
+	ASSERT_EQ(hmac_sign_salted_raw(key_without_salt, key_salt, (unsigned char*)raw->ptr, raw->length, digest), 0);
+	char hex[3];
+	snprintf(hex, sizeof(hex), "%02x", digest[HMAC_DIGEST_SIZE - 1]);
+	EXPECT_EQ(strncmp(hex, signature + HMAC_LENGTH - 2, 2), 0);
+
+	// Same length but different last char must not match.
+	signature[HMAC_LENGTH - 1] = signature[HMAC_LENGTH - 1] == '0' ? '1' : '0';
+	string_t* wrong = string_from_literal(signature);
+	EXPECT_EQ(hmac_verify_salted(key_without_salt, key_salt, wrong, raw), 1);
+	string_free(&wrong);
+}
+
 class AuthCryptoCookieTest: public ::testing::Test {
 	protected: 
 
@@ -147,6 +165,7 @@ TEST_F(AuthCryptoCookieTest, GenerateCryptoTest) {
 	EXPECT_EQ(cookie->token->length, strlen(cookie->token->ptr));
 	EXPECT_EQ(cookie->signature->length, strlen(cookie->signature->ptr));
 	EXPECT_EQ(cookie->salt->length, strlen(cookie->salt->ptr));
+	EXPECT_EQ(hmac_verify_salted(key, cookie->salt, cookie->signature, cookie->token), 0);
 }
 
 TEST_F(AuthCryptoCookieTest, SplitCookieTest) {
@@ -157,6 +176,28 @@ TEST_F(AuthCryptoCookieTest, SplitCookieTest) {
 	EXPECT_STREQ(cookie->signature->ptr, decoded_cookie->signature->ptr);
 }
 
+TEST_F(AuthCryptoCookieTest, CompactCookieTest) {
+	unsigned char token[AUTH_COMPACT_TOKEN_SIZE];
+	string_t* compact = NULL;
+	ASSERT_EQ(auth_generate_compact_cookie(key, token, &compact), 0);
+	EXPECT_EQ(compact->length, AUTH_COMPACT_COOKIE_LENGTH);
+	EXPECT_EQ(strlen(compact->ptr), AUTH_COMPACT_COOKIE_LENGTH);
+	EXPECT_TRUE(auth_is_compact_cookie(compact));
+	EXPECT_FALSE(auth_is_compact_cookie(raw_cookie));
+
+	unsigned char decoded[AUTH_COMPACT_TOKEN_SIZE];
+	ASSERT_EQ(auth_split_compact_cookie(key, compact, decoded), 0);
+	EXPECT_EQ(memcmp(token, decoded, AUTH_COMPACT_TOKEN_SIZE), 0);
+
+	string_t* other_key = string_from_literal("Other Key");
+	EXPECT_EQ(auth_split_compact_cookie(other_key, compact, decoded), AUTH_COMPACT_COOKIE_INVALID_SIGNATURE);
+	string_free(&other_key);
+
+	compact->ptr[10] = compact->ptr[10] == 'A' ? 'B' : 'A';
+	EXPECT_EQ(auth_split_compact_cookie(key, compact, decoded), AUTH_COMPACT_COOKIE_INVALID_SIGNATURE);
+	string_free(&compact);
+}
+
 class AuthCryptoPasswordTest: public ::testing::Test {
 	protected:
 		string_t* raw = NULL;
@@ -176,3 +217,32 @@ TEST_F(AuthCryptoPasswordTest, Argon2HashTest) {
 	ASSERT_EQ(auth_hash_password(raw, &encoded), 0);
 	EXPECT_EQ(encoded->length, strlen(encoded->ptr));
 }
+
+TEST_F(AuthCryptoPasswordTest, Argon2HashWithParamsTest) {
+	auth_password_params_t params = { Argon2_id, 1, 1024, 1 };
+	ASSERT_EQ(auth_hash_password_with(&params, raw, &encoded), 0);
+	EXPECT_EQ(encoded->length, strlen(encoded->ptr));
+	EXPECT_EQ(strncmp(encoded->ptr, "$argon2id$", 10), 0);
+	EXPECT_EQ(auth_verify_password(encoded, raw), 0);
+
+	EXPECT_FALSE(auth_password_needs_rehash(encoded, &params));
+	params.time_cost = 2;
+	EXPECT_TRUE(auth_password_needs_rehash(encoded, &params));
+	params.time_cost = 1;
+	params.type = Argon2_i;
+	EXPECT_TRUE(auth_password_needs_rehash(encoded, &params));
+}
+
+TEST_F(AuthCryptoPasswordTest, Argon2NeedsRehashUnknownTest) {
+	auth_password_params_t params = AUTH_PASSWORD_PARAMS_DEFAULT;
+	EXPECT_FALSE(auth_password_needs_rehash(raw, &params));
+}
+
+TEST_F(AuthCryptoPasswordTest, Argon2CalibrateTest) {
+	auth_password_params_t params = { Argon2_id, 1, 1024, 1 };
+	ASSERT_EQ(auth_password_params_calibrate(&params, 20), 0);
+	EXPECT_GE(params.time_cost, 1);
+	EXPECT_GE(params.memory_cost, 8);
+	EXPECT_LE(params.memory_cost, 1024);
+	EXPECT_EQ(params.parallelism, 1);
+}
@@ -148,6 +148,16 @@ TEST_F(RadicleAuthTests, TestSaveSessionAccessError) {
 	ASSERT_EQ(auth_save_session_access(NULL, session_id, test_request_log), 1);
 }
 
+TEST_F(RadicleAuthTests, TestCopySessionAccess) {
+	pgdb_copy_writer_t* writer = auth_session_access_writer_new(NULL, 0, 0);
+	ASSERT_EQ(writer->columns, 8);
+	ASSERT_EQ(auth_copy_session_access(writer, 1, test_request_log), 0);
+	ASSERT_EQ(auth_copy_session_access(writer, 2, test_request_log), 0);
+	EXPECT_EQ(writer->rows, 2);
+	writer->rows = 0;
+	pgdb_copy_writer_free(&writer);
+}
+
 TEST_F(RadicleAuthTests, TestSaveTokenSuccess) {
 	install_status_command_ok();
 	install_pg_exec_hook();
@@ -0,0 +1,99 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "radicle/auth/hash_pool.h"
+#include "radicle/auth/crypto.h"
+#include "radicle/tests/auth/auth_fixture.hpp"
+
+static std::thread::id hash_pool_verify_thread;
+
+int auth_verify_password_pool_fake(const string_t* encoded, const string_t* password) {
+	hash_pool_verify_thread = std::this_thread::get_id();
+	return strcmp(encoded->ptr, password->ptr) == 0 ? 0 : 1;
+}
+
+TEST_F(RadicleAuthTests, TestHashPoolVerify) {
+	install_hook(subhook_new((void*)auth_verify_password, (void*)auth_verify_password_pool_fake, SUBHOOK_64BIT_OFFSET));
+	auth_hash_pool_t* pool = auth_hash_pool_new(2, 4, 2 * AUTH_PASSWORD_MEMORY_COST, NULL);
+	ASSERT_TRUE(pool != NULL);
+
+	string_t* encoded = string_from_literal("secret");
+	string_t* wrong = string_from_literal("wrong");
+
+	EXPECT_EQ(auth_hash_pool_verify(pool, encoded, encoded), 0);
+	EXPECT_NE(hash_pool_verify_thread, std::this_thread::get_id());
+	EXPECT_EQ(auth_hash_pool_verify(pool, encoded, wrong), 1);
+
+	// Without pool it runs on calling thread.
+	EXPECT_EQ(auth_hash_pool_verify(NULL, encoded, encoded), 0);
+	EXPECT_EQ(hash_pool_verify_thread, std::this_thread::get_id());
+
+	string_free(&encoded);
+	string_free(&wrong);
+	auth_hash_pool_free(&pool);
+	EXPECT_TRUE(pool == NULL);
+}
+
+TEST(AuthHashPoolTests, TestMemoryBudget) {
+	auth_hash_pool_t* pool = auth_hash_pool_new(8, 4, 3 * AUTH_PASSWORD_MEMORY_COST, NULL);
+	EXPECT_EQ(pool->workers, 3);
+	auth_hash_pool_free(&pool);
+
+	pool = auth_hash_pool_new(8, 4, 0, NULL);
+	EXPECT_EQ(pool->workers, 1);
+	auth_hash_pool_free(&pool);
+
+	auth_password_params_t params = AUTH_PASSWORD_PARAMS_DEFAULT;
+	params.memory_cost = AUTH_PASSWORD_MEMORY_COST / 2;
+	pool = auth_hash_pool_new(8, 4, 3 * AUTH_PASSWORD_MEMORY_COST, &params);
+	EXPECT_EQ(pool->workers, 6);
+	auth_hash_pool_free(&pool);
+}
+
+TEST(AuthHashPoolTests, TestBusy) {
+	auth_hash_pool_t* pool = auth_hash_pool_new(1, 0, AUTH_PASSWORD_MEMORY_COST, NULL);
+	string_t* password = string_from_literal("password");
+	string_t* buffer = NULL;
+
+	EXPECT_EQ(auth_hash_pool_hash(pool, password, &buffer), AUTH_HASH_POOL_BUSY);
+	EXPECT_TRUE(buffer == NULL);
+	EXPECT_EQ(auth_hash_pool_verify(pool, password, password), AUTH_HASH_POOL_BUSY);
+
+	string_free(&password);
+	auth_hash_pool_free(&pool);
+}
+
+TEST(AuthHashPoolTests, TestVerifyDummy) {
+	auth_password_params_t params = { Argon2_id, 1, 1024, 1 };
+	auth_hash_pool_t* pool = auth_hash_pool_new(0, 0, 0, &params);
+	ASSERT_TRUE(pool->dummy != NULL);
+	EXPECT_FALSE(auth_password_needs_rehash(pool->dummy, &params));
+
+	string_t* password = string_from_literal("password");
+	EXPECT_EQ(auth_hash_pool_verify_dummy(pool, password), 1);
+	auth_hash_pool_free(&pool);
+
+	pool = auth_hash_pool_new(1, 0, params.memory_cost, &params);
+	EXPECT_EQ(auth_hash_pool_verify_dummy(pool, password), AUTH_HASH_POOL_BUSY);
+	auth_hash_pool_free(&pool);
+
+	string_free(&password);
+}
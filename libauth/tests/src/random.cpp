@@ -0,0 +1,78 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "radicle/auth/random.h"
+
+TEST(AuthRandomTests, TestBytes) {
+	unsigned char first[32] = {0};
+	unsigned char second[32] = {0};
+	ASSERT_EQ(auth_random_bytes(first, sizeof(first)), 0);
+	ASSERT_EQ(auth_random_bytes(second, sizeof(second)), 0);
+	EXPECT_NE(memcmp(first, second, sizeof(first)), 0);
+
+	// Larger than buffer and more than what is left in it.
+	unsigned char large[AUTH_RANDOM_BUFFER_SIZE * 2];
+	ASSERT_EQ(auth_random_bytes(large, sizeof(large)), 0);
+	for(int i = 0; i < 200; i++)
+		ASSERT_EQ(auth_random_bytes(large, AUTH_RANDOM_BUFFER_SIZE / 2), 0);
+}
+
+TEST(AuthRandomTests, TestToken) {
+	char token[256];
+	ASSERT_EQ(auth_random_token(128, BASE64_STANDARD, token), base64_encoded_length(128, BASE64_STANDARD));
+	EXPECT_EQ(strlen(token), base64_encoded_length(128, BASE64_STANDARD));
+
+	ASSERT_EQ(auth_random_token(64, BASE64_URL, token), base64_encoded_length(64, BASE64_URL));
+	EXPECT_EQ(strcspn(token, "+/="), strlen(token));
+
+	// Larger than one chunk, padding may only show up at the very end.
+	char large[AUTH_RANDOM_BUFFER_SIZE * 2];
+	ASSERT_EQ(auth_random_token(AUTH_RANDOM_BUFFER_SIZE + 1, BASE64_STANDARD, large), base64_encoded_length(AUTH_RANDOM_BUFFER_SIZE + 1, BASE64_STANDARD));
+	EXPECT_EQ(strlen(large), base64_encoded_length(AUTH_RANDOM_BUFFER_SIZE + 1, BASE64_STANDARD));
+	EXPECT_EQ(strcspn(large, "="), strlen(large) - 1);
+}
+
+TEST(AuthRandomTests, TestForkDoesNotShareBuffer) {
+	unsigned char parent[16];
+	unsigned char child[16];
+	// Makes sure buffer is filled before forking.
+	ASSERT_EQ(auth_random_bytes(parent, sizeof(parent)), 0);
+
+	int pipes[2];
+	ASSERT_EQ(pipe(pipes), 0);
+	pid_t pid = fork();
+	ASSERT_GE(pid, 0);
+	if(pid == 0) {
+		auth_random_bytes(child, sizeof(child));
+		ssize_t written = write(pipes[1], child, sizeof(child));
+		_exit(written == sizeof(child) ? 0 : 1);
+	}
+
+	ASSERT_EQ(auth_random_bytes(parent, sizeof(parent)), 0);
+	ASSERT_EQ(read(pipes[0], child, sizeof(child)), (ssize_t) sizeof(child));
+	int status;
+	waitpid(pid, &status, 0);
+	close(pipes[0]);
+	close(pipes[1]);
+
+	EXPECT_NE(memcmp(parent, child, sizeof(parent)), 0);
+}
@@ -0,0 +1,62 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "radicle/auth/rate_limiter.h"
+#include "radicle/types/string.h"
+
+TEST(AuthRateLimiterTests, TestLimit) {
+	auth_rate_limiter_t* limiter = auth_rate_limiter_new(3, 100, 16, 4);
+	string_t* ip = string_from_literal("127.0.0.1");
+	string_t* other = string_from_literal("127.0.0.2");
+
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, ip), 0);
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, ip), 0);
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, ip), 0);
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, ip), 1);
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, other), 0);
+
+	auth_rate_limiter_reset(limiter, ip);
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, ip), 0);
+
+	string_free(&ip);
+	string_free(&other);
+	auth_rate_limiter_free(&limiter);
+	EXPECT_TRUE(limiter == NULL);
+}
+
+TEST(AuthRateLimiterTests, TestCapacity) {
+	auth_rate_limiter_t* limiter = auth_rate_limiter_new(1, 100, 2, 1);
+	string_t* first = string_from_literal("10.0.0.1");
+	string_t* second = string_from_literal("10.0.0.2");
+	string_t* third = string_from_literal("10.0.0.3");
+
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, first), 0);
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, second), 0);
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, first), 1);
+
+	// Limiter is full, so third ip is not tracked.
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, third), 0);
+	EXPECT_EQ(auth_rate_limiter_hit(limiter, third), 0);
+
+	string_free(&first);
+	string_free(&second);
+	string_free(&third);
+	auth_rate_limiter_free(&limiter);
+}
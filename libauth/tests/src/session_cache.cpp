@@ -0,0 +1,120 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include "radicle/auth/session_cache.h"
+#include "radicle/auth/types.h"
+#include "radicle/types/string.h"
+#include "radicle/types/uuid.h"
+
+class AuthSessionCacheTests: public ::testing::Test {
+	public:
+		auth_session_cache_t* cache = NULL;
+		string_t* token = NULL;
+		string_t* signature = NULL;
+		auth_account_t* account = NULL;
+	protected:
+		void SetUp() override {
+			cache = auth_session_cache_new(4, 60, 1);
+			token = string_from_literal("token");
+			signature = string_from_literal("signature");
+			unsigned char bin[16] = {1};
+			uuid_t* uuid = uuid_new(bin);
+			string_t* email = string_from_literal("mail@example.com");
+			account = auth_account_new(uuid, email, NULL, ROLE_USER, true, true, 0);
+			uuid_free(&uuid);
+			string_free(&email);
+		}
+
+		void TearDown() override {
+			auth_session_cache_free(&cache);
+			string_free(&token);
+			string_free(&signature);
+			auth_account_free(&account);
+		}
+};
+
+TEST_F(AuthSessionCacheTests, TestHit) {
+	uint32_t id = 0;
+	auth_account_t* cached = NULL;
+	ASSERT_EQ(auth_session_cache_get(cache, token, signature, &id, &cached), 1);
+
+	auth_session_cache_put(cache, token, signature, 7, account);
+	ASSERT_EQ(auth_session_cache_get(cache, token, signature, &id, &cached), 0);
+	EXPECT_EQ(id, 7);
+	ASSERT_TRUE(cached != NULL);
+	EXPECT_STREQ(cached->email->ptr, "mail@example.com");
+	EXPECT_EQ(memcmp(cached->uuid->bin, account->uuid->bin, 16), 0);
+	auth_account_free(&cached);
+
+	string_t* forged = string_from_literal("forged");
+	EXPECT_EQ(auth_session_cache_get(cache, token, forged, &id, &cached), 1);
+	string_free(&forged);
+}
+
+TEST_F(AuthSessionCacheTests, TestInvalidate) {
+	uint32_t id = 0;
+	auth_account_t* cached = NULL;
+
+	auth_session_cache_put(cache, token, signature, 7, account);
+	auth_session_cache_remove(cache, token);
+	EXPECT_EQ(auth_session_cache_get(cache, token, signature, &id, &cached), 1);
+
+	auth_session_cache_put(cache, token, signature, 7, account);
+	auth_session_cache_remove_account(cache, account->uuid);
+	EXPECT_EQ(auth_session_cache_get(cache, token, signature, &id, &cached), 1);
+}
+
+TEST_F(AuthSessionCacheTests, TestEvictsLeastRecentlyUsed) {
+	uint32_t id = 0;
+	auth_account_t* cached = NULL;
+	char name[2] = {0};
+
+	for(int i = 0; i < 5; i++) {
+		name[0] = 'a' + i;
+		string_t* key = string_from_literal(name);
+		auth_session_cache_put(cache, key, signature, i, NULL);
+		string_free(&key);
+
+		if(i == 3) {
+			// Touch a, so b is evicted instead.
+			string_t* first = string_from_literal("a");
+			EXPECT_EQ(auth_session_cache_get(cache, first, signature, &id, &cached), 0);
+			string_free(&first);
+		}
+	}
+
+	string_t* first = string_from_literal("a");
+	string_t* second = string_from_literal("b");
+	EXPECT_EQ(auth_session_cache_get(cache, first, signature, &id, &cached), 0);
+	EXPECT_EQ(auth_session_cache_get(cache, second, signature, &id, &cached), 1);
+	EXPECT_TRUE(cached == NULL);
+	string_free(&first);
+	string_free(&second);
+}
+
+TEST_F(AuthSessionCacheTests, TestExpires) {
+	auth_session_cache_t* expiring = auth_session_cache_new(4, 0, 1);
+	uint32_t id = 0;
+	auth_account_t* cached = NULL;
+
+	auth_session_cache_put(expiring, token, signature, 7, NULL);
+	EXPECT_EQ(auth_session_cache_get(expiring, token, signature, &id, &cached), 1);
+	auth_session_cache_free(&expiring);
+}
@@ -0,0 +1,163 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "radicle/auth.h"
+#include "radicle/auth/stateless_session.h"
+#include "radicle/auth/revocation_list.h"
+#include "radicle/tests/auth/auth_fixture.hpp"
+
+static char REVOKED_UUID[16] = {0x2};
+
+PGDB_FAKE_FETCH_STORY(RevocationFetch) {
+	PGDB_FAKE_STORY_BRANCH(RevocationFetch, 0);
+		PGDB_FAKE_RESULT_1(PGRES_TUPLES_OK, "id");
+		PGDB_FAKE_INT(7);
+		PGDB_FAKE_NEXT_ROW();
+		PGDB_FAKE_INT(3);
+		PGDB_FAKE_FINISH();
+	PGDB_FAKE_STORY_BRANCH_END();
+
+	PGDB_FAKE_STORY_BRANCH(RevocationFetch, 1);
+		PGDB_FAKE_RESULT_1(PGRES_TUPLES_OK, "uuid");
+		PGDB_FAKE_UUID(REVOKED_UUID);
+		PGDB_FAKE_FINISH();
+	PGDB_FAKE_STORY_BRANCH_END();
+
+	return NULL;
+}
+
+static auth_stateless_session_t make_session(const uint32_t id, const unsigned char owner) {
+	auth_stateless_session_t session = { 0 };
+	session.id = id;
+	session.owned = owner != 0;
+	session.owner.bin[0] = owner;
+	session.role = ROLE_USER;
+	session.verified = true;
+	session.expires = time(NULL) + 3600;
+	return session;
+}
+
+TEST(AuthStatelessSessionTests, TestSignAndParse) {
+	string_t* key = string_from_literal("key");
+	auth_stateless_session_t session = make_session(42, 1);
+
+	string_t* cookie = NULL;
+	ASSERT_EQ(auth_stateless_session_sign(key, &session, &cookie), 0);
+	EXPECT_EQ(cookie->length, AUTH_STATELESS_SESSION_COOKIE_LENGTH);
+	EXPECT_EQ(strlen(cookie->ptr), AUTH_STATELESS_SESSION_COOKIE_LENGTH);
+	EXPECT_TRUE(auth_stateless_session_is_cookie(cookie));
+
+	auth_stateless_session_t parsed;
+	ASSERT_EQ(auth_stateless_session_parse(key, cookie, &parsed), AUTH_STATELESS_SESSION_OK);
+	EXPECT_EQ(parsed.id, 42);
+	EXPECT_TRUE(parsed.owned);
+	EXPECT_EQ(memcmp(parsed.owner.bin, session.owner.bin, 16), 0);
+	EXPECT_EQ(parsed.role, ROLE_USER);
+	EXPECT_TRUE(parsed.verified);
+	EXPECT_EQ(parsed.expires, session.expires);
+
+	auth_account_t* account = auth_stateless_session_account(&parsed);
+	ASSERT_TRUE(account != NULL);
+	EXPECT_EQ(memcmp(account->uuid->bin, session.owner.bin, 16), 0);
+	EXPECT_TRUE(account->active);
+	EXPECT_TRUE(account->email == NULL);
+	auth_account_free(&account);
+
+	string_free(&cookie);
+	string_free(&key);
+}
+
+TEST(AuthStatelessSessionTests, TestRejects) {
+	string_t* key = string_from_literal("key");
+	string_t* other_key = string_from_literal("other");
+	auth_stateless_session_t session = make_session(42, 0);
+	auth_stateless_session_t parsed;
+
+	string_t* cookie = NULL;
+	ASSERT_EQ(auth_stateless_session_sign(key, &session, &cookie), 0);
+	EXPECT_EQ(auth_stateless_session_parse(other_key, cookie, &parsed), AUTH_STATELESS_SESSION_INVALID_SIGNATURE);
+
+	// Flipping a payload char must break signature.
+	cookie->ptr[5] = cookie->ptr[5] == 'A' ? 'B' : 'A';
+	EXPECT_EQ(auth_stateless_session_parse(key, cookie, &parsed), AUTH_STATELESS_SESSION_INVALID_SIGNATURE);
+	string_free(&cookie);
+
+	session.expires = time(NULL) - 1;
+	ASSERT_EQ(auth_stateless_session_sign(key, &session, &cookie), 0);
+	EXPECT_EQ(auth_stateless_session_parse(key, cookie, &parsed), AUTH_STATELESS_SESSION_EXPIRED);
+	string_free(&cookie);
+
+	string_t* classic = string_from_literal("token-signature");
+	EXPECT_FALSE(auth_stateless_session_is_cookie(classic));
+	EXPECT_EQ(auth_stateless_session_parse(key, classic, &parsed), AUTH_STATELESS_SESSION_MALFORMED);
+	string_free(&classic);
+
+	string_free(&key);
+	string_free(&other_key);
+}
+
+TEST(AuthRevocationListTests, TestNew) {
+	auth_revocation_list_t* list = auth_revocation_list_new();
+	EXPECT_FALSE(auth_revocation_list_is_fresh(list));
+
+	uuid_t account = { {0x5} };
+	EXPECT_FALSE(auth_revocation_list_session_revoked(list, 10));
+	EXPECT_FALSE(auth_revocation_list_account_revoked(list, &account));
+
+	auth_revocation_list_free(&list);
+	EXPECT_TRUE(list == NULL);
+}
+
+TEST_F(RadicleAuthTests, TestVerifyStatelessCookie) {
+	PGDB_FAKE_INIT_FETCH_STORY(RevocationFetch);
+	install_hook(PGDB_FAKE_CREATE_FETCH_HOOK(RevocationFetch));
+
+	auth_revocation_list_t* list = auth_revocation_list_new();
+	ASSERT_EQ(auth_revocation_list_load(list, NULL), 0);
+	EXPECT_TRUE(auth_revocation_list_is_fresh(list));
+
+	string_t* key = string_from_literal("key");
+	string_t* cookie = NULL;
+	uint32_t session_id = 0;
+	auth_account_t* account = NULL;
+
+	auth_stateless_session_t session = make_session(42, 1);
+	ASSERT_EQ(auth_stateless_session_sign(key, &session, &cookie), 0);
+	EXPECT_EQ(auth_verify_stateless_cookie(NULL, list, key, cookie, &session_id, &account), AUTH_OK);
+	EXPECT_EQ(session_id, 42);
+	ASSERT_TRUE(account != NULL);
+	auth_account_free(&account);
+	string_free(&cookie);
+
+	session = make_session(7, 1);
+	ASSERT_EQ(auth_stateless_session_sign(key, &session, &cookie), 0);
+	EXPECT_EQ(auth_verify_stateless_cookie(NULL, list, key, cookie, &session_id, &account), AUTH_COOKIE_NOT_FOUND);
+	string_free(&cookie);
+
+	session = make_session(43, REVOKED_UUID[0]);
+	ASSERT_EQ(auth_stateless_session_sign(key, &session, &cookie), 0);
+	EXPECT_EQ(auth_verify_stateless_cookie(NULL, list, key, cookie, &session_id, &account), AUTH_ACCOUNT_NOT_ACTIVE);
+	EXPECT_TRUE(account == NULL);
+	string_free(&cookie);
+
+	string_free(&key);
+	auth_revocation_list_free(&list);
+}
@@ -0,0 +1,58 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Monotonic clock helpers, unaffected by changes of the wall clock.
+ * @author Nils Egger
+ *
+ * @addtogroup Common 
+ * @{
+ */
+
+#ifndef RADICLE_COMMON_INCLUDE_RADICLE_CLOCK_H
+#define RADICLE_COMMON_INCLUDE_RADICLE_CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Current monotonic time in seconds.
+ */
+time_t clock_monotonic();
+
+/**
+ * @brief Adds \p milliseconds to current monotonic time, e.g. for pthread_cond_timedwait() on a
+ * condition variable using CLOCK_MONOTONIC.
+ *
+ * @param milliseconds Time from now.
+ * @param deadline Buffer to write to.
+ */
+void clock_deadline_in(const int64_t milliseconds, struct timespec* deadline);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_COMMON_INCLUDE_RADICLE_CLOCK_H
+
+/** @} */
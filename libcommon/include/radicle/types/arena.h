@@ -0,0 +1,122 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Header of bump allocator for short lived objects.
+ * @author Nils Egger
+ *
+ * @addtogroup Common 
+ * @{
+ * @addtogroup Types 
+ * @{
+ * @addtogroup Arena 
+ * @{
+ */
+
+#ifndef RADICLE_COMMON_INCLUDE_RADICLE_TYPES_ARENA_H 
+#define RADICLE_COMMON_INCLUDE_RADICLE_TYPES_ARENA_H 
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Alignment of every allocation.
+ */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * @brief Block of memory allocations are cut from.
+ */
+typedef struct arena_chunk {
+	struct arena_chunk* next; /**< Previously filled chunk. */
+	size_t size; /**< Usable bytes of data. */
+	size_t used; /**< Bytes already handed out. */
+	unsigned char data[] __attribute__((aligned(ARENA_ALIGNMENT))); /**< Memory handed out. */
+} arena_chunk_t;
+
+/**
+ * @brief Hands out memory by bumping an offset and releases all of it at once. Objects allocated
+ * from an arena must never be passed to their usual free function.
+ *
+ * @see arena_new()
+ * @see arena_alloc()
+ * @see arena_reset()
+ * @see arena_free()
+ */
+typedef struct arena {
+	arena_chunk_t* head; /**< Chunk currently allocated from. First chunk is always last in list. */
+	size_t chunk_size; /**< Usable size of new chunks. */
+} arena_t;
+
+/**
+ * @brief Creates a new arena.
+ *
+ * @param chunk_size Usable bytes of first chunk. Allocations which do not fit get a chunk of their own.
+ *
+ * @returns Returns new arena or NULL on failure.
+ */
+arena_t* arena_new(const size_t chunk_size);
+
+/**
+ * @brief Allocates zeroed memory from arena.
+ *
+ * @param arena Arena to allocate from.
+ * @param size Amount of bytes.
+ *
+ * @returns Returns pointer aligned to ARENA_ALIGNMENT, or NULL if no memory is left.
+ */
+void* arena_alloc(arena_t* arena, const size_t size);
+
+/**
+ * @brief Checks if \p ptr was handed out by arena.
+ *
+ * @param arena Arena to check, may be NULL.
+ * @param ptr Pointer to check, may be NULL.
+ *
+ * @returns Returns true if ptr lies within a chunk of arena.
+ */
+bool arena_owns(const arena_t* arena, const void* ptr);
+
+/**
+ * @brief Releases every allocation at once. The first chunk is kept for reuse, all others are freed.
+ *
+ * @param arena Arena to reset.
+ */
+void arena_reset(arena_t* arena);
+
+/**
+ * @brief Frees arena and all of its chunks.
+ *
+ * @param arena Double pointer to arena. Will be set to NULL.
+ */
+void arena_free(arena_t** arena);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_COMMON_INCLUDE_RADICLE_TYPES_ARENA_H 
+
+/** @} */
+/** @} */
+/** @} */
@@ -0,0 +1,110 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Header of bounded multi producer single consumer queue
+ * @author Nils Egger
+ *
+ * @addtogroup Common 
+ * @{
+ * @addtogroup Types 
+ * @{
+ * @addtogroup MPSCQueue 
+ * @{
+ */
+
+#ifndef RADICLE_COMMON_INCLUDE_RADICLE_TYPES_MPSC_QUEUE_H 
+#define RADICLE_COMMON_INCLUDE_RADICLE_TYPES_MPSC_QUEUE_H 
+
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Slot of queue. Sequence tells producers and consumer whose turn it is.
+ */
+typedef struct mpsc_queue_cell {
+	size_t sequence; /**< Equals position if slot is free, position + 1 if slot holds data. */
+	void* data; /**< Custom data */
+} mpsc_queue_cell_t;
+
+/**
+ * @brief Lock free bounded ring buffer. Any amount of threads may push, only a single thread may pop.
+ * Producers never block, a full queue is reported to the caller instead.
+ */
+typedef struct mpsc_queue {
+	size_t mask; /**< Capacity minus one. Capacity is always a power of two. */
+	mpsc_queue_cell_t* cells; /**< Ring of slots. */
+	size_t head __attribute__((aligned(64))); /**< Next position to push to. Shared by producers. */
+	size_t tail __attribute__((aligned(64))); /**< Next position to pop from. Only used by consumer. */
+} mpsc_queue_t;
+
+/**
+ * @brief Creates a new queue.
+ *
+ * @param capacity Amount of entries the queue can hold. Is rounded up to the next power of two.
+ *
+ * @return Returns new queue or NULL on failure.
+ */
+mpsc_queue_t* mpsc_queue_new(size_t capacity);
+
+/**
+ * @brief Adds data to queue. Safe to be called from multiple threads at once.
+ *
+ * @param queue Queue to push to.
+ * @param data Data to add, must not be NULL.
+ *
+ * @return Returns 0 on success and 1 if queue is full.
+ */
+int mpsc_queue_push(mpsc_queue_t* queue, void* data);
+
+/**
+ * @brief Removes oldest entry. Must only be called by a single thread at a time.
+ *
+ * @param queue Queue to pop from.
+ *
+ * @return Returns data or NULL if queue is empty.
+ */
+void* mpsc_queue_pop(mpsc_queue_t* queue);
+
+/**
+ * @brief Returns approximate amount of entries in queue.
+ */
+size_t mpsc_queue_size(mpsc_queue_t* queue);
+
+/**
+ * @brief Frees queue. Data still in queue is passed to free_data.
+ *
+ * @param queue Pointer to queue.
+ * @param free_data Func which takes data as argument and frees it, if NULL will
+ * not be called
+ */
+void mpsc_queue_free(mpsc_queue_t** queue, void(*free_data)(void*));
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_COMMON_INCLUDE_RADICLE_TYPES_MPSC_QUEUE_H 
+
+/** @} */
+/** @} */
+/** @} */
@@ -0,0 +1,135 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Objects which were replaced, but may still be read by other threads for a while.
+ * @author Nils Egger
+ *
+ * @addtogroup Common 
+ * @{
+ * @addtogroup Types 
+ * @{
+ * @addtogroup RetireList 
+ * @{
+ */
+
+#ifndef RADICLE_COMMON_INCLUDE_RADICLE_TYPES_RETIRE_LIST_H
+#define RADICLE_COMMON_INCLUDE_RADICLE_TYPES_RETIRE_LIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Must be the first member of a retired object, so freeing the node frees the object.
+ */
+typedef struct retire_node {
+	struct retire_node* next; /**< Next retired object, which was replaced earlier. */
+	uint64_t epoch; /**< Epoch which started when object was replaced. */
+} retire_node_t;
+
+/**
+ * @brief Slot of a thread which reads objects guarded by a \ref retire_list_t.
+ */
+typedef struct retire_reader {
+	struct retire_reader* next; /**< Next registered slot. */
+	uint64_t epoch; /**< Epoch current read started in, 0 if thread is not reading. Only accessed atomically. */
+	bool used; /**< True while a thread owns the slot. Only accessed atomically. */
+} retire_reader_t;
+
+/**
+ * @brief Keeps objects, which were swapped out of an atomic pointer, alive until every reader
+ * which could have loaded the pointer before the swap is done.
+ *
+ * Readers wrap every access in retire_list_enter() and retire_list_leave(), which publishes the
+ * epoch they started in. Every retired object starts a new epoch and is freed once no reader
+ * is left in an older one. Readers never block and never wait for writers.
+ *
+ * Writers must serialize calls to retire_list_push() and retire_list_collect().
+ *
+ * @see retire_list_new()
+ * @see retire_list_free()
+ */
+typedef struct retire_list {
+	retire_node_t* head; /**< Retired objects which may still be read, newest first. */
+	uint64_t epoch; /**< Current epoch, starts at 1. Only accessed atomically. */
+	retire_reader_t* readers; /**< Slots of all threads which ever read, never shrinks. Only accessed atomically. */
+	pthread_key_t key; /**< Slot of current thread. */
+} retire_list_t;
+
+/**
+ * @brief Creates an empty list.
+ *
+ * @returns Returns new list or NULL if no thread specific key is left.
+ */
+retire_list_t* retire_list_new();
+
+/**
+ * @brief Starts a read. Pointers guarded by \p list must only be loaded after this call.
+ *
+ * @param list List guarding the objects.
+ *
+ * @returns Returns slot of calling thread, which has to be passed to retire_list_leave().
+ */
+retire_reader_t* retire_list_enter(retire_list_t* list);
+
+/**
+ * @brief Ends a read started by retire_list_enter(). Objects loaded during the read must not
+ * be used afterwards.
+ *
+ * @param reader Slot returned by retire_list_enter().
+ */
+void retire_list_leave(retire_reader_t* reader);
+
+/**
+ * @brief Retires object of \p node and frees all retired objects no reader can still use.
+ *
+ * @param list List to retire to.
+ * @param node First member of a malloc'ed object, which has already been swapped out.
+ */
+void retire_list_push(retire_list_t* list, retire_node_t* node);
+
+/**
+ * @brief Frees all retired objects no reader can still use. Objects are otherwise only freed by
+ * the next retire_list_push().
+ *
+ * @param list List to collect.
+ */
+void retire_list_collect(retire_list_t* list);
+
+/**
+ * @brief Frees all retired objects, reader slots and the list itself. Only call once no reader is left.
+ *
+ * @param list Double pointer to list. Will be set to NULL.
+ */
+void retire_list_free(retire_list_t** list);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_COMMON_INCLUDE_RADICLE_TYPES_RETIRE_LIST_H
+
+/** @} */
+/** @} */
+/** @} */
@@ -34,6 +34,8 @@
 
 #include <stddef.h>
 
+#include "radicle/types/arena.h"
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -101,6 +103,47 @@ string_t* string_copy(const string_t* string);
  */
 string_t* string_cat(const string_t* first, const string_t* second);
 
+/**
+ * @brief Same as string_new(), but allocates from \p arena. Must not be passed to string_free().
+ *
+ * @param arena Arena to allocate from.
+ * @param str Char array to copy.
+ * @param length Length of char array to copy. 
+ *
+ * @returns Returns pointer to \ref string_t or NULL if arena is out of memory.
+ */
+string_t* string_new_arena(arena_t* arena, const char* str, const size_t length);
+
+/**
+ * @brief Same as string_new_empty(), but allocates from \p arena. Must not be passed to string_free().
+ *
+ * @param arena Arena to allocate from.
+ * @param length Length of new string.
+ *
+ * @returns Returns pointer to \ref string_t or NULL if arena is out of memory.
+ */
+string_t* string_new_empty_arena(arena_t* arena, const size_t length);
+
+/**
+ * @brief Same as string_from_literal(), but allocates from \p arena. Must not be passed to string_free().
+ *
+ * @param arena Arena to allocate from.
+ * @param literal Literal to copy to \ref string_t.ptr.
+ *
+ * @returns Returns pointer to \ref string_t or NULL if arena is out of memory.
+ */
+string_t* string_from_literal_arena(arena_t* arena, const char* literal);
+
+/**
+ * @brief Same as string_copy(), but allocates from \p arena. Must not be passed to string_free().
+ *
+ * @param arena Arena to allocate from.
+ * @param string String to copy, may be NULL.
+ *
+ * @returns Returns pointer to \ref string_t or NULL.
+ */
+string_t* string_copy_arena(arena_t* arena, const string_t* string);
+
 /**
  * @brief Frees \t str and sets the pointer to NULL.
  * 
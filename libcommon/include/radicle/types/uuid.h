@@ -29,6 +29,7 @@
 #define RADICLE_COMMON_INCLUDE_RADICLE_TYPES_UUID_H
 
 #include "string.h"
+#include "radicle/types/arena.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -52,6 +53,16 @@ typedef struct uuid {
  */
 uuid_t* uuid_new(const unsigned char* bin);
 
+/**
+ * @brief Same as uuid_new(), but allocates from \p arena. Must not be passed to uuid_free().
+ *
+ * @param arena Arena to allocate from.
+ * @param bin UUID binary.
+ *
+ * @returns Returns pointer to \ref uuid_t or NULL if arena is out of memory.
+ */
+uuid_t* uuid_new_arena(arena_t* arena, const unsigned char* bin);
+
 /**
  * @brief Frees the uuid and sets its pointer to NULL
  *
@@ -79,6 +90,16 @@ string_t* uuid_to_str(const uuid_t* uuid);
  */
 uuid_t* uuid_copy(const uuid_t* uuid);
 
+/**
+ * @brief Same as uuid_copy(), but allocates from \p arena. Must not be passed to uuid_free().
+ *
+ * @param arena Arena to allocate from.
+ * @param uuid UUID to copy, may be NULL.
+ *
+ * @returns Returns pointer to \ref uuid_t or NULL.
+ */
+uuid_t* uuid_copy_arena(arena_t* arena, const uuid_t* uuid);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,106 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "radicle/types/arena.h"
+
+static size_t arena_align(const size_t size) {
+	return (size + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+}
+
+static arena_chunk_t* arena_chunk_new(const size_t size) {
+	arena_chunk_t* chunk = malloc(sizeof(arena_chunk_t) + size);
+	if(chunk == NULL)
+		return NULL;
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
+
+arena_t* arena_new(const size_t chunk_size) {
+	arena_t* arena = calloc(1, sizeof(arena_t));
+	if(arena == NULL)
+		return NULL;
+
+	arena->chunk_size = arena_align(chunk_size > 0 ? chunk_size : ARENA_ALIGNMENT);
+	arena->head = arena_chunk_new(arena->chunk_size);
+	if(arena->head == NULL) {
+		free(arena);
+		return NULL;
+	}
+	return arena;
+}
+
+void* arena_alloc(arena_t* arena, const size_t size) {
+	size_t aligned = arena_align(size > 0 ? size : 1);
+	arena_chunk_t* chunk = arena->head;
+
+	if(chunk->size - chunk->used < aligned) {
+		chunk = arena_chunk_new(aligned > arena->chunk_size ? aligned : arena->chunk_size);
+		if(chunk == NULL)
+			return NULL;
+		chunk->next = arena->head;
+		arena->head = chunk;
+	}
+
+	void* ptr = chunk->data + chunk->used;
+	chunk->used += aligned;
+	memset(ptr, 0, aligned);
+	return ptr;
+}
+
+bool arena_owns(const arena_t* arena, const void* ptr) {
+	if(arena == NULL || ptr == NULL)
+		return false;
+
+	uintptr_t address = (uintptr_t) ptr;
+	for(const arena_chunk_t* iter = arena->head; iter != NULL; iter = iter->next) {
+		uintptr_t start = (uintptr_t) iter->data;
+		if(address >= start && address < start + iter->used)
+			return true;
+	}
+	return false;
+}
+
+void arena_reset(arena_t* arena) {
+	while(arena->head->next != NULL) {
+		arena_chunk_t* next = arena->head->next;
+		free(arena->head);
+		arena->head = next;
+	}
+	arena->head->used = 0;
+}
+
+void arena_free(arena_t** arena) {
+	if(*arena == NULL) return;
+	while((*arena)->head != NULL) {
+		arena_chunk_t* next = (*arena)->head->next;
+		free((*arena)->head);
+		(*arena)->head = next;
+	}
+	free(*arena);
+	*arena = NULL;
+}
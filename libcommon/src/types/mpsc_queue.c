@@ -0,0 +1,110 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "radicle/types/mpsc_queue.h"
+
+/*
+ * Bounded queue after Dmitry Vyukov. Every cell carries a sequence number, producers
+ * claim a position with a compare and swap on head and publish their data by bumping
+ * the sequence of the cell. The consumer only reads cells whose sequence says they are filled.
+ */
+
+mpsc_queue_t* mpsc_queue_new(size_t capacity) {
+	size_t size = 2;
+	while(size < capacity)
+		size <<= 1;
+
+	mpsc_queue_t* queue = aligned_alloc(64, sizeof(mpsc_queue_t));
+	if(queue == NULL)
+		return NULL;
+	memset(queue, 0, sizeof(mpsc_queue_t));
+
+	queue->cells = calloc(size, sizeof(mpsc_queue_cell_t));
+	if(queue->cells == NULL) {
+		free(queue);
+		return NULL;
+	}
+	for(size_t i = 0; i < size; i++)
+		queue->cells[i].sequence = i;
+	queue->mask = size - 1;
+	queue->head = 0;
+	queue->tail = 0;
+	return queue;
+}
+
+int mpsc_queue_push(mpsc_queue_t* queue, void* data) {
+	size_t position = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+	while(1) {
+		mpsc_queue_cell_t* cell = &queue->cells[position & queue->mask];
+		size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+		intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+
+		if(difference == 0) {
+			if(__atomic_compare_exchange_n(&queue->head, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				cell->data = data;
+				__atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+				return 0;
+			}
+			// position has been updated by failed compare exchange.
+		} else if(difference < 0) {
+			// Cell still holds data of previous round, consumer hasnt caught up.
+			return 1;
+		} else {
+			position = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+void* mpsc_queue_pop(mpsc_queue_t* queue) {
+	size_t position = queue->tail;
+	mpsc_queue_cell_t* cell = &queue->cells[position & queue->mask];
+	size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+
+	if(sequence != position + 1)
+		return NULL;
+
+	void* data = cell->data;
+	cell->data = NULL;
+	__atomic_store_n(&queue->tail, position + 1, __ATOMIC_RELAXED);
+	// Hand cell over to producers of next round.
+	__atomic_store_n(&cell->sequence, position + queue->mask + 1, __ATOMIC_RELEASE);
+	return data;
+}
+
+size_t mpsc_queue_size(mpsc_queue_t* queue) {
+	size_t head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+	size_t tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+	return head > tail ? head - tail : 0;
+}
+
+void mpsc_queue_free(mpsc_queue_t** queue, void(*free_data)(void*)) {
+	if(*queue == NULL) return;
+	void* data = NULL;
+	while((data = mpsc_queue_pop(*queue)) != NULL) {
+		if(free_data != NULL)
+			free_data(data);
+	}
+	free((*queue)->cells);
+	free(*queue);
+	*queue = NULL;
+}
@@ -0,0 +1,132 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdlib.h>
+
+#include "radicle/types/retire_list.h"
+
+/**
+ * @brief Hands slot of an exiting thread to the next thread which reads.
+ */
+static void retire_list_release_reader(void* data) {
+	retire_reader_t* reader = data;
+	__atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&reader->used, false, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Returns slot of calling thread, registers one on its first read.
+ */
+static retire_reader_t* retire_list_reader(retire_list_t* list) {
+	retire_reader_t* reader = pthread_getspecific(list->key);
+	if(reader != NULL)
+		return reader;
+
+	// Slots of exited threads are reused, so the list only grows with the amount of concurrent readers.
+	for(reader = __atomic_load_n(&list->readers, __ATOMIC_ACQUIRE); reader != NULL; reader = reader->next) {
+		bool used = false;
+		if(__atomic_compare_exchange_n(&reader->used, &used, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			break;
+	}
+
+	if(reader == NULL) {
+		reader = calloc(1, sizeof(retire_reader_t));
+		reader->used = true;
+		reader->next = __atomic_load_n(&list->readers, __ATOMIC_RELAXED);
+		while(!__atomic_compare_exchange_n(&list->readers, &reader->next, reader, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+
+	pthread_setspecific(list->key, reader);
+	return reader;
+}
+
+retire_list_t* retire_list_new() {
+	retire_list_t* list = calloc(1, sizeof(retire_list_t));
+	list->epoch = 1;
+	if(pthread_key_create(&list->key, retire_list_release_reader)) {
+		free(list);
+		return NULL;
+	}
+	return list;
+}
+
+retire_reader_t* retire_list_enter(retire_list_t* list) {
+	retire_reader_t* reader = retire_list_reader(list);
+	__atomic_store_n(&reader->epoch, __atomic_load_n(&list->epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+	// Pairs with fence in retire_list_collect(). Either the writer sees this epoch, or the
+	// reader loads the pointer which was stored before the object got retired.
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	return reader;
+}
+
+void retire_list_leave(retire_reader_t* reader) {
+	__atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+}
+
+void retire_list_push(retire_list_t* list, retire_node_t* node) {
+	// Readers which see the new epoch started after the swap, so they cannot have loaded the object.
+	node->epoch = __atomic_add_fetch(&list->epoch, 1, __ATOMIC_ACQ_REL);
+	node->next = list->head;
+	list->head = node;
+	retire_list_collect(list);
+}
+
+void retire_list_collect(retire_list_t* list) {
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	uint64_t oldest = UINT64_MAX;
+	for(retire_reader_t* reader = __atomic_load_n(&list->readers, __ATOMIC_ACQUIRE); reader != NULL; reader = reader->next) {
+		uint64_t epoch = __atomic_load_n(&reader->epoch, __ATOMIC_ACQUIRE);
+		if(epoch != 0 && epoch < oldest)
+			oldest = epoch;
+	}
+
+	// List is ordered newest first, everything behind the first object no reader can see can go.
+	retire_node_t** iter = &list->head;
+	while(*iter != NULL && (*iter)->epoch > oldest)
+		iter = &(*iter)->next;
+	while(*iter != NULL) {
+		retire_node_t* unused = *iter;
+		*iter = unused->next;
+		free(unused);
+	}
+}
+
+void retire_list_free(retire_list_t** list) {
+	if(*list == NULL) return;
+
+	while((*list)->head != NULL) {
+		retire_node_t* next = (*list)->head->next;
+		free((*list)->head);
+		(*list)->head = next;
+	}
+
+	pthread_key_delete((*list)->key);
+	while((*list)->readers != NULL) {
+		retire_reader_t* next = (*list)->readers->next;
+		free((*list)->readers);
+		(*list)->readers = next;
+	}
+
+	free(*list);
+	*list = NULL;
+}
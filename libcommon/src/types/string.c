@@ -66,6 +66,36 @@ string_t* string_cat(const string_t* first, const string_t* second) {
 	return res;
 }
 
+string_t* string_new_empty_arena(arena_t* arena, const size_t length) {
+	string_t* buf = arena_alloc(arena, sizeof(string_t));
+	if(buf == NULL)
+		return NULL;
+	if(length == 0)
+		return buf;
+
+	buf->ptr = arena_alloc(arena, length + 1);
+	if(buf->ptr == NULL)
+		return NULL;
+	buf->length = length;
+	return buf;
+}
+
+string_t* string_new_arena(arena_t* arena, const char* str, const size_t length) {
+	string_t* buf = string_new_empty_arena(arena, str == NULL ? 0 : length);
+	if(buf != NULL && buf->length > 0)
+		memcpy(buf->ptr, str, length);
+	return buf;
+}
+
+string_t* string_from_literal_arena(arena_t* arena, const char* literal) {
+	return string_new_arena(arena, literal, strlen(literal));
+}
+
+string_t* string_copy_arena(arena_t* arena, const string_t* string) {
+	if(string == NULL) return NULL;
+	return string_new_arena(arena, string->ptr, string->length);
+}
+
 void string_free(string_t** str) {
 	if(*str == NULL)
 	       	return;
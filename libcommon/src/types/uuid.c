@@ -28,6 +28,13 @@ uuid_t* uuid_new(const unsigned char* bin) {
 	return buf;
 }
 
+uuid_t* uuid_new_arena(arena_t* arena, const unsigned char* bin) {
+	uuid_t* buf = arena_alloc(arena, sizeof(uuid_t));
+	if(buf != NULL)
+		memcpy(buf->bin, bin, 16);
+	return buf;
+}
+
 void uuid_free(uuid_t** uuid) {
 	if(*uuid == NULL) return;
 	free(*uuid);
@@ -66,3 +73,8 @@ uuid_t* uuid_copy(const uuid_t* uuid) {
 	memcpy(buf->bin, uuid->bin, 16);
 	return buf;
 }
+
+uuid_t* uuid_copy_arena(arena_t* arena, const uuid_t* uuid) {
+	if(uuid == NULL) return NULL;
+	return uuid_new_arena(arena, uuid->bin);
+}
@@ -0,0 +1,39 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <time.h>
+
+#include "radicle/clock.h"
+
+TEST(ClockTests, TestDeadlineIn) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	struct timespec deadline;
+	clock_deadline_in(1999, &deadline);
+	EXPECT_GE(deadline.tv_nsec, 0);
+	EXPECT_LT(deadline.tv_nsec, 1000000000);
+
+	int64_t difference = (int64_t) (deadline.tv_sec - now.tv_sec) * 1000 + (deadline.tv_nsec - now.tv_nsec) / 1000000;
+	EXPECT_GE(difference, 1999);
+	EXPECT_LT(difference, 2100);
+
+	EXPECT_GE(clock_monotonic(), now.tv_sec);
+}
@@ -0,0 +1,72 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+#include "radicle/types/arena.h"
+
+TEST(ArenaTests, TestAlloc) {
+	arena_t* arena = arena_new(64);
+	ASSERT_TRUE(arena != NULL);
+
+	unsigned char* first = (unsigned char*) arena_alloc(arena, 3);
+	unsigned char* second = (unsigned char*) arena_alloc(arena, 5);
+	EXPECT_EQ((uintptr_t) first % ARENA_ALIGNMENT, 0);
+	EXPECT_EQ((uintptr_t) second % ARENA_ALIGNMENT, 0);
+	EXPECT_EQ(second - first, ARENA_ALIGNMENT);
+	EXPECT_EQ(first[0] | first[1] | first[2], 0);
+
+	EXPECT_TRUE(arena_owns(arena, first));
+	EXPECT_TRUE(arena_owns(arena, second + 4));
+	EXPECT_FALSE(arena_owns(arena, NULL));
+	EXPECT_FALSE(arena_owns(NULL, first));
+
+	int outside = 0;
+	EXPECT_FALSE(arena_owns(arena, &outside));
+
+	arena_free(&arena);
+	EXPECT_TRUE(arena == NULL);
+}
+
+TEST(ArenaTests, TestOverflowAndReset) {
+	arena_t* arena = arena_new(64);
+	arena_chunk_t* first_chunk = arena->head;
+
+	void* small = arena_alloc(arena, 48);
+	void* large = arena_alloc(arena, 1000);
+	ASSERT_TRUE(large != NULL);
+	EXPECT_TRUE(arena->head != first_chunk);
+	EXPECT_TRUE(arena_owns(arena, small));
+	EXPECT_TRUE(arena_owns(arena, large));
+
+	memset(small, 0xff, 48);
+	arena_reset(arena);
+	EXPECT_TRUE(arena->head == first_chunk);
+	EXPECT_EQ(arena->head->used, 0);
+	EXPECT_FALSE(arena_owns(arena, small));
+
+	// Memory handed out again is zeroed.
+	unsigned char* reused = (unsigned char*) arena_alloc(arena, 48);
+	EXPECT_TRUE(reused == small);
+	for(int i = 0; i < 48; i++)
+		EXPECT_EQ(reused[i], 0);
+
+	arena_free(&arena);
+}
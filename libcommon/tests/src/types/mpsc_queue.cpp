@@ -0,0 +1,85 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "radicle/types/mpsc_queue.h"
+
+static int freed = 0;
+
+static void free_counter(void* data) {
+	freed++;
+}
+
+TEST(MPSCQueueTests, TestPushPop) {
+	mpsc_queue_t* queue = mpsc_queue_new(3);
+	ASSERT_TRUE(queue != NULL);
+	EXPECT_EQ(queue->mask, 3);
+
+	int values[5] = {1, 2, 3, 4, 5};
+	EXPECT_TRUE(mpsc_queue_pop(queue) == NULL);
+	for(int i = 0; i < 4; i++)
+		EXPECT_EQ(mpsc_queue_push(queue, &values[i]), 0);
+	EXPECT_EQ(mpsc_queue_push(queue, &values[4]), 1);
+	EXPECT_EQ(mpsc_queue_size(queue), 4);
+
+	EXPECT_EQ(mpsc_queue_pop(queue), &values[0]);
+	EXPECT_EQ(mpsc_queue_push(queue, &values[4]), 0);
+	EXPECT_EQ(mpsc_queue_pop(queue), &values[1]);
+
+	freed = 0;
+	mpsc_queue_free(&queue, &free_counter);
+	EXPECT_EQ(freed, 3);
+	EXPECT_TRUE(queue == NULL);
+}
+
+TEST(MPSCQueueTests, TestConcurrentProducers) {
+	mpsc_queue_t* queue = mpsc_queue_new(64);
+	const intptr_t per_producer = 10000;
+	std::vector<std::thread> producers;
+	for(intptr_t p = 1; p <= 4; p++) {
+		producers.emplace_back([queue, p, per_producer]() {
+			for(intptr_t i = 1; i <= per_producer;) {
+				if(mpsc_queue_push(queue, (void*)(p * 100000 + i)) == 0)
+					i++;
+			}
+		});
+	}
+
+	// Entries of a single producer must arrive in order.
+	intptr_t last[5] = {0};
+	int received = 0;
+	while(received < 4 * per_producer) {
+		void* data = mpsc_queue_pop(queue);
+		if(data == NULL)
+			continue;
+		intptr_t value = (intptr_t)data;
+		EXPECT_EQ(value % 100000, last[value / 100000] + 1);
+		last[value / 100000] = value % 100000;
+		received++;
+	}
+
+	for(auto& producer : producers)
+		producer.join();
+	EXPECT_TRUE(mpsc_queue_pop(queue) == NULL);
+	mpsc_queue_free(&queue, NULL);
+}
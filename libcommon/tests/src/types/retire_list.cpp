@@ -0,0 +1,101 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "radicle/types/retire_list.h"
+
+typedef struct retire_test {
+	retire_node_t retire;
+	int value;
+} retire_test_t;
+
+static retire_test_t* retire_test_new() {
+	return (retire_test_t*) calloc(1, sizeof(retire_test_t));
+}
+
+TEST(RetireListTests, TestWithoutReaders) {
+	retire_list_t* list = retire_list_new();
+	ASSERT_TRUE(list != NULL);
+
+	// Nobody reads, so objects are freed right away.
+	retire_list_push(list, &retire_test_new()->retire);
+	EXPECT_TRUE(list->head == NULL);
+	retire_list_push(list, &retire_test_new()->retire);
+	EXPECT_TRUE(list->head == NULL);
+
+	retire_list_free(&list);
+	EXPECT_TRUE(list == NULL);
+}
+
+TEST(RetireListTests, TestReaderKeepsObject) {
+	retire_list_t* list = retire_list_new();
+	retire_test_t* first = retire_test_new();
+	retire_test_t* second = retire_test_new();
+
+	retire_reader_t* reader = retire_list_enter(list);
+	retire_list_push(list, &first->retire);
+	EXPECT_EQ(list->head, &first->retire);
+	retire_list_leave(reader);
+
+	// Reader which started after the swap does not hold back the object retired before it.
+	reader = retire_list_enter(list);
+	retire_list_push(list, &second->retire);
+	EXPECT_EQ(list->head, &second->retire);
+	EXPECT_TRUE(list->head->next == NULL);
+
+	retire_list_leave(reader);
+	retire_list_collect(list);
+	EXPECT_TRUE(list->head == NULL);
+
+	retire_list_free(&list);
+}
+
+TEST(RetireListTests, TestFreeWithRetired) {
+	retire_list_t* list = retire_list_new();
+	retire_reader_t* reader = retire_list_enter(list);
+	retire_list_push(list, &retire_test_new()->retire);
+	retire_list_push(list, &retire_test_new()->retire);
+	retire_list_leave(reader);
+	retire_list_free(&list);
+	EXPECT_TRUE(list == NULL);
+}
+
+static void* retire_test_read(void* data) {
+	retire_list_t* list = (retire_list_t*) data;
+	retire_list_leave(retire_list_enter(list));
+	return NULL;
+}
+
+TEST(RetireListTests, TestSlotReuse) {
+	retire_list_t* list = retire_list_new();
+	for(int i = 0; i < 4; i++) {
+		pthread_t thread;
+		ASSERT_EQ(pthread_create(&thread, NULL, retire_test_read, list), 0);
+		ASSERT_EQ(pthread_join(thread, NULL), 0);
+	}
+
+	// Threads ran one after another, so they all shared a single slot.
+	ASSERT_TRUE(list->readers != NULL);
+	EXPECT_TRUE(list->readers->next == NULL);
+	EXPECT_EQ(list->readers->epoch, 0);
+	retire_list_free(&list);
+}
@@ -64,3 +64,22 @@ TEST_F(RadicleTests, TestStringCat) {
 	string_free(&second);
 	string_free(&result);
 }
+
+TEST_F(RadicleTests, TestStringArena) {
+	arena_t* arena = arena_new(64);
+	string_t* str = string_from_literal_arena(arena, "Hello World!");
+	test_string_len(str);
+	EXPECT_STREQ(str->ptr, "Hello World!");
+	EXPECT_TRUE(arena_owns(arena, str));
+	EXPECT_TRUE(arena_owns(arena, str->ptr));
+
+	string_t* cpy = string_copy_arena(arena, str);
+	EXPECT_STREQ(cpy->ptr, str->ptr);
+	EXPECT_TRUE(string_copy_arena(arena, NULL) == NULL);
+
+	string_t* empty = string_new_arena(arena, NULL, 0);
+	EXPECT_EQ(empty->length, 0);
+	EXPECT_TRUE(empty->ptr == NULL);
+
+	arena_free(&arena);
+}
@@ -26,11 +26,16 @@
 #ifndef RADICLE_PGDB_INCLUDE_RADICLE_PGDB_H
 #define RADICLE_PGDB_INCLUDE_RADICLE_PGDB_H
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <time.h>
+#include <pthread.h>
 
 #include <libpq-fe.h>
+#include <libpq-events.h>
 #include <arpa/inet.h>
 
+#include "radicle/types/arena.h"
 #include "radicle/types/string.h"
 #include "radicle/types/uuid.h"
 #include "radicle/print.h"
@@ -44,12 +49,21 @@ extern "C" {
 #define ntohll(x) ((1==ntohl(1)) ? (x) : ((uint64_t)ntohl((x) & 0xFFFFFFFF) << 32) | ntohl((x) >> 32))
 
 /**
- * @brief Represents SQL parameters which will be bound to a query.
+ * @brief Bytes stored inline per parameter for fixed width values, large enough for a uuid.
+ */
+#define PGDB_PARAMS_SCRATCH_SIZE 16
+
+/**
+ * @brief Represents SQL parameters which will be bound to a query. All arrays and the scratch area for
+ * fixed width values live in the same allocation as the struct itself, so only copied text and bytea
+ * values need memory of their own.
  *
  * @see pgdb_params_new()
+ * @see pgdb_params_reset()
  * @see pgdb_params_free()
  * @see pgdb_bind_int32()
  * @see pgdb_bind_text()
+ * @see pgdb_bind_text_borrowed()
  */
 typedef struct pgdb_params {
 	int count; /**< Amount of parameters to bind to query. */
@@ -58,10 +72,14 @@ typedef struct pgdb_params {
 	int* lengths; /**< Length of values. */
 	int* formats; /**< Format of values, either 0 for text or 1 for binary. */
 	int next_index; /**< When binding values, this will increase by one and specify next index of next param. */
+	arena_t* arena; /**< If set, params and copied values are allocated from it instead of the heap. */
+	char (* scratch)[PGDB_PARAMS_SCRATCH_SIZE]; /**< Inline storage of fixed width values, one slot per parameter. */
+	bool* owned; /**< True for values copied to the heap, which are freed together with params. */
 } pgdb_params_t;
 
 /**
- * @brief Creates a new \ref pgdb_params_t object and initialzes all array to the size of \p count.
+ * @brief Creates a new \ref pgdb_params_t object and initialzes all array to the size of \p count,
+ * using a single allocation.
  *
  * @param count Amount of parameters.
  *
@@ -69,6 +87,24 @@ typedef struct pgdb_params {
  */
 pgdb_params_t* pgdb_params_new(const int count);
 
+/**
+ * @brief Same as pgdb_params_new(), but params and all values bound to it are allocated from \p arena.
+ * pgdb_params_free() only sets the pointer to NULL, memory is released by resetting arena.
+ *
+ * @param arena Arena to allocate from.
+ * @param count Amount of parameters.
+ *
+ * @returns Returns a new pointer to \ref pgdb_params_t or NULL if arena is out of memory.
+ */
+pgdb_params_t* pgdb_params_new_arena(arena_t* arena, const int count);
+
+/**
+ * @brief Unbinds all values, so params can be bound again for the next execution. Types are kept.
+ *
+ * @param params Params to reset.
+ */
+void pgdb_params_reset(pgdb_params_t* params);
+
 /**
  * @brief Frees all associated data to \p ptr and sets it to NULL.
  *
@@ -104,6 +140,16 @@ pgdb_result_t* pgdb_result_new(PGresult* result);
  */
 void pgdb_result_free(pgdb_result_t** result);
 
+/**
+ * @brief Checks if status of \p result equals \p expected_result_code. If not, logs the error message and frees \p result.
+ *
+ * @param result Result of query.
+ * @param expected_result_code Expected result code of libpq. PGRES_COMMAND_OK, PGRES_TUPLES_OK
+ *
+ * @returns 0 for success.
+ */
+int pgdb_manage_query(pgdb_result_t** result, int expected_result_code);
+
 /**
  * @brief Connects to database using connection info string, then checks status of conneciton, \
  * if connection is bad, frees memory again.
@@ -115,6 +161,17 @@ void pgdb_result_free(pgdb_result_t** result);
  */
 int pgdb_connect(const char* conninfo, PGconn** connection);
 
+/**
+ * @brief Makes sure \p connection is usable, e.g. for a long running background thread. Healthy
+ * connections are kept, broken ones are reset first and replaced using pgdb_connect() if that didnt help.
+ *
+ * @param conninfo String of connection info, used if a new connection is needed.
+ * @param connection Double pointer to connection, may point to NULL. Is set to NULL on failure.
+ *
+ * @returns Returns 0 if connection is usable.
+ */
+int pgdb_reconnect(const char* conninfo, PGconn** connection);
+
 /**
  * @brief Pings the database server to make sure it is running and returns the status as text.
  *
@@ -163,6 +220,146 @@ int pgdb_execute_param(PGconn* conn, const char* stmt, const pgdb_params_t* para
  */
 int pgdb_fetch_param(PGconn* conn, const char* stmt, const pgdb_params_t* params, pgdb_result_t** result);
 
+/**
+ * @brief Named SQL statement, which is prepared once per connection and executed with PQexecPrepared() afterwards.
+ * Must outlive every connection it is used with, hence usually declared static using \ref PGDB_STATEMENT.
+ *
+ * @see pgdb_fetch_prepared()
+ * @see pgdb_execute_prepared()
+ */
+typedef struct pgdb_statement {
+	const char* name; /**< Name of prepared statement. Must be unique. */
+	const char* stmt; /**< SQL Query statement. */
+	int id; /**< Index into the cache of every connection. Assigned on first use. */
+} pgdb_statement_t;
+
+/**
+ * @brief Initializer for \ref pgdb_statement_t.
+ */
+#define PGDB_STATEMENT(name, stmt) { name, stmt, 0 }
+
+/**
+ * @brief libpq event procedure, which creates, clears and frees the statement cache of a connection.
+ * Registered on every connection made by pgdb_connect(). Cache is cleared on PGEVT_CONNRESET, since
+ * prepared statements are gone on server side after a reset.
+ */
+int pgdb_statement_event(PGEventId event, void* info, void* pass_through);
+
+/**
+ * @brief Same as \ref pgdb_execute_param, but prepares \p statement on first use on \p conn and reuses it afterwards.
+ * Cache is cleared when the connection is reset and freed with the connection.
+ * Falls back to \ref pgdb_execute_param if connection wasnt made by \ref pgdb_connect.
+ *
+ * @param conn Connection to database.
+ * @param statement Statement to execute.
+ * @param params Parameters of statement. Types of first call are used for preparing.
+ *
+ * @returns Returns 0 on success.
+ */
+int pgdb_execute_prepared(PGconn* conn, pgdb_statement_t* statement, const pgdb_params_t* params);
+
+/**
+ * @brief Same as \ref pgdb_fetch_param, but prepares \p statement on first use on \p conn and reuses it afterwards.
+ * Falls back to \ref pgdb_fetch_param if connection wasnt made by \ref pgdb_connect.
+ *
+ * @param conn Connection to database.
+ * @param statement Statement to execute.
+ * @param params Parameters of statement. Types of first call are used for preparing.
+ * @param result Result of query. Is freed on failure.
+ *
+ * @returns Returns 0 on success.
+ */
+int pgdb_fetch_prepared(PGconn* conn, pgdb_statement_t* statement, const pgdb_params_t* params, pgdb_result_t** result);
+
+/**
+ * @brief Batch of statements, which are sent to the database in a single round trip using libpq pipeline mode.
+ * Without pipeline support in libpq, or without connection, statements are executed one by one when queued.
+ *
+ * @see pgdb_pipeline_new()
+ * @see pgdb_pipeline_sync()
+ */
+typedef struct pgdb_pipeline {
+	PGconn* conn; /**< Connection in pipeline mode. */
+	bool pipelined; /**< False if statements are executed directly when queued. */
+	int count; /**< Amount of queued statements. */
+	int size; /**< Size of allocated arrays. */
+	ExecStatusType* expected; /**< Expected result status of every queued statement. */
+	int* prepares; /**< Statement id if entry is a PQprepare() sent by the pipeline itself, 0 otherwise. */
+	pgdb_result_t** results; /**< Results of statements queued by the caller. Filled by pgdb_pipeline_sync(). NULL for statements which failed. */
+	int result_count; /**< Amount of entries in results. */
+} pgdb_pipeline_t;
+
+/**
+ * @brief Puts connection into pipeline mode. Connection must be idle.
+ *
+ * @param conn Connection to database.
+ *
+ * @returns Returns new pipeline or NULL if pipeline mode could not be entered.
+ */
+pgdb_pipeline_t* pgdb_pipeline_new(PGconn* conn);
+
+/**
+ * @brief Queues a statement, which is expected to return rows. Results are available after pgdb_pipeline_sync().
+ *
+ * @param pipeline Pipeline to queue statement in.
+ * @param stmt SQL Query statement.
+ * @param params Parameters of statement. Can be freed after queueing.
+ *
+ * @returns Returns 0 on success.
+ */
+int pgdb_pipeline_fetch(pgdb_pipeline_t* pipeline, const char* stmt, const pgdb_params_t* params);
+
+/**
+ * @brief Queues a statement, which is not expected to return rows.
+ *
+ * @see pgdb_pipeline_fetch()
+ */
+int pgdb_pipeline_execute(pgdb_pipeline_t* pipeline, const char* stmt, const pgdb_params_t* params);
+
+/**
+ * @brief Same as pgdb_pipeline_fetch(), but uses the prepared statement cache of the connection.
+ *
+ * @see pgdb_fetch_prepared()
+ */
+int pgdb_pipeline_fetch_prepared(pgdb_pipeline_t* pipeline, pgdb_statement_t* statement, const pgdb_params_t* params);
+
+/**
+ * @brief Same as pgdb_pipeline_execute(), but uses the prepared statement cache of the connection.
+ *
+ * @see pgdb_execute_prepared()
+ */
+int pgdb_pipeline_execute_prepared(pgdb_pipeline_t* pipeline, pgdb_statement_t* statement, const pgdb_params_t* params);
+
+/**
+ * @brief Sends all queued statements and waits for their results. If one statement fails,
+ * the following statements of the same batch are aborted by the database.
+ * Pipeline can be reused afterwards, results are kept until the next call. If the sync itself
+ * cannot be sent, no results are read and all queued statements are dropped.
+ *
+ * @param pipeline Pipeline to synchronize.
+ *
+ * @returns Returns 0 if every statement returned its expected status.
+ */
+int pgdb_pipeline_sync(pgdb_pipeline_t* pipeline);
+
+/**
+ * @brief Takes ownership of result of statement at \p index, in order of queueing.
+ *
+ * @param pipeline Synchronized pipeline.
+ * @param index Index of statement.
+ *
+ * @returns Returns result, which must be freed by the caller, or NULL if statement failed.
+ */
+pgdb_result_t* pgdb_pipeline_take_result(pgdb_pipeline_t* pipeline, const int index);
+
+/**
+ * @brief Leaves pipeline mode and frees all results which havent been taken. Statements queued after the last
+ * pgdb_pipeline_sync() are synchronized first and their results dropped.
+ *
+ * @param pipeline Pointer to pipeline. Is set to NULL.
+ */
+void pgdb_pipeline_free(pgdb_pipeline_t** pipeline);
+
 /**
  * @brief Sends BEGIN command to database.
  *
@@ -224,6 +421,15 @@ void pgdb_bind_uint64(const uint64_t value, pgdb_params_t* params);
  */
 void pgdb_bind_text(const string_t* text, pgdb_params_t* params);
 
+/**
+ * @brief Binds text to query without copying it. \p text must stay unchanged until params
+ * are executed, reset or freed.
+ *
+ * @param text Pointer to text. 
+ * @param param \ref pgdb_params_t struct to use for binding.
+ */
+void pgdb_bind_text_borrowed(const string_t* text, pgdb_params_t* params);
+
 /**
  * @brief Binds text to query.
  *
@@ -234,6 +440,36 @@ void pgdb_bind_text(const string_t* text, pgdb_params_t* params);
  */
 void pgdb_bind_c_str(const char* text, pgdb_params_t* params);
 
+/**
+ * @brief Same as pgdb_bind_text_borrowed(), but for a C string. String literals are always safe to borrow.
+ *
+ * @param text C string. 
+ * @param param \ref pgdb_params_t struct to use for binding.
+ */
+void pgdb_bind_c_str_borrowed(const char* text, pgdb_params_t* params);
+
+/**
+ * @brief Binds raw bytes to query as bytea, without hex or escape encoding. Up to
+ * PGDB_PARAMS_SCRATCH_SIZE bytes are stored inline.
+ *
+ * @param data Bytes to bind.
+ * @param length Amount of bytes.
+ * @param param \ref pgdb_params_t struct to use for binding.
+ *
+ * @returns Returns void. 
+ */
+void pgdb_bind_bytea(const unsigned char* data, const size_t length, pgdb_params_t* params);
+
+/**
+ * @brief Same as pgdb_bind_bytea(), but uses \p data without copying it. \p data must stay unchanged
+ * until params are executed, reset or freed.
+ *
+ * @param data Bytes to bind.
+ * @param length Amount of bytes.
+ * @param param \ref pgdb_params_t struct to use for binding.
+ */
+void pgdb_bind_bytea_borrowed(const unsigned char* data, const size_t length, pgdb_params_t* params);
+
 /**
  * @brief Binds uuid to query.
  *
@@ -339,6 +575,20 @@ int pgdb_get_timestamp(const pgdb_result_t* result, const int row, const char* f
  */
 int pgdb_get_uuid(const pgdb_result_t* result, const int row, const char* field, uuid_t** uuid);
 
+/**
+ * @brief Copies a bytea value into a caller supplied buffer.
+ *
+ * @param result \ref pgdb_params_t containing query result. 
+ * @param row Row index of data.
+ * @param field Name of the column.
+ * @param buffer Buffer to write to.
+ * @param size Size of buffer.
+ * @param length Amount of bytes of value.
+ *
+ * @returns Returns 1 if value is NULL or larger than \p size, otherwise 0 for success.
+ */
+int pgdb_get_bytea(const pgdb_result_t* result, const int row, const char* field, unsigned char* buffer, const size_t size, size_t* length);
+
 /**
  * @brief Retrieves textual representation of enum and converts it to int using
  * the given function.
@@ -365,6 +615,93 @@ int pgdb_get_enum(const pgdb_result_t* result, const int row, const char* field,
  */
 bool pgdb_exists(const pgdb_result_t* result, const char* name, const int row);
 
+/**
+ * @brief Types a column can be decoded to. Comment names the type of the struct member.
+ */
+typedef enum pgdb_column_type {
+	PGDB_COLUMN_TEXT, /**< string_t*, owned by target. */
+	PGDB_COLUMN_UINT32, /**< uint32_t */
+	PGDB_COLUMN_UINT64, /**< uint64_t */
+	PGDB_COLUMN_BOOL, /**< bool */
+	PGDB_COLUMN_TIMESTAMP, /**< time_t */
+	PGDB_COLUMN_UUID, /**< uuid_t*, owned by target. */
+	PGDB_COLUMN_ENUM /**< int, converted by \ref pgdb_column_t.conv */
+} pgdb_column_type_t;
+
+/**
+ * @brief Describes how a column is decoded into a member of a struct.
+ *
+ * @see PGDB_COLUMN()
+ * @see PGDB_COLUMN_OPTIONAL()
+ * @see PGDB_COLUMN_ENUM()
+ */
+typedef struct pgdb_column {
+	const char* name; /**< Name of column in result. */
+	pgdb_column_type_t type; /**< Type of column and member. */
+	size_t offset; /**< Offset of member in target struct. */
+	bool optional; /**< If true, missing columns and NULL values leave member untouched instead of failing. */
+	int (*conv)(const char*); /**< Converts enum label to int. Only used by \ref PGDB_COLUMN_ENUM. */
+} pgdb_column_t;
+
+/**
+ * @brief Initializer for a required \ref pgdb_column_t, decoding column \p name into \p member of \p type.
+ */
+#define PGDB_COLUMN(name, column_type, type, member) { name, column_type, offsetof(type, member), false, NULL }
+
+/**
+ * @brief Same as PGDB_COLUMN(), but column may be missing or NULL.
+ */
+#define PGDB_COLUMN_OPTIONAL(name, column_type, type, member) { name, column_type, offsetof(type, member), true, NULL }
+
+/**
+ * @brief Initializer for a required enum column, converted using \p conv.
+ */
+#define PGDB_COLUMN_ENUM(name, conv, type, member) { name, PGDB_COLUMN_ENUM, offsetof(type, member), false, conv }
+
+/**
+ * @brief Column numbers of a result resolved once for a descriptor table, so rows can be decoded
+ * without looking up columns by name again. Can be used for every result of the same query.
+ *
+ * @see pgdb_row_decoder_new()
+ * @see pgdb_row_decoder_free()
+ */
+typedef struct pgdb_row_decoder {
+	const pgdb_column_t* columns; /**< Descriptor table, not owned. */
+	int count; /**< Amount of columns in descriptor table. */
+	int numbers[]; /**< Column number in result per descriptor, -1 if optional column is missing. */
+} pgdb_row_decoder_t;
+
+/**
+ * @brief Resolves column numbers of \p columns in \p result.
+ *
+ * @param result Result to resolve columns of.
+ * @param columns Descriptor table. Must outlive decoder.
+ * @param count Amount of entries in \p columns.
+ *
+ * @returns Returns new decoder or NULL if a required column is missing.
+ */
+pgdb_row_decoder_t* pgdb_row_decoder_new(const pgdb_result_t* result, const pgdb_column_t* columns, const int count);
+
+/**
+ * @brief Decodes \p row of \p result into the struct pointed to by \p target. Text and uuid members
+ * are allocated and belong to target, also if decoding fails half way.
+ *
+ * @param decoder Decoder created for a result of the same query.
+ * @param result Result to read from.
+ * @param row Row index of data.
+ * @param target Struct to write to.
+ *
+ * @returns Returns 1 if a required value is NULL, otherwise 0 for success.
+ */
+int pgdb_row_decode(const pgdb_row_decoder_t* decoder, const pgdb_result_t* result, const int row, void* target);
+
+/**
+ * @brief Frees decoder.
+ *
+ * @param decoder Double pointer to decoder. Will be set to NULL.
+ */
+void pgdb_row_decoder_free(pgdb_row_decoder_t** decoder);
+
 /**
  * @brief Converts from unix epoch to 01-01-2000 epoch in microseconds.
  *
@@ -389,30 +726,64 @@ time_t pgdb_convert_to_unix_timestamp(const int64_t timestamp);
 typedef struct pgdb_connection {
 	PGconn* connection; /**< Actual connection to database. */
 	bool active; /**< If active, connection has been made to database. This does not guarantee a successfull conneciton, simply that the connection once has been made. */
-	bool claimed; /**< If locked, connection is being used by thread. */
+	bool claimed; /**< If locked, connection is being used by thread or checked by maintenance. */
 	time_t created; /**< Timestamp when connection was made. Used for keeping track of age. */
+	time_t released; /**< Timestamp when connection was last released. Used to decide if an idle connection needs to be pinged. */
+	struct pgdb_connection_queue* queue; /**< Queue owning this connection. NULL if connection is not pooled. */
 } pgdb_connection_t;
 
 /**
  * @brief Struct which contains all connections and is capable of creating new ones or release old ones.
- * @todo Create function which checks in intervalls if there are connections, which must be freed.
+ * Claiming and releasing connections is thread safe.
  */
 typedef struct pgdb_connection_queue {
 	char* conn_info; /**< Connection info required to connect to database. */
+	int min_connections; /**< Amount of connections kept open at all times. */
 	int max_connections; /**< Max amount of simultanious connections. */
-	int64_t max_age; /**< Max age allowed of non active connection. */
+	int64_t max_age; /**< Max age in seconds of a connection before it is recycled. 0 disables recycling. */
+	int64_t claim_timeout; /**< Time in milliseconds pgdb_claim_connection() waits for a connection to be released if all are claimed. 0 returns immediately. */
 	pgdb_connection_t* connections; /**< Array of connections. */
+	pthread_mutex_t lock; /**< Guards active and claimed flags of all connections. */
+	pthread_cond_t released; /**< Signaled every time a connection is released. */
+	pthread_t maintenance; /**< Thread running pgdb_connection_queue_maintain() in intervals. */
+	pthread_cond_t maintenance_wakeup; /**< Signaled to stop maintenance thread. */
+	bool maintenance_running; /**< True while maintenance thread should keep running. */
+	int64_t maintenance_interval; /**< Time in milliseconds between two maintenance runs. */
 } pgdb_connection_queue_t;
 
 /**
- * @brief Creates a new connection queue.
+ * @brief Creates a new connection queue and opens \p min_connections connections right away,
+ * so that the first requests do not pay for the connection handshake.
+ * Connections which could not be opened are retried by pgdb_connection_queue_maintain().
  *
- * @param max_connection Max simultanious connections.
- * @param max_age Max age of a connection which is not being used.
+ * @param connection_info Connection info passed to pgdb_connect().
+ * @param min_connections Amount of connections to keep open. Must not be bigger than \p max_connections.
+ * @param max_connections Max simultanious connections.
+ * @param max_age Max age in seconds of a connection before it is closed and replaced. 0 disables recycling.
  *
  * @returns Pointer to new connection queue.
  */
-pgdb_connection_queue_t* pgdb_connection_queue_new(const char* connection_info, int max_connections, int64_t max_age);
+pgdb_connection_queue_t* pgdb_connection_queue_new(const char* connection_info, int min_connections, int max_connections, int64_t max_age);
+
+/**
+ * @brief Checks every connection which isnt claimed. Connections older than max_age are replaced,
+ * broken connections are reset and connections idle for longer than the maintenance interval are pinged.
+ * Afterwards missing connections are opened until min_connections is reached.
+ *
+ * @param queue Queue to maintain.
+ */
+void pgdb_connection_queue_maintain(pgdb_connection_queue_t* queue);
+
+/**
+ * @brief Starts a thread calling pgdb_connection_queue_maintain() every \p interval milliseconds.
+ * Thread is stopped by pgdb_connection_queue_free().
+ *
+ * @param queue Queue to maintain.
+ * @param interval Time in milliseconds between two runs.
+ *
+ * @returns Returns 0 on success.
+ */
+int pgdb_connection_queue_start_maintenance(pgdb_connection_queue_t* queue, int64_t interval);
 
 /**
  * @brief Frees a connection queue.
@@ -422,19 +793,34 @@ pgdb_connection_queue_t* pgdb_connection_queue_new(const char* connection_info,
 void pgdb_connection_queue_free(pgdb_connection_queue_t** queue);
 
 /**
- * @brief Checks if there is a free connection in queue. If not returns NULL.
+ * @brief Checks if there is a free connection in queue. If all connections are claimed,
+ * waits up to \ref pgdb_connection_queue_t.claim_timeout milliseconds for one to be released.
  *
  * @param queue Queue to take connection from.
  * @param conn Connection which will be claimed. NULL if none could be found.
  *
  * @returns Returns 0 on success. If non is found, 0 is also returned. For failures like, connection could not be made to database, 1 is returned.
  *
+ * @see pgdb_claim_connection_timed()
  * @see pgdb_release_connection()
  */
 int pgdb_claim_connection(pgdb_connection_queue_t* queue, pgdb_connection_t** conn);
 
 /**
- * @brief Releases a connection and makes it available by pgdb_claim_connection()
+ * @brief Same as \ref pgdb_claim_connection but waits up to \p timeout milliseconds instead of
+ * \ref pgdb_connection_queue_t.claim_timeout.
+ *
+ * @param queue Queue to take connection from.
+ * @param timeout Time in milliseconds to wait for a connection to be released. 0 returns immediately.
+ * @param conn Connection which will be claimed. NULL if none could be found in time.
+ *
+ * @returns Returns 0 on success. If non is found, 0 is also returned. For failures like, connection could not be made to database, 1 is returned.
+ */
+int pgdb_claim_connection_timed(pgdb_connection_queue_t* queue, const int64_t timeout, pgdb_connection_t** conn);
+
+/**
+ * @brief Releases a connection, makes it available by pgdb_claim_connection() and wakes up one waiting thread.
+ * Open transactions are rolled back. Broken connections are closed, so that the next claim reconnects.
  *
  * @see pgdb_claim_connection()
  */
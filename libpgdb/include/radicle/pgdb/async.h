@@ -0,0 +1,118 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Non blocking queries, which are completed by a reactor thread multiplexing many connections with epoll.
+ * @author Nils Egger
+ * @addtogroup pgdb
+ * @{
+ */
+
+#ifndef RADICLE_PGDB_INCLUDE_RADICLE_PGDB_ASYNC_H
+#define RADICLE_PGDB_INCLUDE_RADICLE_PGDB_ASYNC_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/pgdb.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Called by reactor thread once a query has completed.
+ *
+ * @param status 0 if query returned its expected status, 1 otherwise.
+ * @param result Result of query. Ownership is passed to callback. NULL if query failed.
+ * @param user_data Pointer passed when query was sent.
+ */
+typedef void (*pgdb_async_callback_t)(int status, pgdb_result_t* result, void* user_data);
+
+/**
+ * @brief A query which has been sent and is waiting for its result.
+ */
+typedef struct pgdb_async_query {
+	PGconn* conn; /**< Connection query was sent on. */
+	ExecStatusType expected; /**< Expected result status. */
+	PGresult* result; /**< First result returned by query. */
+	pgdb_async_callback_t callback; /**< Callback receiving result. */
+	void* user_data; /**< Passed to callback. */
+	struct pgdb_async_query* prev; /**< Previous query in flight. */
+	struct pgdb_async_query* next; /**< Next query in flight. */
+} pgdb_async_query_t;
+
+/**
+ * @brief Thread waiting with epoll on the sockets of all connections with a query in flight.
+ */
+typedef struct pgdb_reactor {
+	int epoll; /**< Epoll instance. */
+	int wakeup; /**< Eventfd used to wake up reactor thread on shutdown. */
+	pthread_t thread; /**< Reactor thread. */
+	pthread_mutex_t lock; /**< Guards running and in_flight. */
+	bool running; /**< False once reactor is being freed. */
+	pgdb_async_query_t* in_flight; /**< List of queries which havent completed yet. */
+} pgdb_reactor_t;
+
+/**
+ * @brief Creates epoll instance and starts reactor thread.
+ *
+ * @returns Returns new reactor or NULL on failure.
+ */
+pgdb_reactor_t* pgdb_reactor_new();
+
+/**
+ * @brief Stops reactor thread. Queries still in flight are cancelled and their callbacks called with failure.
+ *
+ * @param reactor Pointer to reactor. Is set to NULL.
+ */
+void pgdb_reactor_free(pgdb_reactor_t** reactor);
+
+/**
+ * @brief Sends query expected to return rows without waiting for the result. \p callback is called by
+ * the reactor thread once the result has arrived. \p conn must not be used until then, for example it should
+ * only be released back to its queue by the callback.
+ *
+ * @param reactor Reactor completing query.
+ * @param conn Connection which is idle.
+ * @param stmt SQL Query statement.
+ * @param params Parameters of statement. Can be freed right after.
+ * @param callback Called with result.
+ * @param user_data Passed to callback.
+ *
+ * @returns Returns 0 if query has been sent. On failure, callback isnt called.
+ */
+int pgdb_async_fetch(pgdb_reactor_t* reactor, PGconn* conn, const char* stmt, const pgdb_params_t* params, pgdb_async_callback_t callback, void* user_data);
+
+/**
+ * @brief Same as \ref pgdb_async_fetch, but for queries which dont return rows.
+ *
+ * @see pgdb_async_fetch()
+ */
+int pgdb_async_execute(pgdb_reactor_t* reactor, PGconn* conn, const char* stmt, const pgdb_params_t* params, pgdb_async_callback_t callback, void* user_data);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_PGDB_INCLUDE_RADICLE_PGDB_ASYNC_H
+
+/** @} */
@@ -0,0 +1,115 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Bulk writer streaming rows in binary COPY format.
+ * @author Nils Egger
+ * @addtogroup pgdb
+ * @{
+ */
+
+#ifndef RADICLE_PGDB_INCLUDE_RADICLE_PGDB_COPY_H
+#define RADICLE_PGDB_INCLUDE_RADICLE_PGDB_COPY_H
+
+#include <stddef.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/pgdb.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Collects rows bound with the pgdb_bind_* functions and writes them with a single COPY statement
+ * once \ref pgdb_copy_writer_t.max_rows rows or \ref pgdb_copy_writer_t.max_bytes bytes are buffered.
+ * Every flush is a complete COPY, so the connection is usable by others between two flushes.
+ *
+ * @see pgdb_copy_writer_new()
+ */
+typedef struct pgdb_copy_writer {
+	PGconn* conn; /**< Connection used for flushing. Can be changed between flushes. */
+	char* stmt; /**< COPY ... FROM STDIN (FORMAT binary) statement. */
+	int columns; /**< Amount of columns of every row. */
+	int max_rows; /**< Amount of rows after which buffer is flushed. */
+	size_t max_bytes; /**< Size of buffer after which it is flushed. */
+	int rows; /**< Amount of rows currently buffered. */
+	char* buffer; /**< Header and encoded rows. */
+	size_t length; /**< Used length of buffer. */
+	size_t capacity; /**< Allocated size of buffer. */
+	pgdb_params_t* row; /**< Builder handed out by pgdb_copy_writer_row(). */
+} pgdb_copy_writer_t;
+
+/**
+ * @brief Creates a new writer for rows of \p columns columns.
+ *
+ * @param conn Connection to database. Can be NULL and set before first flush.
+ * @param table Table and column list, e.g. "SessionAccesses(session_id, url)".
+ * @param columns Amount of columns in \p table.
+ * @param max_rows Flush after this many rows. 0 disables the limit.
+ * @param max_bytes Flush after this many bytes. 0 disables the limit.
+ *
+ * @returns Returns pointer to new writer.
+ */
+pgdb_copy_writer_t* pgdb_copy_writer_new(PGconn* conn, const char* table, const int columns, const int max_rows, const size_t max_bytes);
+
+/**
+ * @brief Appends a row and flushes if a threshold is reached. Unbound parameters are written as NULL.
+ *
+ * @param writer Writer to append to.
+ * @param row Parameters bound with pgdb_bind_*. Must contain \ref pgdb_copy_writer_t.columns parameters.
+ *
+ * @returns Returns 0 on success. Returns 1 if row is invalid or flushing failed.
+ */
+int pgdb_copy_writer_add(pgdb_copy_writer_t* writer, const pgdb_params_t* row);
+
+/**
+ * @brief Hands out a reset builder of \ref pgdb_copy_writer_t.columns parameters owned by writer, so
+ * adding a row does not need any allocation. Valid until next call or until writer is freed.
+ *
+ * @param writer Writer owning builder.
+ *
+ * @returns Returns params without any bound values.
+ */
+pgdb_params_t* pgdb_copy_writer_row(pgdb_copy_writer_t* writer);
+
+/**
+ * @brief Writes all buffered rows using a single COPY statement. Rows are dropped on failure.
+ *
+ * @param writer Writer to flush.
+ *
+ * @returns Returns 0 on success or if nothing was buffered.
+ */
+int pgdb_copy_writer_flush(pgdb_copy_writer_t* writer);
+
+/**
+ * @brief Flushes remaining rows and frees writer.
+ *
+ * @param writer Pointer to writer. Is set to NULL.
+ */
+void pgdb_copy_writer_free(pgdb_copy_writer_t** writer);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_PGDB_INCLUDE_RADICLE_PGDB_COPY_H
+
+/** @} */
@@ -0,0 +1,122 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ * @brief Row by row fetching of large result sets.
+ * @author Nils Egger
+ * @addtogroup pgdb
+ * @{
+ */
+
+#ifndef RADICLE_PGDB_INCLUDE_RADICLE_PGDB_STREAM_H
+#define RADICLE_PGDB_INCLUDE_RADICLE_PGDB_STREAM_H
+
+#include <stdbool.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/pgdb.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Query whose rows are received in chunks instead of a single result, so memory stays
+ * constant no matter how many rows are returned. Uses chunked rows mode if libpq supports it,
+ * otherwise single row mode. The connection is busy until the stream is freed.
+ *
+ * @see pgdb_stream_open()
+ * @see pgdb_stream_next()
+ * @see pgdb_stream_free()
+ */
+typedef struct pgdb_stream {
+	PGconn* conn; /**< Connection query runs on. */
+	pgdb_result_t* result; /**< Chunk containing current row. Freed once stream moves past its last row. */
+	int row; /**< Index of current row in \ref pgdb_stream_t.result. */
+	bool done; /**< True once all results of the query have been received. */
+	bool failed; /**< True if query failed, also if some rows were received before. */
+} pgdb_stream_t;
+
+/**
+ * @brief Called for every row by pgdb_stream_each().
+ *
+ * @param result Chunk containing row. Only valid during the call.
+ * @param row Index of row in \p result.
+ * @param data User data passed to pgdb_stream_each().
+ *
+ * @returns Returns 0 to continue, anything else stops the stream.
+ */
+typedef int (*pgdb_stream_callback_t)(const pgdb_result_t* result, const int row, void* data);
+
+/**
+ * @brief Sends query and switches connection into chunked or single row mode. Statement is not
+ * prepared, since large result sets are dominated by transfer and not by planning.
+ *
+ * @param conn Idle connection to database.
+ * @param stmt Query returning rows.
+ * @param params Parameters of query. Can be NULL if query has none.
+ * @param chunk_rows Max amount of rows per chunk. Values below 2 and libpq versions without
+ * chunked rows mode receive one row per chunk.
+ *
+ * @returns Returns new stream or NULL if query couldnt be sent.
+ */
+pgdb_stream_t* pgdb_stream_open(PGconn* conn, const char* stmt, const pgdb_params_t* params, const int chunk_rows);
+
+/**
+ * @brief Moves stream to the next row, receiving the next chunk if needed. Values of the current row are
+ * read with the pgdb_get_* functions or pgdb_row_decode() on \ref pgdb_stream_t.result at
+ * \ref pgdb_stream_t.row. A \ref pgdb_row_decoder_t created for the first chunk works for all others.
+ *
+ * @param stream Stream to advance.
+ *
+ * @returns Returns true if there is a row, false once all rows were read or the query failed.
+ * Check \ref pgdb_stream_t.failed to tell both apart.
+ */
+bool pgdb_stream_next(pgdb_stream_t* stream);
+
+/**
+ * @brief Runs query and calls \p callback for every row.
+ *
+ * @param conn Idle connection to database.
+ * @param stmt Query returning rows.
+ * @param params Parameters of query. Can be NULL if query has none.
+ * @param chunk_rows Max amount of rows per chunk, see pgdb_stream_open().
+ * @param callback Called for every row.
+ * @param data Passed to \p callback.
+ *
+ * @returns Returns 0 if all rows were passed to callback. Returns 1 if query failed or callback stopped it.
+ */
+int pgdb_stream_each(PGconn* conn, const char* stmt, const pgdb_params_t* params, const int chunk_rows, pgdb_stream_callback_t callback, void* data);
+
+/**
+ * @brief Frees stream. If not all rows were read, the query is cancelled and the remaining results
+ * are discarded, so connection can be used again afterwards.
+ *
+ * @param stream Double pointer to stream. Will be set to NULL.
+ */
+void pgdb_stream_free(pgdb_stream_t** stream);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // RADICLE_PGDB_INCLUDE_RADICLE_PGDB_STREAM_H
+
+/** @} */
@@ -17,38 +17,125 @@
  */
 
 #include <libpq-fe.h>
+#include <libpq-events.h>
 #include <postgres_ext.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
 
+#include "radicle/clock.h"
 #include "radicle/pgdb.h"
 #include "radicle/types/string.h"
 #include "radicle/types/uuid.h"
 
+/**
+ * @brief Size of params struct together with all of its arrays.
+ */
+static size_t pgdb_params_size(const int count) {
+	return sizeof(pgdb_params_t) + count * (sizeof(char*) + PGDB_PARAMS_SCRATCH_SIZE + sizeof(Oid) + 2 * sizeof(int) + sizeof(bool));
+}
+
+/**
+ * @brief Points arrays of params into the zeroed memory right behind it. Pointers come first,
+ * so every array stays aligned.
+ */
+static pgdb_params_t* pgdb_params_layout(pgdb_params_t* params, const int count) {
+	char* iter = (char*) (params + 1);
+	params->count = count;
+	params->values = (char**) iter;
+	iter += count * sizeof(char*);
+	params->scratch = (char (*)[PGDB_PARAMS_SCRATCH_SIZE]) iter;
+	iter += count * PGDB_PARAMS_SCRATCH_SIZE;
+	params->types = (Oid*) iter;
+	iter += count * sizeof(Oid);
+	params->lengths = (int*) iter;
+	iter += count * sizeof(int);
+	params->formats = (int*) iter;
+	iter += count * sizeof(int);
+	params->owned = (bool*) iter;
+	return params;
+}
+
 pgdb_params_t* pgdb_params_new(const int count) {
-	pgdb_params_t* buf = calloc(1, sizeof(pgdb_params_t));
-	buf->count = count;
-	buf->types = calloc(count, sizeof(Oid));
-	buf->values = calloc(count, sizeof(char*));
-	buf->lengths = calloc(count, sizeof(int));
-	buf->formats = calloc(count, sizeof(int));
-	return buf;
+	return pgdb_params_layout(calloc(1, pgdb_params_size(count)), count);
+}
+
+pgdb_params_t* pgdb_params_new_arena(arena_t* arena, const int count) {
+	pgdb_params_t* buf = arena_alloc(arena, pgdb_params_size(count));
+	if(buf == NULL)
+		return NULL;
+	buf->arena = arena;
+	return pgdb_params_layout(buf, count);
+}
+
+/**
+ * @brief Frees values which were copied to the heap.
+ */
+static void pgdb_params_release(pgdb_params_t* params) {
+	for(int i = 0; i < params->count; i++) {
+		if(params->owned[i])
+			free(params->values[i]);
+	}
+}
+
+void pgdb_params_reset(pgdb_params_t* params) {
+	pgdb_params_release(params);
+	memset(params->values, 0, params->count * sizeof(char*));
+	memset(params->lengths, 0, params->count * sizeof(int));
+	memset(params->formats, 0, params->count * sizeof(int));
+	memset(params->owned, 0, params->count * sizeof(bool));
+	params->next_index = 0;
 }
 
 void pgdb_params_free(pgdb_params_t** ptr) {
 	if(*ptr == NULL) return;
-	free((*ptr)->types);
-	for(int i = 0; i < (*ptr)->count; i++) {
-		free((*ptr)->values[i]);
-	}
-	free((*ptr)->values);
-	free((*ptr)->lengths);
-	free((*ptr)->formats);
-	free(*ptr);
+	pgdb_params_release(*ptr);
+	// Arrays live in the same allocation, arena memory is released with arena.
+	if((*ptr)->arena == NULL)
+		free(*ptr);
 	*ptr = NULL;
 }
 
+/**
+ * @brief Sets next value of params.
+ */
+static void pgdb_params_set(pgdb_params_t* params, const void* value, const size_t length) {
+	params->values[params->next_index] = (char*) value;
+	params->lengths[params->next_index] = length;
+	params->formats[params->next_index] = 1;
+	params->next_index++;
+}
+
+/**
+ * @brief Binds fixed width value by copying it into scratch slot of next index.
+ */
+static void pgdb_params_set_inline(pgdb_params_t* params, const void* value, const size_t length) {
+	memcpy(params->scratch[params->next_index], value, length);
+	pgdb_params_set(params, params->scratch[params->next_index], length);
+}
+
+/**
+ * @brief Binds a copy of value, placed in scratch slot if it fits, otherwise in arena or on the heap.
+ */
+static void pgdb_params_set_copy(pgdb_params_t* params, const void* value, const size_t length) {
+	if(length <= PGDB_PARAMS_SCRATCH_SIZE) {
+		pgdb_params_set_inline(params, value, length);
+		return;
+	}
+
+	char* buffer;
+	if(params->arena != NULL) {
+		buffer = arena_alloc(params->arena, length);
+	} else {
+		buffer = malloc(length);
+		params->owned[params->next_index] = true;
+	}
+	memcpy(buffer, value, length);
+	pgdb_params_set(params, buffer, length);
+}
+
 pgdb_result_t* pgdb_result_new(PGresult* result) {
 	pgdb_result_t* buf = calloc(1, sizeof(pgdb_result_t));
 	buf->pg= result;
@@ -62,6 +149,50 @@ void pgdb_result_free(pgdb_result_t** result) {
 	*result = NULL;
 }
 
+/**
+ * @brief Prepared statements of a single connection. Attached to PGconn as libpq instance data.
+ */
+typedef struct pgdb_statement_cache {
+	bool* prepared; /**< Indexed by \ref pgdb_statement_t.id */
+	int size; /**< Size of prepared. */
+} pgdb_statement_cache_t;
+
+/**
+ * @brief Last id handed out to a \ref pgdb_statement_t.
+ */
+static int pgdb_statement_ids = 0;
+
+int pgdb_statement_event(PGEventId event, void* info, void* pass_through) {
+	switch(event) {
+		case PGEVT_REGISTER: {
+			PGconn* conn = ((PGEventRegister*) info)->conn;
+			pgdb_statement_cache_t* cache = calloc(1, sizeof(pgdb_statement_cache_t));
+			if(cache == NULL)
+				return 0;
+			PQsetInstanceData(conn, pgdb_statement_event, cache);
+			break;
+		}
+		case PGEVT_CONNRESET: {
+			// Prepared statements are gone on server side after a reset.
+			pgdb_statement_cache_t* cache = PQinstanceData(((PGEventConnReset*) info)->conn, pgdb_statement_event);
+			if(cache != NULL && cache->prepared != NULL)
+				memset(cache->prepared, 0, cache->size * sizeof(bool));
+			break;
+		}
+		case PGEVT_CONNDESTROY: {
+			pgdb_statement_cache_t* cache = PQinstanceData(((PGEventConnDestroy*) info)->conn, pgdb_statement_event);
+			if(cache != NULL) {
+				free(cache->prepared);
+				free(cache);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+	return 1;
+}
+
 int pgdb_connect(const char* conninfo, PGconn** connection) {
 	*connection = PQconnectdb(conninfo);
 	ConnStatusType status = PQstatus(*connection);
@@ -71,9 +202,28 @@ int pgdb_connect(const char* conninfo, PGconn** connection) {
 		*connection = NULL;
 		return EXIT_FAILURE;
 	}
+
+	if(PQregisterEventProc(*connection, pgdb_statement_event, "pgdb_statement_cache", NULL) == 0) {
+		ERROR("Failed to register statement cache. Prepared statements will be parsed on every call.\n");
+	}
 	return 0;
 }
 
+int pgdb_reconnect(const char* conninfo, PGconn** connection) {
+	if(*connection != NULL && PQstatus(*connection) == CONNECTION_OK)
+		return 0;
+
+	if(*connection != NULL) {
+		PQreset(*connection);
+		if(PQstatus(*connection) == CONNECTION_OK)
+			return 0;
+		PQfinish(*connection);
+		*connection = NULL;
+	}
+
+	return pgdb_connect(conninfo, connection);
+}
+
 const char* pgdb_ping_info(const char* conninfo, PGPing* status) {
 	*status = PQping(conninfo);	
 	switch(*status) {
@@ -154,6 +304,307 @@ int pgdb_fetch_param(PGconn* conn, const char* stmt, const pgdb_params_t* params
 	return pgdb_manage_query(result, PGRES_TUPLES_OK);	
 }
 
+/**
+ * @brief Returns id of \p statement and assigns a new one if it has none yet.
+ */
+static int pgdb_statement_id(pgdb_statement_t* statement) {
+	int id = __atomic_load_n(&statement->id, __ATOMIC_ACQUIRE);
+	if(id != 0)
+		return id;
+	int fresh = __atomic_add_fetch(&pgdb_statement_ids, 1, __ATOMIC_RELAXED);
+	// If another thread was faster, its id is loaded into id.
+	if(__atomic_compare_exchange_n(&statement->id, &id, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		return fresh;
+	return id;
+}
+
+/**
+ * @brief Makes sure \p cache can hold statement \p id.
+ *
+ * @returns Returns 0 on success.
+ */
+static int pgdb_statement_cache_reserve(pgdb_statement_cache_t* cache, const int id) {
+	if(id < cache->size)
+		return 0;
+	int size = id + 16;
+	bool* prepared = realloc(cache->prepared, size * sizeof(bool));
+	if(prepared == NULL)
+		return 1;
+	memset(prepared + cache->size, 0, (size - cache->size) * sizeof(bool));
+	cache->prepared = prepared;
+	cache->size = size;
+	return 0;
+}
+
+/**
+ * @brief Prepares \p statement on \p conn if it hasnt been yet and executes it.
+ *
+ * @returns Returns result of PQexecPrepared() or of PQprepare() if preparing failed.
+ */
+static PGresult* pgdb_exec_prepared(PGconn* conn, pgdb_statement_cache_t* cache, pgdb_statement_t* statement, const pgdb_params_t* params) {
+	int id = pgdb_statement_id(statement);
+	if(pgdb_statement_cache_reserve(cache, id))
+		return NULL;
+
+	if(!cache->prepared[id]) {
+		PGresult* prepare = PQprepare(conn, statement->name, statement->stmt, params->count, params->types);
+		if(PQresultStatus(prepare) != PGRES_COMMAND_OK)
+			return prepare;
+		PQclear(prepare);
+		cache->prepared[id] = true;
+	}
+
+	return PQexecPrepared(conn, statement->name, params->count, (const char* const*)params->values, params->lengths, params->formats, 1);
+}
+
+int pgdb_execute_prepared(PGconn* conn, pgdb_statement_t* statement, const pgdb_params_t* params) {
+	pgdb_statement_cache_t* cache = conn != NULL ? PQinstanceData(conn, pgdb_statement_event) : NULL;
+	if(cache == NULL)
+		return pgdb_execute_param(conn, statement->stmt, params);
+
+	pgdb_result_t* result = pgdb_result_new(pgdb_exec_prepared(conn, cache, statement, params));
+	int r = pgdb_manage_query(&result, PGRES_COMMAND_OK);	
+	pgdb_result_free(&result);
+	return r;
+}
+
+int pgdb_fetch_prepared(PGconn* conn, pgdb_statement_t* statement, const pgdb_params_t* params, pgdb_result_t** result) {
+	pgdb_statement_cache_t* cache = conn != NULL ? PQinstanceData(conn, pgdb_statement_event) : NULL;
+	if(cache == NULL)
+		return pgdb_fetch_param(conn, statement->stmt, params, result);
+
+	*result = pgdb_result_new(pgdb_exec_prepared(conn, cache, statement, params));
+	return pgdb_manage_query(result, PGRES_TUPLES_OK);	
+}
+
+pgdb_pipeline_t* pgdb_pipeline_new(PGconn* conn) {
+	pgdb_pipeline_t* pipeline = calloc(1, sizeof(pgdb_pipeline_t));
+	pipeline->conn = conn;
+	pipeline->pipelined = false;
+#ifdef LIBPQ_HAS_PIPELINING
+	if(conn != NULL) {
+		if(PQenterPipelineMode(conn) == 0) {
+			ERROR("Failed to enter pipeline mode: %s\n", PQerrorMessage(conn));
+			free(pipeline);
+			return NULL;
+		}
+		pipeline->pipelined = true;
+	}
+#endif
+	return pipeline;
+}
+
+/**
+ * @brief Makes room for one more entry. Frees results of previous batch if this is the first entry of a new one.
+ *
+ * @returns Returns 0 on success.
+ */
+static int pgdb_pipeline_reserve(pgdb_pipeline_t* pipeline) {
+	if(pipeline->count == 0) {
+		for(int i = 0; i < pipeline->result_count; i++)
+			pgdb_result_free(&pipeline->results[i]);
+		pipeline->result_count = 0;
+	}
+
+	if(pipeline->count < pipeline->size)
+		return 0;
+
+	int size = pipeline->size == 0 ? 8 : pipeline->size * 2;
+	ExecStatusType* expected = realloc(pipeline->expected, size * sizeof(ExecStatusType));
+	if(expected == NULL)
+		return 1;
+	pipeline->expected = expected;
+	int* prepares = realloc(pipeline->prepares, size * sizeof(int));
+	if(prepares == NULL)
+		return 1;
+	pipeline->prepares = prepares;
+	pgdb_result_t** results = realloc(pipeline->results, size * sizeof(pgdb_result_t*));
+	if(results == NULL)
+		return 1;
+	pipeline->results = results;
+	pipeline->size = size;
+	return 0;
+}
+
+/**
+ * @brief Stores result of a statement which has been executed directly, because pipeline mode isnt available.
+ */
+static void pgdb_pipeline_store(pgdb_pipeline_t* pipeline, PGresult* pg, const ExecStatusType expected) {
+	pgdb_result_t* result = pgdb_result_new(pg);
+	pgdb_manage_query(&result, expected);
+	pipeline->expected[pipeline->count] = expected;
+	pipeline->prepares[pipeline->count] = 0;
+	pipeline->count++;
+	pipeline->results[pipeline->result_count++] = result;
+}
+
+/**
+ * @brief Remembers a statement which has been sent to the database.
+ */
+static void pgdb_pipeline_push(pgdb_pipeline_t* pipeline, const ExecStatusType expected, const int prepare) {
+	pipeline->expected[pipeline->count] = expected;
+	pipeline->prepares[pipeline->count] = prepare;
+	pipeline->count++;
+}
+
+static int pgdb_pipeline_send(pgdb_pipeline_t* pipeline, const char* stmt, const pgdb_params_t* params, const ExecStatusType expected) {
+	if(pgdb_pipeline_reserve(pipeline))
+		return 1;
+
+	if(!pipeline->pipelined) {
+		pgdb_pipeline_store(pipeline, PQexecParams(pipeline->conn, stmt, params->count, params->types, (const char* const*)params->values, params->lengths, params->formats, 1), expected);
+		return 0;
+	}
+
+	if(PQsendQueryParams(pipeline->conn, stmt, params->count, params->types, (const char* const*)params->values, params->lengths, params->formats, 1) == 0) {
+		ERROR("Failed to queue statement: %s\n", PQerrorMessage(pipeline->conn));
+		return 1;
+	}
+	pgdb_pipeline_push(pipeline, expected, 0);
+	return 0;
+}
+
+static int pgdb_pipeline_send_prepared(pgdb_pipeline_t* pipeline, pgdb_statement_t* statement, const pgdb_params_t* params, const ExecStatusType expected) {
+	pgdb_statement_cache_t* cache = pipeline->conn != NULL ? PQinstanceData(pipeline->conn, pgdb_statement_event) : NULL;
+	if(cache == NULL)
+		return pgdb_pipeline_send(pipeline, statement->stmt, params, expected);
+
+	if(pgdb_pipeline_reserve(pipeline))
+		return 1;
+
+	if(!pipeline->pipelined) {
+		pgdb_pipeline_store(pipeline, pgdb_exec_prepared(pipeline->conn, cache, statement, params), expected);
+		return 0;
+	}
+
+	int id = pgdb_statement_id(statement);
+	if(pgdb_statement_cache_reserve(cache, id))
+		return 1;
+
+	if(!cache->prepared[id]) {
+		if(PQsendPrepare(pipeline->conn, statement->name, statement->stmt, params->count, params->types) == 0) {
+			ERROR("Failed to queue prepare: %s\n", PQerrorMessage(pipeline->conn));
+			return 1;
+		}
+		// Marked optimistically, so later statements of the same batch dont prepare again. Reverted by sync on failure.
+		cache->prepared[id] = true;
+		pgdb_pipeline_push(pipeline, PGRES_COMMAND_OK, id);
+		if(pgdb_pipeline_reserve(pipeline))
+			return 1;
+	}
+
+	if(PQsendQueryPrepared(pipeline->conn, statement->name, params->count, (const char* const*)params->values, params->lengths, params->formats, 1) == 0) {
+		ERROR("Failed to queue statement: %s\n", PQerrorMessage(pipeline->conn));
+		return 1;
+	}
+	pgdb_pipeline_push(pipeline, expected, 0);
+	return 0;
+}
+
+int pgdb_pipeline_fetch(pgdb_pipeline_t* pipeline, const char* stmt, const pgdb_params_t* params) {
+	return pgdb_pipeline_send(pipeline, stmt, params, PGRES_TUPLES_OK);
+}
+
+int pgdb_pipeline_execute(pgdb_pipeline_t* pipeline, const char* stmt, const pgdb_params_t* params) {
+	return pgdb_pipeline_send(pipeline, stmt, params, PGRES_COMMAND_OK);
+}
+
+int pgdb_pipeline_fetch_prepared(pgdb_pipeline_t* pipeline, pgdb_statement_t* statement, const pgdb_params_t* params) {
+	return pgdb_pipeline_send_prepared(pipeline, statement, params, PGRES_TUPLES_OK);
+}
+
+int pgdb_pipeline_execute_prepared(pgdb_pipeline_t* pipeline, pgdb_statement_t* statement, const pgdb_params_t* params) {
+	return pgdb_pipeline_send_prepared(pipeline, statement, params, PGRES_COMMAND_OK);
+}
+
+int pgdb_pipeline_sync(pgdb_pipeline_t* pipeline) {
+	int failed = 0;
+	if(!pipeline->pipelined) {
+		for(int i = 0; i < pipeline->result_count; i++) {
+			if(pipeline->results[i] == NULL)
+				failed = 1;
+		}
+		pipeline->count = 0;
+		return failed;
+	}
+
+#ifdef LIBPQ_HAS_PIPELINING
+	pgdb_statement_cache_t* cache = PQinstanceData(pipeline->conn, pgdb_statement_event);
+	if(PQpipelineSync(pipeline->conn) == 0) {
+		ERROR("Failed to send pipeline sync: %s\n", PQerrorMessage(pipeline->conn));
+		// No sync was requested, so waiting for results could block forever. Nothing got prepared either.
+		for(int i = 0; i < pipeline->count; i++) {
+			if(pipeline->prepares[i] != 0 && cache != NULL)
+				cache->prepared[pipeline->prepares[i]] = false;
+		}
+		pipeline->count = 0;
+		return 1;
+	}
+
+	for(int i = 0; i < pipeline->count; i++) {
+		PGresult* pg = PQgetResult(pipeline->conn);
+		// Results of every statement are terminated by NULL.
+		PGresult* end = NULL;
+		while((end = PQgetResult(pipeline->conn)) != NULL)
+			PQclear(end);
+
+		if(pipeline->prepares[i] != 0) {
+			if(PQresultStatus(pg) != PGRES_COMMAND_OK) {
+				DEBUG("%s: %s\n", PQresStatus(PQresultStatus(pg)), PQresultErrorMessage(pg));
+				if(cache != NULL)
+					cache->prepared[pipeline->prepares[i]] = false;
+				failed = 1;
+			}
+			PQclear(pg);
+			continue;
+		}
+
+		pgdb_result_t* result = pgdb_result_new(pg);
+		if(pgdb_manage_query(&result, pipeline->expected[i]))
+			failed = 1;
+		pipeline->results[pipeline->result_count++] = result;
+	}
+
+	PGresult* sync = PQgetResult(pipeline->conn);
+	if(PQresultStatus(sync) != PGRES_PIPELINE_SYNC) {
+		ERROR("Pipeline did not end with sync.\n");
+		failed = 1;
+	}
+	PQclear(sync);
+#endif
+
+	pipeline->count = 0;
+	return failed;
+}
+
+pgdb_result_t* pgdb_pipeline_take_result(pgdb_pipeline_t* pipeline, const int index) {
+	if(index < 0 || index >= pipeline->result_count)
+		return NULL;
+	pgdb_result_t* result = pipeline->results[index];
+	pipeline->results[index] = NULL;
+	return result;
+}
+
+void pgdb_pipeline_free(pgdb_pipeline_t** pipeline) {
+	if(*pipeline == NULL) return;
+	if((*pipeline)->count > 0)
+		pgdb_pipeline_sync(*pipeline);
+
+#ifdef LIBPQ_HAS_PIPELINING
+	if((*pipeline)->pipelined && PQexitPipelineMode((*pipeline)->conn) == 0) {
+		ERROR("Failed to exit pipeline mode: %s\n", PQerrorMessage((*pipeline)->conn));
+	}
+#endif
+
+	for(int i = 0; i < (*pipeline)->result_count; i++)
+		pgdb_result_free(&(*pipeline)->results[i]);
+	free((*pipeline)->expected);
+	free((*pipeline)->prepares);
+	free((*pipeline)->results);
+	free(*pipeline);
+	*pipeline = NULL;
+}
+
 int pgdb_transaction_begin(PGconn* conn) {
 	return pgdb_execute(conn, "BEGIN;");
 }
@@ -171,71 +622,68 @@ void pgdb_bind_null(pgdb_params_t* params) {
 }
 
 void pgdb_bind_uint32(int value, pgdb_params_t* params) {
-	uint32_t* buffer = malloc(sizeof(uint32_t));
-	*buffer = htonl((uint32_t)value);
-
-	params->values[params->next_index] = (char*)buffer;
-	params->lengths[params->next_index] = sizeof(uint32_t);
-	params->formats[params->next_index] = 1;
-	params->next_index++;
+	uint32_t buffer = htonl((uint32_t)value);
+	pgdb_params_set_inline(params, &buffer, sizeof(uint32_t));
 }
 
 void pgdb_bind_uint64(const uint64_t value, pgdb_params_t* params) {
-	uint32_t* buffer = malloc(sizeof(uint64_t));
-	*buffer = htonll((uint64_t)(value));
-
-	params->values[params->next_index] = (char*)buffer;
-	params->lengths[params->next_index] = sizeof(uint64_t);
-	params->formats[params->next_index] = 1;
-	params->next_index++;
+	uint64_t buffer = htonll(value);
+	pgdb_params_set_inline(params, &buffer, sizeof(uint64_t));
 }
 
 void pgdb_bind_text(const string_t* text, pgdb_params_t* params) {
-	params->lengths[params->next_index] = text->length;
-	params->values[params->next_index] = calloc(text->length, sizeof(char));
-	params->formats[params->next_index] = 1;
+	pgdb_params_set_copy(params, text->ptr, text->length);
+}
 
-	memcpy(params->values[params->next_index], text->ptr, text->length);
-	params->next_index++;
+void pgdb_bind_text_borrowed(const string_t* text, pgdb_params_t* params) {
+	// Empty strings may come without buffer, which would be sent as NULL.
+	if(text->ptr == NULL)
+		pgdb_params_set_inline(params, "", 0);
+	else
+		pgdb_params_set(params, text->ptr, text->length);
 }
 
 void pgdb_bind_c_str(const char* text, pgdb_params_t* params) {
-	params->lengths[params->next_index] = strlen(text);
-	params->values[params->next_index] = strdup(text);
-	params->formats[params->next_index] = 1;
-	params->next_index++;
+	pgdb_params_set_copy(params, text, strlen(text));
 }
 
-void pgdb_bind_uuid(const uuid_t* uuid, pgdb_params_t* params) {
-	params->lengths[params->next_index] = 16;
-	params->values[params->next_index] = calloc(16, sizeof(char));
-	params->formats[params->next_index] = 1;
+void pgdb_bind_c_str_borrowed(const char* text, pgdb_params_t* params) {
+	pgdb_params_set(params, text, strlen(text));
+}
 
-	memcpy(params->values[params->next_index], (char*)uuid->bin, 16);
-	params->next_index++;
+void pgdb_bind_bytea(const unsigned char* data, const size_t length, pgdb_params_t* params) {
+	pgdb_params_set_copy(params, data, length);
 }
 
-void pgdb_bind_bool(const bool flag, pgdb_params_t* params) {
-	params->lengths[params->next_index] = 1;
-	params->values[params->next_index] = calloc(1, sizeof(char));
-	params->formats[params->next_index] = 1;
+void pgdb_bind_bytea_borrowed(const unsigned char* data, const size_t length, pgdb_params_t* params) {
+	if(data == NULL)
+		pgdb_params_set_inline(params, "", 0);
+	else
+		pgdb_params_set(params, data, length);
+}
 
-	memcpy(params->values[params->next_index], &flag, 1);
-	params->next_index++;
+void pgdb_bind_uuid(const uuid_t* uuid, pgdb_params_t* params) {
+	pgdb_params_set_inline(params, uuid->bin, 16);
+}
+
+void pgdb_bind_bool(const bool flag, pgdb_params_t* params) {
+	pgdb_params_set_inline(params, &flag, 1);
 }
 
 void pgdb_bind_timestamp(const time_t timestamp, pgdb_params_t* params) {
-	time_t * buffer = malloc(sizeof(time_t));
-	*buffer = htonll(pgdb_convert_to_pg_timestamp(timestamp));
-	params->values[params->next_index] = (char*)buffer;
-	params->lengths[params->next_index] = sizeof(time_t);
-	params->formats[params->next_index] = 1;
-	params->next_index++;
+	uint64_t buffer = htonll((uint64_t) pgdb_convert_to_pg_timestamp(timestamp));
+	pgdb_params_set_inline(params, &buffer, sizeof(uint64_t));
 }
 
-int pgdb_get_text(const pgdb_result_t* result, const int row, const char* field, string_t** buffer) {
-	int column = PQfnumber(result->pg, field);
-	if(column == -1 || PQgetisnull(result->pg, row, column)) {
+/**
+ * @brief Checks if \p column was found and value at \p row isnt NULL.
+ */
+static bool pgdb_value_present(const pgdb_result_t* result, const int row, const int column) {
+	return column != -1 && !PQgetisnull(result->pg, row, column);
+}
+
+static int pgdb_value_text(const pgdb_result_t* result, const int row, const int column, string_t** buffer) {
+	if(!pgdb_value_present(result, row, column)) {
 		*buffer = NULL;
 		return 1;
 	}
@@ -243,41 +691,32 @@ int pgdb_get_text(const pgdb_result_t* result, const int row, const char* field,
 	return 0;
 }
 
-int pgdb_get_uint32(const pgdb_result_t* result, const int row, const char* field, uint32_t* buffer) {
-	int column = PQfnumber(result->pg, field);
-	if(column == -1 || PQgetisnull(result->pg, row, column)) {
+static int pgdb_value_uint32(const pgdb_result_t* result, const int row, const int column, uint32_t* buffer) {
+	if(!pgdb_value_present(result, row, column)) {
 		return 1;
 	}
   	*buffer = ntohl(*((uint32_t *)PQgetvalue(result->pg, row, column)));
 	return 0;
 }
 
-int pgdb_get_uint64(const pgdb_result_t* result, const int row, const char* field, uint64_t* buffer) {
-	int column = PQfnumber(result->pg, field);
-	if(column == -1 || PQgetisnull(result->pg, row, column)) {
+static int pgdb_value_uint64(const pgdb_result_t* result, const int row, const int column, uint64_t* buffer) {
+	if(!pgdb_value_present(result, row, column)) {
 		return 1;
 	}
   	*buffer = ntohll(*(uint64_t*)PQgetvalue(result->pg, row, column));
 	return 0;
-
 }
 
-int pgdb_get_bool(const pgdb_result_t* result, const int row, const char* field, bool* buffer) {
-	int column = PQfnumber(result->pg, field);
-	if(column == -1 || PQgetisnull(result->pg, row, column)) {
+static int pgdb_value_bool(const pgdb_result_t* result, const int row, const int column, bool* buffer) {
+	if(!pgdb_value_present(result, row, column)) {
 		return 1;
 	}
-	if(*PQgetvalue(result->pg, row, column) == 0x00) {
-		*buffer = false;
-	} else {
-		*buffer = true;
-	}
+	*buffer = *PQgetvalue(result->pg, row, column) != 0x00;
 	return 0;
 }
 
-int pgdb_get_timestamp(const pgdb_result_t* result, const int row, const char* field, time_t* buffer) {
-	int column = PQfnumber(result->pg, field);
-	if(column == -1 || PQgetisnull(result->pg, row, column)) {
+static int pgdb_value_timestamp(const pgdb_result_t* result, const int row, const int column, time_t* buffer) {
+	if(!pgdb_value_present(result, row, column)) {
 		return 1;
 	}
 	int64_t psql_timestamp = (int64_t)ntohll(*(uint64_t*)PQgetvalue(result->pg, row, column));
@@ -285,9 +724,8 @@ int pgdb_get_timestamp(const pgdb_result_t* result, const int row, const char* f
 	return 0;
 }
 
-int pgdb_get_uuid(const pgdb_result_t* result, const int row, const char* field, uuid_t** buf) {
-	int column = PQfnumber(result->pg, field);
-	if(column == -1 || PQgetisnull(result->pg, row, column)) {
+static int pgdb_value_uuid(const pgdb_result_t* result, const int row, const int column, uuid_t** buf) {
+	if(!pgdb_value_present(result, row, column)) {
 		*buf = NULL;
 		return 1;
 	}
@@ -295,9 +733,8 @@ int pgdb_get_uuid(const pgdb_result_t* result, const int row, const char* field,
 	return 0;
 }
 
-int pgdb_get_enum(const pgdb_result_t* result, const int row, const char* field, int(*conv)(const char*), int* buffer) {
-	int column = PQfnumber(result->pg, field);
-	if(column == -1 || PQgetisnull(result->pg, row, column)) {
+static int pgdb_value_enum(const pgdb_result_t* result, const int row, const int column, int(*conv)(const char*), int* buffer) {
+	if(!pgdb_value_present(result, row, column)) {
 		*buffer = -1;
 		return 1;
 	}
@@ -305,9 +742,108 @@ int pgdb_get_enum(const pgdb_result_t* result, const int row, const char* field,
 	return 0;
 }
 
+int pgdb_get_text(const pgdb_result_t* result, const int row, const char* field, string_t** buffer) {
+	return pgdb_value_text(result, row, PQfnumber(result->pg, field), buffer);
+}
+
+int pgdb_get_uint32(const pgdb_result_t* result, const int row, const char* field, uint32_t* buffer) {
+	return pgdb_value_uint32(result, row, PQfnumber(result->pg, field), buffer);
+}
+
+int pgdb_get_uint64(const pgdb_result_t* result, const int row, const char* field, uint64_t* buffer) {
+	return pgdb_value_uint64(result, row, PQfnumber(result->pg, field), buffer);
+}
+
+int pgdb_get_bool(const pgdb_result_t* result, const int row, const char* field, bool* buffer) {
+	return pgdb_value_bool(result, row, PQfnumber(result->pg, field), buffer);
+}
+
+int pgdb_get_timestamp(const pgdb_result_t* result, const int row, const char* field, time_t* buffer) {
+	return pgdb_value_timestamp(result, row, PQfnumber(result->pg, field), buffer);
+}
+
+int pgdb_get_uuid(const pgdb_result_t* result, const int row, const char* field, uuid_t** buf) {
+	return pgdb_value_uuid(result, row, PQfnumber(result->pg, field), buf);
+}
+
+int pgdb_get_bytea(const pgdb_result_t* result, const int row, const char* field, unsigned char* buffer, const size_t size, size_t* length) {
+	int column = PQfnumber(result->pg, field);
+	if(!pgdb_value_present(result, row, column)) {
+		*length = 0;
+		return 1;
+	}
+	*length = PQgetlength(result->pg, row, column);
+	if(*length > size)
+		return 1;
+	memcpy(buffer, PQgetvalue(result->pg, row, column), *length);
+	return 0;
+}
+
+int pgdb_get_enum(const pgdb_result_t* result, const int row, const char* field, int(*conv)(const char*), int* buffer) {
+	return pgdb_value_enum(result, row, PQfnumber(result->pg, field), conv, buffer);
+}
+
 bool pgdb_exists(const pgdb_result_t* result, const char* name, const int row) {
-	int column = PQfnumber(result->pg, name);
-	return column != -1 && !PQgetisnull(result->pg, row, column);
+	return pgdb_value_present(result, row, PQfnumber(result->pg, name));
+}
+
+pgdb_row_decoder_t* pgdb_row_decoder_new(const pgdb_result_t* result, const pgdb_column_t* columns, const int count) {
+	pgdb_row_decoder_t* decoder = malloc(sizeof(pgdb_row_decoder_t) + count * sizeof(int));
+	decoder->columns = columns;
+	decoder->count = count;
+	for(int i = 0; i < count; i++) {
+		decoder->numbers[i] = PQfnumber(result->pg, columns[i].name);
+		if(decoder->numbers[i] == -1 && !columns[i].optional) {
+			ERROR("Result is missing column %s.\n", columns[i].name);
+			free(decoder);
+			return NULL;
+		}
+	}
+	return decoder;
+}
+
+int pgdb_row_decode(const pgdb_row_decoder_t* decoder, const pgdb_result_t* result, const int row, void* target) {
+	for(int i = 0; i < decoder->count; i++) {
+		const pgdb_column_t* column = &decoder->columns[i];
+		int number = decoder->numbers[i];
+		if(!pgdb_value_present(result, row, number)) {
+			if(column->optional)
+				continue;
+			return 1;
+		}
+
+		void* member = (char*) target + column->offset;
+		switch(column->type) {
+			case PGDB_COLUMN_TEXT:
+				pgdb_value_text(result, row, number, member);
+				break;
+			case PGDB_COLUMN_UINT32:
+				pgdb_value_uint32(result, row, number, member);
+				break;
+			case PGDB_COLUMN_UINT64:
+				pgdb_value_uint64(result, row, number, member);
+				break;
+			case PGDB_COLUMN_BOOL:
+				pgdb_value_bool(result, row, number, member);
+				break;
+			case PGDB_COLUMN_TIMESTAMP:
+				pgdb_value_timestamp(result, row, number, member);
+				break;
+			case PGDB_COLUMN_UUID:
+				pgdb_value_uuid(result, row, number, member);
+				break;
+			case PGDB_COLUMN_ENUM:
+				pgdb_value_enum(result, row, number, column->conv, member);
+				break;
+		}
+	}
+	return 0;
+}
+
+void pgdb_row_decoder_free(pgdb_row_decoder_t** decoder) {
+	if(*decoder == NULL) return;
+	free(*decoder);
+	*decoder = NULL;
 }
 
 int64_t pgdb_convert_to_pg_timestamp(const time_t timestamp) {
@@ -318,22 +854,80 @@ time_t pgdb_convert_to_unix_timestamp(const int64_t timestamp) {
 	return (time_t)(timestamp / 1000000) + 946684800;
 }
 
-pgdb_connection_queue_t* pgdb_connection_queue_new(const char* connection_info, int max_connections, int64_t max_age) {
+/**
+ * @brief Opens connection of a slot, which must be claimed by caller.
+ *
+ * @returns Returns 0 on success.
+ */
+static int pgdb_connection_open(pgdb_connection_queue_t* queue, pgdb_connection_t* connection) {
+	if(pgdb_connect(queue->conn_info, &connection->connection))
+		return 1;
+
+	pthread_mutex_lock(&queue->lock);
+	connection->active = true;
+	connection->created = time(NULL);
+	connection->released = connection->created;
+	pthread_mutex_unlock(&queue->lock);
+	return 0;
+}
+
+/**
+ * @brief Closes connection of a slot, which must be claimed by caller.
+ */
+static void pgdb_connection_close(pgdb_connection_queue_t* queue, pgdb_connection_t* connection) {
+	PQfinish(connection->connection);
+	connection->connection = NULL;
+
+	pthread_mutex_lock(&queue->lock);
+	connection->active = false;
+	pthread_mutex_unlock(&queue->lock);
+}
+
+pgdb_connection_queue_t* pgdb_connection_queue_new(const char* connection_info, int min_connections, int max_connections, int64_t max_age) {
 	pgdb_connection_queue_t* queue = calloc(1, sizeof(pgdb_connection_queue_t));
 	queue->conn_info = calloc(strlen(connection_info) + 1, sizeof(char));
 	strcpy(queue->conn_info, connection_info);
+	queue->min_connections = min_connections < max_connections ? min_connections : max_connections;
 	queue->max_connections = max_connections;
 	queue->max_age = max_age;
+	queue->claim_timeout = 0;
+	queue->maintenance_running = false;
 	queue->connections = calloc(max_connections, sizeof(pgdb_connection_t));
 	for(int i = 0; i < max_connections; i++) {
 		queue->connections[i].active = false;
 		queue->connections[i].claimed = false;
+		queue->connections[i].queue = queue;
+	}
+
+	pthread_mutex_init(&queue->lock, NULL);
+	// Deadlines are measured with the monotonic clock, so wall clock jumps dont shorten or extend waits.
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&queue->released, &attr);
+	pthread_cond_init(&queue->maintenance_wakeup, &attr);
+	pthread_condattr_destroy(&attr);
+
+	for(int i = 0; i < queue->min_connections; i++) {
+		if(pgdb_connection_open(queue, &queue->connections[i])) {
+			ERROR("Failed to pre-warm connection %d of %d.\n", i + 1, queue->min_connections);
+			break;
+		}
 	}
 	return queue;
 }
 
 void pgdb_connection_queue_free(pgdb_connection_queue_t** queue) {
 	if(*queue == NULL) return;
+
+	pthread_mutex_lock(&(*queue)->lock);
+	bool running = (*queue)->maintenance_running;
+	(*queue)->maintenance_running = false;
+	pthread_cond_signal(&(*queue)->maintenance_wakeup);
+	pthread_mutex_unlock(&(*queue)->lock);
+	if(running)
+		pthread_join((*queue)->maintenance, NULL);
+
 	free((*queue)->conn_info);
 	for(int i = 0; i < (*queue)->max_connections; i++) {
 		if((*queue)->connections[i].active) {
@@ -341,45 +935,217 @@ void pgdb_connection_queue_free(pgdb_connection_queue_t** queue) {
 		}
 	}
 	free((*queue)->connections);
+	pthread_cond_destroy(&(*queue)->maintenance_wakeup);
+	pthread_cond_destroy(&(*queue)->released);
+	pthread_mutex_destroy(&(*queue)->lock);
 	free(*queue);
 	*queue = NULL;
 }
 
-int pgdb_claim_connection(pgdb_connection_queue_t* queue, pgdb_connection_t** conn) {
-	// try to find active connections which arent claimed.
-	for(int i = 0; i < queue->max_connections; i++) {
-		if(queue->connections[i].active && !queue->connections[i].claimed) {
-			queue->connections[i].claimed = true;
-			*conn = &queue->connections[i];
-			return 0;
+/**
+ * @brief Checks a single claimed connection and replaces it if necessary.
+ */
+static void pgdb_connection_maintain(pgdb_connection_queue_t* queue, pgdb_connection_t* connection, const time_t now) {
+	if(!connection->active)
+		return;
+
+	if(queue->max_age > 0 && now - connection->created >= queue->max_age) {
+		DEBUG("Recycling connection older than %ld seconds.\n", (long) queue->max_age);
+		pgdb_connection_close(queue, connection);
+		return;
+	}
+
+	int64_t idle = (int64_t) (now - connection->released) * 1000;
+	if(PQstatus(connection->connection) == CONNECTION_OK && idle >= queue->maintenance_interval) {
+		// Empty query is the cheapest round trip which detects a dead socket.
+		PGresult* ping = PQexec(connection->connection, "");
+		PQclear(ping);
+		connection->released = now;
+	}
+
+	if(PQstatus(connection->connection) == CONNECTION_BAD) {
+		PQreset(connection->connection);
+		if(PQstatus(connection->connection) == CONNECTION_BAD) {
+			ERROR("Failed to reset broken connection.\n");
+			pgdb_connection_close(queue, connection);
 		}
 	}
+}
 
-	// try to find non active connection which isnt claimed.
+void pgdb_connection_queue_maintain(pgdb_connection_queue_t* queue) {
+	int active = 0;
 	for(int i = 0; i < queue->max_connections; i++) {
-		if(!queue->connections[i].active && !queue->connections[i].claimed) {
-			queue->connections[i].claimed = true;
-			if(pgdb_connect(queue->conn_info, &queue->connections[i].connection)) {
-				queue->connections[i].claimed = false;
-				*conn = NULL;
-				return 1;
-			}
-			queue->connections[i].active = true;
-			queue->connections[i].created = time(NULL);
-			*conn = &queue->connections[i];
-			return 0;
+		pgdb_connection_t* connection = &queue->connections[i];
+		pthread_mutex_lock(&queue->lock);
+		if(connection->claimed) {
+			active += connection->active;
+			pthread_mutex_unlock(&queue->lock);
+			continue;
+		}
+		// Take connection out of rotation while it is checked.
+		connection->claimed = true;
+		pthread_mutex_unlock(&queue->lock);
+
+		pgdb_connection_maintain(queue, connection, time(NULL));
+
+		pthread_mutex_lock(&queue->lock);
+		active += connection->active;
+		connection->claimed = false;
+		pthread_cond_signal(&queue->released);
+		pthread_mutex_unlock(&queue->lock);
+	}
+
+	for(int i = 0; i < queue->max_connections && active < queue->min_connections; i++) {
+		pgdb_connection_t* connection = &queue->connections[i];
+		pthread_mutex_lock(&queue->lock);
+		if(connection->claimed || connection->active) {
+			pthread_mutex_unlock(&queue->lock);
+			continue;
+		}
+		connection->claimed = true;
+		pthread_mutex_unlock(&queue->lock);
+
+		if(pgdb_connection_open(queue, connection)) {
+			ERROR("Failed to open connection during maintenance.\n");
+		} else {
+			active++;
 		}
+
+		pthread_mutex_lock(&queue->lock);
+		connection->claimed = false;
+		pthread_cond_signal(&queue->released);
+		pthread_mutex_unlock(&queue->lock);
+	}
+}
+
+static void* pgdb_connection_queue_maintenance_thread(void* data) {
+	pgdb_connection_queue_t* queue = data;
+	pthread_mutex_lock(&queue->lock);
+	while(queue->maintenance_running) {
+		struct timespec deadline;
+		clock_deadline_in(queue->maintenance_interval, &deadline);
+		if(pthread_cond_timedwait(&queue->maintenance_wakeup, &queue->lock, &deadline) != ETIMEDOUT)
+			continue;
+		pthread_mutex_unlock(&queue->lock);
+		pgdb_connection_queue_maintain(queue);
+		pthread_mutex_lock(&queue->lock);
 	}
+	pthread_mutex_unlock(&queue->lock);
+	return NULL;
+}
+
+int pgdb_connection_queue_start_maintenance(pgdb_connection_queue_t* queue, int64_t interval) {
+	pthread_mutex_lock(&queue->lock);
+	if(queue->maintenance_running) {
+		pthread_mutex_unlock(&queue->lock);
+		ERROR("Maintenance is already running.\n");
+		return 1;
+	}
+	queue->maintenance_interval = interval;
+	queue->maintenance_running = true;
+	if(pthread_create(&queue->maintenance, NULL, pgdb_connection_queue_maintenance_thread, queue)) {
+		queue->maintenance_running = false;
+		pthread_mutex_unlock(&queue->lock);
+		ERROR("Failed to start maintenance thread.\n");
+		return 1;
+	}
+	pthread_mutex_unlock(&queue->lock);
+	return 0;
+}
+
+/**
+ * @brief Finds index of a connection which isnt claimed. Active connections are preferred,
+ * so that no new connection is made while an existing one is idle. Must be called with queue->lock held.
+ *
+ * @returns Returns index of free connection or -1 if all are claimed.
+ */
+static int pgdb_connection_queue_find_free(const pgdb_connection_queue_t* queue) {
+	int inactive = -1;
+	for(int i = 0; i < queue->max_connections; i++) {
+		if(queue->connections[i].claimed)
+			continue;
+		if(queue->connections[i].active)
+			return i;
+		if(inactive == -1)
+			inactive = i;
+	}
+	return inactive;
+}
+
+int pgdb_claim_connection(pgdb_connection_queue_t* queue, pgdb_connection_t** conn) {
+	return pgdb_claim_connection_timed(queue, queue->claim_timeout, conn);
+}
 
+int pgdb_claim_connection_timed(pgdb_connection_queue_t* queue, const int64_t timeout, pgdb_connection_t** conn) {
 	*conn = NULL;
+
+	struct timespec deadline;
+	if(timeout > 0)
+		clock_deadline_in(timeout, &deadline);
+
+	pthread_mutex_lock(&queue->lock);
+	int index = pgdb_connection_queue_find_free(queue);
+	while(index == -1 && timeout > 0) {
+		int error = pthread_cond_timedwait(&queue->released, &queue->lock, &deadline);
+		index = pgdb_connection_queue_find_free(queue);
+		if(error == ETIMEDOUT)
+			break;
+	}
+
+	if(index == -1) {
+		pthread_mutex_unlock(&queue->lock);
+		return 0;
+	}
+
+	pgdb_connection_t* candidate = &queue->connections[index];
+	candidate->claimed = true;
+	bool active = candidate->active;
+	pthread_mutex_unlock(&queue->lock);
+
+	if(active) {
+		*conn = candidate;
+		return 0;
+	}
+
+	// Connecting takes a full round trip, hence it is done without holding the lock.
+	if(pgdb_connection_open(queue, candidate)) {
+		pthread_mutex_lock(&queue->lock);
+		candidate->claimed = false;
+		pthread_cond_signal(&queue->released);
+		pthread_mutex_unlock(&queue->lock);
+		return 1;
+	}
+
+	*conn = candidate;
 	return 0;
 }
 
 void pgdb_release_connection(pgdb_connection_t** connection) {
 	if(*connection == NULL) return;
+	pgdb_connection_queue_t* queue = (*connection)->queue;
+
+	PGconn* conn = (*connection)->connection;
+	if(queue != NULL && conn != NULL) {
+		// Dont hand out a connection in the middle of a transaction to the next thread.
+		PGTransactionStatusType transaction = PQtransactionStatus(conn);
+		if(transaction == PQTRANS_INTRANS || transaction == PQTRANS_INERROR) {
+			pgdb_execute(conn, "ROLLBACK;");
+		}
+		if(PQstatus(conn) == CONNECTION_BAD || transaction == PQTRANS_ACTIVE) {
+			ERROR("Closing broken connection on release.\n");
+			pgdb_connection_close(queue, *connection);
+		}
+	}
+
+	if(queue != NULL)
+		pthread_mutex_lock(&queue->lock);
+
 	(*connection)->claimed = false;
-	// Reset created, otherwise it may be destroyed instantly.
-	(*connection)->created = time(NULL);
-	// Maybe reset connection? In case of errors or open transactions etc.
+	(*connection)->released = time(NULL);
+
+	if(queue != NULL) {
+		pthread_cond_signal(&queue->released);
+		pthread_mutex_unlock(&queue->lock);
+	}
 	*connection = NULL;
 }
@@ -0,0 +1,257 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/print.h"
+#include "radicle/pgdb.h"
+#include "radicle/pgdb/async.h"
+
+/**
+ * @brief Amount of events handled per epoll_wait call.
+ */
+#define PGDB_REACTOR_EVENTS 64
+
+/**
+ * @brief Removes query from reactor, restores blocking mode of its connection and hands result to callback.
+ */
+static void pgdb_async_complete(pgdb_reactor_t* reactor, pgdb_async_query_t* query, int failed) {
+	epoll_ctl(reactor->epoll, EPOLL_CTL_DEL, PQsocket(query->conn), NULL);
+
+	pthread_mutex_lock(&reactor->lock);
+	if(query->prev != NULL)
+		query->prev->next = query->next;
+	else
+		reactor->in_flight = query->next;
+	if(query->next != NULL)
+		query->next->prev = query->prev;
+	pthread_mutex_unlock(&reactor->lock);
+
+	PQsetnonblocking(query->conn, 0);
+
+	pgdb_result_t* result = NULL;
+	if(failed) {
+		PQclear(query->result);
+	} else {
+		result = pgdb_result_new(query->result);
+		failed = pgdb_manage_query(&result, query->expected);
+	}
+	query->callback(failed, result, query->user_data);
+	free(query);
+}
+
+/**
+ * @brief Handles readiness of a query's socket. Flushes outstanding data, reads available input
+ * and completes query once libpq has returned all results.
+ */
+static void pgdb_async_process(pgdb_reactor_t* reactor, pgdb_async_query_t* query, uint32_t events) {
+	if(events & EPOLLOUT) {
+		int flushed = PQflush(query->conn);
+		if(flushed == -1) {
+			ERROR("Failed to flush query: %s\n", PQerrorMessage(query->conn));
+			pgdb_async_complete(reactor, query, 1);
+			return;
+		}
+		if(flushed == 0) {
+			struct epoll_event event = { .events = EPOLLIN, .data.ptr = query };
+			epoll_ctl(reactor->epoll, EPOLL_CTL_MOD, PQsocket(query->conn), &event);
+		}
+	}
+
+	if(events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+		if(PQconsumeInput(query->conn) == 0) {
+			ERROR("Failed to read result: %s\n", PQerrorMessage(query->conn));
+			pgdb_async_complete(reactor, query, 1);
+			return;
+		}
+	}
+
+	while(!PQisBusy(query->conn)) {
+		PGresult* result = PQgetResult(query->conn);
+		if(result == NULL) {
+			pgdb_async_complete(reactor, query, 0);
+			return;
+		}
+		// Only first result is of interest, others are drained so the connection is idle afterwards.
+		if(query->result == NULL)
+			query->result = result;
+		else
+			PQclear(result);
+	}
+}
+
+static void* pgdb_reactor_thread(void* data) {
+	pgdb_reactor_t* reactor = data;
+	struct epoll_event events[PGDB_REACTOR_EVENTS];
+
+	while(1) {
+		int count = epoll_wait(reactor->epoll, events, PGDB_REACTOR_EVENTS, -1);
+		if(count == -1)
+			continue;
+
+		for(int i = 0; i < count; i++) {
+			if(events[i].data.ptr == NULL) {
+				uint64_t value;
+				if(read(reactor->wakeup, &value, sizeof(value)) == -1) {
+					DEBUG("Failed to read wakeup of reactor.\n");
+				}
+				continue;
+			}
+			pgdb_async_process(reactor, events[i].data.ptr, events[i].events);
+		}
+
+		pthread_mutex_lock(&reactor->lock);
+		bool running = reactor->running;
+		pthread_mutex_unlock(&reactor->lock);
+		if(!running)
+			break;
+	}
+	return NULL;
+}
+
+pgdb_reactor_t* pgdb_reactor_new() {
+	pgdb_reactor_t* reactor = calloc(1, sizeof(pgdb_reactor_t));
+	reactor->epoll = epoll_create1(EPOLL_CLOEXEC);
+	if(reactor->epoll == -1) {
+		ERROR("Failed to create epoll instance.\n");
+		free(reactor);
+		return NULL;
+	}
+
+	reactor->wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+	if(reactor->wakeup == -1 || epoll_ctl(reactor->epoll, EPOLL_CTL_ADD, reactor->wakeup, &event)) {
+		ERROR("Failed to create wakeup of reactor.\n");
+		if(reactor->wakeup != -1)
+			close(reactor->wakeup);
+		close(reactor->epoll);
+		free(reactor);
+		return NULL;
+	}
+
+	pthread_mutex_init(&reactor->lock, NULL);
+	reactor->running = true;
+	reactor->in_flight = NULL;
+	if(pthread_create(&reactor->thread, NULL, pgdb_reactor_thread, reactor)) {
+		ERROR("Failed to start reactor thread.\n");
+		pthread_mutex_destroy(&reactor->lock);
+		close(reactor->wakeup);
+		close(reactor->epoll);
+		free(reactor);
+		return NULL;
+	}
+	return reactor;
+}
+
+void pgdb_reactor_free(pgdb_reactor_t** reactor) {
+	if(*reactor == NULL) return;
+
+	pthread_mutex_lock(&(*reactor)->lock);
+	(*reactor)->running = false;
+	pthread_mutex_unlock(&(*reactor)->lock);
+
+	uint64_t value = 1;
+	if(write((*reactor)->wakeup, &value, sizeof(value)) == -1) {
+		ERROR("Failed to wake up reactor.\n");
+	}
+	pthread_join((*reactor)->thread, NULL);
+
+	// Reactor thread is gone, queries left over will never complete.
+	while((*reactor)->in_flight != NULL) {
+		pgdb_async_query_t* query = (*reactor)->in_flight;
+		PGcancel* cancel = PQgetCancel(query->conn);
+		if(cancel != NULL) {
+			char error[256];
+			PQcancel(cancel, error, sizeof(error));
+			PQfreeCancel(cancel);
+		}
+		pgdb_async_complete(*reactor, query, 1);
+	}
+
+	pthread_mutex_destroy(&(*reactor)->lock);
+	close((*reactor)->wakeup);
+	close((*reactor)->epoll);
+	free(*reactor);
+	*reactor = NULL;
+}
+
+/**
+ * @brief Sends query in non blocking mode and registers its socket with the reactor.
+ */
+static int pgdb_async_send(pgdb_reactor_t* reactor, PGconn* conn, const char* stmt, const pgdb_params_t* params, const ExecStatusType expected, pgdb_async_callback_t callback, void* user_data) {
+	if(conn == NULL || PQsetnonblocking(conn, 1)) {
+		ERROR("Failed to set connection non blocking.\n");
+		return 1;
+	}
+
+	if(PQsendQueryParams(conn, stmt, params->count, params->types, (const char* const*)params->values, params->lengths, params->formats, 1) == 0) {
+		ERROR("Failed to send query: %s\n", PQerrorMessage(conn));
+		PQsetnonblocking(conn, 0);
+		return 1;
+	}
+
+	pgdb_async_query_t* query = calloc(1, sizeof(pgdb_async_query_t));
+	query->conn = conn;
+	query->expected = expected;
+	query->callback = callback;
+	query->user_data = user_data;
+
+	pthread_mutex_lock(&reactor->lock);
+	if(!reactor->running) {
+		pthread_mutex_unlock(&reactor->lock);
+		ERROR("Reactor is shutting down.\n");
+		free(query);
+		PQsetnonblocking(conn, 0);
+		return 1;
+	}
+	query->next = reactor->in_flight;
+	if(reactor->in_flight != NULL)
+		reactor->in_flight->prev = query;
+	reactor->in_flight = query;
+
+	// Large parameters may not have been written completely, then reactor waits for the socket to become writable.
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = query };
+	if(PQflush(conn) != 0)
+		event.events |= EPOLLOUT;
+	if(epoll_ctl(reactor->epoll, EPOLL_CTL_ADD, PQsocket(conn), &event)) {
+		reactor->in_flight = query->next;
+		if(query->next != NULL)
+			query->next->prev = NULL;
+		pthread_mutex_unlock(&reactor->lock);
+		ERROR("Failed to register connection with reactor.\n");
+		free(query);
+		PQsetnonblocking(conn, 0);
+		return 1;
+	}
+	pthread_mutex_unlock(&reactor->lock);
+	return 0;
+}
+
+int pgdb_async_fetch(pgdb_reactor_t* reactor, PGconn* conn, const char* stmt, const pgdb_params_t* params, pgdb_async_callback_t callback, void* user_data) {
+	return pgdb_async_send(reactor, conn, stmt, params, PGRES_TUPLES_OK, callback, user_data);
+}
+
+int pgdb_async_execute(pgdb_reactor_t* reactor, PGconn* conn, const char* stmt, const pgdb_params_t* params, pgdb_async_callback_t callback, void* user_data) {
+	return pgdb_async_send(reactor, conn, stmt, params, PGRES_COMMAND_OK, callback, user_data);
+}
@@ -0,0 +1,174 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/print.h"
+#include "radicle/pgdb.h"
+#include "radicle/pgdb/copy.h"
+
+/**
+ * @brief Signature, flags and header extension length of binary COPY format.
+ */
+static const char pgdb_copy_header[19] = "PGCOPY\n\377\r\n\0\0\0\0\0\0\0\0\0";
+
+/**
+ * @brief Makes sure \p additional bytes fit into buffer.
+ *
+ * @returns Returns 0 on success.
+ */
+static int pgdb_copy_writer_reserve(pgdb_copy_writer_t* writer, const size_t additional) {
+	if(writer->length + additional <= writer->capacity)
+		return 0;
+	size_t capacity = writer->capacity * 2;
+	while(capacity < writer->length + additional)
+		capacity *= 2;
+	char* buffer = realloc(writer->buffer, capacity);
+	if(buffer == NULL)
+		return 1;
+	writer->buffer = buffer;
+	writer->capacity = capacity;
+	return 0;
+}
+
+static void pgdb_copy_writer_put_int16(pgdb_copy_writer_t* writer, const int16_t value) {
+	uint16_t network = htons((uint16_t) value);
+	memcpy(writer->buffer + writer->length, &network, sizeof(network));
+	writer->length += sizeof(network);
+}
+
+static void pgdb_copy_writer_put_int32(pgdb_copy_writer_t* writer, const int32_t value) {
+	uint32_t network = htonl((uint32_t) value);
+	memcpy(writer->buffer + writer->length, &network, sizeof(network));
+	writer->length += sizeof(network);
+}
+
+pgdb_copy_writer_t* pgdb_copy_writer_new(PGconn* conn, const char* table, const int columns, const int max_rows, const size_t max_bytes) {
+	pgdb_copy_writer_t* writer = calloc(1, sizeof(pgdb_copy_writer_t));
+	writer->conn = conn;
+	writer->columns = columns;
+	writer->max_rows = max_rows;
+	writer->max_bytes = max_bytes;
+
+	const char* prefix = "COPY ";
+	const char* suffix = " FROM STDIN (FORMAT binary);";
+	writer->stmt = calloc(strlen(prefix) + strlen(table) + strlen(suffix) + 1, sizeof(char));
+	strcpy(writer->stmt, prefix);
+	strcat(writer->stmt, table);
+	strcat(writer->stmt, suffix);
+
+	writer->capacity = 4096;
+	writer->buffer = malloc(writer->capacity);
+	memcpy(writer->buffer, pgdb_copy_header, sizeof(pgdb_copy_header));
+	writer->length = sizeof(pgdb_copy_header);
+	writer->rows = 0;
+	writer->row = pgdb_params_new(columns);
+	return writer;
+}
+
+pgdb_params_t* pgdb_copy_writer_row(pgdb_copy_writer_t* writer) {
+	pgdb_params_reset(writer->row);
+	return writer->row;
+}
+
+int pgdb_copy_writer_add(pgdb_copy_writer_t* writer, const pgdb_params_t* row) {
+	if(row->count != writer->columns) {
+		ERROR("Row has %d columns, expected %d.\n", row->count, writer->columns);
+		return 1;
+	}
+
+	size_t size = sizeof(int16_t);
+	for(int i = 0; i < row->count; i++)
+		size += sizeof(int32_t) + (row->values[i] != NULL ? row->lengths[i] : 0);
+	// Trailer is reserved as well, so flushing never needs to grow buffer.
+	if(pgdb_copy_writer_reserve(writer, size + sizeof(int16_t))) {
+		ERROR("Failed to grow copy buffer.\n");
+		return 1;
+	}
+
+	pgdb_copy_writer_put_int16(writer, row->count);
+	for(int i = 0; i < row->count; i++) {
+		if(row->values[i] == NULL) {
+			pgdb_copy_writer_put_int32(writer, -1);
+			continue;
+		}
+		pgdb_copy_writer_put_int32(writer, row->lengths[i]);
+		memcpy(writer->buffer + writer->length, row->values[i], row->lengths[i]);
+		writer->length += row->lengths[i];
+	}
+	writer->rows++;
+
+	if((writer->max_rows > 0 && writer->rows >= writer->max_rows) ||
+		(writer->max_bytes > 0 && writer->length >= writer->max_bytes)) {
+		return pgdb_copy_writer_flush(writer);
+	}
+	return 0;
+}
+
+int pgdb_copy_writer_flush(pgdb_copy_writer_t* writer) {
+	if(writer->rows == 0)
+		return 0;
+
+	int rows = writer->rows;
+	pgdb_copy_writer_put_int16(writer, -1);
+	writer->rows = 0;
+	size_t length = writer->length;
+	writer->length = sizeof(pgdb_copy_header);
+
+	pgdb_result_t* result = pgdb_result_new(PQexec(writer->conn, writer->stmt));
+	if(pgdb_manage_query(&result, PGRES_COPY_IN)) {
+		ERROR("Failed to start copy, dropping %d rows.\n", rows);
+		return 1;
+	}
+	pgdb_result_free(&result);
+
+	if(PQputCopyData(writer->conn, writer->buffer, length) != 1) {
+		ERROR("Failed to send copy data: %s\n", PQerrorMessage(writer->conn));
+		PQputCopyEnd(writer->conn, "Failed to send copy data.");
+	} else if(PQputCopyEnd(writer->conn, NULL) != 1) {
+		ERROR("Failed to end copy: %s\n", PQerrorMessage(writer->conn));
+	}
+
+	result = pgdb_result_new(PQgetResult(writer->conn));
+	int failed = pgdb_manage_query(&result, PGRES_COMMAND_OK);
+	pgdb_result_free(&result);
+
+	PGresult* end = NULL;
+	while((end = PQgetResult(writer->conn)) != NULL)
+		PQclear(end);
+
+	if(failed) {
+		ERROR("Copy failed, dropped %d rows.\n", rows);
+	}
+	return failed;
+}
+
+void pgdb_copy_writer_free(pgdb_copy_writer_t** writer) {
+	if(*writer == NULL) return;
+	pgdb_copy_writer_flush(*writer);
+	free((*writer)->stmt);
+	free((*writer)->buffer);
+	pgdb_params_free(&(*writer)->row);
+	free(*writer);
+	*writer = NULL;
+}
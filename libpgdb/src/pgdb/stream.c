@@ -0,0 +1,130 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file
+ */
+
+#include <stdlib.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/print.h"
+#include "radicle/pgdb.h"
+#include "radicle/pgdb/stream.h"
+
+/**
+ * @brief Switches the query just sent into chunked or single row mode. If neither works, all rows
+ * arrive in a single result, which pgdb_stream_next() handles just the same.
+ */
+static void pgdb_stream_set_mode(PGconn* conn, const int chunk_rows) {
+#if defined(LIBPQ_HAS_CHUNK_MODE)
+	if(chunk_rows > 1 && PQsetChunkedRowsMode(conn, chunk_rows))
+		return;
+#endif
+	if(!PQsetSingleRowMode(conn)) {
+		DEBUG("Failed to enter single row mode, result is received at once.\n");
+	}
+}
+
+pgdb_stream_t* pgdb_stream_open(PGconn* conn, const char* stmt, const pgdb_params_t* params, const int chunk_rows) {
+	int sent = params != NULL
+		? PQsendQueryParams(conn, stmt, params->count, params->types, (const char* const*)params->values, params->lengths, params->formats, 1)
+		: PQsendQueryParams(conn, stmt, 0, NULL, NULL, NULL, NULL, 1);
+	if(!sent) {
+		ERROR("Failed to send query: %s\n", PQerrorMessage(conn));
+		return NULL;
+	}
+	pgdb_stream_set_mode(conn, chunk_rows);
+
+	pgdb_stream_t* stream = calloc(1, sizeof(pgdb_stream_t));
+	stream->conn = conn;
+	return stream;
+}
+
+bool pgdb_stream_next(pgdb_stream_t* stream) {
+	if(stream->result != NULL && ++stream->row < PQntuples(stream->result->pg))
+		return true;
+	pgdb_result_free(&stream->result);
+
+	// Errors are followed by more results as well, connection is idle only after NULL.
+	while(!stream->done) {
+		PGresult* pg = PQgetResult(stream->conn);
+		if(pg == NULL) {
+			stream->done = true;
+			break;
+		}
+
+		ExecStatusType status = PQresultStatus(pg);
+		bool rows = status == PGRES_SINGLE_TUPLE || status == PGRES_TUPLES_OK;
+#if defined(LIBPQ_HAS_CHUNK_MODE)
+		rows = rows || status == PGRES_TUPLES_CHUNK;
+#endif
+		if(rows && !stream->failed && PQntuples(pg) > 0) {
+			stream->result = pgdb_result_new(pg);
+			stream->result->status = status;
+			stream->row = 0;
+			return true;
+		}
+
+		if(!rows) {
+			DEBUG("%s: %s\n", PQresStatus(status), PQresultErrorMessage(pg));
+			stream->failed = true;
+		}
+		PQclear(pg);
+	}
+	return false;
+}
+
+int pgdb_stream_each(PGconn* conn, const char* stmt, const pgdb_params_t* params, const int chunk_rows, pgdb_stream_callback_t callback, void* data) {
+	pgdb_stream_t* stream = pgdb_stream_open(conn, stmt, params, chunk_rows);
+	if(stream == NULL)
+		return 1;
+
+	int stopped = 0;
+	while(!stopped && pgdb_stream_next(stream))
+		stopped = callback(stream->result, stream->row, data);
+
+	int r = stopped || stream->failed;
+	pgdb_stream_free(&stream);
+	return r;
+}
+
+void pgdb_stream_free(pgdb_stream_t** stream) {
+	if(*stream == NULL) return;
+	pgdb_result_free(&(*stream)->result);
+
+	if(!(*stream)->done) {
+		// Without cancelling, the server would keep sending all remaining rows.
+		PGcancel* cancel = PQgetCancel((*stream)->conn);
+		if(cancel != NULL) {
+			char error[256];
+			if(!PQcancel(cancel, error, sizeof(error))) {
+				DEBUG("Failed to cancel query: %s\n", error);
+			}
+			PQfreeCancel(cancel);
+		}
+
+		PGresult* rest = NULL;
+		while((rest = PQgetResult((*stream)->conn)) != NULL)
+			PQclear(rest);
+	}
+
+	free(*stream);
+	*stream = NULL;
+}
@@ -0,0 +1,59 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/tests/pgdb_hooks.hpp"
+#include "radicle/pgdb.h"
+#include "radicle/pgdb/async.h"
+
+static int async_callback_calls = 0;
+
+static void async_callback(int status, pgdb_result_t* result, void* user_data) {
+	async_callback_calls++;
+	pgdb_result_free(&result);
+}
+
+TEST_F(RadicleTests, TestReactorLifecycle) {
+	pgdb_reactor_t* reactor = pgdb_reactor_new();
+	ASSERT_TRUE(reactor != NULL);
+	EXPECT_TRUE(reactor->in_flight == NULL);
+	pgdb_reactor_free(&reactor);
+	EXPECT_TRUE(reactor == NULL);
+	pgdb_reactor_free(&reactor);
+}
+
+TEST_F(RadicleTests, TestAsyncFetchWithoutConnection) {
+	async_callback_calls = 0;
+	pgdb_reactor_t* reactor = pgdb_reactor_new();
+	ASSERT_TRUE(reactor != NULL);
+
+	pgdb_params_t* params = pgdb_params_new(1);
+	pgdb_bind_uint32(1, params);
+	EXPECT_EQ(pgdb_async_fetch(reactor, NULL, "SELECT id FROM Accounts WHERE id=$1::int;", params, async_callback, NULL), 1);
+	EXPECT_EQ(pgdb_async_execute(reactor, NULL, "DELETE FROM Accounts WHERE id=$1::int;", params, async_callback, NULL), 1);
+	EXPECT_TRUE(reactor->in_flight == NULL);
+
+	pgdb_reactor_free(&reactor);
+	// Failed sends never reach the callback.
+	EXPECT_EQ(async_callback_calls, 0);
+	pgdb_params_free(&params);
+}
@@ -0,0 +1,100 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/tests/pgdb_hooks.hpp"
+#include "radicle/pgdb.h"
+#include "radicle/pgdb/copy.h"
+
+TEST_F(RadiclePGDBHooks, TestCopyWriterEncoding) {
+	pgdb_copy_writer_t* writer = pgdb_copy_writer_new(NULL, "Accounts(id, email, password)", 3, 0, 0);
+	EXPECT_STREQ(writer->stmt, "COPY Accounts(id, email, password) FROM STDIN (FORMAT binary);");
+	EXPECT_EQ(writer->length, 19);
+	EXPECT_EQ(memcmp(writer->buffer, "PGCOPY\n\377\r\n\0", 11), 0);
+
+	pgdb_params_t* params = pgdb_params_new(3);
+	pgdb_bind_uint32(42, params);
+	pgdb_bind_c_str("mail", params);
+	pgdb_bind_null(params);
+	EXPECT_EQ(pgdb_copy_writer_add(writer, params), 0);
+	pgdb_params_free(&params);
+	EXPECT_EQ(writer->rows, 1);
+
+	// Field count, int4 with its length, text with its length and NULL as length -1.
+	const char* row = writer->buffer + 19;
+	EXPECT_EQ(ntohs(*(uint16_t*)row), 3);
+	EXPECT_EQ(ntohl(*(uint32_t*)(row + 2)), 4);
+	EXPECT_EQ(ntohl(*(uint32_t*)(row + 6)), 42);
+	EXPECT_EQ(ntohl(*(uint32_t*)(row + 10)), 4);
+	EXPECT_EQ(memcmp(row + 14, "mail", 4), 0);
+	EXPECT_EQ((int32_t)ntohl(*(uint32_t*)(row + 18)), -1);
+	EXPECT_EQ(writer->length, 19 + 22);
+
+	params = pgdb_params_new(2);
+	EXPECT_EQ(pgdb_copy_writer_add(writer, params), 1);
+	pgdb_params_free(&params);
+	EXPECT_EQ(writer->rows, 1);
+
+	pgdb_copy_writer_free(&writer);
+	EXPECT_TRUE(writer == NULL);
+}
+
+TEST_F(RadiclePGDBHooks, TestCopyWriterFlushThreshold) {
+	install_pg_exec_hook();
+	pgdb_copy_writer_t* writer = pgdb_copy_writer_new(NULL, "Accounts(id)", 1, 2, 0);
+
+	pgdb_params_t* params = pgdb_params_new(1);
+	pgdb_bind_uint32(1, params);
+	EXPECT_EQ(pgdb_copy_writer_add(writer, params), 0);
+	EXPECT_EQ(writer->rows, 1);
+	// Second row reaches threshold, copy cannot be started without connection and rows are dropped.
+	EXPECT_EQ(pgdb_copy_writer_add(writer, params), 1);
+	EXPECT_EQ(writer->rows, 0);
+	EXPECT_EQ(writer->length, 19);
+	pgdb_params_free(&params);
+
+	EXPECT_EQ(pgdb_copy_writer_flush(writer), 0);
+	pgdb_copy_writer_free(&writer);
+}
+
+TEST_F(RadiclePGDBHooks, TestCopyWriterRowReuse) {
+	pgdb_copy_writer_t* writer = pgdb_copy_writer_new(NULL, "Accounts(id, email)", 2, 0, 0);
+
+	pgdb_params_t* params = pgdb_copy_writer_row(writer);
+	EXPECT_EQ(params->count, 2);
+	pgdb_bind_uint32(1, params);
+	pgdb_bind_c_str("first", params);
+	EXPECT_EQ(pgdb_copy_writer_add(writer, params), 0);
+
+	// Builder comes back without bound values.
+	EXPECT_TRUE(pgdb_copy_writer_row(writer) == params);
+	EXPECT_EQ(params->next_index, 0);
+	EXPECT_TRUE(params->values[1] == NULL);
+	pgdb_bind_uint32(2, params);
+	EXPECT_EQ(pgdb_copy_writer_add(writer, params), 0);
+	EXPECT_EQ(writer->rows, 2);
+
+	pgdb_copy_writer_free(&writer);
+}
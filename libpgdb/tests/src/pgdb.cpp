@@ -20,6 +20,11 @@
 
 #include <libpq-fe.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 #include "radicle/tests/pgdb_hooks.hpp"
 #include "radicle/pgdb.h"
 
@@ -108,8 +113,145 @@ TEST(PGDBParamsTest, TestParamsNew) {
 	ASSERT_TRUE(params == NULL);
 }
 
+PGDB_FAKE_FETCH(fake_fetch_prepared_fallback) {
+	EXPECT_STREQ(command, "SELECT id FROM Accounts WHERE id=$1::int;");
+	EXPECT_EQ(nParams, 1);
+	PGDB_FAKE_RESULT_1(PGRES_TUPLES_OK, "id");
+	PGDB_FAKE_INT(1);
+	PGDB_FAKE_FINISH();
+}
+
+TEST_F(RadiclePGDBHooks, TestPreparedFallback) {
+	install_hook(PGDB_FAKE_CREATE_FETCH_HOOK(fake_fetch_prepared_fallback));
+	static pgdb_statement_t stmt = PGDB_STATEMENT("test_prepared_fallback", "SELECT id FROM Accounts WHERE id=$1::int;");
+	pgdb_params_t* params = pgdb_params_new(1);
+	pgdb_bind_uint32(1, params);	
+
+	// Connections not made by pgdb_connect have no cache and use unnamed statements.
+	pgdb_result_t* result = NULL;
+	ASSERT_EQ(pgdb_fetch_prepared(NULL, &stmt, params, &result), 0);
+	uint32_t id = 0;
+	EXPECT_EQ(pgdb_get_uint32(result, 0, "id", &id), 0);
+	EXPECT_EQ(id, 1);
+	EXPECT_EQ(stmt.id, 0);
+
+	pgdb_result_free(&result);
+	pgdb_params_free(&params);
+}
+
+/**
+ * @brief Unconnected but real connection, so event procedures and instance data work.
+ */
+static PGconn* PQconnectdbUnconnected(const char *conninfo) {
+	return PQconnectStart("host=/nonexistent");
+}
+
+static int prepare_calls = 0;
+static int exec_prepared_calls = 0;
+
+static PGresult* PQprepareFake(PGconn* conn, const char* stmtName, const char* query, int nParams, const Oid* paramTypes) {
+	EXPECT_STREQ(stmtName, "test_prepared_cache");
+	EXPECT_STREQ(query, "SELECT id FROM Accounts WHERE id=$1::int;");
+	prepare_calls++;
+	return PQmakeEmptyPGresult(NULL, PGRES_COMMAND_OK);
+}
+
+static PGresult* PQexecPreparedFake(PGconn* conn, const char* stmtName, int nParams, const char* const* paramValues, const int* paramLengths, const int* paramFormats, int resultFormat) {
+	EXPECT_STREQ(stmtName, "test_prepared_cache");
+	EXPECT_EQ(nParams, 1);
+	exec_prepared_calls++;
+	PGDB_FAKE_RESULT_1(PGRES_TUPLES_OK, "id");
+	PGDB_FAKE_INT(1);
+	PGDB_FAKE_FINISH();
+}
+
+TEST_F(RadiclePGDBHooks, TestPreparedCache) {
+	install_hook(subhook_new((void*)PQconnectdb, (void*)PQconnectdbUnconnected, SUBHOOK_64BIT_OFFSET));
+	install_hook(subhook_new((void*)PQstatus, (void*)PQstatusSuccess, SUBHOOK_64BIT_OFFSET));
+	install_hook(subhook_new((void*)PQprepare, (void*)PQprepareFake, SUBHOOK_64BIT_OFFSET));
+	install_hook(subhook_new((void*)PQexecPrepared, (void*)PQexecPreparedFake, SUBHOOK_64BIT_OFFSET));
+	prepare_calls = 0;
+	exec_prepared_calls = 0;
+
+	PGconn* conn = NULL;
+	ASSERT_EQ(pgdb_connect("", &conn), 0);
+	ASSERT_TRUE(conn != NULL);
+	ASSERT_TRUE(PQinstanceData(conn, pgdb_statement_event) != NULL);
+
+	static pgdb_statement_t stmt = PGDB_STATEMENT("test_prepared_cache", "SELECT id FROM Accounts WHERE id=$1::int;");
+	pgdb_params_t* params = pgdb_params_new(1);
+	pgdb_bind_uint32(1, params);
+
+	pgdb_result_t* result = NULL;
+	for(int i = 0; i < 2; i++) {
+		ASSERT_EQ(pgdb_fetch_prepared(conn, &stmt, params, &result), 0);
+		pgdb_result_free(&result);
+	}
+	EXPECT_NE(stmt.id, 0);
+	EXPECT_EQ(prepare_calls, 1);
+	EXPECT_EQ(exec_prepared_calls, 2);
+
+	// Server forgets prepared statements on reset, so the next call prepares again.
+	PGEventConnReset reset = { conn };
+	EXPECT_EQ(pgdb_statement_event(PGEVT_CONNRESET, &reset, NULL), 1);
+	ASSERT_EQ(pgdb_fetch_prepared(conn, &stmt, params, &result), 0);
+	pgdb_result_free(&result);
+	EXPECT_EQ(prepare_calls, 2);
+	EXPECT_EQ(exec_prepared_calls, 3);
+
+	pgdb_params_free(&params);
+	PQfinish(conn);
+}
+
+PGDB_FAKE_FETCH_STORY(fake_pipeline_story) {
+	PGDB_FAKE_STORY_BRANCH(fake_pipeline_story, 0)
+		PGDB_FAKE_RESULT_1(PGRES_TUPLES_OK, "id");
+		PGDB_FAKE_INT(7);
+		PGDB_FAKE_FINISH();
+	PGDB_FAKE_STORY_BRANCH_END()
+	PGDB_FAKE_STORY_BRANCH(fake_pipeline_story, 1)
+		PGDB_FAKE_EMPTY_RESULT(PGRES_COMMAND_OK);
+	PGDB_FAKE_STORY_BRANCH_END()
+	PGDB_FAKE_EMPTY_RESULT(PGRES_FATAL_ERROR);
+}
+
+TEST_F(RadiclePGDBHooks, TestPipeline) {
+	PGDB_FAKE_INIT_FETCH_STORY(fake_pipeline_story);
+	install_hook(PGDB_FAKE_CREATE_FETCH_HOOK(fake_pipeline_story));
+	static pgdb_statement_t insert = PGDB_STATEMENT("test_pipeline_insert", "INSERT INTO Accounts(id) VALUES ($1::int);");
+	pgdb_params_t* params = pgdb_params_new(1);
+	pgdb_bind_uint32(7, params);	
+
+	// Without connection statements are executed one after another.
+	pgdb_pipeline_t* pipeline = pgdb_pipeline_new(NULL);
+	ASSERT_TRUE(pipeline != NULL);
+	EXPECT_EQ(pgdb_pipeline_fetch(pipeline, "SELECT id FROM Accounts WHERE id=$1::int;", params), 0);
+	EXPECT_EQ(pgdb_pipeline_execute_prepared(pipeline, &insert, params), 0);
+	EXPECT_EQ(pgdb_pipeline_sync(pipeline), 0);
+
+	pgdb_result_t* result = pgdb_pipeline_take_result(pipeline, 0);
+	ASSERT_TRUE(result != NULL);
+	uint32_t id = 0;
+	EXPECT_EQ(pgdb_get_uint32(result, 0, "id", &id), 0);
+	EXPECT_EQ(id, 7);
+	pgdb_result_free(&result);
+	EXPECT_TRUE(pgdb_pipeline_take_result(pipeline, 0) == NULL);
+	EXPECT_TRUE(pipeline->results[1] != NULL);
+	EXPECT_TRUE(pgdb_pipeline_take_result(pipeline, 2) == NULL);
+
+	// Next batch drops results of previous one.
+	EXPECT_EQ(pgdb_pipeline_execute(pipeline, "DELETE FROM Accounts;", params), 0);
+	EXPECT_EQ(pipeline->result_count, 1);
+	EXPECT_EQ(pgdb_pipeline_sync(pipeline), 1);
+	EXPECT_TRUE(pgdb_pipeline_take_result(pipeline, 0) == NULL);
+
+	pgdb_pipeline_free(&pipeline);
+	EXPECT_TRUE(pipeline == NULL);
+	pgdb_params_free(&params);
+}
+
 TEST_F(RadicleTests, TestBinds) {
-	pgdb_params_t* params = pgdb_params_new(8);
+	pgdb_params_t* params = pgdb_params_new(9);
 	
 	pgdb_bind_null(params);
 	EXPECT_EQ(params->lengths[0], 0);
@@ -119,6 +261,7 @@ TEST_F(RadicleTests, TestBinds) {
 
 	pgdb_bind_uint64(1, params);
 	EXPECT_EQ(params->lengths[2], sizeof(uint64_t));
+	EXPECT_EQ(ntohll(*(uint64_t*) params->values[2]), 1);
 
 	pgdb_bind_text(common_string, params);
 	EXPECT_EQ(params->lengths[3], strlen(common_string->ptr));
@@ -135,7 +278,70 @@ TEST_F(RadicleTests, TestBinds) {
 	pgdb_bind_timestamp(1, params);
 	EXPECT_EQ(params->lengths[7], sizeof(time_t));
 
+	const unsigned char bytes[3] = {0x00, 0xff, 0x10};
+	pgdb_bind_bytea(bytes, sizeof(bytes), params);
+	EXPECT_EQ(params->lengths[8], 3);
+	EXPECT_EQ(params->formats[8], 1);
+	EXPECT_EQ(memcmp(params->values[8], bytes, 3), 0);
+
+	pgdb_params_free(&params);
+}
+
+TEST(PGDBParamsTest, TestArenaBinds) {
+	arena_t* arena = arena_new(256);
+	pgdb_params_t* params = pgdb_params_new_arena(arena, 3);
+	ASSERT_TRUE(params != NULL);
+	EXPECT_TRUE(arena_owns(arena, params));
+
+	pgdb_bind_c_str("hello", params);
+	EXPECT_EQ(params->lengths[0], 5);
+	EXPECT_EQ(memcmp(params->values[0], "hello", 5), 0);
+	EXPECT_TRUE(arena_owns(arena, params->values[0]));
+
+	pgdb_bind_uint32(7, params);
+	EXPECT_EQ(ntohl(*(uint32_t*) params->values[1]), 7);
+	EXPECT_TRUE(arena_owns(arena, params->values[1]));
+
+	pgdb_bind_null(params);
+	EXPECT_TRUE(params->values[2] == NULL);
+
+	pgdb_params_free(&params);
+	EXPECT_TRUE(params == NULL);
+	arena_free(&arena);
+}
+
+TEST(PGDBParamsTest, TestBorrowAndReset) {
+	pgdb_params_t* params = pgdb_params_new(3);
+	string_t* text = string_from_literal("a text longer than the inline scratch area");
+	string_t* empty = string_new_empty(0);
+
+	pgdb_bind_text_borrowed(text, params);
+	EXPECT_TRUE(params->values[0] == text->ptr);
+	EXPECT_EQ(params->lengths[0], text->length);
+	EXPECT_FALSE(params->owned[0]);
+
+	pgdb_bind_text(text, params);
+	EXPECT_TRUE(params->values[1] != text->ptr);
+	EXPECT_TRUE(params->owned[1]);
+
+	// Empty text is sent as empty string, not as NULL.
+	pgdb_bind_text_borrowed(empty, params);
+	EXPECT_TRUE(params->values[2] != NULL);
+	EXPECT_EQ(params->lengths[2], 0);
+
+	pgdb_params_reset(params);
+	EXPECT_EQ(params->next_index, 0);
+	EXPECT_TRUE(params->values[1] == NULL);
+	EXPECT_FALSE(params->owned[1]);
+
+	uuid_t uuid = {{0x01, 0x02}};
+	pgdb_bind_uuid(&uuid, params);
+	EXPECT_TRUE(params->values[0] == params->scratch[0]);
+	EXPECT_EQ(memcmp(params->values[0], uuid.bin, 16), 0);
+
 	pgdb_params_free(&params);
+	string_free(&text);
+	string_free(&empty);
 }
 
 TEST(PGDBResultTest, TestNewResult) {
@@ -145,10 +351,95 @@ TEST(PGDBResultTest, TestNewResult) {
 	ASSERT_TRUE(result == NULL);
 }
 
+typedef struct decoder_row {
+	uint32_t id;
+	string_t* name;
+	bool active;
+	time_t created;
+	uint64_t size;
+} decoder_row_t;
+
+static const pgdb_column_t decoder_columns[] = {
+	PGDB_COLUMN("id", PGDB_COLUMN_UINT32, decoder_row_t, id),
+	PGDB_COLUMN("name", PGDB_COLUMN_TEXT, decoder_row_t, name),
+	PGDB_COLUMN("active", PGDB_COLUMN_BOOL, decoder_row_t, active),
+	PGDB_COLUMN_OPTIONAL("created", PGDB_COLUMN_TIMESTAMP, decoder_row_t, created),
+	PGDB_COLUMN_OPTIONAL("size", PGDB_COLUMN_UINT64, decoder_row_t, size)
+};
+
+static PGresult* decoder_result() {
+	PGDB_FAKE_RESULT_4(PGRES_TUPLES_OK, "active", "created", "name", "id");
+
+	PGDB_FAKE_BOOL(true);
+	PGDB_FAKE_TIMESTAMP(1000000000);
+	PGDB_FAKE_C_STR("first");
+	PGDB_FAKE_INT(1);
+
+	PGDB_FAKE_NEXT_ROW();
+
+	PGDB_FAKE_BOOL(false);
+	column++;
+	PGDB_FAKE_C_STR("second");
+	PGDB_FAKE_INT(2);
+
+	PGDB_FAKE_NEXT_ROW();
+
+	PGDB_FAKE_BOOL(false);
+	PGDB_FAKE_TIMESTAMP(1000000000);
+	column++;
+	PGDB_FAKE_INT(3);
+
+	PGDB_FAKE_FINISH();
+}
+
+TEST(PGDBResultTest, TestRowDecoder) {
+	pgdb_result_t* result = pgdb_result_new(decoder_result());
+	ASSERT_EQ(PQntuples(result->pg), 3);
+
+	pgdb_row_decoder_t* decoder = pgdb_row_decoder_new(result, decoder_columns, 5);
+	ASSERT_TRUE(decoder != NULL);
+	EXPECT_EQ(decoder->numbers[0], 3);
+	EXPECT_EQ(decoder->numbers[4], -1);
+
+	decoder_row_t row = {};
+	row.size = 42;
+	ASSERT_EQ(pgdb_row_decode(decoder, result, 0, &row), 0);
+	EXPECT_EQ(row.id, 1);
+	ASSERT_TRUE(row.name != NULL);
+	EXPECT_STREQ(row.name->ptr, "first");
+	EXPECT_TRUE(row.active);
+	EXPECT_EQ(row.created, 1000000000);
+	EXPECT_EQ(row.size, 42);
+	string_free(&row.name);
+
+	// NULL in optional column leaves member untouched.
+	row.created = 0;
+	ASSERT_EQ(pgdb_row_decode(decoder, result, 1, &row), 0);
+	EXPECT_EQ(row.id, 2);
+	EXPECT_STREQ(row.name->ptr, "second");
+	EXPECT_FALSE(row.active);
+	EXPECT_EQ(row.created, 0);
+	string_free(&row.name);
+
+	// NULL in required column fails.
+	EXPECT_EQ(pgdb_row_decode(decoder, result, 2, &row), 1);
+	EXPECT_TRUE(row.name == NULL);
+
+	pgdb_row_decoder_free(&decoder);
+	EXPECT_TRUE(decoder == NULL);
+
+	const pgdb_column_t missing[] = {
+		PGDB_COLUMN("size", PGDB_COLUMN_UINT64, decoder_row_t, size)
+	};
+	EXPECT_TRUE(pgdb_row_decoder_new(result, missing, 1) == NULL);
+
+	pgdb_result_free(&result);
+}
+
 TEST_F(RadiclePGDBHooks, TestCreateLimit) {
 	// TODO subhook for pgdb_connect
 	install_pgdb_connect_fake();	
-	pgdb_connection_queue_t* queue = pgdb_connection_queue_new("", 1, 0);
+	pgdb_connection_queue_t* queue = pgdb_connection_queue_new("", 0, 1, 0);
 
 	pgdb_connection_t* claimed = NULL;
 	EXPECT_EQ(pgdb_claim_connection(queue, &claimed), 0);
@@ -166,3 +457,137 @@ TEST_F(RadiclePGDBHooks, TestCreateLimit) {
 	pgdb_connection_queue_free(&queue);
 }
 
+TEST_F(RadiclePGDBHooks, TestPrewarm) {
+	install_pgdb_connect_fake();	
+	pgdb_connection_queue_t* queue = pgdb_connection_queue_new("", 2, 3, 0);
+	EXPECT_TRUE(queue->connections[0].active);
+	EXPECT_TRUE(queue->connections[1].active);
+	EXPECT_FALSE(queue->connections[2].active);
+	pgdb_connection_queue_free(&queue);
+}
+
+TEST_F(RadiclePGDBHooks, TestMaintainRecyclesOldConnections) {
+	install_pgdb_connect_fake();	
+	pgdb_connection_queue_t* queue = pgdb_connection_queue_new("", 1, 2, 60);
+	ASSERT_TRUE(queue->connections[0].active);
+	queue->connections[0].created = time(NULL) - 120;
+
+	pgdb_connection_t* claimed = NULL;
+	EXPECT_EQ(pgdb_claim_connection(queue, &claimed), 0);
+	ASSERT_EQ(claimed, &queue->connections[0]);
+	claimed->created = time(NULL) - 120;
+
+	// Claimed connections are left alone, a second one is opened to satisfy min_connections.
+	pgdb_connection_queue_maintain(queue);
+	EXPECT_TRUE(queue->connections[0].claimed);
+	EXPECT_LT(queue->connections[0].created, time(NULL) - 60);
+	EXPECT_TRUE(queue->connections[1].active);
+
+	pgdb_release_connection(&claimed);
+	queue->connections[1].created = time(NULL) - 120;
+	pgdb_connection_queue_maintain(queue);
+	for(int i = 0; i < 2; i++) {
+		EXPECT_FALSE(queue->connections[i].claimed);
+		if(queue->connections[i].active)
+			EXPECT_GE(queue->connections[i].created, time(NULL) - 60);
+	}
+	pgdb_connection_queue_free(&queue);
+}
+
+TEST_F(RadiclePGDBHooks, TestMaintenanceThread) {
+	install_pgdb_connect_fake();	
+	pgdb_connection_queue_t* queue = pgdb_connection_queue_new("", 0, 1, 0);
+	queue->min_connections = 1;
+	EXPECT_FALSE(queue->connections[0].active);
+	EXPECT_EQ(pgdb_connection_queue_start_maintenance(queue, 10), 0);
+	EXPECT_EQ(pgdb_connection_queue_start_maintenance(queue, 10), 1);
+
+	pgdb_connection_t* claimed = NULL;
+	for(int i = 0; i < 100 && claimed == NULL; i++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		pthread_mutex_lock(&queue->lock);
+		if(queue->connections[0].active)
+			claimed = &queue->connections[0];
+		pthread_mutex_unlock(&queue->lock);
+	}
+	EXPECT_TRUE(claimed != NULL);
+	pgdb_connection_queue_free(&queue);
+	EXPECT_TRUE(queue == NULL);
+}
+
+TEST_F(RadiclePGDBHooks, TestClaimTimeout) {
+	install_pgdb_connect_fake();	
+	pgdb_connection_queue_t* queue = pgdb_connection_queue_new("", 0, 1, 0);
+
+	pgdb_connection_t* claimed = NULL;
+	EXPECT_EQ(pgdb_claim_connection(queue, &claimed), 0);
+	ASSERT_TRUE(claimed != NULL);
+	EXPECT_EQ(claimed->queue, queue);
+
+	auto start = std::chrono::steady_clock::now();
+	pgdb_connection_t* not_claimed = NULL;
+	EXPECT_EQ(pgdb_claim_connection_timed(queue, 50, &not_claimed), 0);
+	EXPECT_TRUE(not_claimed == NULL);
+	EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+	pgdb_release_connection(&claimed);
+	pgdb_connection_queue_free(&queue);
+}
+
+TEST_F(RadiclePGDBHooks, TestClaimWaitsForRelease) {
+	install_pgdb_connect_fake();	
+	pgdb_connection_queue_t* queue = pgdb_connection_queue_new("", 0, 1, 0);
+	queue->claim_timeout = 5000;
+
+	pgdb_connection_t* claimed = NULL;
+	EXPECT_EQ(pgdb_claim_connection(queue, &claimed), 0);
+	ASSERT_TRUE(claimed != NULL);
+	pgdb_connection_t* first = claimed;
+
+	std::thread releaser([&claimed]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		pgdb_release_connection(&claimed);
+	});
+
+	pgdb_connection_t* waited = NULL;
+	EXPECT_EQ(pgdb_claim_connection(queue, &waited), 0);
+	releaser.join();
+	EXPECT_EQ(waited, first);
+
+	pgdb_release_connection(&waited);
+	pgdb_connection_queue_free(&queue);
+}
+
+TEST_F(RadiclePGDBHooks, TestClaimConcurrent) {
+	install_pgdb_connect_fake();	
+	pgdb_connection_queue_t* queue = pgdb_connection_queue_new("", 0, 2, 0);
+	queue->claim_timeout = 5000;
+
+	std::atomic<int> holders(0);
+	std::atomic<int> max_holders(0);
+	std::atomic<int> failures(0);
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 8; t++) {
+		threads.emplace_back([&]() {
+			for(int i = 0; i < 100; i++) {
+				pgdb_connection_t* conn = NULL;
+				if(pgdb_claim_connection(queue, &conn) || conn == NULL) {
+					failures++;
+					continue;
+				}
+				int current = ++holders;
+				int seen = max_holders.load();
+				while(current > seen && !max_holders.compare_exchange_weak(seen, current));
+				holders--;
+				pgdb_release_connection(&conn);
+			}
+		});
+	}
+	for(auto& thread : threads)
+		thread.join();
+
+	EXPECT_EQ(failures.load(), 0);
+	EXPECT_LE(max_holders.load(), 2);
+	pgdb_connection_queue_free(&queue);
+}
+
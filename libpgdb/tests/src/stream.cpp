@@ -0,0 +1,137 @@
+/* LIBRADICLE - The Radicle Library
+ * Copyright (C) 2021 Nils Egger <nilsxegger@gmail.com>
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <libpq-fe.h>
+
+#include "radicle/tests/pgdb_hooks.hpp"
+#include "radicle/pgdb.h"
+#include "radicle/pgdb/stream.h"
+
+/**
+ * @brief Amount of results handed out by StreamGetResult so far.
+ */
+static int stream_results = 0;
+
+/**
+ * @brief If set, the third result is an error instead of a row.
+ */
+static bool stream_fail = false;
+
+static int StreamSendQueryParams(PGconn* conn, const char* command, int nParams, const Oid* paramTypes, const char* const* paramValues, const int* paramLengths, const int* paramFormats, int resultFormat) {
+	stream_results = 0;
+	return 1;
+}
+
+static int StreamSetSingleRowMode(PGconn* conn) {
+	return 1;
+}
+
+static PGcancel* StreamGetCancel(PGconn* conn) {
+	return NULL;
+}
+
+static PGresult* StreamRow(const int id) {
+	PGDB_FAKE_RESULT_2(PGRES_SINGLE_TUPLE, "id", "name");
+	PGDB_FAKE_INT(id);
+	PGDB_FAKE_C_STR("row");
+	PGDB_FAKE_FINISH();
+}
+
+/**
+ * @brief Three single rows, followed by the empty final result and NULL.
+ */
+static PGresult* StreamGetResult(PGconn* conn) {
+	int index = stream_results++;
+	if(index == 2 && stream_fail)
+		return PQmakeEmptyPGresult(NULL, PGRES_FATAL_ERROR);
+	if(index < 3)
+		return StreamRow(index + 1);
+	if(index == 3)
+		return PQmakeEmptyPGresult(NULL, PGRES_TUPLES_OK);
+	return NULL;
+}
+
+class RadiclePGDBStream: public RadiclePGDBHooks {
+	protected:
+
+	void SetUp() override {
+		RadiclePGDBHooks::SetUp();
+		stream_fail = false;
+		install_hook(subhook_new((void*)PQsendQueryParams, (void*)StreamSendQueryParams, SUBHOOK_64BIT_OFFSET));
+		install_hook(subhook_new((void*)PQsetSingleRowMode, (void*)StreamSetSingleRowMode, SUBHOOK_64BIT_OFFSET));
+		install_hook(subhook_new((void*)PQgetResult, (void*)StreamGetResult, SUBHOOK_64BIT_OFFSET));
+		install_hook(subhook_new((void*)PQgetCancel, (void*)StreamGetCancel, SUBHOOK_64BIT_OFFSET));
+	}
+};
+
+TEST_F(RadiclePGDBStream, TestStreamNext) {
+	pgdb_stream_t* stream = pgdb_stream_open(NULL, "SELECT id, name FROM Test;", NULL, 1);
+	ASSERT_TRUE(stream != NULL);
+
+	uint32_t expected = 1;
+	while(pgdb_stream_next(stream)) {
+		uint32_t id = 0;
+		EXPECT_EQ(pgdb_get_uint32(stream->result, stream->row, "id", &id), 0);
+		EXPECT_EQ(id, expected++);
+	}
+	EXPECT_EQ(expected, 4);
+	EXPECT_TRUE(stream->done);
+	EXPECT_FALSE(stream->failed);
+	EXPECT_TRUE(stream->result == NULL);
+	EXPECT_FALSE(pgdb_stream_next(stream));
+
+	pgdb_stream_free(&stream);
+	EXPECT_TRUE(stream == NULL);
+}
+
+TEST_F(RadiclePGDBStream, TestStreamFailure) {
+	stream_fail = true;
+	pgdb_stream_t* stream = pgdb_stream_open(NULL, "SELECT id, name FROM Test;", NULL, 1);
+	ASSERT_TRUE(stream != NULL);
+
+	int rows = 0;
+	while(pgdb_stream_next(stream))
+		rows++;
+	EXPECT_EQ(rows, 2);
+	EXPECT_TRUE(stream->failed);
+	// Remaining results were drained.
+	EXPECT_TRUE(stream->done);
+	EXPECT_EQ(stream_results, 5);
+	pgdb_stream_free(&stream);
+}
+
+static int stream_sum(const pgdb_result_t* result, const int row, void* data) {
+	uint32_t id = 0;
+	pgdb_get_uint32(result, row, "id", &id);
+	*(uint32_t*)data += id;
+	return id == 2 ? *(uint32_t*)data > 100 : 0;
+}
+
+TEST_F(RadiclePGDBStream, TestStreamEach) {
+	uint32_t sum = 0;
+	EXPECT_EQ(pgdb_stream_each(NULL, "SELECT id, name FROM Test;", NULL, 64, stream_sum, &sum), 0);
+	EXPECT_EQ(sum, 6);
+
+	// Callback stops after second row, rest is discarded.
+	sum = 200;
+	EXPECT_EQ(pgdb_stream_each(NULL, "SELECT id, name FROM Test;", NULL, 64, stream_sum, &sum), 1);
+	EXPECT_EQ(sum, 203);
+	EXPECT_EQ(stream_results, 5);
+}